@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/compiler/aot/codegen.h"
 
+#include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -24,6 +26,7 @@ limitations under the License.
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
 #include "absl/types/span.h"
 #include "tensorflow/compiler/aot/embedded_protocol_buffers.h"
 #include "tensorflow/compiler/tf2xla/tf2xla.pb.h"
@@ -475,6 +478,41 @@ Status GenerateHeader(const CodegenOpts& opts, const tf2xla::Config& config,
             "profile_counters_size());"
           : "";
 
+  // With feature variants, the entry point is chosen from the features of the
+  // CPU when the static data is first used.
+  string include_cpu_info, variant_entry_decls, select_raw_function;
+  string raw_function = compile_result.entry_point;
+  if (!compile_result.variants.empty()) {
+    include_cpu_info =
+        "#include \"tensorflow/core/platform/cpu_info.h\"\n";
+    raw_function = "SelectRawFunction()";
+    select_raw_function =
+        "  // Returns the variant of the entry point for the features of the "
+        "CPU.\n"
+        "  static RawFunction SelectRawFunction() {\n";
+    for (const CompileResult::Variant& variant : compile_result.variants) {
+      absl::StrAppend(
+          &variant_entry_decls, "\n// (Implementation detail) Entry point ",
+          "compiled for ", variant.feature_variant.target_features, ".\n",
+          "extern \"C\" void ", variant.entry_point, "(\n",
+          "    void* result, const ::xla::ExecutableRunOptions* run_options,\n",
+          "    const void** args, void** temps, tensorflow::int64* "
+          "profile_counters);\n");
+      std::vector<string> feature_tests;
+      for (const string& cpu_feature : variant.feature_variant.cpu_features) {
+        feature_tests.push_back(
+            absl::StrCat("::tensorflow::port::TestCPUFeature(",
+                         "::tensorflow::port::", cpu_feature, ")"));
+      }
+      absl::StrAppend(&select_raw_function, "    if (",
+                      absl::StrJoin(feature_tests, " &&\n        "),
+                      ") {\n      return ", variant.entry_point,
+                      ";\n    }\n");
+    }
+    absl::StrAppend(&select_raw_function, "    return ",
+                    compile_result.entry_point, ";\n  }\n\n");
+  }
+
   // Use a poor-man's text templating mechanism; first populate the full header
   // with placeholder tokens, and then rewrite the tokens with real values.
   *header =
@@ -492,7 +530,7 @@ Status GenerateHeader(const CodegenOpts& opts, const tf2xla::Config& config,
 {{INCLUDE_XLA_DATA_PROTO}}
 {{INCLUDE_HLO_PROFILE_PRINTER_DATA_PROTO}}
 #include "tensorflow/compiler/tf2xla/xla_compiled_cpu_function.h"
-#include "tensorflow/core/platform/types.h"
+{{INCLUDE_CPU_INFO}}#include "tensorflow/core/platform/types.h"
 
 namespace Eigen { struct ThreadPoolDevice; }
 namespace xla { class ExecutableRunOptions; }
@@ -501,7 +539,7 @@ namespace xla { class ExecutableRunOptions; }
 extern "C" void {{ENTRY}}(
     void* result, const ::xla::ExecutableRunOptions* run_options,
     const void** args, void** temps, tensorflow::int64* profile_counters);
-
+{{VARIANT_ENTRY_DECLS}}
 {{DECLS_FROM_OBJ_FILE}}
 
 {{NS_START}}
@@ -554,7 +592,7 @@ class {{CLASS}} final : public tensorflow::XlaCompiledCpuFunction {
     static XlaCompiledCpuFunction::StaticData* kStaticData = [](){
       XlaCompiledCpuFunction::StaticData* data =
         new XlaCompiledCpuFunction::StaticData;
-      set_static_data_raw_function(data, {{ENTRY}});
+      set_static_data_raw_function(data, {{RAW_FUNCTION}});
       set_static_data_buffer_infos(data, BufferInfos());
       set_static_data_num_buffers(data, kNumBuffers);
       set_static_data_arg_index_table(data, ArgIndexToBufferIndex());
@@ -641,7 +679,7 @@ class {{CLASS}} final : public tensorflow::XlaCompiledCpuFunction {
 {{METHODS_VARIABLE}}
 
  private:
-  // Number of buffers for the compiled computation.
+{{SELECT_RAW_FUNCTION}}  // Number of buffers for the compiled computation.
   static constexpr size_t kNumBuffers = {{NUM_BUFFERS}};
 
   static const ::xla::cpu_function_runtime::BufferInfo* BufferInfos() {
@@ -705,6 +743,7 @@ class {{CLASS}} final : public tensorflow::XlaCompiledCpuFunction {
       {"{{ENTRY}}", compile_result.entry_point},
       {"{{HLO_PROFILE_PRINTER_DATA_SHIM_EXPRESSION}}",
        metadata_result.hlo_profile_printer_data_access_shim},
+      {"{{INCLUDE_CPU_INFO}}", include_cpu_info},
       {"{{INCLUDE_XLA_DATA_PROTO}}", include_xla_data_proto},
       {"{{INCLUDE_HLO_PROFILE_PRINTER_DATA_PROTO}}",
        include_hlo_profile_printer_data_proto},
@@ -714,11 +753,14 @@ class {{CLASS}} final : public tensorflow::XlaCompiledCpuFunction {
       {"{{NS_END}}\n", ns_end},
       {"{{NS_START}}\n", ns_start},
       {"{{PROGRAM_SHAPE}}", xla::ShapeUtil::HumanString(xla::ProgramShape(ps))},
+      {"{{RAW_FUNCTION}}", raw_function},
       {"{{PROGRAM_SHAPE_SHIM_EXPRESSION}}",
        metadata_result.program_shape_access_shim},
       {"{{VARIABLE_NAMES_CODE}}", variable_names_code},
+      {"{{VARIANT_ENTRY_DECLS}}", variant_entry_decls},
       {"{{RESULT_INDEX}}", absl::StrCat(result_index)},
       {"{{RESULT_NAMES_CODE}}", result_names_code},
+      {"{{SELECT_RAW_FUNCTION}}", select_raw_function},
       {"{{TEMP_BYTES_ALIGNED}}", absl::StrCat(temp_bytes_aligned)},
       {"{{TEMP_BYTES_TOTAL}}", absl::StrCat(temp_bytes_total)},
       {"{{NUM_BUFFERS}}", absl::StrCat(buffer_infos.size())},
@@ -811,6 +853,91 @@ Status ParseCppClass(const string& cpp_class, string* class_name,
   return Status::OK();
 }
 
+// Returns the name of the tensorflow::port::CPUFeature which tells whether the
+// CPU supports the LLVM target feature `llvm_feature`, or null if there is
+// none.
+static const char* CpuFeatureForLlvmFeature(absl::string_view llvm_feature) {
+  static const auto* const kCpuFeatures =
+      new std::map<absl::string_view, const char*>({
+          {"adx", "ADX"},
+          {"aes", "AES"},
+          {"avx", "AVX"},
+          {"avx2", "AVX2"},
+          {"avx5124fmaps", "AVX512_4FMAPS"},
+          {"avx5124vnniw", "AVX512_4VNNIW"},
+          {"avx512bw", "AVX512BW"},
+          {"avx512cd", "AVX512CD"},
+          {"avx512dq", "AVX512DQ"},
+          {"avx512er", "AVX512ER"},
+          {"avx512f", "AVX512F"},
+          {"avx512ifma", "AVX512IFMA"},
+          {"avx512pf", "AVX512PF"},
+          {"avx512vbmi", "AVX512VBMI"},
+          {"avx512vl", "AVX512VL"},
+          {"bmi", "BMI1"},
+          {"bmi2", "BMI2"},
+          {"f16c", "F16C"},
+          {"fma", "FMA"},
+          {"pclmul", "PCLMULQDQ"},
+          {"popcnt", "POPCNT"},
+          {"rdrnd", "RDRAND"},
+          {"rdseed", "RDSEED"},
+          {"sse3", "SSE3"},
+          {"sse4.1", "SSE4_1"},
+          {"sse4.2", "SSE4_2"},
+          {"ssse3", "SSSE3"},
+      });
+  auto it = kCpuFeatures->find(llvm_feature);
+  return it == kCpuFeatures->end() ? nullptr : it->second;
+}
+
+Status ParseFeatureVariants(const string& spec,
+                            std::vector<FeatureVariant>* variants) {
+  variants->clear();
+  if (spec.empty()) {
+    return Status::OK();
+  }
+  std::set<string> names;
+  for (absl::string_view variant_spec : absl::StrSplit(spec, ';')) {
+    std::vector<absl::string_view> parts =
+        absl::StrSplit(variant_spec, absl::MaxSplits(':', 1));
+    if (parts.size() != 2 || parts[1].empty()) {
+      return errors::InvalidArgument(
+          "expected <name>:<features> in target_feature_variants: ",
+          variant_spec);
+    }
+    FeatureVariant variant;
+    variant.name = string(parts[0]);
+    variant.target_features = string(parts[1]);
+    TF_RETURN_IF_ERROR(ValidateCppIdent(
+        variant.name, "in variant name of target_feature_variants: " + spec));
+    if (!names.insert(variant.name).second) {
+      return errors::InvalidArgument(
+          "duplicate variant name in target_feature_variants: ", variant.name);
+    }
+    for (absl::string_view feature : absl::StrSplit(parts[1], ',')) {
+      if (absl::ConsumePrefix(&feature, "-")) {
+        // Disabled features don't need any runtime check.
+        continue;
+      }
+      absl::ConsumePrefix(&feature, "+");
+      const char* cpu_feature = CpuFeatureForLlvmFeature(feature);
+      if (cpu_feature == nullptr) {
+        return errors::InvalidArgument(
+            "target feature '", feature, "' of variant ", variant.name,
+            " can't be detected at runtime");
+      }
+      variant.cpu_features.push_back(cpu_feature);
+    }
+    if (variant.cpu_features.empty()) {
+      return errors::InvalidArgument("variant ", variant.name,
+                                     " doesn't enable any target feature");
+    }
+    variants->push_back(std::move(variant));
+  }
+  return Status::OK();
+}
+
 Status ValidateCppIdent(absl::string_view ident, absl::string_view msg) {
   if (ident.empty()) {
     return errors::InvalidArgument("empty identifier: ", msg);
@@ -94,6 +94,14 @@ Status GenerateHeader(const CodegenOpts& opts, const tf2xla::Config& config,
 Status ParseCppClass(const string& cpp_class, string* class_name,
                      std::vector<string>* namespaces);
 
+// ParseFeatureVariants parses `spec`, the value of --target_feature_variants,
+// into `variants`.  The syntax is <name>:<features>[;<name>:<features>...],
+// where each name is a valid C++ identifier, and features is a comma-separated
+// list of LLVM target features such as +avx2.  Every enabled feature must have
+// a tensorflow::port::CPUFeature counterpart, to detect it at runtime.
+Status ParseFeatureVariants(const string& spec,
+                            std::vector<FeatureVariant>* variants);
+
 // ValidateCppIdent returns OK iff ident is a valid C++ identifier.  The msg is
 // appended to error messages.
 Status ValidateCppIdent(absl::string_view ident, absl::string_view msg);
@@ -139,6 +139,39 @@ TEST_F(ParseCppClassTest, ParseFail) {
   ExpectFail("good::0bad");
 }
 
+TEST(ParseFeatureVariants, ParseOK) {
+  std::vector<FeatureVariant> variants;
+  TF_EXPECT_OK(ParseFeatureVariants("", &variants));
+  EXPECT_TRUE(variants.empty());
+
+  TF_EXPECT_OK(ParseFeatureVariants(
+      "avx512:+avx512f,+avx512bw;avx2:+avx2,+fma,-avx512f", &variants));
+  ASSERT_EQ(variants.size(), 2);
+  EXPECT_EQ(variants[0].name, "avx512");
+  EXPECT_EQ(variants[0].target_features, "+avx512f,+avx512bw");
+  EXPECT_EQ(variants[0].cpu_features,
+            std::vector<string>({"AVX512F", "AVX512BW"}));
+  EXPECT_EQ(variants[1].name, "avx2");
+  EXPECT_EQ(variants[1].target_features, "+avx2,+fma,-avx512f");
+  EXPECT_EQ(variants[1].cpu_features, std::vector<string>({"AVX2", "FMA"}));
+}
+
+TEST(ParseFeatureVariants, ParseFail) {
+  std::vector<FeatureVariant> variants;
+  ExpectErrorContains(ParseFeatureVariants("avx2", &variants),
+                      "expected <name>:<features>");
+  ExpectErrorContains(ParseFeatureVariants("avx2:", &variants),
+                      "expected <name>:<features>");
+  ExpectErrorContains(ParseFeatureVariants("0avx2:+avx2", &variants),
+                      "illegal leading char");
+  ExpectErrorContains(ParseFeatureVariants("a:+avx2;a:+fma", &variants),
+                      "duplicate variant name");
+  ExpectErrorContains(ParseFeatureVariants("neon:+neon", &variants),
+                      "can't be detected at runtime");
+  ExpectErrorContains(ParseFeatureVariants("noavx:-avx", &variants),
+                      "doesn't enable any target feature");
+}
+
 static void CompareWithGoldenFile(
     const string& tensorflow_relative_golden_file_name,
     const string& expected_contents, bool ignore_cr) {
@@ -264,6 +297,70 @@ TEST(CodegenTest, Golden) {
   CompareWithGoldenFile("tensorflow/compiler/aot/codegen_test_h.golden", header,
                         true);
 }
+
+TEST(CodegenTest, FeatureVariants) {
+  LLVMInitializeX86Target();
+  LLVMInitializeX86TargetInfo();
+  LLVMInitializeX86TargetMC();
+  LLVMInitializeX86AsmPrinter();
+
+  CodegenOpts opts;
+  opts.class_name = "MyClass";
+  opts.target_triple = "x86_64-pc-linux";
+  tf2xla::Config config;
+  config.add_feed()->mutable_id()->set_node_name("feed0");
+  config.add_fetch()->mutable_id()->set_node_name("fetch0");
+  CompileResult compile_result;
+  compile_result.aot.reset(new xla::cpu::CpuAotCompilationResult(
+      {},
+      {BufferInfo::MakeEntryParameter(/*size=*/8, /*param_number=*/0),
+       BufferInfo::MakeTempBuffer(8)},
+      1, {}));
+  compile_result.program_shape =
+      xla::ShapeUtil::MakeProgramShape(
+          {xla::ShapeUtil::MakeShape(xla::F32, {2})},
+          xla::ShapeUtil::MakeTupleShape(
+              {xla::ShapeUtil::MakeShape(xla::F32, {2})}))
+          .ToProto();
+  compile_result.entry_point = "entry_point";
+  compile_result.pointer_size = 8;
+  std::vector<FeatureVariant> feature_variants;
+  TF_ASSERT_OK(ParseFeatureVariants(
+      "avx512:+avx512f;avx2:+avx2,+fma", &feature_variants));
+  for (FeatureVariant& feature_variant : feature_variants) {
+    CompileResult::Variant variant;
+    variant.entry_point = "entry_point_" + feature_variant.name;
+    variant.feature_variant = std::move(feature_variant);
+    compile_result.variants.push_back(std::move(variant));
+  }
+
+  MetadataResult metadata_result;
+  TF_ASSERT_OK(GenerateMetadata(opts, compile_result, &metadata_result));
+  string header;
+  TF_ASSERT_OK(
+      GenerateHeader(opts, config, compile_result, metadata_result, &header));
+
+  EXPECT_TRUE(absl::StrContains(
+      header, "#include \"tensorflow/core/platform/cpu_info.h\""));
+  EXPECT_TRUE(absl::StrContains(header, "extern \"C\" void entry_point("));
+  EXPECT_TRUE(
+      absl::StrContains(header, "extern \"C\" void entry_point_avx512("));
+  EXPECT_TRUE(absl::StrContains(header, "extern \"C\" void entry_point_avx2("));
+  EXPECT_TRUE(absl::StrContains(
+      header, "set_static_data_raw_function(data, SelectRawFunction());"));
+  EXPECT_TRUE(absl::StrContains(
+      header,
+      "    if (::tensorflow::port::TestCPUFeature("
+      "::tensorflow::port::AVX2) &&\n"
+      "        ::tensorflow::port::TestCPUFeature("
+      "::tensorflow::port::FMA)) {\n"
+      "      return entry_point_avx2;\n"
+      "    }\n"
+      "    return entry_point;\n"));
+  // The variants are tried in order.
+  EXPECT_LT(header.find("return entry_point_avx512;"),
+            header.find("return entry_point_avx2;"));
+}
 }  // namespace
 }  // namespace tfcompile
 }  // namespace tensorflow
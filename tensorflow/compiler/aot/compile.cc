@@ -21,6 +21,8 @@ limitations under the License.
 #include <vector>
 
 #include "absl/base/call_once.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "llvm-c/Target.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "tensorflow/compiler/aot/codegen.h"
@@ -148,7 +150,42 @@ Status CompileGraph(GraphDef graph_def, const tf2xla::Config& config,
       flags.entry_point,
       xla::cpu::CpuAotCompilationOptions::RelocationModel::BigPic);
 
-  return CompileXla(client, computation, aot_opts, compile_result);
+  std::vector<FeatureVariant> feature_variants;
+  TF_RETURN_IF_ERROR(
+      ParseFeatureVariants(flags.target_feature_variants, &feature_variants));
+
+  TF_RETURN_IF_ERROR(CompileXla(client, computation, aot_opts, compile_result));
+  for (FeatureVariant& feature_variant : feature_variants) {
+    const string target_features =
+        flags.target_features.empty()
+            ? feature_variant.target_features
+            : absl::StrCat(flags.target_features, ",",
+                           feature_variant.target_features);
+    xla::cpu::CpuAotCompilationOptions variant_aot_opts(
+        flags.target_triple, flags.target_cpu, target_features,
+        absl::StrCat(flags.entry_point, "_", feature_variant.name),
+        xla::cpu::CpuAotCompilationOptions::RelocationModel::BigPic);
+    CompileResult variant_result;
+    TF_RETURN_IF_ERROR(
+        CompileXla(client, computation, variant_aot_opts, &variant_result));
+    // The generated class allocates the buffers of the baseline function, and
+    // passes them to whichever variant runs.
+    if (variant_result.aot->buffer_infos() !=
+            compile_result->aot->buffer_infos() ||
+        variant_result.aot->result_buffer_index() !=
+            compile_result->aot->result_buffer_index()) {
+      return errors::FailedPrecondition(
+          "Variant ", feature_variant.name,
+          " was assigned different buffers than the baseline function; it "
+          "can't be dispatched to through the same generated class.");
+    }
+    CompileResult::Variant variant;
+    variant.feature_variant = std::move(feature_variant);
+    variant.aot = std::move(variant_result.aot);
+    variant.entry_point = std::move(variant_result.entry_point);
+    compile_result->variants.push_back(std::move(variant));
+  }
+  return Status::OK();
 }
 
 static Status ReadProtoFile(const string& fname, protobuf::Message* proto) {
@@ -246,6 +283,23 @@ Status Main(const MainFlags& flags) {
   TF_RETURN_IF_ERROR(
       WriteStringToFile(env, flags.out_function_object,
                         absl::string_view(obj.data(), obj.size())));
+  const std::vector<string> variant_objects =
+      absl::StrSplit(flags.out_function_variant_objects, ',',
+                     absl::SkipEmpty());
+  if (variant_objects.size() != compile_result.variants.size()) {
+    return errors::InvalidArgument(
+        "Must specify one --out_function_variant_objects file per "
+        "--target_feature_variants entry, got ",
+        variant_objects.size(), " for ", compile_result.variants.size(),
+        " variants");
+  }
+  for (int i = 0; i < variant_objects.size(); ++i) {
+    const std::vector<char>& variant_obj =
+        compile_result.variants[i].aot->object_file_data();
+    TF_RETURN_IF_ERROR(WriteStringToFile(
+        env, variant_objects[i],
+        absl::string_view(variant_obj.data(), variant_obj.size())));
+  }
   CodegenOpts codegen_opts;
   codegen_opts.gen_name_to_index = flags.gen_name_to_index;
   codegen_opts.gen_program_shape = flags.gen_program_shape;
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "tensorflow/compiler/aot/flags.h"
 #include "tensorflow/compiler/tf2xla/tf2xla.pb.h"
@@ -28,6 +29,19 @@ limitations under the License.
 namespace tensorflow {
 namespace tfcompile {
 
+// FeatureVariant describes a variant of the generated function, compiled for
+// CPUs with more features than the baseline target.  See the
+// --target_feature_variants flag.
+struct FeatureVariant {
+  // Suffix of the entry point of the variant, e.g. "avx2".
+  string name;
+  // LLVM target features the variant is compiled with, e.g. "+avx2,+fma".
+  string target_features;
+  // Names of the tensorflow::port::CPUFeature values the CPU must support to
+  // run the variant, e.g. {"AVX2", "FMA"}.
+  std::vector<string> cpu_features;
+};
+
 // CompileResult describes the output of CompileGraph, where the object file
 // data and meta-information is available in aot.
 struct CompileResult {
@@ -36,6 +50,19 @@ struct CompileResult {
   xla::ProgramShapeProto program_shape;  // Static shape of args and results.
   string entry_point;                    // Name of generated function.
   int pointer_size = 0;                  // Size of a pointer in bytes.
+
+  // A variant of the generated function, in its own object file.  Variants
+  // use the same buffers as the baseline function in aot, so that any of them
+  // may be called through the same generated class.
+  struct Variant {
+    FeatureVariant feature_variant;
+    std::unique_ptr<xla::cpu::CpuAotCompilationResult> aot;
+    string entry_point;  // Name of the generated function of the variant.
+  };
+  // The variants of the generated function, in order of preference.  The
+  // generated class calls the first one which the CPU supports, or the
+  // baseline function if there is none.
+  std::vector<Variant> variants;
 };
 
 // CompileGraph compiles the graph_def into an object file containing a function
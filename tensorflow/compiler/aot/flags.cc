@@ -55,6 +55,14 @@ void AppendMainFlags(std::vector<Flag>* flag_list, MainFlags* flags) {
        "http://clang.llvm.org/docs/CrossCompilation.html#cpu-fpu-abi"},
       {"target_features", &flags->target_features,
        "Target features, e.g. +avx2, +neon, etc."},
+      {"target_feature_variants", &flags->target_feature_variants,
+       "Variants of the generated function to compile for CPUs with more "
+       "features than the target, in order of preference.  The syntax of "
+       "this flag is <name>:<features>[;<name>:<features>...], e.g. "
+       "avx512:+avx512f,+avx512dq,+avx512bw,+avx512vl;avx2:+avx2,+fma.  Each "
+       "variant is compiled with the given features added to "
+       "--target_features, and the generated class calls the first variant "
+       "whose features the CPU supports.  x86 only."},
       {"entry_point", &flags->entry_point,
        "Name of the generated function.  If multiple generated object files "
        "will be linked into the same binary, each will need a unique entry "
@@ -69,6 +77,10 @@ void AppendMainFlags(std::vector<Flag>* flag_list, MainFlags* flags) {
       {"out_function_object", &flags->out_function_object,
        "Output object file containing the generated function for the "
        "TensorFlow model."},
+      {"out_function_variant_objects", &flags->out_function_variant_objects,
+       "Comma-separated output object files containing the variants of the "
+       "generated function, one per --target_feature_variants entry, in the "
+       "same order."},
       {"out_header", &flags->out_header, "Output header file name."},
       {"out_metadata_object", &flags->out_metadata_object,
        "Output object file name containing optional metadata for the generated "
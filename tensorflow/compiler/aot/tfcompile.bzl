@@ -40,6 +40,7 @@ def tf_library(
         enable_xla_hlo_profiling = False,
         enable_tracemes = False,
         mlir_components = "None",
+        target_feature_variants = None,
         deps = None,
         tags = []):
     """Runs tfcompile to compile a TensorFlow graph into executable code with fast
@@ -96,6 +97,12 @@ def tf_library(
         Xprof to construct profiler timelines.
       mlir_components: When the value is "None", no components use MLIR. When
         the value is "Bridge", use MLIR to translate GraphDef to HLO.
+      target_feature_variants: A list of "<name>:<target features>" strings,
+        e.g. ["avx512:+avx512f,+avx512dq,+avx512bw,+avx512vl",
+        "avx2:+avx2,+fma"].  Each entry compiles a variant of the computation
+        with these LLVM target features, into the same library.  The generated
+        class calls the first variant whose features the CPU supports, or the
+        baseline computation.
       deps: a list of deps to include on the build rules for the generated
         library, added to the standard deps if standard_runtime_deps is True.
       tags: tags to apply to subsidiary build rules.
@@ -171,6 +178,20 @@ def tf_library(
     header_file = name + ".h"
     metadata_object_file = name + "_tfcompile_metadata.o"
     function_object_file = name + "_tfcompile_function.o"
+    variant_object_files = [
+        name + "_tfcompile_function_" + variant.split(":", 1)[0] + ".o"
+        for variant in (target_feature_variants or [])
+    ]
+    variants_flag = ""
+    if target_feature_variants:
+        variants_flag = (
+            " '--target_feature_variants=" +
+            ";".join(target_feature_variants) + "'" +
+            " --out_function_variant_objects=" + ",".join([
+                "$(@D)/" + f
+                for f in variant_object_files
+            ])
+        )
 
     # The XLA backends morph kernal name prefix __ that is not in the form of
     # __xla_.
@@ -226,7 +247,7 @@ def tf_library(
             header_file,
             metadata_object_file,
             function_object_file,
-        ],
+        ] + variant_object_files,
         cmd = (
             default_fast_math_xla_flags +
             "CUDA_VISIBLE_DEVICES='' " +
@@ -240,6 +261,7 @@ def tf_library(
             " --out_header=$(@D)/" + header_file +
             " --out_metadata_object=$(@D)/" + metadata_object_file +
             " --out_function_object=$(@D)/" + function_object_file +
+            variants_flag +
             " " + flags + " " + profiling_flag + " " + mlir_flag + " " + traceme_flag
         ),
         tools = [tfcompile_tool],
@@ -292,7 +314,8 @@ def tf_library(
     # kernel implementations.
     native.cc_library(
         name = name,
-        srcs = [function_object_file, metadata_object_file],
+        srcs = [function_object_file, metadata_object_file] +
+               variant_object_files,
         hdrs = [header_file],
         visibility = visibility,
         testonly = testonly,
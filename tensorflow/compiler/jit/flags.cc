@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/compiler/jit/flags.h"
 
+#include <algorithm>
 #include <mutex>  // NOLINT
 
 #include "absl/base/call_once.h"
@@ -163,6 +164,8 @@ void AllocateAndParseFlags() {
 
   ops_flags = new XlaOpsCommonFlags;
   ops_flags->tf_xla_always_defer_compilation = false;
+  ops_flags->tf_xla_shape_bucketing_dims = {0};
+  ops_flags->tf_xla_compilation_cache_capacity = 0;
 
   jitter_flags = new IntroduceFloatingPointJitterPassFlags;
   jitter_flags->jitter_amount = 1e-5;
@@ -175,6 +178,28 @@ void AllocateAndParseFlags() {
     return true;
   };
 
+  // Parses a comma-separated list of non-negative integers into `values`.
+  auto parse_int_list = [](const string& sequence, std::vector<int64>* values) {
+    values->clear();
+    for (absl::string_view item :
+         absl::StrSplit(sequence, ',', absl::SkipEmpty())) {
+      int64 value;
+      if (!absl::SimpleAtoi(item, &value) || value < 0) {
+        return false;
+      }
+      values->push_back(value);
+    }
+    return true;
+  };
+  auto setter_for_shape_buckets = [parse_int_list](string sequence) {
+    std::vector<int64>* buckets = &ops_flags->tf_xla_shape_buckets;
+    return parse_int_list(sequence, buckets) &&
+           std::is_sorted(buckets->begin(), buckets->end());
+  };
+  auto setter_for_shape_bucketing_dims = [parse_int_list](string sequence) {
+    return parse_int_list(sequence, &ops_flags->tf_xla_shape_bucketing_dims);
+  };
+
   flag_list = new std::vector<Flag>(
       {Flag("tf_xla_enable_lazy_compilation",
             &build_ops_flags->tf_xla_enable_lazy_compilation, ""),
@@ -207,6 +232,22 @@ void AllocateAndParseFlags() {
 
        Flag("tf_xla_always_defer_compilation",
             &ops_flags->tf_xla_always_defer_compilation, ""),
+       Flag("tf_xla_shape_buckets", setter_for_shape_buckets, "",
+            "Comma-separated, increasing sizes of the shape buckets which the "
+            "dimensions in --tf_xla_shape_bucketing_dims of XLA cluster inputs "
+            "are padded to, so that inputs of different sizes share one "
+            "compiled executable.  Padded dimensions are compiled as dynamic "
+            "dimensions, and the padding is masked out.  Empty disables "
+            "bucketing."),
+       Flag("tf_xla_shape_bucketing_dims", setter_for_shape_bucketing_dims,
+            "0",
+            "Comma-separated dimensions of XLA cluster inputs which are padded "
+            "to the buckets in --tf_xla_shape_buckets."),
+       Flag("tf_xla_compilation_cache_capacity",
+            &ops_flags->tf_xla_compilation_cache_capacity,
+            "The maximum number of executables in the XLA JIT compilation "
+            "cache, after which the least recently used ones are evicted.  0 "
+            "means unbounded."),
 
        Flag("tf_introduce_floating_point_jitter_to_tensors",
             setter_for_jitter_tensor_names, "",
@@ -97,6 +97,23 @@ struct XlaOpsCommonFlags {
   // If true, _XlaCompile always refuses to compile the cluster, which means the
   // XLA clusters always run in the TF executor.  Defaults to false.
   bool tf_xla_always_defer_compilation;
+
+  // If non-empty, the sizes, in increasing order, of the shape buckets which
+  // the dimensions in `tf_xla_shape_bucketing_dims` of cluster inputs are
+  // padded to, so that inputs of different sizes share one executable. The
+  // padded dimensions are compiled as dynamic dimensions bounded by the
+  // bucket, so that the padding is masked out. Dimensions larger than the
+  // largest bucket are not padded.
+  std::vector<int64> tf_xla_shape_buckets;
+
+  // The dimensions of cluster inputs which are padded to shape buckets.
+  // Defaults to the leading dimension.
+  std::vector<int64> tf_xla_shape_bucketing_dims;
+
+  // The maximum number of executables the XLA JIT compilation cache holds;
+  // beyond it, the least recently used executables are evicted. 0 means
+  // unbounded.
+  int64 tf_xla_compilation_cache_capacity;
 };
 
 // Flags for the build_xla_ops pass.
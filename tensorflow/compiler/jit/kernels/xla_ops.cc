@@ -108,10 +108,12 @@ class XlaExecutableClosure {
   explicit XlaExecutableClosure(
       xla::LocalClient* client, xla::LocalExecutable* executable,
       const XlaCompiler::CompilationResult* compilation_result,
+      XlaCompilationCache::EntryRef cache_entry,
       ResourceVarsSnapshot resource_var_snapshots, int num_constant_args)
       : client_(client),
         executable_(executable),
         compilation_result_(compilation_result),
+        cache_entry_(std::move(cache_entry)),
         resource_var_snapshots_(std::move(resource_var_snapshots)),
         num_constant_args_(num_constant_args) {}
 
@@ -132,6 +134,9 @@ class XlaExecutableClosure {
   xla::LocalClient* client_;
   xla::LocalExecutable* executable_;
   const XlaCompiler::CompilationResult* compilation_result_;
+  // Keeps `executable_` and `compilation_result_` alive if they are evicted
+  // from the compilation cache.
+  XlaCompilationCache::EntryRef cache_entry_;
   ResourceVarsSnapshot resource_var_snapshots_;
   int num_constant_args_;
 
@@ -223,7 +228,8 @@ static Status BuildCompilationCache(OpKernelContext* ctx,
   if (platform_info.xla_device_metadata()) {
     *cache = new XlaCompilationCache(
         platform_info.xla_device_metadata()->client(),
-        platform_info.xla_device_metadata()->jit_device_type());
+        platform_info.xla_device_metadata()->jit_device_type(),
+        GetXlaOpsCommonFlags().tf_xla_compilation_cache_capacity);
     return Status::OK();
   }
 
@@ -269,7 +275,8 @@ static Status BuildCompilationCache(OpKernelContext* ctx,
                                    platform_info.device_type().type());
   }
   *cache = new XlaCompilationCache(
-      client.ValueOrDie(), DeviceType(registration->compilation_device_name));
+      client.ValueOrDie(), DeviceType(registration->compilation_device_name),
+      GetXlaOpsCommonFlags().tf_xla_compilation_cache_capacity);
   return Status::OK();
 }
 
@@ -279,7 +286,8 @@ static Status CompileToLocalExecutable(
     absl::Span<VariableInfo const> variable_infos,
     absl::Span<const int> constants, bool lazy, xla::LocalClient** client,
     const XlaCompiler::CompilationResult** compilation_result,
-    xla::LocalExecutable** executable) {
+    xla::LocalExecutable** executable,
+    XlaCompilationCache::EntryRef* cache_entry) {
   // We store information about the JIT-compiled XLA computation
   // in the ResourceMgr.
   ResourceMgr* rm = ctx->resource_manager();
@@ -318,10 +326,15 @@ static Status CompileToLocalExecutable(
     options.shape_representation_fn =
         platform_info.xla_device_metadata()->shape_representation_fn();
   }
+  // Inputs padded to shape buckets are copied into buffers that only live
+  // until the computation completes, so they must not be passed through.
+  const XlaOpsCommonFlags& flags = GetXlaOpsCommonFlags();
+  const bool bucket_shapes = !flags.tf_xla_shape_buckets.empty() &&
+                             !platform_info.is_on_xla_device();
   // If reference variables are not present in the graph, we can safely alias
   // passthrough parameters without performing a copy.
   options.alias_passthrough_params =
-      !has_ref_vars && !platform_info.is_on_xla_device();
+      !has_ref_vars && !platform_info.is_on_xla_device() && !bucket_shapes;
 
   std::map<int, Tensor> constant_args;
   for (int i : constants) {
@@ -336,10 +349,14 @@ static Status CompileToLocalExecutable(
   std::vector<XlaCompiler::Argument> args;
   TF_RETURN_IF_ERROR(XlaComputationLaunchContext::BuildXlaCompilerArguments(
       constant_args, variable_infos, ctx, &args));
+  if (bucket_shapes) {
+    TF_RETURN_IF_ERROR(XlaCompilationCache::PadArgumentsToShapeBuckets(
+        flags.tf_xla_shape_buckets, flags.tf_xla_shape_bucketing_dims, &args));
+  }
   return cache->Compile(options, function, args, compile_options,
                         lazy ? XlaCompilationCache::CompileMode::kLazy
                              : XlaCompilationCache::CompileMode::kStrict,
-                        compilation_result, executable);
+                        compilation_result, executable, cache_entry);
 }
 
 void XlaLocalLaunchBase::Compute(OpKernelContext* ctx) {
@@ -349,6 +366,7 @@ void XlaLocalLaunchBase::Compute(OpKernelContext* ctx) {
   xla::LocalClient* client;
   const XlaCompiler::CompilationResult* compilation_result;
   xla::LocalExecutable* executable;
+  XlaCompilationCache::EntryRef cache_entry;
 
   ResourceVarsSnapshot variables_snapshot;
   {
@@ -359,7 +377,7 @@ void XlaLocalLaunchBase::Compute(OpKernelContext* ctx) {
     Status s = CompileToLocalExecutable(
         ctx, function_, /*has_ref_vars=*/has_ref_vars_, platform_info_,
         variable_infos, constants_, /*lazy=*/false, &client,
-        &compilation_result, &executable);
+        &compilation_result, &executable, &cache_entry);
     OP_REQUIRES_OK(ctx, s);
     OP_REQUIRES_OK(ctx,
                    SnapshotResourceVariables(ctx, resources_, variable_infos,
@@ -378,8 +396,9 @@ void XlaLocalLaunchBase::Compute(OpKernelContext* ctx) {
       client, allocator,
       /*allocate_xla_tensors=*/platform_info_.is_on_xla_device(),
       platform_info_.UseMultipleStreams());
-  launch_context.PopulateInputs(ctx, compilation_result, variables_snapshot,
-                                /*missing_ctx_input_prefix=*/0);
+  OP_REQUIRES_OK(ctx, launch_context.PopulateInputs(
+                          ctx, compilation_result, variables_snapshot,
+                          /*missing_ctx_input_prefix=*/0));
 
   // Execute the computation.
   VLOG(2) << "Executing computation.";
@@ -500,6 +519,7 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
   xla::LocalClient* client;
   const XlaCompiler::CompilationResult* kernel;
   xla::LocalExecutable* executable;
+  XlaCompilationCache::EntryRef cache_entry;
   ResourceVarsSnapshot variables;
 
   bool cannot_compile_cluster;
@@ -519,7 +539,8 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
     Status status = CompileToLocalExecutable(
         ctx, function_, has_ref_vars_, platform_info_, variable_infos,
         constants_,
-        /*lazy=*/!must_compile_, &client, &kernel, &executable);
+        /*lazy=*/!must_compile_, &client, &kernel, &executable,
+        &cache_entry);
     OP_REQUIRES_OK(ctx, SnapshotResourceVariables(ctx, resources_,
                                                   variable_infos, &variables));
     if (must_compile_ || status.code() != error::UNIMPLEMENTED) {
@@ -561,7 +582,8 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
   // variables.
   XlaExecutableClosureStore::KeyT key =
       XlaExecutableClosureStore::Global()->Produce(XlaExecutableClosure(
-          client, executable, kernel, std::move(variables), constants_.size()));
+          client, executable, kernel, std::move(cache_entry),
+          std::move(variables), constants_.size()));
 
   Tensor compilation_key(cpu_allocator, DT_STRING, TensorShape({}));
   compilation_key.flat<tstring>()(0) = key;
@@ -604,9 +626,11 @@ void XlaRunOp::Compute(OpKernelContext* ctx) {
         },
         tensorflow::profiler::TraceMeLevel::kInfo);
 
-    launch_context.PopulateInputs(
-        ctx, closure.compilation_result(), closure.resource_var_snapshots(),
-        /*missing_ctx_input_prefix=*/closure.num_constant_args());
+    OP_REQUIRES_OK(
+        ctx, launch_context.PopulateInputs(
+                 ctx, closure.compilation_result(),
+                 closure.resource_var_snapshots(),
+                 /*missing_ctx_input_prefix=*/closure.num_constant_args()));
   }
 
   se::Stream* stream =
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <numeric>
 
+#include "absl/algorithm/container.h"
 #include "absl/base/call_once.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
@@ -51,9 +52,39 @@ namespace tensorflow {
 
 constexpr int64 XlaCompilationCache::kDefaultCompilationThreshold;
 
+// The value associated with a cache entry.
+struct XlaCompilationCache::Entry {
+  mutex mu;
+
+  // Have we tried compiling this entry?
+  bool compiled = false;
+
+  // The number of times a compilation with this signature has been requested.
+  int64 request_count = 0;
+
+  // Did compilation succeed?
+  Status compilation_status TF_GUARDED_BY(mu);
+
+  // Output of the XlaCompiler.
+  XlaCompiler::CompilationResult compilation_result TF_GUARDED_BY(mu);
+
+  // The XLA executable compiled from <computation>. May be null if no
+  // executable has been built.
+  std::unique_ptr<xla::LocalExecutable> executable TF_GUARDED_BY(mu);
+
+  // The position of the entry in the LRU list of its cache, and whether it has
+  // been evicted from the cache. Both are guarded by the cache's
+  // compile_cache_mu_.
+  std::list<Signature>::iterator lru_position;
+  bool evicted = false;
+};
+
 XlaCompilationCache::XlaCompilationCache(xla::LocalClient* client,
-                                         DeviceType device_type)
-    : client_(client), device_type_(std::move(device_type)) {}
+                                         DeviceType device_type,
+                                         int64 capacity)
+    : client_(client),
+      device_type_(std::move(device_type)),
+      capacity_(capacity) {}
 
 XlaCompilationCache::~XlaCompilationCache() {
   // Ensure any use of our programs have completed by waiting for all stream
@@ -81,9 +112,16 @@ string XlaCompilationCache::DebugString() const {
 // arguments in the supplied list.
 string XlaCompilationCache::Signature::HumanString() const {
   string result = name;
-  for (const auto& a : arg_shapes) {
+  for (int i = 0; i < arg_shapes.size(); ++i) {
+    const auto& a = arg_shapes[i];
     absl::StrAppend(&result, ",", DataTypeString(a.first));
-    absl::StrAppend(&result, " [", absl::StrJoin(a.second, ","), "]");
+    absl::StrAppend(&result, " [");
+    for (int j = 0; j < a.second.size(); ++j) {
+      const bool is_dynamic = arg_dynamic_dims[i] & (uint64{1} << j);
+      absl::StrAppend(&result, j > 0 ? "," : "", is_dynamic ? "<=" : "",
+                      a.second[j]);
+    }
+    absl::StrAppend(&result, "]");
   }
 
   for (const auto& v : arg_values) {
@@ -95,6 +133,7 @@ string XlaCompilationCache::Signature::HumanString() const {
 bool XlaCompilationCache::Signature::operator==(const Signature& other) const {
   if (name != other.name) return false;
   if (arg_shapes != other.arg_shapes) return false;
+  if (arg_dynamic_dims != other.arg_dynamic_dims) return false;
 
   if (arg_values.size() != other.arg_values.size()) return false;
   for (int i = 0; i < arg_values.size(); ++i) {
@@ -117,6 +156,9 @@ uint64 XlaCompilationCache::Signature::Hash::operator()(
       h = Hash64Combine(h, std::hash<int>()(dim));
     }
   }
+  for (uint64 dynamic_dims : signature.arg_dynamic_dims) {
+    h = Hash64Combine(h, dynamic_dims);
+  }
   for (const auto& arg : signature.arg_values) {
     h = Hash64Combine(
         h, Hash64(arg.tensor_data().data(), arg.tensor_data().size()));
@@ -137,10 +179,26 @@ XlaCompilationCache::BuildSignature(
         signature.arg_values.push_back(arg.constant_value);
         break;
       case XlaCompiler::Argument::kParameter:
-      case XlaCompiler::Argument::kResource:
+      case XlaCompiler::Argument::kResource: {
         signature.arg_shapes.emplace_back(arg.type,
                                           arg.DimensionSizesAsInlinedVector());
+        uint64 dynamic_dims = 0;
+        if (const auto* shape = absl::get_if<xla::Shape>(&arg.shape)) {
+          if (shape->IsArray()) {
+            for (int i = 0; i < shape->rank(); ++i) {
+              if (!shape->is_dynamic_dimension(i)) continue;
+              if (i >= 64) {
+                return errors::Unimplemented(
+                    "Dynamic dimension ", i, " of argument ", arg.HumanString(),
+                    " is not supported by XlaCompilationCache");
+              }
+              dynamic_dims |= uint64{1} << i;
+            }
+          }
+        }
+        signature.arg_dynamic_dims.push_back(dynamic_dims);
         break;
+      }
       default:
         return errors::InvalidArgument(
             "Unhandled argument kind in XlaCompilationCache: ",
@@ -150,6 +208,82 @@ XlaCompilationCache::BuildSignature(
   return std::move(signature);
 }
 
+/*static*/ Status XlaCompilationCache::PadArgumentsToShapeBuckets(
+    absl::Span<const int64> buckets, absl::Span<const int64> dims,
+    std::vector<XlaCompiler::Argument>* args) {
+  if (buckets.empty()) {
+    return Status::OK();
+  }
+  TF_RET_CHECK(absl::c_is_sorted(buckets));
+  for (XlaCompiler::Argument& arg : *args) {
+    if (arg.kind != XlaCompiler::Argument::kParameter ||
+        !absl::holds_alternative<TensorShape>(arg.shape)) {
+      continue;
+    }
+    const TensorShape& tensor_shape = absl::get<TensorShape>(arg.shape);
+    xla::Shape shape;
+    TF_RETURN_IF_ERROR(TensorShapeToXLAShape(arg.type, tensor_shape, &shape));
+    bool padded = false;
+    for (int64 dim : dims) {
+      if (dim < 0 || dim >= shape.rank()) continue;
+      auto bucket = absl::c_lower_bound(buckets, shape.dimensions(dim));
+      if (bucket == buckets.end()) continue;
+      shape.set_dimensions(dim, *bucket);
+      shape.set_dynamic_dimension(dim, true);
+      padded = true;
+    }
+    if (padded) {
+      arg.shape = shape;
+    }
+  }
+  return Status::OK();
+}
+
+XlaCompilationCache::EntryRef XlaCompilationCache::LookupOrCreateEntry(
+    const Signature& signature) {
+  // Releasing the last reference to an evicted entry waits for its executable
+  // to complete, so evicted entries are declared before `lock`, and released
+  // only after compile_cache_mu_ is.
+  std::vector<EntryRef> evicted_entries;
+  mutex_lock lock(compile_cache_mu_);
+  EntryRef& e = cache_[signature];
+  if (!e) {
+    xla::LocalClient* client = client_;
+    e.reset(new Entry, [client](Entry* entry) {
+      // An evicted entry may be released while its executable is still
+      // running, so wait for all programs to complete before deleting it.
+      if (entry->evicted && entry->executable != nullptr) {
+        for (auto* executor : client->backend().stream_executors()) {
+          if (!executor->SynchronizeAllActivity()) {
+            LOG(ERROR) << "Error synchronizing activity while waiting for "
+                          "an evicted program to complete";
+          }
+        }
+      }
+      delete entry;
+    });
+    if (capacity_ > 0) {
+      lru_list_.push_front(signature);
+      e->lru_position = lru_list_.begin();
+    }
+  } else if (capacity_ > 0) {
+    lru_list_.splice(lru_list_.begin(), lru_list_, e->lru_position);
+  }
+  EntryRef entry = e;
+
+  while (capacity_ > 0 && lru_list_.size() > capacity_) {
+    auto it = cache_.find(lru_list_.back());
+    VLOG(2) << "Evicting compilation cache entry for signature: "
+            << it->first.HumanString();
+    it->second->evicted = true;
+    evicted_entries.push_back(std::move(it->second));
+    cache_.erase(it);
+    lru_list_.pop_back();
+    metrics::IncrementXlaCompilationCacheEvictions();
+  }
+  return entry;
+}
+
 Status XlaCompilationCache::BuildExecutable(
     const XlaCompiler::Options& options,
     const XlaCompiler::CompilationResult& result,
@@ -183,7 +317,7 @@ Status XlaCompilationCache::Compile(
     const XlaCompiler::CompileOptions& compile_options,
     CompileMode compile_mode,
     const XlaCompiler::CompilationResult** out_compilation_result,
-    xla::LocalExecutable** out_executable) {
+    xla::LocalExecutable** out_executable, EntryRef* out_entry_ref) {
   absl::optional<int64> compile_threshold;
   if (compile_mode == CompileMode::kLazy) {
     compile_threshold = kDefaultCompilationThreshold;
@@ -194,7 +328,7 @@ Status XlaCompilationCache::Compile(
   };
   return CompileImpl(options, function, args, compile_fn,
                      /*compile_threshold=*/compile_threshold,
-                     out_compilation_result, out_executable);
+                     out_compilation_result, out_executable, out_entry_ref);
 }
 
 static bool ShouldBeMegamorphic(int64 compile_count, int64 execution_count) {
@@ -259,7 +393,7 @@ Status XlaCompilationCache::CompileSingleOp(
     absl::Span<const XlaCompiler::Argument> args, OpKernelContext* ctx,
     const XlaCompiler::CompileOptions& compile_options,
     const XlaCompiler::CompilationResult** out_compilation_result,
-    xla::LocalExecutable** out_executable) {
+    xla::LocalExecutable** out_executable, EntryRef* out_entry_ref) {
   const NodeDef& def = ctx->op_kernel().def();
   NameAttrList name;
   name.set_name(def.op());
@@ -300,7 +434,7 @@ Status XlaCompilationCache::CompileSingleOp(
   };
   return CompileImpl(options, name, args, compile_op,
                      /*compile_threshold=*/absl::nullopt,
-                     out_compilation_result, out_executable);
+                     out_compilation_result, out_executable, out_entry_ref);
 }
 
 namespace {
@@ -324,8 +458,10 @@ Status XlaCompilationCache::CompileImpl(
                                XlaCompiler::CompilationResult*)>& compile_fn,
     absl::optional<int64> compile_threshold,
     const XlaCompiler::CompilationResult** out_compilation_result,
-    xla::LocalExecutable** out_executable) {
+    xla::LocalExecutable** out_executable, EntryRef* out_entry_ref) {
   DCHECK_NE(out_executable, nullptr);
+  TF_RET_CHECK(capacity_ <= 0 || out_entry_ref != nullptr)
+      << "Compiling with a bounded cache requires an entry reference";
   VLOG(2) << "XlaCompilationCache::Compile " << DebugString();
 
   if (VLOG_IS_ON(2)) {
@@ -338,18 +474,10 @@ Status XlaCompilationCache::CompileImpl(
   TF_ASSIGN_OR_RETURN(Signature signature, BuildSignature(function, args));
   VLOG(2) << "Signature: " << signature.HumanString();
 
-  // The outer lock protects the existence of the cache entry. It does not
-  // protect the contents of the cache entry.
-  Entry* entry;
-  {
-    mutex_lock lock(compile_cache_mu_);
-    // Find or create a cache entry.
-    std::unique_ptr<Entry>& e = cache_[signature];
-    if (!e) {
-      e.reset(new Entry);
-    }
-    entry = e.get();
-  }
+  // The cache lock protects the existence of the cache entry. It does not
+  // protect the contents of the cache entry, which our reference keeps alive
+  // even if the entry is evicted concurrently.
+  EntryRef entry = LookupOrCreateEntry(signature);
 
   // We always compile a cluster the very first time it is executed.  This is an
   // optimistic guess that pays off for statically shaped TensorFlow graphs
@@ -384,10 +512,9 @@ Status XlaCompilationCache::CompileImpl(
   }
 
   // Acquire the cache entry lock and compile, if necessary.
-  // TODO(phawkins): this locking will need to be restructured when we implement
-  // cache eviction.
   mutex_lock entry_lock(entry->mu);
   int64 current_request_count = ++entry->request_count;
+  metrics::UpdateXlaCompilationCacheLookup(/*hit=*/entry->compiled);
   VLOG(2) << "Compilation cache entry hit: " << entry->compiled
           << " signature: " << signature.HumanString() << " with request count "
           << current_request_count << " and compile threshold "
@@ -482,6 +609,9 @@ Status XlaCompilationCache::CompileImpl(
   TF_RETURN_IF_ERROR(entry->compilation_status);
   *out_compilation_result = &entry->compilation_result;
   *out_executable = entry->executable.get();
+  if (out_entry_ref != nullptr) {
+    *out_entry_ref = entry;
+  }
   return Status::OK();
 }
 
@@ -16,6 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_JIT_XLA_COMPILATION_CACHE_H_
 #define TENSORFLOW_COMPILER_JIT_XLA_COMPILATION_CACHE_H_
 
+#include <list>
+#include <memory>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/types/optional.h"
@@ -38,13 +41,17 @@ namespace tensorflow {
 // which converts a Tensorflow graph into a compiled XLA compilation.
 //
 // Since XLA computations must have static shapes, the cache generates a new
-// XLA computation for each new set of input shapes.
+// XLA computation for each new set of input shapes. Callers may pad inputs to
+// shape buckets (see PadArgumentsToShapeBuckets) so that inputs of different
+// shapes share one computation.
 //
-// Currently no cache eviction policy is implemented and the cache grows without
-// bound.
+// If `capacity` is positive, the cache holds at most that many entries, and
+// evicts the least recently used ones beyond it. Otherwise the cache grows
+// without bound.
 class XlaCompilationCache : public ResourceBase {
  public:
-  XlaCompilationCache(xla::LocalClient* client, DeviceType device_type);
+  XlaCompilationCache(xla::LocalClient* client, DeviceType device_type,
+                      int64 capacity = 0);
   ~XlaCompilationCache() override;
 
   enum class CompileMode {
@@ -52,6 +59,13 @@ class XlaCompilationCache : public ResourceBase {
     kStrict,
   };
 
+  // A cache entry, holding a compilation result and its executable.
+  struct Entry;
+
+  // A reference to a cache entry, which keeps the compilation result and the
+  // executable returned with it alive after the entry is evicted.
+  using EntryRef = std::shared_ptr<Entry>;
+
   // Compiles a function into a XlaCompiler::CompilationResult that can be used
   // to execute an XLA Computation. Compilation results are cached.
   // `function` is the name of a Tensorflow function to compile.
@@ -69,13 +83,18 @@ class XlaCompilationCache : public ResourceBase {
   // xla::LocalExecutable and sets `out_executable` to point to it. The
   // resulting executable pointer may be null if the computation has no
   // non-constant outputs.
+  //
+  // If the cache has a capacity, the results may be evicted at any time, so
+  // callers must pass `out_entry_ref` and hold on to the reference for as long
+  // as they use the results.
   Status Compile(const XlaCompiler::Options& options,
                  const NameAttrList& function,
                  absl::Span<const XlaCompiler::Argument> args,
                  const XlaCompiler::CompileOptions& compile_options,
                  CompileMode compile_mode,
                  const XlaCompiler::CompilationResult** out_compilation_result,
-                 xla::LocalExecutable** out_executable);
+                 xla::LocalExecutable** out_executable,
+                 EntryRef* out_entry_ref = nullptr);
 
   // As above, but calls XlaCompiler::CompileSingleOp instead of
   // XlaCompiler::CompileFunction. If MLIR bridge is enabled through ConfigProto
@@ -86,9 +105,11 @@ class XlaCompilationCache : public ResourceBase {
       absl::Span<const XlaCompiler::Argument> args, OpKernelContext* ctx,
       const XlaCompiler::CompileOptions& compile_options,
       const XlaCompiler::CompilationResult** out_compilation_result,
-      xla::LocalExecutable** out_executable);
+      xla::LocalExecutable** out_executable,
+      EntryRef* out_entry_ref = nullptr);
 
   xla::LocalClient* client() const { return client_; }
+  int64 capacity() const { return capacity_; }
   const DeviceType& device_type() const { return device_type_; }
 
   string DebugString() const override;
@@ -103,6 +124,10 @@ class XlaCompilationCache : public ResourceBase {
     absl::InlinedVector<std::pair<DataType, absl::InlinedVector<int64, 4>>, 4>
         arg_shapes;
 
+    // For each entry of `arg_shapes`, a mask of its dynamic dimensions, i.e.
+    // those padded to a shape bucket.
+    absl::InlinedVector<uint64, 4> arg_dynamic_dims;
+
     // List of Tensor values for compile-time constant arguments to the
     // compilation, ordered by argument number. Tensors must be in host memory.
     absl::InlinedVector<Tensor, 4> arg_values;
@@ -122,6 +147,15 @@ class XlaCompilationCache : public ResourceBase {
       const NameAttrList& function,
       absl::Span<const XlaCompiler::Argument> args);
 
+  // Pads dimensions `dims` of the parameters in `args` to the smallest of
+  // `buckets`, which must be sorted, that holds them. Each padded dimension
+  // becomes a dynamic dimension bounded by its bucket, so that the compiled
+  // computation masks out the padding, and the parameter's shape becomes an
+  // xla::Shape. Dimensions larger than all buckets are left as they are.
+  static Status PadArgumentsToShapeBuckets(
+      absl::Span<const int64> buckets, absl::Span<const int64> dims,
+      std::vector<XlaCompiler::Argument>* args);
+
  private:
   // Common implementation of Compile and CompileSingleOp.
   Status CompileImpl(
@@ -131,7 +165,7 @@ class XlaCompilationCache : public ResourceBase {
                                  XlaCompiler::CompilationResult*)>& compile_fn,
       absl::optional<int64> compile_threshold,
       const XlaCompiler::CompilationResult** out_compilation_result,
-      xla::LocalExecutable** out_executable);
+      xla::LocalExecutable** out_executable, EntryRef* out_entry_ref);
 
   // Takes `result` which has been compiled from a Tensorflow subgraph to a
   // XLA computation already, and generates an XLA LocalExecutable `executable`.
@@ -139,34 +173,23 @@ class XlaCompilationCache : public ResourceBase {
                          const XlaCompiler::CompilationResult& result,
                          std::unique_ptr<xla::LocalExecutable>* executable);
 
+  // Returns the entry for `signature`, creating it if there is none, and marks
+  // it as the most recently used. Evicts the least recently used entries
+  // beyond the capacity of the cache.
+  EntryRef LookupOrCreateEntry(const Signature& signature);
+
   xla::LocalClient* const client_;
   const DeviceType device_type_;
-
-  // The value associated with a cache entry.
-  struct Entry {
-    mutex mu;
-
-    // Have we tried compiling this entry?
-    bool compiled = false;
-
-    // The number of times a compilation with this signature has been requested.
-    int64 request_count = 0;
-
-    // Did compilation succeed?
-    Status compilation_status TF_GUARDED_BY(mu);
-
-    // Output of the XlaCompiler.
-    XlaCompiler::CompilationResult compilation_result TF_GUARDED_BY(mu);
-
-    // The XLA executable compiled from <computation>. May be null if no
-    // executable has been built.
-    std::unique_ptr<xla::LocalExecutable> executable TF_GUARDED_BY(mu);
-  };
+  const int64 capacity_;
 
   mutex compile_cache_mu_;
-  absl::flat_hash_map<Signature, std::unique_ptr<Entry>, Signature::Hash> cache_
+  absl::flat_hash_map<Signature, EntryRef, Signature::Hash> cache_
       TF_GUARDED_BY(compile_cache_mu_);
 
+  // The signatures of the entries of `cache_`, most recently used first. Only
+  // maintained if the cache has a capacity.
+  std::list<Signature> lru_list_ TF_GUARDED_BY(compile_cache_mu_);
+
   struct ClusterCompileStats {
     // Number of times the cluster has been (re-)compiled.
     int64 compile_count = 0;
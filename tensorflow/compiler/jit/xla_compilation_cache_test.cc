@@ -15,9 +15,20 @@ limitations under the License.
 
 #include "tensorflow/compiler/jit/xla_compilation_cache.h"
 
+#include "absl/strings/match.h"
 #include "tensorflow/compiler/tf2xla/shape_util.h"
+#include "tensorflow/compiler/tf2xla/xla_op_registry.h"
+#include "tensorflow/compiler/xla/client/client_library.h"
+#include "tensorflow/compiler/xla/client/local_client.h"
+#include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/tests/literal_test_util.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/monitoring/collection_registry.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/version.h"
 
 namespace tensorflow {
 namespace {
@@ -52,6 +63,152 @@ TEST(XlaCompilationCacheTest, SignatureEquality) {
   }
 }
 
+TEST(XlaCompilationCacheTest, PadArgumentsToShapeBuckets) {
+  std::vector<XlaCompiler::Argument> args(4);
+  args[0].kind = XlaCompiler::Argument::kParameter;
+  args[0].type = DT_FLOAT;
+  args[0].shape = TensorShape({3, 5});
+  args[1].kind = XlaCompiler::Argument::kParameter;
+  args[1].type = DT_FLOAT;
+  args[1].shape = TensorShape({100, 5});
+  args[2].kind = XlaCompiler::Argument::kParameter;
+  args[2].type = DT_INT32;
+  args[2].shape = TensorShape({});
+  args[3].kind = XlaCompiler::Argument::kConstant;
+  args[3].type = DT_INT32;
+  args[3].shape = TensorShape({3});
+  args[3].constant_value = Tensor(DT_INT32, {3});
+
+  TF_ASSERT_OK(XlaCompilationCache::PadArgumentsToShapeBuckets(
+      /*buckets=*/{4, 8, 16}, /*dims=*/{0}, &args));
+
+  ASSERT_TRUE(absl::holds_alternative<xla::Shape>(args[0].shape));
+  const xla::Shape& shape = absl::get<xla::Shape>(args[0].shape);
+  EXPECT_EQ(shape.dimensions(0), 4);
+  EXPECT_EQ(shape.dimensions(1), 5);
+  EXPECT_TRUE(shape.is_dynamic_dimension(0));
+  EXPECT_FALSE(shape.is_dynamic_dimension(1));
+  // Dimensions larger than all buckets, scalars and constants are unchanged.
+  EXPECT_EQ(absl::get<TensorShape>(args[1].shape), TensorShape({100, 5}));
+  EXPECT_EQ(absl::get<TensorShape>(args[2].shape), TensorShape({}));
+  EXPECT_EQ(absl::get<TensorShape>(args[3].shape), TensorShape({3}));
+}
+
+TEST(XlaCompilationCacheTest, SignatureOfPaddedArguments) {
+  NameAttrList fn;
+  fn.set_name("afunction");
+  std::vector<XlaCompiler::Argument> args(1);
+  args[0].kind = XlaCompiler::Argument::kParameter;
+  args[0].type = DT_FLOAT;
+
+  std::vector<XlaCompilationCache::Signature> signatures;
+  for (int64 size : {5, 7, 8}) {
+    args[0].shape = TensorShape({size});
+    TF_ASSERT_OK(XlaCompilationCache::PadArgumentsToShapeBuckets(
+        /*buckets=*/{8}, /*dims=*/{0}, &args));
+    TF_ASSERT_OK_AND_ASSIGN(XlaCompilationCache::Signature s,
+                            XlaCompilationCache::BuildSignature(fn, args));
+    signatures.push_back(s);
+  }
+  args[0].shape = TensorShape({8});
+  TF_ASSERT_OK_AND_ASSIGN(XlaCompilationCache::Signature unpadded,
+                          XlaCompilationCache::BuildSignature(fn, args));
+
+  // All sizes share the signature of their bucket, which differs from the
+  // signature of the static bucket shape.
+  EXPECT_TRUE(signatures[0] == signatures[1]);
+  EXPECT_TRUE(signatures[0] == signatures[2]);
+  EXPECT_FALSE(signatures[0] == unpadded);
+  EXPECT_TRUE(
+      absl::StrContains(signatures[0].HumanString(), ",float [<=8]"))
+      << signatures[0].HumanString();
+}
+
+// Returns the number of compilation cache entries evicted so far.
+int64 NumEvictions() {
+  monitoring::CollectionRegistry::CollectMetricsOptions options;
+  std::unique_ptr<monitoring::CollectedMetrics> metrics =
+      monitoring::CollectionRegistry::Default()->CollectMetrics(options);
+  auto it = metrics->point_set_map.find(
+      "/tensorflow/core/xla_compilation_cache_evictions");
+  if (it == metrics->point_set_map.end() || it->second->points.empty()) {
+    return 0;
+  }
+  return it->second->points[0]->int64_value;
+}
+
+TEST(XlaCompilationCacheTest, EvictsLeastRecentlyUsedEntries) {
+  XlaOpRegistry::RegisterCompilationKernels();
+  xla::LocalClient* client = xla::ClientLibrary::LocalClientOrDie();
+  FunctionDefLibrary fdef_lib;
+  *fdef_lib.add_function() = test::function::XTimesTwo();
+  FunctionLibraryDefinition flib_def(OpRegistry::Global(), fdef_lib);
+  XlaCompiler::Options options;
+  options.device_type = DeviceType(DEVICE_CPU_XLA_JIT);
+  options.client = client;
+  options.flib_def = &flib_def;
+  options.graph_def_version = TF_GRAPH_DEF_VERSION;
+
+  NameAttrList function;
+  function.set_name("XTimesTwo");
+  (*function.mutable_attr())["T"].set_type(DT_FLOAT);
+
+  XlaCompilationCache* cache = new XlaCompilationCache(
+      client, DeviceType(DEVICE_CPU_XLA_JIT), /*capacity=*/1);
+  core::ScopedUnref cache_ref(cache);
+  // Each size of the argument is a distinct signature.
+  auto compile = [&](int64 size, XlaCompilationCache::EntryRef* entry_ref,
+                     xla::LocalExecutable** executable) {
+    std::vector<XlaCompiler::Argument> args(1);
+    args[0].kind = XlaCompiler::Argument::kParameter;
+    args[0].type = DT_FLOAT;
+    args[0].shape = TensorShape({size});
+    const XlaCompiler::CompilationResult* result;
+    return cache->Compile(options, function, args,
+                          XlaCompiler::CompileOptions(),
+                          XlaCompilationCache::CompileMode::kStrict, &result,
+                          executable, entry_ref);
+  };
+
+  const int64 initial_evictions = NumEvictions();
+  XlaCompilationCache::EntryRef first_entry;
+  xla::LocalExecutable* first_executable;
+  TF_ASSERT_OK(compile(4, &first_entry, &first_executable));
+  ASSERT_NE(first_executable, nullptr);
+  EXPECT_EQ(NumEvictions(), initial_evictions);
+
+  // The second signature evicts the first entry, which stays alive as long as
+  // it is referenced.
+  XlaCompilationCache::EntryRef second_entry;
+  xla::LocalExecutable* second_executable;
+  TF_ASSERT_OK(compile(8, &second_entry, &second_executable));
+  ASSERT_NE(second_executable, nullptr);
+  EXPECT_EQ(NumEvictions(), initial_evictions + 1);
+
+  TF_ASSERT_OK_AND_ASSIGN(
+      xla::ScopedShapedBuffer argument,
+      client->LiteralToShapedBuffer(
+          xla::LiteralUtil::CreateR1<float>({1, 2, 3, 4}),
+          client->default_device_ordinal()));
+  xla::ExecutableRunOptions run_options;
+  run_options.set_allocator(client->backend().memory_allocator());
+  TF_ASSERT_OK_AND_ASSIGN(xla::ScopedShapedBuffer output,
+                          first_executable->Run({&argument}, run_options));
+  TF_ASSERT_OK_AND_ASSIGN(xla::Literal result,
+                          client->ShapedBufferToLiteral(output));
+  xla::Literal expected = xla::LiteralUtil::CreateR1<float>({2, 4, 6, 8});
+  EXPECT_TRUE(xla::LiteralTestUtil::Equal(
+      xla::LiteralUtil::MakeTuple({&expected}), result));
+  first_entry.reset();
+
+  // Once evicted, the first signature is compiled again, and evicts the second
+  // entry, of which the cache held the last reference.
+  second_entry.reset();
+  TF_ASSERT_OK(compile(4, &first_entry, &first_executable));
+  ASSERT_NE(first_executable, nullptr);
+  EXPECT_EQ(NumEvictions(), initial_evictions + 2);
+}
+
 static void BM_BuildSignature(int iters, int n_args) {
   NameAttrList fn;
   fn.set_name("afunction");
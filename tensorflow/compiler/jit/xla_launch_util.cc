@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/compiler/jit/xla_launch_util.h"
 
+#include <cstring>
 #include <memory>
 
 #include "absl/algorithm/container.h"
@@ -24,6 +25,8 @@ limitations under the License.
 #include "tensorflow/compiler/tf2xla/xla_compiler.h"
 #include "tensorflow/compiler/xla/client/client_library.h"
 #include "tensorflow/compiler/xla/client/local_client.h"
+#include "tensorflow/compiler/xla/layout_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/statusor.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/function.h"
@@ -187,7 +190,47 @@ XlaComputationLaunchContext::XlaComputationLaunchContext(
   }
 }
 
-void XlaComputationLaunchContext::PopulateInputs(
+// Copies `tensor` into `dst`, which holds the dynamic shape `shape`: the
+// elements of `tensor` are stored contiguously at the start of `dst`, and the
+// sizes of the dimensions of `tensor` follow the space for `shape`'s largest
+// size.
+static Status CopyToDynamicShapeBuffer(const Tensor& tensor,
+                                       const xla::Shape& shape,
+                                       se::Stream* stream,
+                                       se::DeviceMemoryBase dst) {
+  TF_RET_CHECK(xla::LayoutUtil::IsMonotonicWithDim0Major(shape.layout()))
+      << "Unsupported layout for dynamic argument shape "
+      << xla::ShapeUtil::HumanStringWithLayout(shape);
+  TF_RET_CHECK(tensor.dims() == shape.rank());
+  auto sizes = std::make_shared<std::vector<int32>>(shape.rank());
+  for (int i = 0; i < shape.rank(); ++i) {
+    TF_RET_CHECK(tensor.dim_size(i) <= shape.dimensions(i));
+    (*sizes)[i] = tensor.dim_size(i);
+  }
+  const int64 data_size = tensor.TotalBytes();
+  const int64 metadata_offset =
+      xla::ShapeUtil::ByteSizeOf(xla::ShapeUtil::MakeStaticShape(shape));
+  const int64 metadata_size = sizes->size() * sizeof(int32);
+  se::DeviceMemoryBase src = XlaTensor::DeviceMemoryFromTensor(tensor);
+  se::DeviceMemoryBase metadata(
+      static_cast<char*>(dst.opaque()) + metadata_offset, metadata_size);
+
+  if (stream == nullptr) {
+    // The tensor lives in host memory.
+    std::memcpy(dst.opaque(), src.opaque(), data_size);
+    std::memcpy(metadata.opaque(), sizes->data(), metadata_size);
+    return Status::OK();
+  }
+  stream->ThenMemcpyD2D(&dst, src, data_size);
+  stream->ThenMemcpy(&metadata, sizes->data(), metadata_size);
+  // Keep the dimension sizes alive until they have been copied.
+  stream->ThenDoHostCallback([sizes]() {});
+  return stream->ok() ? Status::OK()
+                      : errors::Internal(
+                            "Failed to enqueue copy of dynamic argument");
+}
+
+Status XlaComputationLaunchContext::PopulateInputs(
     OpKernelContext* ctx,
     const XlaCompiler::CompilationResult* compilation_result,
     const ResourceVarsSnapshot& variables, int missing_ctx_input_prefix) {
@@ -215,8 +258,27 @@ void XlaComputationLaunchContext::PopulateInputs(
           ctx->op_device_context()->stream());
     }
 
-    if (xla::Shape::Equal().MinorToMajorOnlyInLayout()(
-            shape, transfer_manager->HostShapeToDeviceShape(shape))) {
+    if (!shape.is_static()) {
+      se::Stream* stream = ctx->op_device_context()
+                               ? ctx->op_device_context()->stream()
+                               : nullptr;
+      const int device_ordinal = stream ? stream->parent()->device_ordinal()
+                                        : client_->default_device_ordinal();
+      const int64 size =
+          xla::ShapeUtil::ByteSizeOf(xla::ShapeUtil::MakeStaticShape(shape)) +
+          shape.rank() * sizeof(int32);
+      TF_ASSIGN_OR_RETURN(se::OwningDeviceMemory memory,
+                          xla_allocator_->Allocate(device_ordinal, size));
+      TF_RETURN_IF_ERROR(
+          CopyToDynamicShapeBuffer(*t, shape, stream, *memory));
+      arg_buffers_.emplace_back(
+          /*on_host_shape=*/shape, /*on_device_shape=*/shape,
+          client_->platform(), device_ordinal);
+      arg_buffers_.back().set_buffer(*memory, /*index=*/{});
+      arg_ptrs_[i] = &arg_buffers_.back();
+      padded_arg_memory_.push_back(std::move(memory));
+    } else if (xla::Shape::Equal().MinorToMajorOnlyInLayout()(
+                   shape, transfer_manager->HostShapeToDeviceShape(shape))) {
       se::DeviceMemoryBase dmem = XlaTensor::DeviceMemoryFromTensor(*t);
       arg_buffers_.emplace_back(
           /*on_host_shape=*/shape, /*on_device_shape=*/shape,
@@ -229,6 +291,7 @@ void XlaComputationLaunchContext::PopulateInputs(
       arg_ptrs_[i] = const_cast<ShapedBuffer*>(&xla_tensor->shaped_buffer());
     }
   }
+  return Status::OK();
 }
 
 // Construct the tensor for given type and buffer.
@@ -142,10 +142,14 @@ class XlaComputationLaunchContext {
   // missing and adjusts input indices accordingly.  All elements in kernel's
   // input_mapping must be greater than or equal to `missing_ctx_input_prefix`
   // (in other words, no inputs actually required by the kernel can be missing).
-  void PopulateInputs(OpKernelContext* ctx,
-                      const XlaCompiler::CompilationResult* compilation_result,
-                      const ResourceVarsSnapshot& variables,
-                      int missing_ctx_input_prefix);
+  //
+  // Inputs whose XLA shapes have dynamic dimensions, i.e. that were padded to
+  // shape buckets, are copied into buffers of their padded size, followed by
+  // their actual dimension sizes.
+  Status PopulateInputs(
+      OpKernelContext* ctx,
+      const XlaCompiler::CompilationResult* compilation_result,
+      const ResourceVarsSnapshot& variables, int missing_ctx_input_prefix);
 
   // Given the XLA output in `output`, populate all outputs of `ctx`.  Also
   // writes out the resource variable updates.
@@ -175,6 +179,8 @@ class XlaComputationLaunchContext {
   bool use_multiple_streams_;
   std::deque<xla::ShapedBuffer> arg_buffers_;
   std::vector<xla::ShapedBuffer*> arg_ptrs_;
+  // The buffers of inputs padded to dynamic shapes.
+  std::vector<se::OwningDeviceMemory> padded_arg_memory_;
 };
 
 // A simple TensorBuffer implementation that allows us to create Tensors that
@@ -711,8 +711,11 @@ Status XlaCompiler::CompileFunction(
 
     if (absl::holds_alternative<xla::Shape>(args[i].shape)) {
       xla::Shape xla_shape = absl::get<xla::Shape>(args[i].shape);
+      // The dimensions of dynamic shapes are only upper bounds, which must not
+      // be constant folded.
       TensorShape tensor_shape;
-      if (XLAShapeToTensorShape(xla_shape, &tensor_shape).ok()) {
+      if (xla_shape.is_static() &&
+          XLAShapeToTensorShape(xla_shape, &tensor_shape).ok()) {
         fbody->arg_nodes[i]->ClearAttr("_output_shapes");
         fbody->arg_nodes[i]->AddAttr("_output_shapes",
                                      std::vector<TensorShape>{tensor_shape});
@@ -781,6 +784,17 @@ Status XlaCompiler::XLAShapeForArgument(
         TF_ASSIGN_OR_RETURN(*xla_shape, options_.shape_representation_fn(
                                             shape, arg.type,
                                             /*use_fast_memory=*/false));
+        // Keep the dynamic dimensions of the argument, e.g. those padded to a
+        // shape bucket, if the representation preserves its dimensions.
+        if (const auto* arg_shape = absl::get_if<xla::Shape>(&arg.shape)) {
+          if (arg_shape->IsArray() && xla_shape->IsArray() &&
+              xla::ShapeUtil::SameDimensions(*arg_shape, *xla_shape)) {
+            for (int i = 0; i < arg_shape->rank(); ++i) {
+              xla_shape->set_dynamic_dimension(
+                  i, arg_shape->is_dynamic_dimension(i));
+            }
+          }
+        }
         TF_RETURN_IF_ERROR(RewriteLayoutWithShardedShape(
             arg_sharding, /*use_fast_memory=*/false,
             options_.shape_representation_fn, xla_shape));
@@ -73,6 +73,9 @@ DebugOptions DefaultDebugOptionsIgnoringFlags() {
   opts.set_xla_gpu_deterministic_reductions(false);
   opts.set_xla_cpu_enable_xprof_traceme(true);
   opts.set_xla_gpu_unsafe_fallback_to_driver_on_ptxas_not_found(false);
+  opts.set_xla_hlo_pass_num_threads(1);
+  opts.set_xla_heap_interval_packing_trials(0);
+  opts.set_xla_heap_interval_packing_time_budget_ms(100);
 
   return opts;
 }
@@ -388,6 +391,29 @@ static void AllocateFlags() {
       "xla_hlo_profile", bool_setter_for(&DebugOptions::set_xla_hlo_profile),
       flag_values->xla_hlo_profile(),
       "Instrument the computation to collect per-HLO cycle counts"));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_hlo_pass_num_threads",
+      int32_setter_for(&DebugOptions::set_xla_hlo_pass_num_threads),
+      flag_values->xla_hlo_pass_num_threads(),
+      "Number of threads on which HLO passes which work on each computation "
+      "independently (e.g. algebraic simplification, constant folding and "
+      "DCE) process the computations of a module concurrently. Names and ids "
+      "of new instructions may then vary between compilations."));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_heap_interval_packing_trials",
+      int32_setter_for(&DebugOptions::set_xla_heap_interval_packing_trials),
+      flag_values->xla_heap_interval_packing_trials(),
+      "Number of buffer placements which buffer assignment may try while "
+      "searching for a more compact heap, in addition to the default "
+      "heuristics. 0 disables the search."));
+  flag_objects->push_back(tensorflow::Flag(
+      "xla_heap_interval_packing_time_budget_ms",
+      int32_setter_for(
+          &DebugOptions::set_xla_heap_interval_packing_time_budget_ms),
+      flag_values->xla_heap_interval_packing_time_budget_ms(),
+      "Time budget, in milliseconds, of each search for a more compact heap "
+      "enabled by --xla_heap_interval_packing_trials. When the budget runs "
+      "out, the result depends on the speed of the host."));
   flag_objects->push_back(tensorflow::Flag(
       "xla_backend_extra_options", setter_for_xla_backend_extra_options, "",
       "Extra options to pass to a backend; comma-separated list of 'key=val' "
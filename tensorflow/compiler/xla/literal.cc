@@ -642,16 +642,65 @@ StatusOr<Literal> LiteralBase::Broadcast(
 
   Literal result(result_shape);
 
-  // scratch_source_index is temporary storage space for the computed index into
-  // the input literal.  We put it here to avoid allocating an std::vector in
-  // every iteration of ShapeUtil::ForEachIndex.
-  std::vector<int64> scratch_source_index(shape().dimensions_size());
-
   char* dest_data = static_cast<char*>(result.untyped_data());
   const char* source_data = static_cast<const char*>(untyped_data());
   const int64 primitive_size =
       ShapeUtil::ByteSizeOfPrimitiveType(shape().element_type());
 
+  const int64 rank = result_shape.rank();
+  if (rank > 0 && LayoutUtil::IsMonotonicWithDim0Major(shape().layout()) &&
+      LayoutUtil::IsMonotonicWithDim0Major(result_shape.layout())) {
+    // Both literals are stored row-major, so fill the result a minor-most row
+    // at a time, stepping through the source with the strides of the
+    // dimensions the rows map to (zero for broadcast dimensions).
+    std::vector<int64> source_strides(rank, 0);
+    int64 stride = 1;
+    for (int64 i = dimensions.size() - 1; i >= 0; --i) {
+      source_strides[dimensions[i]] = stride;
+      stride *= shape().dimensions(i);
+    }
+    const int64 row_size = result_shape.dimensions(rank - 1);
+    const int64 row_bytes = row_size * primitive_size;
+    const int64 row_stride = source_strides[rank - 1];
+    const int64 num_rows =
+        row_size == 0 ? 0 : ShapeUtil::ElementsIn(result_shape) / row_size;
+    std::vector<int64> row_index(rank - 1, 0);
+    int64 source_offset = 0;
+    for (int64 row = 0; row < num_rows; ++row) {
+      char* dest = dest_data + row * row_bytes;
+      const char* source = source_data + source_offset * primitive_size;
+      if (row_stride == 1) {
+        memcpy(dest, source, row_bytes);
+      } else if (row_stride == 0) {
+        // Splat the element, doubling the filled prefix with each copy.
+        memcpy(dest, source, primitive_size);
+        for (int64 filled = primitive_size; filled < row_bytes;
+             filled *= 2) {
+          memcpy(dest + filled, dest, std::min(filled, row_bytes - filled));
+        }
+      } else {
+        for (int64 i = 0; i < row_size; ++i) {
+          memcpy(dest + i * primitive_size,
+                 source + i * row_stride * primitive_size, primitive_size);
+        }
+      }
+      for (int64 dim = rank - 2; dim >= 0; --dim) {
+        source_offset += source_strides[dim];
+        if (++row_index[dim] < result_shape.dimensions(dim)) {
+          break;
+        }
+        source_offset -= row_index[dim] * source_strides[dim];
+        row_index[dim] = 0;
+      }
+    }
+    return std::move(result);
+  }
+
+  // scratch_source_index is temporary storage space for the computed index into
+  // the input literal.  We put it here to avoid allocating an std::vector in
+  // every iteration of ShapeUtil::ForEachIndex.
+  std::vector<int64> scratch_source_index(shape().dimensions_size());
+
   ShapeUtil::ForEachIndex(
       result_shape, [&](absl::Span<const int64> output_index) {
         for (int64 i = 0; i < dimensions.size(); ++i) {
@@ -1973,6 +1973,40 @@ TEST_F(LiteralUtilTest, BroadcastScalarToMatrix) {
             LiteralUtil::CreateR2<int32>({{9, 9}, {9, 9}}));
 }
 
+TEST_F(LiteralUtilTest, BroadcastMatrixToRank3Transposed) {
+  Literal literal = LiteralUtil::CreateR2<int32>({{1, 2, 3}, {4, 5, 6}});
+  TF_ASSERT_OK_AND_ASSIGN(
+      Literal broadcasted_literal,
+      literal.Broadcast(/*result_shape=*/ShapeUtil::MakeShape(S32, {3, 4, 2}),
+                        /*dimensions=*/{2, 0}));
+  EXPECT_EQ(broadcasted_literal,
+            LiteralUtil::CreateR3<int32>(
+                {{{1, 4}, {1, 4}, {1, 4}, {1, 4}},
+                 {{2, 5}, {2, 5}, {2, 5}, {2, 5}},
+                 {{3, 6}, {3, 6}, {3, 6}, {3, 6}}}));
+}
+
+TEST_F(LiteralUtilTest, BroadcastVectorToMatrixWithLayout) {
+  Literal literal = LiteralUtil::CreateR1<float>({1, 2, 3});
+  TF_ASSERT_OK_AND_ASSIGN(
+      Literal broadcasted_literal,
+      literal.Broadcast(/*result_shape=*/ShapeUtil::MakeShapeWithLayout(
+                            F32, {2, 3}, {0, 1}),
+                        /*dimensions=*/{1}));
+  EXPECT_EQ(broadcasted_literal,
+            LiteralUtil::CreateR2<float>({{1, 2, 3}, {1, 2, 3}}));
+}
+
+TEST_F(LiteralUtilTest, BroadcastToZeroSizedMatrix) {
+  Literal literal = LiteralUtil::CreateR1<int32>({1, 2, 3});
+  TF_ASSERT_OK_AND_ASSIGN(
+      Literal broadcasted_literal,
+      literal.Broadcast(/*result_shape=*/ShapeUtil::MakeShape(S32, {3, 0}),
+                        /*dimensions=*/{0}));
+  EXPECT_EQ(broadcasted_literal,
+            LiteralUtil::CreateR2FromArray2D<int32>(Array2D<int32>(3, 0)));
+}
+
 TEST_F(LiteralUtilTest, GetAsComplex128) {
   complex128 value = {1, 0};
   Literal c1 = LiteralUtil::CreateR0<complex128>(value);
@@ -159,6 +159,11 @@ StatusOr<DeviceAssignment> DevicesToDeviceAssignment(
   return xla_assignment;
 }
 
+// Two staging buffers per size let the inputs of the next execution be copied
+// while the current execution still reads the previous ones.
+constexpr int kStagingBuffersPerSize = 2;
+constexpr int64 kMaxCachedStagingBufferBytes = 256LL << 20;
+
 class CpuAllocator : public tensorflow::Allocator {
  public:
   CpuAllocator() = default;
@@ -200,6 +205,9 @@ PjRtClient::PjRtClient(
   if (!host_memory_allocator_) {
     host_memory_allocator_ = std::make_unique<CpuAllocator>();
   }
+  staging_buffer_pool_ = std::make_unique<StagingBufferPool>(
+      host_memory_allocator_.get(), cpu_function_runtime::kMinAlign,
+      kStagingBuffersPerSize, kMaxCachedStagingBufferBytes);
 
   for (const std::unique_ptr<Device>& device : devices_) {
     CHECK(id_to_device_.insert({device->id(), device.get()}).second)
@@ -591,12 +599,11 @@ StatusOr<std::unique_ptr<PjRtBuffer>> PjRtBuffer::FromHostBuffer(
                       transfer_manager->ChooseCompactLayoutForShape(shape));
 
   // The CPU platform is special because the "host" and the "device" are in the
-  // same memory space. If the input shape is in the correct layout and we don't
-  // want to defer the copy onto a thread, we can use the following fast
-  // path.
+  // same memory space. If the input shape is in the correct layout we can
+  // skip the transfer manager and either alias or copy the input directly.
   bool is_cpu_platform =
       local_device->executor()->platform()->id() == se::host::kHostPlatformId;
-  if (is_cpu_platform) {
+  if (is_cpu_platform && shape.layout() == compact_shape.layout()) {
     // If we are on the host platform and the input buffer is sufficiently
     // aligned, we can simply point to the input array's data without any
     // further copies. At the time of writing we require a 16-byte alignment
@@ -605,29 +612,26 @@ StatusOr<std::unique_ptr<PjRtBuffer>> PjRtBuffer::FromHostBuffer(
         host_buffer_semantics == HostBufferSemantics::kZeroCopy &&
         ((absl::bit_cast<std::uintptr_t>(data) &
           (cpu_function_runtime::kMinAlign - 1)) == 0);
-    if (shape.layout() == compact_shape.layout() &&
-        (host_buffer_semantics ==
-             HostBufferSemantics::kImmutableOnlyDuringCall ||
-         can_use_zero_copy)) {
-      std::function<void()> on_delete_callback;
-      se::DeviceMemoryBase buffer;
-      // If we are on the host platform and the input buffer is sufficiently
-      // aligned, we can simply point to the input array's data without any
-      // further copies. At the time of writing we require a 16-byte alignment
-      // because XLA may generate code which requires it.
-      if (can_use_zero_copy) {
-        on_delete_callback = [buffer_reference{std::move(buffer_reference)}]() {
-          // Frees buffer_reference.
-        };
-        buffer = se::DeviceMemoryBase(const_cast<void*>(data), size);
-      } else {
-        void* staging_buffer = client->host_memory_allocator()->AllocateRaw(
-            cpu_function_runtime::kMinAlign, size);
-        on_delete_callback = [staging_buffer, client]() {
-          client->host_memory_allocator()->DeallocateRaw(staging_buffer);
-        };
-        buffer = se::DeviceMemoryBase(staging_buffer, size);
-        std::memcpy(staging_buffer, data, size);
+    std::function<void()> on_delete_callback;
+    se::DeviceMemoryBase buffer;
+    if (can_use_zero_copy) {
+      on_delete_callback = [buffer_reference{std::move(buffer_reference)}]() {
+        // Frees buffer_reference.
+      };
+      buffer = se::DeviceMemoryBase(const_cast<void*>(data), size);
+    } else {
+      StagingBufferPool* staging_buffer_pool = client->staging_buffer_pool();
+      void* staging_buffer = staging_buffer_pool->Allocate(size);
+      on_delete_callback = [staging_buffer, size, staging_buffer_pool]() {
+        staging_buffer_pool->Deallocate(staging_buffer, size);
+      };
+      buffer = se::DeviceMemoryBase(staging_buffer, size);
+    }
+    if (can_use_zero_copy ||
+        host_buffer_semantics ==
+            HostBufferSemantics::kImmutableOnlyDuringCall) {
+      if (!can_use_zero_copy) {
+        std::memcpy(buffer.opaque(), data, size);
       }
       absl::Span<const std::shared_ptr<BufferSequencingEvent>>
           definition_events;
@@ -638,6 +642,33 @@ StatusOr<std::unique_ptr<PjRtBuffer>> PjRtBuffer::FromHostBuffer(
       return absl::make_unique<PjRtBuffer>(
           shape, shape, std::move(device_buffer), client, device);
     }
+
+    // The caller keeps `data` alive until the transfer completes, so rather
+    // than copying on the calling thread we enqueue the copy on the
+    // host-to-device stream, which on CPU has its own thread. The copy then
+    // overlaps with computations running on the compute stream, and any
+    // execution that consumes the buffer waits on its definition event.
+    auto definition_event = std::make_shared<BufferSequencingEvent>();
+    auto device_buffer = std::make_shared<TrackedDeviceBuffer>(
+        /*allocator=*/nullptr, local_device->device_ordinal(),
+        std::initializer_list<se::DeviceMemoryBase>{buffer},
+        std::initializer_list<std::shared_ptr<BufferSequencingEvent>>{
+            definition_event},
+        std::move(on_delete_callback));
+    auto py_buffer = absl::make_unique<PjRtBuffer>(
+        shape, shape, std::move(device_buffer), client, device);
+    ScopedHold device_buffer_hold(py_buffer->GetBufferWithUsageHold());
+    CHECK(device_buffer_hold.ok());
+
+    se::Stream* h2d_stream = local_device->host_to_device_stream();
+    h2d_stream->ThenMemcpy(&buffer, data, size);
+    TF_RETURN_IF_ERROR(AddDestinationBufferSynchronization(
+        local_device, std::move(device_buffer_hold), definition_event,
+        h2d_stream));
+    // Releasing buffer_reference tells the caller that the transfer is
+    // complete and `data` may be mutated or freed.
+    local_device->ThenRelease(h2d_stream, std::move(buffer_reference));
+    return py_buffer;
   }
 
   TF_ASSIGN_OR_RETURN(
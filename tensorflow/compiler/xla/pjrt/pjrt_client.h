@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/client/xla_computation.h"
 #include "tensorflow/compiler/xla/layout.h"
 #include "tensorflow/compiler/xla/pjrt/local_device_state.h"
+#include "tensorflow/compiler/xla/pjrt/staging_buffer_pool.h"
 #include "tensorflow/compiler/xla/pjrt/tracked_device_buffer.h"
 #include "tensorflow/compiler/xla/service/computation_placer.h"
 #include "tensorflow/compiler/xla/service/gpu/gpu_executable_run_options.h"
@@ -157,6 +158,11 @@ class PjRtClient {
   tensorflow::Allocator* host_memory_allocator() const {
     return host_memory_allocator_.get();
   }
+  // Recycles staging buffers allocated on host_memory_allocator(). Used for
+  // host-to-device transfers on the CPU platform.
+  StagingBufferPool* staging_buffer_pool() const {
+    return staging_buffer_pool_.get();
+  }
   bool should_stage_host_to_device_transfers() const {
     return should_stage_host_to_device_transfers_;
   }
@@ -199,6 +205,7 @@ class PjRtClient {
 
   // Allocator to be used for staging memory transfers to devices.
   std::unique_ptr<tensorflow::Allocator> host_memory_allocator_;
+  std::unique_ptr<StagingBufferPool> staging_buffer_pool_;
 
   // Includes all devices, including non-local devices on multi-host platforms.
   std::vector<std::unique_ptr<Device>> devices_;
@@ -424,7 +431,9 @@ class PjRtBuffer {
     // promises not to mutate or free `data` until the transfer completes, at
     // which point the runtime will release `buffer_reference`. It is also
     // correct to wait on the host (directly or indirectly) for the buffer's
-    // definition event to complete.
+    // definition event to complete. On CPU the copy is enqueued on the
+    // host-to-device stream, so it overlaps with any computation already
+    // running on the device.
     kImmutableUntilTransferCompletes,
 
     // The PjRtBuffer may alias `data` internally and the runtime may use the
@@ -432,8 +441,9 @@ class PjRtBuffer {
     // The caller promises to keep `data` alive and not to mutate its contents
     // as long as the buffer is alive; to notify the caller that the buffer may
     // be freed, the runtime will release its `buffer_reference` when the
-    // PjRtBuffer is freed. On non-CPU platforms this acts identically to
-    // kImmutableUntilTransferCompletes.
+    // PjRtBuffer is freed. On non-CPU platforms, and on CPU if `data` is not
+    // sufficiently aligned or not in the default layout, this acts
+    // identically to kImmutableUntilTransferCompletes.
     kZeroCopy,
   };
   static StatusOr<std::unique_ptr<PjRtBuffer>> FromHostBuffer(
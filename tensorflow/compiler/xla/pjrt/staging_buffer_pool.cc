@@ -0,0 +1,79 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/pjrt/staging_buffer_pool.h"
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace xla {
+
+StagingBufferPool::StagingBufferPool(tensorflow::Allocator* allocator,
+                                     size_t alignment,
+                                     size_t max_buffers_per_size,
+                                     int64 max_cached_bytes)
+    : allocator_(allocator),
+      alignment_(alignment),
+      max_buffers_per_size_(max_buffers_per_size),
+      max_cached_bytes_(max_cached_bytes) {
+  CHECK(allocator_ != nullptr);
+}
+
+StagingBufferPool::~StagingBufferPool() {
+  absl::MutexLock lock(&mu_);
+  for (auto& size_and_buffers : free_buffers_) {
+    for (void* ptr : size_and_buffers.second) {
+      allocator_->DeallocateRaw(ptr);
+    }
+  }
+}
+
+void* StagingBufferPool::Allocate(size_t size) {
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = free_buffers_.find(size);
+    if (it != free_buffers_.end() && !it->second.empty()) {
+      void* ptr = it->second.back();
+      it->second.pop_back();
+      cached_bytes_ -= size;
+      return ptr;
+    }
+  }
+  return allocator_->AllocateRaw(alignment_, size);
+}
+
+void StagingBufferPool::Deallocate(void* ptr, size_t size) {
+  {
+    absl::MutexLock lock(&mu_);
+    auto it = free_buffers_.find(size);
+    size_t num_cached = it == free_buffers_.end() ? 0 : it->second.size();
+    if (num_cached < max_buffers_per_size_ &&
+        cached_bytes_ + static_cast<int64>(size) <= max_cached_bytes_) {
+      if (it == free_buffers_.end()) {
+        it = free_buffers_.emplace(size, std::vector<void*>()).first;
+      }
+      it->second.push_back(ptr);
+      cached_bytes_ += size;
+      return;
+    }
+  }
+  allocator_->DeallocateRaw(ptr);
+}
+
+int64 StagingBufferPool::cached_bytes() const {
+  absl::MutexLock lock(&mu_);
+  return cached_bytes_;
+}
+
+}  // namespace xla
@@ -0,0 +1,70 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_PJRT_STAGING_BUFFER_POOL_H_
+#define TENSORFLOW_COMPILER_XLA_PJRT_STAGING_BUFFER_POOL_H_
+
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/framework/allocator.h"
+
+namespace xla {
+
+// Recycles host buffers used to stage host-to-device transfers on the CPU
+// platform, where every freshly allocated large buffer costs a round of page
+// faults the first time it is written.
+//
+// Buffers are cached by size. Keeping `max_buffers_per_size` = 2 buffers of a
+// size double-buffers the inputs of back-to-back executions of the same
+// executable: the host fills one staging buffer while the computation that
+// consumes the other one is still running. The cache holds at most
+// `max_cached_bytes` bytes; buffers returned beyond that are freed.
+class StagingBufferPool {
+ public:
+  StagingBufferPool(tensorflow::Allocator* allocator, size_t alignment,
+                    size_t max_buffers_per_size, int64 max_cached_bytes);
+  ~StagingBufferPool();
+
+  StagingBufferPool(const StagingBufferPool&) = delete;
+  StagingBufferPool& operator=(const StagingBufferPool&) = delete;
+
+  // Returns a buffer of `size` bytes, reusing a cached one if possible.
+  void* Allocate(size_t size);
+
+  // Returns `ptr`, which must have been allocated by Allocate(size), to the
+  // pool.
+  void Deallocate(void* ptr, size_t size);
+
+  int64 cached_bytes() const;
+
+ private:
+  tensorflow::Allocator* const allocator_;
+  const size_t alignment_;
+  const size_t max_buffers_per_size_;
+  const int64 max_cached_bytes_;
+
+  mutable absl::Mutex mu_;
+  absl::flat_hash_map<size_t, std::vector<void*>> free_buffers_
+      ABSL_GUARDED_BY(mu_);
+  int64 cached_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_PJRT_STAGING_BUFFER_POOL_H_
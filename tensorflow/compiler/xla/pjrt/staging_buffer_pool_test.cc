@@ -0,0 +1,77 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/pjrt/staging_buffer_pool.h"
+
+#include "tensorflow/compiler/xla/test.h"
+#include "tensorflow/core/framework/allocator.h"
+
+namespace xla {
+namespace {
+
+constexpr size_t kAlignment = 64;
+
+TEST(StagingBufferPoolTest, ReusesBuffersOfTheSameSize) {
+  tensorflow::Allocator* allocator = tensorflow::cpu_allocator();
+  StagingBufferPool pool(allocator, kAlignment, /*max_buffers_per_size=*/2,
+                         /*max_cached_bytes=*/1 << 20);
+  void* a = pool.Allocate(1024);
+  void* b = pool.Allocate(1024);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % kAlignment, 0);
+  pool.Deallocate(a, 1024);
+  pool.Deallocate(b, 1024);
+  EXPECT_EQ(pool.cached_bytes(), 2048);
+
+  void* c = pool.Allocate(1024);
+  void* d = pool.Allocate(1024);
+  EXPECT_TRUE((c == a && d == b) || (c == b && d == a));
+  EXPECT_EQ(pool.cached_bytes(), 0);
+
+  // A buffer of a different size is never handed out for a cached size.
+  pool.Deallocate(c, 1024);
+  void* e = pool.Allocate(512);
+  EXPECT_NE(e, c);
+  pool.Deallocate(d, 1024);
+  pool.Deallocate(e, 512);
+  EXPECT_EQ(pool.cached_bytes(), 2048 + 512);
+}
+
+TEST(StagingBufferPoolTest, RespectsMaxBuffersPerSize) {
+  StagingBufferPool pool(tensorflow::cpu_allocator(), kAlignment,
+                         /*max_buffers_per_size=*/2,
+                         /*max_cached_bytes=*/1 << 20);
+  void* a = pool.Allocate(256);
+  void* b = pool.Allocate(256);
+  void* c = pool.Allocate(256);
+  pool.Deallocate(a, 256);
+  pool.Deallocate(b, 256);
+  pool.Deallocate(c, 256);
+  EXPECT_EQ(pool.cached_bytes(), 512);
+}
+
+TEST(StagingBufferPoolTest, RespectsMaxCachedBytes) {
+  StagingBufferPool pool(tensorflow::cpu_allocator(), kAlignment,
+                         /*max_buffers_per_size=*/2,
+                         /*max_cached_bytes=*/1000);
+  void* a = pool.Allocate(600);
+  void* b = pool.Allocate(600);
+  pool.Deallocate(a, 600);
+  pool.Deallocate(b, 600);
+  EXPECT_EQ(pool.cached_bytes(), 600);
+}
+
+}  // namespace
+}  // namespace xla
@@ -153,8 +153,9 @@ class AlgebraicSimplifierOptions {
   Metadata metadata_;
 };
 
-// A pass which performs algebraic simplifications.
-class AlgebraicSimplifier : public HloModulePass {
+// A pass which performs algebraic simplifications. Given a thread pool, it
+// simplifies independent computations concurrently.
+class AlgebraicSimplifier : public HloComputationPass {
  public:
   // If is_layout_sensitive is true, then the simplifier preserves layout during
   // transformation. Otherwise, layout is ignored.
@@ -163,9 +164,13 @@ class AlgebraicSimplifier : public HloModulePass {
   ~AlgebraicSimplifier() override = default;
   absl::string_view name() const override { return "algsimp"; }
 
+  // Run algebraic simplification on the given module. Returns whether the
+  // module was changed.
+  StatusOr<bool> Run(HloModule* module) override;
+
   // Run algebraic simplification on the given computation. Returns whether the
   // computation was changed.
-  StatusOr<bool> Run(HloModule* module) override;
+  StatusOr<bool> RunOnComputation(HloComputation* computation) override;
 
   // Create constant from literal with tiles and element size updated in the
   // constant's layout.
@@ -27,6 +27,7 @@ limitations under the License.
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/time/time.h"
 #include "tensorflow/compiler/xla/map_util.h"
 #include "tensorflow/compiler/xla/service/buffer_value_containers.h"
 #include "tensorflow/compiler/xla/service/heap_simulator.h"
@@ -1421,6 +1422,8 @@ Status BufferAssigner::AssignBuffersWithSequentialOrdering(
   // runs of alloc / free calls sorted in decreasing size order.
   const HloOrdering& hlo_ordering = assignment->hlo_ordering();
 
+  const DebugOptions& debug_options =
+      assignment->module().config().debug_options();
   // Returns a heap algorithm that chooses the best result from several
   // algorithms.
   auto get_heap_algorithm = [&](int64 alignment) {
@@ -1430,6 +1433,14 @@ Status BufferAssigner::AssignBuffersWithSequentialOrdering(
         alignment, GlobalDecreasingSizeBestFitHeap::kSpatial));
     algorithms->push_back(absl::make_unique<GlobalDecreasingSizeBestFitHeap>(
         alignment, GlobalDecreasingSizeBestFitHeap::kTemporal));
+    if (debug_options.xla_heap_interval_packing_trials() > 0) {
+      IntervalPackingHeap::Options options;
+      options.max_trials = debug_options.xla_heap_interval_packing_trials();
+      options.time_budget = absl::Milliseconds(
+          debug_options.xla_heap_interval_packing_time_budget_ms());
+      algorithms->push_back(
+          absl::make_unique<IntervalPackingHeap>(alignment, options));
+    }
     return absl::make_unique<ChooseBestHeapAlgorithm>(std::move(algorithms));
   };
 
@@ -18,6 +18,7 @@ limitations under the License.
 #include <stddef.h>
 #include <string.h>
 
+#include <limits>
 #include <map>
 #include <string>
 #include <unordered_map>
@@ -66,6 +67,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/cpu/cpu_layout_assignment.h"
 #include "tensorflow/compiler/xla/service/cpu/cpu_options.h"
 #include "tensorflow/compiler/xla/service/cpu/dot_op_emitter.h"
+#include "tensorflow/compiler/xla/service/cpu/inter_op_parallel_task_assignment.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_emission_utils.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_emitter.h"
 #include "tensorflow/compiler/xla/service/cpu/parallel_task_assignment.h"
@@ -79,6 +81,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/hlo.pb.h"
 #include "tensorflow/compiler/xla/service/hlo_computation.h"
 #include "tensorflow/compiler/xla/service/hlo_constant_folding.h"
+#include "tensorflow/compiler/xla/service/hlo_cost_analysis.h"
 #include "tensorflow/compiler/xla/service/hlo_cse.h"
 #include "tensorflow/compiler/xla/service/hlo_dce.h"
 #include "tensorflow/compiler/xla/service/hlo_element_type_converter.h"
@@ -90,6 +93,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/hlo_pass_fix.h"
 #include "tensorflow/compiler/xla/service/hlo_pass_pipeline.h"
 #include "tensorflow/compiler/xla/service/hlo_proto_util.h"
+#include "tensorflow/compiler/xla/service/hlo_rematerialization.h"
 #include "tensorflow/compiler/xla/service/hlo_subcomputation_unification.h"
 #include "tensorflow/compiler/xla/service/hlo_verifier.h"
 #include "tensorflow/compiler/xla/service/indexed_array_analysis.h"
@@ -117,6 +121,8 @@ limitations under the License.
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_data.pb.h"
 #include "tensorflow/core/platform/dynamic_annotations.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace xla {
 namespace cpu {
@@ -175,6 +181,47 @@ namespace {
 // first module is compiled.
 absl::once_flag llvm_command_line_options_initialized;
 
+// The minimum cost, in flops and bytes accessed, of an instruction worth
+// running as an inter-op task, so that it amortizes dispatching the task to the
+// thread pool.
+constexpr int64 kMinInterOpTaskCost = 1 << 16;
+
+// Throughput of a single core assumed when estimating the cost of recomputing
+// an instruction for rematerialization. Only the ratios matter: they decide
+// whether recomputing an instruction is bound by arithmetic or memory traffic.
+constexpr float kRematFlopsPerSecond = 1e10;
+constexpr float kRematTranscendentalsPerSecond = 1e9;
+constexpr float kRematBytesPerSecond = 1e10;
+
+// Returns a function which estimates the time it takes to recompute an
+// instruction from its HloCostAnalysis flop, transcendental and bytes accessed
+// counts, for use by HloRematerialization.
+HloRematerialization::RecomputeCostFunction RematerializationRecomputeCost(
+    const HloCostAnalysis::ShapeSizeFunction& shape_size) {
+  return [shape_size](HloInstruction* instruction) -> double {
+    HloCostAnalysis cost_analysis(shape_size);
+    cost_analysis.set_flops_per_second(kRematFlopsPerSecond);
+    cost_analysis.set_transcendentals_per_second(
+        kRematTranscendentalsPerSecond);
+    cost_analysis.set_bytes_per_second(kRematBytesPerSecond);
+    Status status = cost_analysis.Preprocess(instruction);
+    if (status.ok()) {
+      status = instruction->Visit(&cost_analysis);
+    }
+    if (status.ok()) {
+      status = cost_analysis.Postprocess(instruction);
+    }
+    if (!status.ok()) {
+      // HloCostAnalysis does not support every instruction; prefer not to
+      // recompute the ones it can't estimate.
+      VLOG(2) << "No recompute cost for " << instruction->name() << ": "
+              << status;
+      return std::numeric_limits<double>::infinity();
+    }
+    return cost_analysis.optimal_seconds(*instruction);
+  };
+}
+
 // This visitor records which HLO instructions should have profiling information
 // recorded.
 class CollectProfileCandidates : public DfsHloVisitorWithDefault {
@@ -237,12 +284,28 @@ class CollectProfileCandidates : public DfsHloVisitorWithDefault {
   const std::unordered_map<const HloInstruction*, int64>& assigned_indices_;
 };
 
+// Returns the thread pool on which passes process the computations of `module`
+// concurrently, or null to run them sequentially.
+std::unique_ptr<tensorflow::thread::ThreadPool> CreatePassThreadPool(
+    const HloModule& module) {
+  const int num_threads =
+      module.config().debug_options().xla_hlo_pass_num_threads();
+  if (num_threads <= 1) {
+    return nullptr;
+  }
+  return absl::make_unique<tensorflow::thread::ThreadPool>(
+      tensorflow::Env::Default(), "xla_hlo_pass", num_threads);
+}
+
 }  // namespace
 
 Status CpuCompiler::RunHloPassesThroughLayoutAssn(
     HloModule* module, bool /*is_aot_compile*/,
     LLVMTargetMachineFeatures* target_machine_features) {
   HloPassPipeline pipeline("HLO passes through layout assignment");
+  std::unique_ptr<tensorflow::thread::ThreadPool> thread_pool =
+      CreatePassThreadPool(*module);
+  pipeline.SetThreadPool(thread_pool.get());
   pipeline.AddInvariantChecker<HloVerifier>(/*layout_sensitive=*/false,
                                             /*allow_mixed_precision=*/false);
   // Expand random number generation.
@@ -337,7 +400,13 @@ Status CpuCompiler::RunHloPassesThroughLayoutAssn(
       module->mutable_entry_computation_layout(),
       LayoutAssignment::InstructionCanChangeLayout, target_machine_features);
 
-  pipeline.AddPass<CpuInstructionFusion>();
+  FusionProfile* fusion_profile = nullptr;
+  if (absl::optional<string> fusion_profile_path =
+          options::FusionProfilePath(module->config())) {
+    TF_ASSIGN_OR_RETURN(fusion_profile,
+                        FusionProfile::GetOrLoad(*fusion_profile_path));
+  }
+  pipeline.AddPass<CpuInstructionFusion>(fusion_profile);
 
   return pipeline.Run(module).status();
 }
@@ -346,6 +415,9 @@ Status CpuCompiler::RunHloPassesAfterLayoutAssn(
     HloModule* module, bool is_aot_compile,
     LLVMTargetMachineFeatures* target_machine_features) {
   HloPassPipeline pipeline("HLO passes after layout assignment");
+  std::unique_ptr<tensorflow::thread::ThreadPool> thread_pool =
+      CreatePassThreadPool(*module);
+  pipeline.SetThreadPool(thread_pool.get());
   // After layout assignment, use a layout-sensitive verifier.
 
   pipeline.AddPass<HloPassPipeline>("after layout assignment")
@@ -372,6 +444,24 @@ Status CpuCompiler::RunHloPassesAfterLayoutAssn(
 
   pipeline.AddPass<HloElementTypeConverter>(BF16, F32);
 
+  // If the module has a memory budget, rematerialize values to bring its peak
+  // memory use under it, recomputing the instructions which are cheapest per
+  // byte saved. Rematerialization needs a schedule; the module is scheduled
+  // again for buffer assignment, so it is dropped afterwards.
+  if (absl::optional<int64> memory_limit_bytes =
+          options::RematerializationMemoryLimitBytes(module->config())) {
+    pipeline.AddPass<HloMemoryScheduler>(
+        BufferSizeBytesFunction(),
+        ComputationSchedulerToModuleScheduler(DFSMemoryScheduler));
+    pipeline.AddPass<HloRematerialization>(
+        ShapeSizeBytesFunction(), *memory_limit_bytes, /*sizes=*/nullptr,
+        HloRematerialization::RematerializationPass::kPostFusion,
+        /*block_size_limit=*/1, /*compact_shape_function=*/nullptr,
+        HloRematerialization::RematerializationMode::kRecomputeOnly,
+        RematerializationRecomputeCost(ShapeSizeBytesFunction()));
+    pipeline.AddPass<HloDescheduler>();
+  }
+
   // Outline ops in the entry computation into calls to subcomputations.
   const int max_parallelism =
       module->config().intra_op_parallelism_threads() > 0
@@ -385,6 +475,16 @@ Status CpuCompiler::RunHloPassesAfterLayoutAssn(
     // TODO(b/29630486) Support multi-threaded AOT.
     pipeline.AddPass<ParallelTaskAssigner>(
         max_parallelism, ShapeSizeBytesFunction(), target_machine_features);
+    // Group the instructions which ParallelTaskAssigner left on a single
+    // thread, but which are independent of each other, into task graphs which
+    // run them concurrently. Profile counters would be updated concurrently,
+    // so this is disabled when profiling.
+    if (options::InterOpParallelismEnabled(module->config()) &&
+        !module->config().hlo_profiling_enabled()) {
+      pipeline.AddPass<InterOpParallelTaskAssigner>(
+          kMinInterOpTaskCost, /*max_tasks_per_graph=*/4 * max_parallelism,
+          ShapeSizeBytesFunction());
+    }
   }
   // Copy insertion should be performed immediately before IR emission to
   // avoid inserting unnecessary copies (later pass adds an instruction which
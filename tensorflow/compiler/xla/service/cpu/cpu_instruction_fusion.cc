@@ -15,9 +15,17 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/service/cpu/cpu_instruction_fusion.h"
 
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/service/fusion_node_indexing_evaluation.h"
 #include "tensorflow/compiler/xla/service/hlo_opcode.h"
 #include "tensorflow/compiler/xla/service/llvm_ir/fused_ir_emitter.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/status_macros.h"
+#include "tensorflow/core/platform/env.h"
 
 namespace xla {
 namespace cpu {
@@ -66,8 +74,116 @@ bool CanBeOutputFusedIntoSomeOperand(const HloInstruction* consumer) {
          (CanBeOutputFused(consumer->operand(0), consumer) ||
           CanBeOutputFused(consumer->operand(1), consumer));
 }
+
+// Returns the name of the instruction printed as `short_name` in an
+// HloProfilePrinterData, i.e. "foo" for "%foo = f32[] ...".
+absl::string_view InstructionNameFromShortName(absl::string_view short_name) {
+  if (!absl::ConsumePrefix(&short_name, "%")) {
+    return absl::string_view();
+  }
+  return short_name.substr(0, short_name.find(" = "));
+}
+
+// Returns `short_name` without the layouts of the shapes in it, i.e.
+// "%foo = f32[2,3] add(f32[2,3], ...)" for
+// "%foo = f32[2,3]{1,0} add(f32[2,3]{1,0}, ...)".
+std::string StripLayouts(absl::string_view short_name) {
+  std::string stripped;
+  stripped.reserve(short_name.size());
+  for (size_t i = 0; i < short_name.size(); ++i) {
+    // A layout follows the closing bracket of the dimensions of an array.
+    if (short_name[i] == '{' && i > 0 && short_name[i - 1] == ']') {
+      const size_t end = short_name.find('}', i);
+      if (end != absl::string_view::npos) {
+        i = end;
+        continue;
+      }
+    }
+    stripped.push_back(short_name[i]);
+  }
+  return stripped;
+}
 }  // namespace
 
+FusionProfile::FusionProfile(const HloExecutionProfileData& profile_data) {
+  const auto& counters = profile_data.profile_counters();
+  for (const auto& computation_info :
+       profile_data.printer_data().computation_infos()) {
+    for (const auto& instruction_info : computation_info.instruction_infos()) {
+      absl::string_view name =
+          InstructionNameFromShortName(instruction_info.short_name());
+      const int64 index = instruction_info.profile_index();
+      // Instructions that never ran, e.g. in a branch that was not taken, have
+      // no meaningful timing.
+      if (name.empty() || index < 0 || index >= counters.size() ||
+          counters.Get(index) <= 0) {
+        continue;
+      }
+      timings_[name] = {StripLayouts(instruction_info.short_name()),
+                        counters.Get(index)};
+    }
+  }
+}
+
+/*static*/ StatusOr<FusionProfile*> FusionProfile::GetOrLoad(
+    const std::string& path) {
+  static tensorflow::mutex mu(tensorflow::LINKER_INITIALIZED);
+  static auto* profiles =
+      new absl::flat_hash_map<std::string, std::unique_ptr<FusionProfile>>();
+  tensorflow::mutex_lock lock(mu);
+  std::unique_ptr<FusionProfile>& profile = (*profiles)[path];
+  if (profile == nullptr) {
+    HloExecutionProfileData profile_data;
+    Status status = tensorflow::ReadBinaryProto(tensorflow::Env::Default(),
+                                                path, &profile_data);
+    if (!status.ok()) {
+      profiles->erase(path);
+      return status;
+    }
+    profile = absl::make_unique<FusionProfile>(profile_data);
+  }
+  return profile.get();
+}
+
+absl::optional<double> FusionProfile::CyclesPerElement(
+    const HloInstruction& instruction) const {
+  auto it = timings_.find(instruction.name());
+  if (it == timings_.end()) {
+    return absl::nullopt;
+  }
+  // The module may have changed since it was profiled, so only use the timing
+  // if the instruction still has the same shape and opcode.
+  const std::string expected_prefix =
+      absl::StrCat("%", instruction.name(), " = ",
+                   ShapeUtil::HumanString(instruction.shape()), " ",
+                   HloOpcodeString(instruction.opcode()), "(");
+  if (!absl::StartsWith(it->second.short_name, expected_prefix)) {
+    return absl::nullopt;
+  }
+  return static_cast<double>(it->second.cycles) /
+         std::max<int64>(ShapeUtil::ElementsInRecursive(instruction.shape()),
+                         1);
+}
+
+/*static*/ bool CpuInstructionFusion::IsExpensive(
+    const FusionProfile* profile, const HloInstruction& instruction) {
+  // An instruction is expensive if computing an element costs significantly
+  // more than writing it out.  Timings of small instructions are dominated by
+  // fixed overheads, so they are not used.
+  constexpr double kExpensiveCyclesPerElement = 4.0;
+  constexpr int64 kMinElementsForProfile = 1024;
+  if (profile != nullptr &&
+      ShapeUtil::ElementsInRecursive(instruction.shape()) >=
+          kMinElementsForProfile) {
+    absl::optional<double> cycles_per_element =
+        profile->CyclesPerElement(instruction);
+    if (cycles_per_element.has_value()) {
+      return *cycles_per_element > kExpensiveCyclesPerElement;
+    }
+  }
+  return InstructionFusion::IsExpensive(instruction);
+}
+
 bool CpuInstructionFusion::ShouldFuse(HloInstruction* consumer,
                                       int64 operand_index) {
   HloInstruction* producer = consumer->mutable_operand(operand_index);
@@ -16,18 +16,60 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_XLA_SERVICE_CPU_CPU_INSTRUCTION_FUSION_H_
 #define TENSORFLOW_COMPILER_XLA_SERVICE_CPU_CPU_INSTRUCTION_FUSION_H_
 
+#include <string>
+
 #include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
 #include "tensorflow/compiler/xla/service/fusion_node_indexing_evaluation.h"
+#include "tensorflow/compiler/xla/service/hlo_execution_profile_data.pb.h"
 #include "tensorflow/compiler/xla/service/hlo_instruction.h"
 #include "tensorflow/compiler/xla/service/instruction_fusion.h"
+#include "tensorflow/compiler/xla/statusor.h"
 
 namespace xla {
 namespace cpu {
 
+// Per-instruction timings from an earlier, profiled run of a module, used to
+// guide fusion decisions when the module is compiled again.  The timings are
+// read from the HloExecutionProfileData that XLA dumps for runs with
+// --xla_hlo_profile and --xla_dump_to.
+class FusionProfile {
+ public:
+  explicit FusionProfile(const HloExecutionProfileData& profile_data);
+
+  // Returns the FusionProfile for the HloExecutionProfileData serialized in
+  // the file at `path`.  The file is read once per process; later calls with
+  // the same path return the same FusionProfile.
+  static StatusOr<FusionProfile*> GetOrLoad(const std::string& path);
+
+  // Returns the number of cycles per element of its output that `instruction`
+  // took in the profiled run, or nullopt if the profile has no timing for it.
+  // Instructions that were fused in the profiled run have no timing of their
+  // own.
+  absl::optional<double> CyclesPerElement(
+      const HloInstruction& instruction) const;
+
+ private:
+  struct InstructionTiming {
+    // The instruction as printed in the profile with its layouts removed,
+    // used to check that it still has the same shape and opcode.  Fusion runs
+    // before layout assignment, so layouts are not compared.
+    std::string short_name;
+    int64 cycles;
+  };
+
+  absl::flat_hash_map<std::string, InstructionTiming> timings_;
+};
+
 class CpuInstructionFusion : public InstructionFusion {
  public:
-  CpuInstructionFusion()
-      : InstructionFusion(CpuInstructionFusion::IsExpensive) {}
+  // If `profile` is not null, instructions it has timings for are considered
+  // expensive based on those timings rather than on their opcode.
+  explicit CpuInstructionFusion(FusionProfile* profile = nullptr)
+      : InstructionFusion([profile](const HloInstruction& instruction) {
+          return IsExpensive(profile, instruction);
+        }),
+        profile_(profile) {}
   ~CpuInstructionFusion() override = default;
 
   StatusOr<bool> Run(HloModule* module) override {
@@ -35,6 +77,11 @@ class CpuInstructionFusion : public InstructionFusion {
     return InstructionFusion::Run(module);
   }
 
+  // Returns whether `instruction` is expensive, as InstructionFusion::
+  // IsExpensive, but measured by its timing in `profile` when there is one.
+  static bool IsExpensive(const FusionProfile* profile,
+                          const HloInstruction& instruction);
+
  protected:
   bool ShouldFuse(HloInstruction* consumer, int64 operand_index) override;
   HloInstruction::FusionKind ChooseKind(
@@ -48,6 +95,8 @@ class CpuInstructionFusion : public InstructionFusion {
   // indexed with different index vectors.
   absl::flat_hash_map<const HloInstruction*, FusionNodeIndexingEvaluation>
       fusion_node_evaluations_;
+
+  FusionProfile* profile_;
 };
 
 }  // namespace cpu
@@ -21,6 +21,7 @@ limitations under the License.
 
 #include "absl/strings/str_cat.h"
 #include "absl/types/span.h"
+#include "tensorflow/compiler/xla/service/hlo_execution_profile_data.pb.h"
 #include "tensorflow/compiler/xla/service/hlo_matchers.h"
 #include "tensorflow/compiler/xla/service/transpose_folding.h"
 #include "tensorflow/compiler/xla/shape.h"
@@ -945,6 +946,125 @@ ENTRY main {
   EXPECT_TRUE(fused_something);
   EXPECT_THAT(module->entry_computation()->root_instruction(), op::Fusion());
 }
+
+// Returns profile data in which each instruction of `module` named in
+// `cycles` took the given number of cycles, printed the way
+// HloExecutionProfile prints it.
+HloExecutionProfileData MakeProfileData(
+    HloModule* module, const std::vector<std::pair<string, int64>>& cycles) {
+  HloExecutionProfileData profile_data;
+  auto* computation_info =
+      profile_data.mutable_printer_data()->add_computation_infos();
+  computation_info->set_name(module->entry_computation()->name());
+  for (const auto& instruction_cycles : cycles) {
+    const HloInstruction* instruction =
+        module->entry_computation()->GetInstructionWithName(
+            instruction_cycles.first);
+    auto* instruction_info = computation_info->add_instruction_infos();
+    instruction_info->set_short_name(instruction->ToString(
+        HloPrintOptions().set_compact_operands(true).set_print_operand_names(
+            false)));
+    instruction_info->set_profile_index(profile_data.profile_counters_size());
+    profile_data.add_profile_counters(instruction_cycles.second);
+  }
+  return profile_data;
+}
+
+TEST_F(InstructionFusionTest, ProfileShowsTranscendentalIsCheap) {
+  absl::string_view module_string = R"(
+HloModule module
+
+ENTRY main {
+  p0 = f32[4096]{0} parameter(0)
+  exp = f32[4096]{0} exponential(p0)
+  neg = f32[4096]{0} negate(exp)
+  abs = f32[4096]{0} abs(exp)
+  ROOT tuple = (f32[4096]{0}, f32[4096]{0}) tuple(neg, abs)
+}
+)";
+
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(module_string));
+  // Without a profile the exponential is too expensive to duplicate.
+  TF_ASSERT_OK_AND_ASSIGN(bool fused_something,
+                          CpuInstructionFusion().Run(module.get()));
+  EXPECT_FALSE(fused_something);
+
+  FusionProfile profile(MakeProfileData(module.get(), {{"exp", 4096}}));
+  TF_ASSERT_OK_AND_ASSIGN(fused_something,
+                          CpuInstructionFusion(&profile).Run(module.get()));
+  EXPECT_TRUE(fused_something);
+  EXPECT_THAT(module->entry_computation()->root_instruction(),
+              op::Tuple(op::Fusion(), op::Fusion()));
+}
+
+TEST_F(InstructionFusionTest, ProfileShowsElementwiseOpIsExpensive) {
+  absl::string_view module_string = R"(
+HloModule module
+
+ENTRY main {
+  p0 = f32[4096]{0} parameter(0)
+  p1 = f32[4096]{0} parameter(1)
+  add = f32[4096]{0} add(p0, p1)
+  neg = f32[4096]{0} negate(add)
+  abs = f32[4096]{0} abs(add)
+  ROOT tuple = (f32[4096]{0}, f32[4096]{0}) tuple(neg, abs)
+}
+)";
+
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(module_string));
+  FusionProfile profile(MakeProfileData(module.get(), {{"add", 20 * 4096}}));
+  TF_ASSERT_OK_AND_ASSIGN(bool fused_something,
+                          CpuInstructionFusion(&profile).Run(module.get()));
+  EXPECT_FALSE(fused_something);
+  EXPECT_THAT(module->entry_computation()->root_instruction(),
+              op::Tuple(op::Negate(op::Add()), op::Abs(op::Add())));
+}
+
+TEST_F(InstructionFusionTest, ProfileIgnoresLayouts) {
+  // The profile is taken from a module after layout assignment, but fusion
+  // runs before it, so the layouts in the profile may differ.
+  absl::string_view profiled_module_string = R"(
+HloModule module
+
+ENTRY main {
+  p0 = f32[64,64]{0,1} parameter(0)
+  exp = f32[64,64]{0,1} exponential(p0)
+  neg = f32[64,64]{0,1} negate(exp)
+  abs = f32[64,64]{0,1} abs(exp)
+  ROOT tuple = (f32[64,64]{0,1}, f32[64,64]{0,1}) tuple(neg, abs)
+}
+)";
+  absl::string_view module_string = R"(
+HloModule module
+
+ENTRY main {
+  p0 = f32[64,64]{1,0} parameter(0)
+  exp = f32[64,64]{1,0} exponential(p0)
+  neg = f32[64,64]{1,0} negate(exp)
+  abs = f32[64,64]{1,0} abs(exp)
+  ROOT tuple = (f32[64,64]{1,0}, f32[64,64]{1,0}) tuple(neg, abs)
+}
+)";
+
+  TF_ASSERT_OK_AND_ASSIGN(auto profiled_module,
+                          ParseAndReturnVerifiedModule(profiled_module_string));
+  TF_ASSERT_OK_AND_ASSIGN(auto module,
+                          ParseAndReturnVerifiedModule(module_string));
+  FusionProfile profile(
+      MakeProfileData(profiled_module.get(), {{"exp", 4096}}));
+  ASSERT_TRUE(profile
+                  .CyclesPerElement(*module->entry_computation()
+                                         ->GetInstructionWithName("exp"))
+                  .has_value());
+  TF_ASSERT_OK_AND_ASSIGN(bool fused_something,
+                          CpuInstructionFusion(&profile).Run(module.get()));
+  EXPECT_TRUE(fused_something);
+  EXPECT_THAT(module->entry_computation()->root_instruction(),
+              op::Tuple(op::Fusion(), op::Fusion()));
+}
+
 }  // namespace
 }  // namespace cpu
 }  // namespace xla
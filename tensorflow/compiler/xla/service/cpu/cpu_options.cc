@@ -27,6 +27,11 @@ const char* const kXlaForceEnableExperimentalLlvmIrGemm =
     "xla_force_enable_experimental_llvm_ir_gemm";
 const char* const kXlaUseLinalgForDot = "xla_use_linalg_for_dot";
 const char* const kLlvmIrGemmTileSize = "xla_llvm_ir_gemm_tile_size";
+const char* const kLlvmIrGemmMaxCost = "xla_llvm_ir_gemm_max_cost";
+const char* const kXlaCpuInterOpParallelism = "xla_cpu_inter_op_parallelism";
+const char* const kXlaCpuFusionProfile = "xla_cpu_fusion_profile";
+const char* const kXlaCpuRematerializationMemoryLimit =
+    "xla_cpu_rematerialization_memory_limit_bytes";
 
 }  // namespace
 
@@ -58,6 +63,32 @@ absl::optional<int64> LlvmIrGemvTilingFactor(const HloModuleConfig& config) {
   return absl::nullopt;
 }
 
+absl::optional<int64> LlvmIrGemmMaxCost(const HloModuleConfig& config) {
+  const auto& extra_options_map =
+      config.debug_options().xla_backend_extra_options();
+  auto it = extra_options_map.find(kLlvmIrGemmMaxCost);
+  int64 max_cost;
+  if (it != extra_options_map.end() &&
+      absl::SimpleAtoi(it->second, &max_cost)) {
+    return max_cost;
+  }
+  return absl::nullopt;
+}
+
+absl::optional<int64> RematerializationMemoryLimitBytes(
+    const HloModuleConfig& config) {
+  const auto& extra_options_map =
+      config.debug_options().xla_backend_extra_options();
+  auto it = extra_options_map.find(kXlaCpuRematerializationMemoryLimit);
+  int64 memory_limit_bytes;
+  if (it != extra_options_map.end() &&
+      absl::SimpleAtoi(it->second, &memory_limit_bytes) &&
+      memory_limit_bytes > 0) {
+    return memory_limit_bytes;
+  }
+  return absl::nullopt;
+}
+
 bool ForceEnableExperimentalLlvmIrGemm(const HloModuleConfig& config) {
   const auto& extra_options_map =
       config.debug_options().xla_backend_extra_options();
@@ -70,6 +101,22 @@ bool UseLinalgForDot(const HloModuleConfig& config) {
   return extra_options_map.count(kXlaUseLinalgForDot) > 0;
 }
 
+bool InterOpParallelismEnabled(const HloModuleConfig& config) {
+  const auto& extra_options_map =
+      config.debug_options().xla_backend_extra_options();
+  return extra_options_map.count(kXlaCpuInterOpParallelism) > 0;
+}
+
+absl::optional<string> FusionProfilePath(const HloModuleConfig& config) {
+  const auto& extra_options_map =
+      config.debug_options().xla_backend_extra_options();
+  auto it = extra_options_map.find(kXlaCpuFusionProfile);
+  if (it == extra_options_map.end() || it->second.empty()) {
+    return absl::nullopt;
+  }
+  return it->second;
+}
+
 static absl::string_view RemoveSuffix(absl::string_view str,
                                       absl::string_view suffix) {
   CHECK_GE(str.size(), suffix.size());
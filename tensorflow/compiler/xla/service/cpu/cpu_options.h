@@ -28,7 +28,12 @@ bool OptimizeForSizeRequested(const HloModuleConfig& config);
 bool VectorizedReduceDisabled(const HloModuleConfig& config);
 bool ForceEnableExperimentalLlvmIrGemm(const HloModuleConfig& config);
 bool UseLinalgForDot(const HloModuleConfig& config);
+bool InterOpParallelismEnabled(const HloModuleConfig& config);
+absl::optional<string> FusionProfilePath(const HloModuleConfig& config);
 absl::optional<int64> LlvmIrGemvTilingFactor(const HloModuleConfig& config);
+absl::optional<int64> LlvmIrGemmMaxCost(const HloModuleConfig& config);
+absl::optional<int64> RematerializationMemoryLimitBytes(
+    const HloModuleConfig& config);
 absl::optional<std::tuple<int64, int64, int64>> LlvmIrGemmTileSize(
     const HloModuleConfig& config);
 
@@ -927,25 +927,39 @@ bool IsAlignedGemm(const DotInfo& dot_info,
                        dot_info.result_shape, target_machine_features);
 }
 
+// Returns the largest GEMM, measured in multiply-adds, that we lower to the
+// tiled LLVM IR kernel instead of calling into Eigen.
+int64 GetLlvmIrGemmMaxCost(const HloModuleConfig& config) {
+  // Multi-threaded Eigen can split up mid-sized GEMMs, so the single-threaded
+  // tiled kernel only wins for smaller ones.
+  const int64 kDefaultMaxCost = 128 * 128 * 32;
+  const int64 kDefaultMaxCostWithMultiThreadedEigen = 64 * 64 * 32;
+  return options::LlvmIrGemmMaxCost(config).value_or(
+      ShouldUseMultiThreadedEigen(config)
+          ? kDefaultMaxCostWithMultiThreadedEigen
+          : kDefaultMaxCost);
+}
+
 bool CanEmitTiledLlvmIrGemm(
     const HloModuleConfig& config, const DotInfo& dot_info,
     const TargetMachineFeatures& target_machine_features) {
   CHECK(IsAlignedGemm(dot_info, target_machine_features));
 
-  if (ShouldUseMultiThreadedEigen(config)) {
-    return false;
-  }
-
-  int m = dot_info.result_shape.dimensions(0);
-  int k = dot_info.lhs_shape.dimensions(
+  int64 m = dot_info.result_shape.dimensions(0);
+  int64 k = dot_info.lhs_shape.dimensions(
       dot_info.dim_nums.lhs_contracting_dimensions(0));
-  int n = dot_info.result_shape.dimensions(1);
+  int64 n = dot_info.result_shape.dimensions(1);
 
   if (!options::ForceEnableExperimentalLlvmIrGemm(config)) {
+    // The tiled kernel does no cache blocking, so it is only used for GEMMs
+    // whose operands fit in cache and whose cost, in multiply-adds, is low
+    // enough that calling into Eigen (packing the operands and, when Eigen is
+    // multi-threaded, handing the work to the thread pool) would dominate.
+    //
     // TODO(sanjoy):  We should make these numbers micro-arch specific.
-    bool small_gemm =
-        k <= 128 && ((m <= 32 && n <= 128) || (m <= 128 && n <= 32));
-    if (!small_gemm) {
+    const int64 kMaxDimension = 128;
+    if (m > kMaxDimension || k > kMaxDimension || n > kMaxDimension ||
+        m * k * n > GetLlvmIrGemmMaxCost(config)) {
       return false;
     }
   }
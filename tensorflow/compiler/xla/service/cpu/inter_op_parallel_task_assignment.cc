@@ -0,0 +1,264 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/inter_op_parallel_task_assignment.h"
+
+#include <memory>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/map_util.h"
+#include "tensorflow/compiler/xla/service/hlo_opcode.h"
+#include "tensorflow/compiler/xla/service/hlo_reachability.h"
+
+namespace xla {
+namespace cpu {
+
+bool CanRunAsInterOpTask(const HloInstruction& instruction,
+                         const HloModuleConfig& config) {
+  if (instruction.HasSideEffect() ||
+      !instruction.control_predecessors().empty() ||
+      !instruction.control_successors().empty()) {
+    return false;
+  }
+  switch (instruction.opcode()) {
+    case HloOpcode::kFusion:
+      // Output fusions hold dots, which may be lowered to Eigen.
+      return instruction.fusion_kind() == HloInstruction::FusionKind::kLoop ||
+             instruction.fusion_kind() == HloInstruction::FusionKind::kInput;
+    case HloOpcode::kDot:
+    case HloOpcode::kConvolution:
+      // Multi-threaded Eigen kernels run on the intra-op thread pool
+      // themselves, and block the calling thread until they are done.
+      return !config.debug_options().xla_cpu_multi_thread_eigen();
+    case HloOpcode::kBroadcast:
+    case HloOpcode::kConcatenate:
+    case HloOpcode::kDynamicSlice:
+    case HloOpcode::kPad:
+    case HloOpcode::kReduce:
+    case HloOpcode::kReduceWindow:
+    case HloOpcode::kReverse:
+    case HloOpcode::kSlice:
+    case HloOpcode::kTranspose:
+      return true;
+    default:
+      return instruction.IsElementwise();
+  }
+}
+
+bool IsInterOpTaskGraph(const HloComputation& computation) {
+  const HloInstruction* root = computation.root_instruction();
+  if (root->opcode() != HloOpcode::kTuple) {
+    return false;
+  }
+  const absl::flat_hash_set<const HloInstruction*> root_operands(
+      root->operands().begin(), root->operands().end());
+  int64 num_tasks = 0;
+  for (const HloInstruction* instruction : computation.instructions()) {
+    if (instruction == root) {
+      continue;
+    }
+    if (!root_operands.contains(instruction)) {
+      return false;
+    }
+    if (instruction->opcode() == HloOpcode::kParameter) {
+      continue;
+    }
+    if (instruction->opcode() != HloOpcode::kCall) {
+      return false;
+    }
+    const HloComputation* task = instruction->to_apply();
+    const HloInstruction* task_root = task->root_instruction();
+    if (task->instruction_count() != task->num_parameters() + 1 ||
+        task_root->opcode() == HloOpcode::kParameter ||
+        !task_root->outer_dimension_partitions().empty() ||
+        !CanRunAsInterOpTask(*task_root, computation.parent()->config())) {
+      return false;
+    }
+    ++num_tasks;
+  }
+  return num_tasks > 1;
+}
+
+namespace {
+
+// Returns true if some two instructions of 'group' may run concurrently.
+bool HasIndependentInstructions(absl::Span<HloInstruction* const> group,
+                                const HloReachabilityMap& reachability) {
+  for (int64 i = 0; i < group.size(); ++i) {
+    for (int64 j = i + 1; j < group.size(); ++j) {
+      if (!reachability.IsConnected(group[i], group[j])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+StatusOr<std::vector<std::vector<HloInstruction*>>>
+InterOpParallelTaskAssigner::FindTaskGroups(HloComputation* computation) {
+  HloCostAnalysis cost_analysis(shape_size_function_);
+  TF_RETURN_IF_ERROR(computation->Accept(&cost_analysis));
+  const HloModuleConfig& config = computation->parent()->config();
+  auto is_task = [&](const HloInstruction* instruction) {
+    return CanRunAsInterOpTask(*instruction, config) &&
+           cost_analysis.flop_count(*instruction) +
+                   cost_analysis.transcendental_count(*instruction) +
+                   cost_analysis.bytes_accessed(*instruction) >=
+               min_task_cost_;
+  };
+
+  const std::vector<HloInstruction*> post_order =
+      computation->MakeInstructionPostOrder();
+  std::unique_ptr<HloReachabilityMap> reachability =
+      HloReachabilityMap::Build(computation);
+
+  // Tasks are grouped greedily in post order. A group must stay convex: a
+  // path between two of its instructions must not leave the group, or the
+  // task graph and the instructions on that path would depend on each other.
+  std::vector<std::vector<HloInstruction*>> groups;
+  std::vector<HloInstruction*> group;
+  absl::flat_hash_set<const HloInstruction*> in_group;
+  // The position in 'post_order' of the first instruction of 'group'.
+  int64 group_start = 0;
+  auto close_group = [&]() {
+    if (HasIndependentInstructions(group, *reachability)) {
+      groups.push_back(group);
+    }
+    group.clear();
+    in_group.clear();
+  };
+  for (int64 i = 0; i < post_order.size(); ++i) {
+    HloInstruction* instruction = post_order[i];
+    if (!is_task(instruction)) {
+      continue;
+    }
+    // Instructions which come later in post order can't reach 'instruction',
+    // so only those between the group and it may make a path leave the group.
+    bool convex = group.size() < max_tasks_per_graph_;
+    for (int64 j = group_start; convex && !group.empty() && j < i; ++j) {
+      const HloInstruction* other = post_order[j];
+      if (in_group.contains(other) ||
+          !reachability->IsReachable(other, instruction)) {
+        continue;
+      }
+      for (const HloInstruction* member : group) {
+        if (reachability->IsReachable(member, other)) {
+          convex = false;
+          break;
+        }
+      }
+    }
+    if (!convex) {
+      close_group();
+    }
+    if (group.empty()) {
+      group_start = i;
+    }
+    group.push_back(instruction);
+    in_group.insert(instruction);
+  }
+  close_group();
+  return std::move(groups);
+}
+
+void InterOpParallelTaskAssigner::OutlineTaskGraph(
+    absl::Span<HloInstruction* const> group, HloComputation* computation) {
+  HloModule* module = computation->parent();
+  HloComputation::Builder builder(
+      absl::StrCat("task_graph_", group.front()->name()));
+  // Maps the instructions of the group, and their operands from outside the
+  // group, to their counterparts in the task graph.
+  absl::flat_hash_map<const HloInstruction*, HloInstruction*> outlined;
+  std::vector<HloInstruction*> arguments;
+  std::vector<HloInstruction*> root_operands;
+  for (HloInstruction* instruction : group) {
+    HloComputation::Builder task_builder(
+        absl::StrCat("task_", instruction->name()));
+    std::vector<HloInstruction*> call_operands;
+    std::vector<HloInstruction*> task_parameters;
+    for (HloInstruction* operand : instruction->operands()) {
+      HloInstruction*& graph_operand = outlined[operand];
+      if (graph_operand == nullptr) {
+        // The group is in topological order, so this is an input of the group.
+        graph_operand = builder.AddInstruction(HloInstruction::CreateParameter(
+            arguments.size(), operand->shape(), "p"));
+        arguments.push_back(operand);
+      }
+      call_operands.push_back(graph_operand);
+      task_parameters.push_back(
+          task_builder.AddInstruction(HloInstruction::CreateParameter(
+              task_parameters.size(), operand->shape(), "p")));
+    }
+    task_builder.AddInstruction(
+        instruction->CloneWithNewOperands(instruction->shape(),
+                                          task_parameters));
+    HloComputation* task =
+        module->AddEmbeddedComputation(task_builder.Build());
+    HloInstruction* call = builder.AddInstruction(HloInstruction::CreateCall(
+        instruction->shape(), call_operands, task));
+    InsertOrDie(&outlined, instruction, call);
+    root_operands.push_back(call);
+  }
+  // The root tuple holds all the tasks, and all the parameters, so that none
+  // of their buffers can be reused within the task graph.
+  for (HloInstruction* argument : arguments) {
+    root_operands.push_back(FindOrDie(outlined, argument));
+  }
+  builder.AddInstruction(HloInstruction::CreateTuple(root_operands));
+  HloComputation* task_graph = module->AddEmbeddedComputation(builder.Build());
+  HloInstruction* call = computation->AddInstruction(HloInstruction::CreateCall(
+      task_graph->root_instruction()->shape(), arguments, task_graph));
+
+  VLOG(2) << "Outlined " << group.size() << " instructions into task graph "
+          << task_graph->name();
+
+  const absl::flat_hash_set<const HloInstruction*> group_set(group.begin(),
+                                                             group.end());
+  for (int64 i = 0; i < group.size(); ++i) {
+    HloInstruction* instruction = group[i];
+    const bool used_outside_group =
+        instruction == computation->root_instruction() ||
+        absl::c_any_of(instruction->users(), [&](const HloInstruction* user) {
+          return !group_set.contains(user);
+        });
+    if (used_outside_group) {
+      HloInstruction* get_tuple_element =
+          computation->AddInstruction(HloInstruction::CreateGetTupleElement(
+              instruction->shape(), call, i));
+      TF_CHECK_OK(instruction->ReplaceAllUsesWith(get_tuple_element));
+    }
+  }
+  for (auto it = group.rbegin(); it != group.rend(); ++it) {
+    TF_CHECK_OK(computation->RemoveInstruction(*it));
+  }
+}
+
+StatusOr<bool> InterOpParallelTaskAssigner::Run(HloModule* module) {
+  HloComputation* computation = module->entry_computation();
+  TF_ASSIGN_OR_RETURN(std::vector<std::vector<HloInstruction*>> groups,
+                      FindTaskGroups(computation));
+  for (const std::vector<HloInstruction*>& group : groups) {
+    OutlineTaskGraph(group, computation);
+  }
+  return !groups.empty();
+}
+
+}  // namespace cpu
+}  // namespace xla
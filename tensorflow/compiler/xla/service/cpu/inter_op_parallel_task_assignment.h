@@ -0,0 +1,96 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_CPU_INTER_OP_PARALLEL_TASK_ASSIGNMENT_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_CPU_INTER_OP_PARALLEL_TASK_ASSIGNMENT_H_
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_cost_analysis.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+
+namespace xla {
+namespace cpu {
+
+// Returns true if 'instruction' may run as a task concurrently with other
+// tasks on the intra-op thread pool: it has no side effects, and its emitted
+// code doesn't itself dispatch work to the thread pool, which would block the
+// pool thread running it.
+bool CanRunAsInterOpTask(const HloInstruction& instruction,
+                         const HloModuleConfig& config);
+
+// Returns true if 'computation' is a task graph, as built by
+// InterOpParallelTaskAssigner: it holds only parameters, calls to task
+// computations of a single instruction which CanRunAsInterOpTask, and a root
+// tuple of all the calls and parameters. Keeping all of them live until the
+// end of the graph ensures that buffer assignment, which assumes the calls run
+// in sequence, gives no two tasks which may run concurrently the same buffer.
+bool IsInterOpTaskGraph(const HloComputation& computation);
+
+// InterOpParallelTaskAssigner finds expensive instructions of the entry
+// computation which are independent of each other, such as parallel branches
+// of dots or fusions, and outlines each group of them into a task graph
+// computation (see IsInterOpTaskGraph), which is invoked from a kCall
+// instruction. Each instruction of the group becomes a task: a call to its
+// own computation, which is compiled as a separate function.
+//
+// IrEmitter lowers calls to task graphs to a runtime call which runs the tasks
+// on the intra-op thread pool as their dependencies within the graph
+// complete. Tasks of the same group may depend on each other, as long as the
+// paths between them stay within the group.
+class InterOpParallelTaskAssigner : public HloModulePass {
+ public:
+  // 'min_task_cost': the minimum cost, in flops and bytes accessed, of an
+  //                  instruction worth running as a task.
+  // 'max_tasks_per_graph': the maximum number of tasks in a task graph.
+  // 'shape_size': shape size function used by HloCostAnalysis.
+  InterOpParallelTaskAssigner(
+      int64 min_task_cost, int64 max_tasks_per_graph,
+      const HloCostAnalysis::ShapeSizeFunction& shape_size)
+      : min_task_cost_(min_task_cost),
+        max_tasks_per_graph_(max_tasks_per_graph),
+        shape_size_function_(shape_size) {}
+  ~InterOpParallelTaskAssigner() override {}
+
+  absl::string_view name() const override {
+    return "cpu-inter-op-parallel-task-assigner";
+  }
+
+  // Run inter-op parallel task assigner on 'module'.
+  // Returns true if the computation was changed, false otherwise.
+  StatusOr<bool> Run(HloModule* module) override;
+
+ private:
+  // Returns the groups of instructions of 'computation' to run as task graphs,
+  // each in topological order.
+  StatusOr<std::vector<std::vector<HloInstruction*>>> FindTaskGroups(
+      HloComputation* computation);
+
+  // Outlines 'group' into a task graph computation, called from 'computation'.
+  void OutlineTaskGraph(absl::Span<HloInstruction* const> group,
+                        HloComputation* computation);
+
+  int64 min_task_cost_;
+  int64 max_tasks_per_graph_;
+  HloCostAnalysis::ShapeSizeFunction shape_size_function_;
+};
+
+}  // namespace cpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_CPU_INTER_OP_PARALLEL_TASK_ASSIGNMENT_H_
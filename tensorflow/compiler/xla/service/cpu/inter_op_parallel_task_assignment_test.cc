@@ -0,0 +1,137 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/inter_op_parallel_task_assignment.h"
+
+#include "tensorflow/compiler/xla/service/cpu/cpu_executable.h"
+#include "tensorflow/compiler/xla/service/hlo_matchers.h"
+#include "tensorflow/compiler/xla/test.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace xla {
+namespace {
+
+namespace op = xla::testing::opcode_matchers;
+
+class InterOpParallelTaskAssignmentTest : public HloTestBase {
+ protected:
+  StatusOr<bool> RunInterOpParallelTaskAssigner(HloModule* module) {
+    return cpu::InterOpParallelTaskAssigner(
+               /*min_task_cost=*/1024, /*max_tasks_per_graph=*/8,
+               cpu::CpuExecutable::ShapeSizeBytes)
+        .Run(module);
+  }
+};
+
+TEST_F(InterOpParallelTaskAssignmentTest, IndependentInstructionsAreGrouped) {
+  const string hlo_string = R"(
+    HloModule TestInterOpParallel_Independent
+    add {
+      lhs = f32[] parameter(0)
+      rhs = f32[] parameter(1)
+      ROOT add = f32[] add(lhs, rhs)
+    }
+    ENTRY Independent {
+      p0 = f32[1024,1024]{1,0} parameter(0)
+      p1 = f32[1024,1024]{1,0} parameter(1)
+      zero = f32[] constant(0)
+      reduce0 = f32[1024]{0} reduce(p0, zero), dimensions={1}, to_apply=add
+      reduce1 = f32[1024]{0} reduce(p1, zero), dimensions={1}, to_apply=add
+      ROOT tuple = (f32[1024]{0}, f32[1024]{0}) tuple(reduce0, reduce1)
+    }
+  )";
+
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> m,
+                          ParseAndReturnVerifiedModule(hlo_string));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          RunInterOpParallelTaskAssigner(m.get()));
+  EXPECT_TRUE(changed);
+
+  const HloInstruction* root = m->entry_computation()->root_instruction();
+  EXPECT_THAT(root, op::Tuple(op::GetTupleElement(op::Call(), 0),
+                              op::GetTupleElement(op::Call(), 1)));
+  const HloInstruction* call = root->operand(0)->operand(0);
+  EXPECT_EQ(call, root->operand(1)->operand(0));
+  EXPECT_TRUE(cpu::IsInterOpTaskGraph(*call->to_apply()));
+  // The task graph returns both tasks and all of its parameters.
+  EXPECT_EQ(ShapeUtil::TupleElementCount(call->shape()),
+            2 + call->operand_count());
+}
+
+TEST_F(InterOpParallelTaskAssignmentTest, DependentChainIsNotGrouped) {
+  const string hlo_string = R"(
+    HloModule TestInterOpParallel_Chain
+    ENTRY Chain {
+      p0 = f32[1024,1024]{1,0} parameter(0)
+      exp = f32[1024,1024]{1,0} exponential(p0)
+      ROOT negate = f32[1024,1024]{1,0} negate(exp)
+    }
+  )";
+
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> m,
+                          ParseAndReturnVerifiedModule(hlo_string));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          RunInterOpParallelTaskAssigner(m.get()));
+  EXPECT_FALSE(changed);
+}
+
+TEST_F(InterOpParallelTaskAssignmentTest, PathLeavingGroupSplitsGroup) {
+  // 'add' depends on 'exp0' through 'custom-call', which can't run as a task,
+  // so it can't be in the same task graph as 'exp0'.
+  const string hlo_string = R"(
+    HloModule TestInterOpParallel_NonConvex
+    ENTRY NonConvex {
+      p0 = f32[1024,1024]{1,0} parameter(0)
+      p1 = f32[1024,1024]{1,0} parameter(1)
+      exp0 = f32[1024,1024]{1,0} exponential(p0)
+      exp1 = f32[1024,1024]{1,0} exponential(p1)
+      custom-call = f32[1024,1024]{1,0} custom-call(exp0),
+        custom_call_target="foo"
+      ROOT add = f32[1024,1024]{1,0} add(custom-call, exp1)
+    }
+  )";
+
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> m,
+                          ParseAndReturnVerifiedModule(hlo_string));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          RunInterOpParallelTaskAssigner(m.get()));
+  EXPECT_TRUE(changed);
+  EXPECT_THAT(m->entry_computation()->root_instruction(),
+              op::Add(op::CustomCall(op::GetTupleElement(op::Call())),
+                      op::GetTupleElement(op::Call())));
+}
+
+TEST_F(InterOpParallelTaskAssignmentTest, SideEffectingInstructionsNotGrouped) {
+  const string hlo_string = R"(
+    HloModule TestInterOpParallel_Rng
+    ENTRY Rng {
+      zero = f32[] constant(0)
+      one = f32[] constant(1)
+      rng0 = f32[1024,1024]{1,0} rng(zero, one), distribution=rng_uniform
+      rng1 = f32[1024,1024]{1,0} rng(zero, one), distribution=rng_uniform
+      ROOT tuple = (f32[1024,1024]{1,0}, f32[1024,1024]{1,0}) tuple(rng0, rng1)
+    }
+  )";
+
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> m,
+                          ParseAndReturnVerifiedModule(hlo_string));
+  TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                          RunInterOpParallelTaskAssigner(m.get()));
+  EXPECT_FALSE(changed);
+}
+
+}  // namespace
+}  // namespace xla
@@ -51,6 +51,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/cpu/cpu_runtime.h"
 #include "tensorflow/compiler/xla/service/cpu/dot_op_emitter.h"
 #include "tensorflow/compiler/xla/service/cpu/elemental_ir_emitter.h"
+#include "tensorflow/compiler/xla/service/cpu/inter_op_parallel_task_assignment.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_emission_utils.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_function.h"
 #include "tensorflow/compiler/xla/service/cpu/parallel_loop_emitter.h"
@@ -2249,6 +2250,10 @@ Status IrEmitter::HandleFusion(HloInstruction* fusion) {
 
 Status IrEmitter::HandleCall(HloInstruction* call) {
   HloComputation* computation = call->to_apply();
+  if (options::InterOpParallelismEnabled(hlo_module_config_) &&
+      IsInterOpTaskGraph(*computation)) {
+    return EmitParallelTaskGraph(call);
+  }
   llvm::Function* call_ir_function = FindOrDie(emitted_functions_, computation);
 
   TF_RETURN_IF_ERROR(EmitTargetAddressForOp(call));
@@ -2274,6 +2279,58 @@ Status IrEmitter::HandleCall(HloInstruction* call) {
   return Status::OK();
 }
 
+Status IrEmitter::EmitParallelTaskGraph(HloInstruction* call) {
+  const HloComputation* task_graph = call->to_apply();
+  TF_RETURN_IF_ERROR(EmitTargetAddressForOp(call));
+
+  // Tasks are numbered in post order, so that a task only depends on tasks
+  // with lower numbers.
+  std::vector<const HloInstruction*> tasks;
+  for (const HloInstruction* instruction :
+       task_graph->MakeInstructionPostOrder()) {
+    if (instruction->opcode() == HloOpcode::kCall) {
+      tasks.push_back(instruction);
+    }
+  }
+  absl::flat_hash_map<const HloInstruction*, int32> task_index;
+  for (int32 i = 0; i < tasks.size(); ++i) {
+    task_index[tasks[i]] = i;
+  }
+  std::vector<llvm::Function*> task_functions;
+  std::vector<std::vector<int32>> task_successors;
+  for (const HloInstruction* task : tasks) {
+    task_functions.push_back(FindOrDie(emitted_functions_, task->to_apply()));
+    std::vector<int32> successors;
+    for (const HloInstruction* user : task->users()) {
+      auto it = task_index.find(user);
+      if (it != task_index.end()) {
+        successors.push_back(it->second);
+      }
+    }
+    // A task using the same result twice depends on it once.
+    absl::c_sort(successors);
+    successors.erase(std::unique(successors.begin(), successors.end()),
+                     successors.end());
+    task_successors.push_back(std::move(successors));
+  }
+  TF_RETURN_IF_ERROR(EmitCallToParallelTaskGraph(
+      GetExecutableRunOptionsArgument(), GetBufferTableArgument(),
+      GetProfileCountersArgument(), task_functions, task_successors, &b_,
+      task_graph->name()));
+
+  // The task functions don't write the root tuple of the task graph, so its
+  // buffer pointers are written here.
+  const HloInstruction* root = task_graph->root_instruction();
+  std::vector<llvm::Value*> element_ptrs;
+  for (const HloInstruction* operand : root->operands()) {
+    TF_ASSIGN_OR_RETURN(const BufferAllocation::Slice slice,
+                        assignment_.GetUniqueTopLevelSlice(operand));
+    element_ptrs.push_back(EmitBufferPointer(slice, operand->shape()));
+  }
+  llvm_ir::EmitTuple(GetIrArrayFor(call), element_ptrs, &b_);
+  return Status::OK();
+}
+
 Status IrEmitter::HandleSliceToDynamic(HloInstruction* hlo) {
   TF_RETURN_IF_ERROR(EmitTargetAddressForOp(hlo));
   std::vector<llvm::Value*> dynamic_dims;
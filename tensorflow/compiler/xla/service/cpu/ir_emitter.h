@@ -425,6 +425,10 @@ class IrEmitter : public DfsHloVisitorWithDefault,
   llvm::Value* EmitPrintf(absl::string_view fmt,
                           absl::Span<llvm::Value* const> arguments);
 
+  // Emits a call to the task graph 'call->to_apply()', built by
+  // InterOpParallelTaskAssigner, which runs its tasks concurrently.
+  Status EmitParallelTaskGraph(HloInstruction* call);
+
   // Emits a call to a non-variadic function `func_name` with arguments
   // `arguments` assuming C calling convention.
   llvm::Value* EmitCallToFunc(
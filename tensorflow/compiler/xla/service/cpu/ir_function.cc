@@ -337,5 +337,112 @@ Status EmitCallToParallelForkJoin(
   return Status::OK();
 }
 
+// Creates a private constant global holding the int32 array 'values', and
+// returns a pointer to it, or a null pointer if 'values' is empty.
+static llvm::Value* CreateInt32ArrayGlobal(absl::Span<const int32> values,
+                                           llvm::IRBuilder<>* b,
+                                           const string& name) {
+  llvm::Module* module = b->GetInsertBlock()->getModule();
+  llvm::Type* i32_ptr_type = llvm::Type::getInt32PtrTy(module->getContext());
+  if (values.empty()) {
+    return llvm::Constant::getNullValue(i32_ptr_type);
+  }
+  std::vector<llvm::Constant*> elements;
+  elements.reserve(values.size());
+  for (int32 value : values) {
+    elements.push_back(b->getInt32(value));
+  }
+  llvm::ArrayType* array_type =
+      llvm::ArrayType::get(b->getInt32Ty(), elements.size());
+  llvm::GlobalVariable* global = new llvm::GlobalVariable(
+      /*M=*/*module,
+      /*Ty=*/array_type,
+      /*isConstant=*/true,
+      /*Linkage=*/llvm::GlobalValue::PrivateLinkage,
+      /*Initializer=*/llvm::ConstantArray::get(array_type, elements),
+      /*Name=*/name);
+  return b->CreateBitCast(global, i32_ptr_type);
+}
+
+Status EmitCallToParallelTaskGraph(
+    llvm::Value* exec_run_options_arg, llvm::Value* buffer_table_arg,
+    llvm::Value* profile_counters_arg,
+    absl::Span<llvm::Function* const> task_functions,
+    absl::Span<const std::vector<int32>> task_successors, llvm::IRBuilder<>* b,
+    const string& name) {
+  TF_RET_CHECK(task_functions.size() == task_successors.size());
+  llvm::Module* module = b->GetInsertBlock()->getModule();
+  llvm::LLVMContext& context = module->getContext();
+  llvm::Type* i8_ptr_type = llvm::Type::getInt8PtrTy(context);
+  llvm::Type* i32_ptr_type = llvm::Type::getInt32PtrTy(context);
+
+  // Build ParallelTaskGraph function type.
+  llvm::FunctionType* task_graph_type = llvm::FunctionType::get(
+      /*Result=*/llvm::Type::getVoidTy(context),
+      /*Params=*/
+      {/*run_options=*/i8_ptr_type,
+       /*buffer_table=*/i8_ptr_type->getPointerTo(),
+       /*prof_counters=*/llvm::Type::getInt64PtrTy(context),
+       /*num_tasks=*/b->getInt32Ty(),
+       /*task_functions=*/i8_ptr_type->getPointerTo(),
+       /*dependency_counts=*/i32_ptr_type,
+       /*successor_offsets=*/i32_ptr_type,
+       /*successors=*/i32_ptr_type},
+      /*isVarArg=*/false);
+  llvm::Function* task_graph_func = llvm::dyn_cast<llvm::Function>(
+      module
+          ->getOrInsertFunction(runtime::kParallelTaskGraphSymbolName,
+                                task_graph_type)
+          .getCallee());
+  task_graph_func->setCallingConv(llvm::CallingConv::C);
+  task_graph_func->setDoesNotThrow();
+
+  // The successors of all the tasks are stored contiguously, see the comments
+  // in runtime_fork_join.cc.
+  const int32 num_tasks = task_functions.size();
+  std::vector<int32> dependency_counts(num_tasks, 0);
+  std::vector<int32> successor_offsets = {0};
+  std::vector<int32> successors;
+  for (int32 i = 0; i < num_tasks; ++i) {
+    for (int32 successor : task_successors[i]) {
+      TF_RET_CHECK(successor > i && successor < num_tasks);
+      ++dependency_counts[successor];
+      successors.push_back(successor);
+    }
+    successor_offsets.push_back(successors.size());
+  }
+
+  std::vector<llvm::Constant*> function_pointers;
+  function_pointers.reserve(num_tasks);
+  for (llvm::Function* function : task_functions) {
+    function_pointers.push_back(
+        llvm::ConstantExpr::getBitCast(function, i8_ptr_type));
+  }
+  llvm::ArrayType* functions_array_type =
+      llvm::ArrayType::get(i8_ptr_type, num_tasks);
+  llvm::GlobalVariable* global_functions_array = new llvm::GlobalVariable(
+      /*M=*/*module,
+      /*Ty=*/functions_array_type,
+      /*isConstant=*/true,
+      /*Linkage=*/llvm::GlobalValue::PrivateLinkage,
+      /*Initializer=*/
+      llvm::ConstantArray::get(functions_array_type, function_pointers),
+      /*Name=*/absl::StrCat(name, "_task_functions"));
+
+  b->CreateCall(
+      task_graph_func,
+      {exec_run_options_arg, buffer_table_arg, profile_counters_arg,
+       b->getInt32(num_tasks),
+       b->CreateBitCast(global_functions_array, i8_ptr_type->getPointerTo()),
+       CreateInt32ArrayGlobal(dependency_counts, b,
+                              absl::StrCat(name, "_dependency_counts")),
+       CreateInt32ArrayGlobal(successor_offsets, b,
+                              absl::StrCat(name, "_successor_offsets")),
+       CreateInt32ArrayGlobal(successors, b,
+                              absl::StrCat(name, "_successors"))});
+
+  return Status::OK();
+}
+
 }  // namespace cpu
 }  // namespace xla
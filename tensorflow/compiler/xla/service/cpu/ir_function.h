@@ -134,6 +134,17 @@ Status EmitCallToParallelForkJoin(
     const std::vector<int64>& dimension_partition_counts, llvm::IRBuilder<>* b,
     llvm::Function* parallel_function, const string& name);
 
+// Emits a call to a runtime function which runs 'task_functions' on the
+// intra-op thread pool, each once the tasks it depends on are done, and
+// returns when all of them are done. The tasks depending on task 'i' are
+// 'task_successors[i]'.
+Status EmitCallToParallelTaskGraph(
+    llvm::Value* exec_run_options_arg, llvm::Value* buffer_table_arg,
+    llvm::Value* profile_counters_arg,
+    absl::Span<llvm::Function* const> task_functions,
+    absl::Span<const std::vector<int32>> task_successors, llvm::IRBuilder<>* b,
+    const string& name);
+
 }  // namespace cpu
 }  // namespace xla
 
@@ -17,6 +17,10 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/compiler/xla/executable_run_options.h"
 #include "tensorflow/core/platform/blocking_counter.h"
@@ -30,6 +34,8 @@ using tensorflow::uint64;
 
 using ComputeFunctionType = void (*)(void*, const void*, const void**, void**,
                                      int64*, uint64*);
+using TaskFunctionType = void (*)(void*, const void*, const void**, void**,
+                                  uint64*);
 
 // Dispatches 'num_partitions - 1' calls to 'function_ptr' in parallel.
 // Calls 'function_ptr' for first partition inline.
@@ -102,3 +108,111 @@ TF_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_ParallelForkJoin(
   bc.Wait();
   VLOG(2) << "ParallelForkJoin EXIT";
 }
+
+namespace {
+
+// The state of one run of a task graph, shared by its tasks.
+struct TaskGraphRun {
+  const xla::ExecutableRunOptions* run_options;
+  void** buffer_table;
+  uint64* prof_counters;
+  void** task_functions;
+  const int32* successor_offsets;
+  const int32* successors;
+  // The number of unfinished dependencies of each task.
+  std::unique_ptr<std::atomic<int32>[]> pending;
+  tensorflow::BlockingCounter* done;
+};
+
+void RunTasks(TaskGraphRun* run, int32 task);
+
+void EnqueueTask(TaskGraphRun* run, int32 task) {
+  run->run_options->intra_op_thread_pool()->enqueueNoNotification(
+      [run, task]() { RunTasks(run, task); });
+}
+
+// Runs 'task', then keeps running one of the tasks which it made ready, on the
+// calling thread, and enqueues the others.
+void RunTasks(TaskGraphRun* run, int32 task) {
+  while (task >= 0) {
+    TaskFunctionType function =
+        reinterpret_cast<TaskFunctionType>(run->task_functions[task]);
+    function(nullptr, run->run_options, nullptr, run->buffer_table,
+             run->prof_counters);
+    VLOG(3) << "ParallelTaskGraph task " << task << " done.";
+
+    int32 next_task = -1;
+    for (int32 i = run->successor_offsets[task];
+         i < run->successor_offsets[task + 1]; ++i) {
+      const int32 successor = run->successors[i];
+      if (run->pending[successor].fetch_sub(1, std::memory_order_acq_rel) ==
+          1) {
+        if (next_task < 0) {
+          next_task = successor;
+        } else {
+          EnqueueTask(run, successor);
+        }
+      }
+    }
+    // 'run' is destroyed once the last task is counted down, so it must not be
+    // touched after that. Tasks made ready above keep the count positive.
+    run->done->DecrementCount();
+    task = next_task;
+  }
+}
+
+}  // namespace
+
+// Runs the task graph described by:
+//
+//   'task_functions': the 'num_tasks' compute functions, which read and write
+//   their operands and results through 'buffer_table'.
+//   'dependency_counts': the number of tasks each task depends on.
+//   'successor_offsets', 'successors': the tasks depending on task 'i' are
+//   'successors[successor_offsets[i]]' to
+//   'successors[successor_offsets[i + 1] - 1]'.
+//
+// Tasks which are ready at the start are enqueued, except for the first,
+// which runs inline. A task which finishes runs one of the tasks it made ready
+// on the same thread, and enqueues the others. Returns when all the tasks are
+// done.
+TF_ATTRIBUTE_NO_SANITIZE_MEMORY void __xla_cpu_runtime_ParallelTaskGraph(
+    const void* run_options_ptr, void** buffer_table, uint64* prof_counters,
+    int32 num_tasks, void** task_functions, const int32* dependency_counts,
+    const int32* successor_offsets, const int32* successors) {
+  VLOG(2) << "ParallelTaskGraph ENTRY num_tasks: " << num_tasks;
+  CHECK_GT(num_tasks, 1);
+  CHECK_NE(task_functions, nullptr);
+  CHECK_NE(dependency_counts, nullptr);
+  CHECK_NE(successor_offsets, nullptr);
+  const xla::ExecutableRunOptions* run_options =
+      static_cast<const xla::ExecutableRunOptions*>(run_options_ptr);
+  CHECK_NE(run_options, nullptr);
+  CHECK_NE(run_options->intra_op_thread_pool(), nullptr);
+
+  tensorflow::BlockingCounter done(num_tasks);
+  TaskGraphRun run;
+  run.run_options = run_options;
+  run.buffer_table = buffer_table;
+  run.prof_counters = prof_counters;
+  run.task_functions = task_functions;
+  run.successor_offsets = successor_offsets;
+  run.successors = successors;
+  run.pending.reset(new std::atomic<int32>[num_tasks]);
+  run.done = &done;
+
+  std::vector<int32> ready_tasks;
+  for (int32 i = 0; i < num_tasks; ++i) {
+    run.pending[i].store(dependency_counts[i], std::memory_order_relaxed);
+    if (dependency_counts[i] == 0) {
+      ready_tasks.push_back(i);
+    }
+  }
+  CHECK(!ready_tasks.empty());
+  for (size_t i = 1; i < ready_tasks.size(); ++i) {
+    EnqueueTask(&run, ready_tasks[i]);
+  }
+  RunTasks(&run, ready_tasks[0]);
+  done.Wait();
+  VLOG(2) << "ParallelTaskGraph EXIT";
+}
@@ -28,6 +28,16 @@ extern void __xla_cpu_runtime_ParallelForkJoin(
     tensorflow::int32 num_partitions, tensorflow::int64* partitions,
     tensorflow::int32 num_partitioned_dims, void* function_ptr);
 
+// Runs the 'num_tasks' functions of a task graph on the intra-op thread pool,
+// each once all the tasks it depends on are done, and returns when all of
+// them are done. See comments in runtime_fork_join.cc for details.
+extern void __xla_cpu_runtime_ParallelTaskGraph(
+    const void* run_options_ptr, void** buffer_table,
+    tensorflow::uint64* prof_counters, tensorflow::int32 num_tasks,
+    void** task_functions, const tensorflow::int32* dependency_counts,
+    const tensorflow::int32* successor_offsets,
+    const tensorflow::int32* successors);
+
 }  // extern "C"
 
 #endif  // TENSORFLOW_COMPILER_XLA_SERVICE_CPU_RUNTIME_FORK_JOIN_H_
@@ -92,6 +92,21 @@ TEST_P(CpuEigenDotOperationTest, DotTransposeOp) {
   CompileAndCheck(builder.Build(), spec.filecheck_lines);
 }
 
+TEST_F(CpuEigenDotOperationTest, SmallDotOpIsEmittedInline) {
+  HloComputation::Builder builder(TestName());
+
+  auto param_shape = ShapeUtil::MakeShape(F32, {16, 16});
+
+  HloInstruction* lhs = builder.AddInstruction(
+      HloInstruction::CreateParameter(0, param_shape, "input"));
+  HloInstruction* rhs = builder.AddInstruction(
+      HloInstruction::CreateParameter(1, param_shape, "input"));
+
+  builder.AddInstruction(CreateCanonicalDot(param_shape, lhs, rhs));
+  CompileAndCheck(builder.Build(),
+                  R"(CHECK-NOT: call void @__xla_cpu_runtime_EigenMatMulF32)");
+}
+
 std::vector<DotTestSpec> GetDotTestCases() {
   std::vector<DotTestSpec> result;
   result.push_back(
@@ -0,0 +1,101 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "tensorflow/compiler/xla/literal.h"
+#include "tensorflow/compiler/xla/service/cpu/inter_op_parallel_task_assignment.h"
+#include "tensorflow/compiler/xla/service/executable.h"
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/tests/hlo_test_base.h"
+#include "tensorflow/compiler/xla/tests/literal_test_util.h"
+#include "tensorflow/compiler/xla/tests/test_utils.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+// Two independent chains of dots, joined by a final dot. Each dot is costly
+// enough to become an inter-op task.
+const char* const kIndependentDotsHlo = R"(
+HloModule IndependentDots
+
+ENTRY main {
+  p0 = f32[64,64] parameter(0)
+  p1 = f32[64,64] parameter(1)
+  p2 = f32[64,64] parameter(2)
+  p3 = f32[64,64] parameter(3)
+  p4 = f32[64,64] parameter(4)
+  p5 = f32[64,64] parameter(5)
+  a = f32[64,64] dot(p0, p1), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  b = f32[64,64] dot(p2, p3), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  c = f32[64,64] dot(a, p4), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  d = f32[64,64] dot(b, p5), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  ROOT e = f32[64,64] dot(c, d), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+}
+)";
+
+class CpuInterOpParallelismTest : public HloTestBase {
+ protected:
+  DebugOptions GetDebugOptionsForTest() override {
+    DebugOptions debug_options = HloTestBase::GetDebugOptionsForTest();
+    // Dots lowered to multi-threaded Eigen never become inter-op tasks.
+    debug_options.set_xla_cpu_multi_thread_eigen(false);
+    return debug_options;
+  }
+
+  // Compiles and runs kIndependentDotsHlo on `arguments`, with inter-op
+  // parallelism enabled or not, and checks whether task graphs were emitted.
+  Literal CompileAndRun(bool inter_op_parallelism,
+                        absl::Span<const Literal> arguments) {
+    HloModuleConfig config = GetModuleConfigForTest();
+    if (inter_op_parallelism) {
+      DebugOptions debug_options = config.debug_options();
+      (*debug_options.mutable_xla_backend_extra_options())
+          ["xla_cpu_inter_op_parallelism"] = "";
+      config.set_debug_options(debug_options);
+    }
+    auto module =
+        ParseAndReturnVerifiedModule(kIndependentDotsHlo, config).ValueOrDie();
+    std::unique_ptr<Executable> executable =
+        test_runner_.CreateExecutable(std::move(module), /*run_hlo_passes=*/true)
+            .ValueOrDie();
+    EXPECT_EQ(inter_op_parallelism,
+              absl::c_any_of(executable->module().computations(),
+                             [](const HloComputation* computation) {
+                               return IsInterOpTaskGraph(*computation);
+                             }));
+    return test_runner_.Execute(std::move(executable), arguments).ValueOrDie();
+  }
+};
+
+TEST_F(CpuInterOpParallelismTest, TaskGraphMatchesSequentialExecution) {
+  auto module = ParseAndReturnVerifiedModule(kIndependentDotsHlo).ValueOrDie();
+  std::vector<Literal> arguments =
+      MakeFakeArguments(module.get()).ValueOrDie();
+
+  Literal expected = CompileAndRun(/*inter_op_parallelism=*/false, arguments);
+  Literal actual = CompileAndRun(/*inter_op_parallelism=*/true, arguments);
+  EXPECT_TRUE(LiteralTestUtil::Near(expected, actual, ErrorSpec{1e-3, 1e-3}));
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace xla
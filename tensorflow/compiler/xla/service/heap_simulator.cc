@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/heap_simulator.h"
 
 #include <algorithm>
+#include <random>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
@@ -936,6 +937,165 @@ void GlobalDecreasingSizeBestFitHeap::AddToChunkMap(const HloValue* buffer,
   DCHECK(emplace_result.second);
 }
 
+int64 IntervalPackingHeap::ComputeLowerBound() const {
+  // Sweeps the live ranges in time order. Each event is a time and the change
+  // in live size at that time.
+  std::vector<std::pair<int64, int64>> events;
+  for (const auto& entry : buffer_intervals_) {
+    const BufferInterval& interval = entry.second;
+    if (!interval.need_allocation) {
+      continue;
+    }
+    std::vector<std::pair<int64, int64>> live_ranges = {
+        {interval.start, interval.end}};
+    for (const HloValue* colocation : GetTransitiveColocations(interval)) {
+      const BufferInterval& colocation_interval =
+          buffer_intervals_.at(colocation);
+      live_ranges.push_back(
+          {colocation_interval.start, colocation_interval.end});
+    }
+    // Merge the overlapping live ranges of the colocated buffers, which are
+    // inclusive on both ends.
+    absl::c_sort(live_ranges);
+    int64 start = live_ranges.front().first;
+    int64 end = live_ranges.front().second;
+    for (const auto& live_range : live_ranges) {
+      if (live_range.first > end + 1) {
+        events.push_back({start, interval.size});
+        events.push_back({end + 1, -interval.size});
+        start = live_range.first;
+      }
+      end = std::max(end, live_range.second);
+    }
+    events.push_back({start, interval.size});
+    events.push_back({end + 1, -interval.size});
+  }
+  // At equal times, frees sort before allocations.
+  absl::c_sort(events);
+  int64 live_size = 0;
+  int64 max_live_size = 0;
+  for (const auto& event : events) {
+    live_size += event.second;
+    max_live_size = std::max(max_live_size, live_size);
+  }
+  return max_live_size;
+}
+
+HeapSimulator::Result IntervalPackingHeap::Place(
+    absl::Span<const BufferInterval> order, const Result& initial_result) {
+  interval_tree_ = BufferIntervalTree();
+  result_ = initial_result;
+  for (const BufferInterval& buffer_interval : order) {
+    CommitChunk(buffer_interval, FindChunkCandidate(buffer_interval));
+  }
+  ++num_trials_;
+  return std::move(result_);
+}
+
+double IntervalPackingHeap::fragmentation_ratio() const {
+  if (lower_bound_ == 0) {
+    return 1.0;
+  }
+  return static_cast<double>(heap_size_) / lower_bound_;
+}
+
+HeapSimulator::Result IntervalPackingHeap::Finish() {
+  const absl::Time start_time = absl::Now();
+  lower_bound_ = ComputeLowerBound();
+
+  std::vector<BufferInterval> order;
+  // The end of the live range of each buffer and its colocations.
+  absl::flat_hash_map<const HloValue*, int64> live_range_ends;
+  for (const auto& entry : buffer_intervals_) {
+    const BufferInterval& interval = entry.second;
+    if (!interval.need_allocation) {
+      continue;
+    }
+    order.push_back(interval);
+    int64 end = interval.end;
+    for (const HloValue* colocation : GetTransitiveColocations(interval)) {
+      end = std::max(end, buffer_intervals_.at(colocation).end);
+    }
+    live_range_ends[interval.buffer] = end;
+  }
+  auto area = [&](const BufferInterval& interval) {
+    return interval.size *
+           (live_range_ends.at(interval.buffer) - interval.start + 1);
+  };
+  BufferIntervalCompare area_compare = [&](const BufferInterval& x,
+                                           const BufferInterval& y) {
+    if (area(x) != area(y)) {
+      return area(x) > area(y);
+    }
+    if (x.size != y.size) {
+      return x.size > y.size;
+    }
+    return x.buffer->id() < y.buffer->id();
+  };
+
+  // Zero-sized buffers were given their chunks by Alloc and ShareWith.
+  const Result initial_result = std::move(result_);
+  Result best_result;
+  std::vector<BufferInterval> best_order;
+  auto search_done = [&]() {
+    return num_trials_ >= options_.max_trials ||
+           best_result.heap_size <= lower_bound_ ||
+           absl::Now() - start_time >= options_.time_budget;
+  };
+  auto try_order = [&](std::vector<BufferInterval> candidate_order) {
+    Result result = Place(candidate_order, initial_result);
+    // Ties are accepted so that refinement can move across plateaus.
+    if (num_trials_ == 1 || result.heap_size <= best_result.heap_size) {
+      best_result = std::move(result);
+      best_order = std::move(candidate_order);
+    }
+  };
+
+  // At least one placement always runs, whatever the budget.
+  for (const BufferIntervalCompare& compare :
+       {GetSpatialBufferIntervalCompare(), GetTemporalBufferIntervalCompare(),
+        area_compare}) {
+    if (num_trials_ > 0 && search_done()) {
+      break;
+    }
+    std::vector<BufferInterval> sorted_order = order;
+    absl::c_sort(sorted_order, compare);
+    try_order(std::move(sorted_order));
+  }
+
+  // Refine the best order with random swaps and moves of buffers which are
+  // close to each other in it, since those decide which chunks are free for
+  // each other.
+  constexpr int64 kMaxDistance = 8;
+  std::mt19937_64 rng(options_.seed);
+  while (best_order.size() > 1 && !search_done()) {
+    std::vector<BufferInterval> candidate_order = best_order;
+    const int64 size = candidate_order.size();
+    const int64 num_moves = 1 + rng() % std::max<int64>(1, size / 16);
+    for (int64 i = 0; i < num_moves; ++i) {
+      const int64 from = rng() % (size - 1);
+      const int64 to =
+          from + 1 + rng() % std::min(kMaxDistance, size - 1 - from);
+      if (rng() % 2 == 0) {
+        std::swap(candidate_order[from], candidate_order[to]);
+      } else {
+        // Moves the buffer at 'to' in front of the one at 'from'.
+        std::rotate(candidate_order.begin() + from,
+                    candidate_order.begin() + to,
+                    candidate_order.begin() + to + 1);
+      }
+    }
+    try_order(std::move(candidate_order));
+  }
+
+  heap_size_ = best_result.heap_size;
+  VLOG(1) << "Interval packing heap size: " << heap_size_
+          << ", lower bound: " << lower_bound_
+          << ", fragmentation ratio: " << fragmentation_ratio() << " after "
+          << num_trials_ << " trials in " << absl::Now() - start_time;
+  return best_result;
+}
+
 HeapSimulator::Result ChooseBestHeapAlgorithm::Finish() {
   DCHECK(!algorithms_.empty());
   std::vector<Result> results(algorithms_.size());
@@ -23,6 +23,8 @@ limitations under the License.
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "tensorflow/compiler/xla/service/buffer_value.h"
 #include "tensorflow/compiler/xla/service/buffer_value_containers.h"
 #include "tensorflow/compiler/xla/service/hlo.pb.h"
@@ -413,6 +415,12 @@ class GlobalDecreasingSizeBestFitHeap : public HeapAlgorithm {
   // contiguous.
   BufferIntervalCompare GetTemporalBufferIntervalCompare() const;
 
+  // Returns all transitive colocated buffers of this buffer interval. I.e., If
+  // a buffer A is colocated with B and B is colocated with C, this function
+  // returns all three of them.
+  absl::flat_hash_set<const HloValue*> GetTransitiveColocations(
+      const BufferInterval& interval) const;
+
   absl::flat_hash_map<const HloValue*, BufferInterval> buffer_intervals_;
   Result result_;
   BufferIntervalCompare buffer_interval_compare_;
@@ -424,12 +432,61 @@ class GlobalDecreasingSizeBestFitHeap : public HeapAlgorithm {
   // The current time represented as an integer. It increments by 1 at each
   // Alloc or Free call.
   int64 current_time_ = 0;
+};
 
-  // Returns all transitive colocated buffers of this buffer interval. I.e., If
-  // a buffer A is colocated with B and B is colocated with C, this function
-  // returns all three of them.
-  absl::flat_hash_set<const HloValue*> GetTransitiveColocations(
-      const BufferInterval& interval) const;
+// IntervalPackingHeap treats buffer assignment as packing the (time, space)
+// rectangles of the buffers, and searches the order in which
+// GlobalDecreasingSizeBestFitHeap places them. It runs best-fit placement with
+// the spatial, temporal and area (size times live range) orders, then refines
+// the best order found so far with random local perturbations, keeping any
+// order which doesn't grow the heap. The search stops after max_trials
+// placements, when the time budget runs out, or as soon as a placement reaches
+// the lower bound: the maximum total size of the buffers live at once.
+//
+// The search is deterministic for a given seed unless the time budget cuts it
+// short, in which case the result depends on the speed of the host.
+class IntervalPackingHeap : public GlobalDecreasingSizeBestFitHeap {
+ public:
+  struct Options {
+    // The maximum number of placements to run, including the initial ones.
+    int64 max_trials = 32;
+    // The maximum time to spend searching, checked after each placement.
+    absl::Duration time_budget = absl::Milliseconds(100);
+    // Seed of the random perturbations.
+    uint64 seed = 0;
+  };
+
+  explicit IntervalPackingHeap(int64 alignment)
+      : IntervalPackingHeap(alignment, Options()) {}
+  IntervalPackingHeap(int64 alignment, const Options& options)
+      : GlobalDecreasingSizeBestFitHeap(alignment), options_(options) {}
+  ~IntervalPackingHeap() override {}
+
+  Result Finish() override;
+
+  // The following are valid after Finish. lower_bound() is the heap size which
+  // no placement can beat, and fragmentation_ratio() is the size of the chosen
+  // heap relative to it, i.e. 1.0 for an optimal placement.
+  int64 lower_bound() const { return lower_bound_; }
+  double fragmentation_ratio() const;
+  // The number of placements run.
+  int64 num_trials() const { return num_trials_; }
+
+ private:
+  // Returns the total size of the buffers live at the busiest time. Colocated
+  // buffers share a chunk, so they are counted once while any of them is live.
+  int64 ComputeLowerBound() const;
+
+  // Places the buffer intervals in 'order' with best fit, starting from
+  // 'initial_result', which holds the chunks of the zero-sized buffers, and
+  // returns the result.
+  Result Place(absl::Span<const BufferInterval> order,
+               const Result& initial_result);
+
+  Options options_;
+  int64 lower_bound_ = 0;
+  int64 heap_size_ = 0;
+  int64 num_trials_ = 0;
 };
 
 // A heap algorithm that chooses the best results from other algorithms added to
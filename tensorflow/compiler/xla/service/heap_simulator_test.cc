@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/heap_simulator.h"
 
 #include <memory>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -1311,6 +1312,142 @@ TEST_F(GlobalDecreasingSizeBestFitHeapTest, ChunkCandidate) {
   // Preferred offset 15 could not be given because it is occupied.
 }
 
+class IntervalPackingHeapTest : public HeapAlgorithmTestBase {
+ protected:
+  // Buffers are live at times (inclusive):
+  //   b: 40 bytes [0, 4], c: 50 bytes [1, 2], d: 20 bytes [3, 6],
+  //   a: 50 bytes [5, 7].
+  // Both the spatial and temporal orders need a 110 byte heap, while placing
+  // buffers by decreasing area packs them into 90 bytes, the lower bound.
+  void AllocAreaFirstBuffers(HeapAlgorithm* heap) {
+    heap->Alloc(buffer_b_, 40);
+    heap->Alloc(buffer_c_, 50);
+    heap->Free(buffer_c_, 50);
+    heap->Alloc(buffer_d_, 20);
+    heap->Free(buffer_b_, 40);
+    heap->Alloc(buffer_a_, 50);
+    heap->Free(buffer_d_, 20);
+    heap->Free(buffer_a_, 50);
+  }
+
+  // Returns true if no two buffers of 'result' which are live at the same
+  // time, given by 'live_ranges', overlap in the heap.
+  bool IsValidPlacement(
+      const HeapSimulator::Result& result,
+      const std::vector<std::tuple<const HloValue*, int64, int64>>&
+          live_ranges) {
+    for (const auto& x : live_ranges) {
+      for (const auto& y : live_ranges) {
+        if (std::get<0>(x) == std::get<0>(y) ||
+            std::get<1>(x) > std::get<2>(y) ||
+            std::get<1>(y) > std::get<2>(x)) {
+          continue;
+        }
+        if (result.chunk_map.at(std::get<0>(x))
+                .OverlapsWith(result.chunk_map.at(std::get<0>(y)))) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+};
+
+TEST_F(IntervalPackingHeapTest, Empty) {
+  IntervalPackingHeap heap(/*alignment=*/1);
+  const HeapSimulator::Result result = heap.Finish();
+  EXPECT_EQ(0, result.heap_size);
+  EXPECT_EQ(0, result.chunk_map.size());
+  EXPECT_EQ(0, heap.lower_bound());
+  EXPECT_EQ(1.0, heap.fragmentation_ratio());
+}
+
+TEST_F(IntervalPackingHeapTest, FindsAreaOrder) {
+  GlobalDecreasingSizeBestFitHeap spatial_heap(
+      /*alignment=*/1, GlobalDecreasingSizeBestFitHeap::kSpatial);
+  AllocAreaFirstBuffers(&spatial_heap);
+  EXPECT_EQ(110, spatial_heap.Finish().heap_size);
+  GlobalDecreasingSizeBestFitHeap temporal_heap(
+      /*alignment=*/1, GlobalDecreasingSizeBestFitHeap::kTemporal);
+  AllocAreaFirstBuffers(&temporal_heap);
+  EXPECT_EQ(110, temporal_heap.Finish().heap_size);
+
+  IntervalPackingHeap heap(/*alignment=*/1);
+  AllocAreaFirstBuffers(&heap);
+  const HeapSimulator::Result result = heap.Finish();
+  EXPECT_EQ(90, result.heap_size);
+  EXPECT_EQ(90, heap.lower_bound());
+  EXPECT_EQ(1.0, heap.fragmentation_ratio());
+  // The search stops as soon as it reaches the lower bound.
+  EXPECT_EQ(3, heap.num_trials());
+
+  EXPECT_EQ(0, result.chunk_map.at(buffer_a_).offset);
+  EXPECT_EQ(0, result.chunk_map.at(buffer_b_).offset);
+  EXPECT_EQ(40, result.chunk_map.at(buffer_c_).offset);
+  EXPECT_EQ(50, result.chunk_map.at(buffer_d_).offset);
+}
+
+TEST_F(IntervalPackingHeapTest, TimeBudget) {
+  IntervalPackingHeap::Options options;
+  options.time_budget = absl::ZeroDuration();
+  IntervalPackingHeap heap(/*alignment=*/1, options);
+  AllocAreaFirstBuffers(&heap);
+  // Only the spatial order is placed.
+  EXPECT_EQ(110, heap.Finish().heap_size);
+  EXPECT_EQ(1, heap.num_trials());
+  EXPECT_NEAR(110.0 / 90.0, heap.fragmentation_ratio(), 1e-9);
+}
+
+TEST_F(IntervalPackingHeapTest, RefinesOrder) {
+  // Buffers are live at times (inclusive):
+  //   b: 10 bytes [0, 4], d: 40 bytes [1, 2], a: 10 bytes [3, 7],
+  //   c: 40 bytes [5, 6].
+  // The spatial, temporal and area orders all need a 60 byte heap, but d and c
+  // can share a chunk next to a and b.
+  IntervalPackingHeap::Options options;
+  options.max_trials = 100;
+  options.time_budget = absl::InfiniteDuration();
+  IntervalPackingHeap heap(/*alignment=*/1, options);
+  heap.Alloc(buffer_b_, 10);
+  heap.Alloc(buffer_d_, 40);
+  heap.Free(buffer_d_, 40);
+  heap.Alloc(buffer_a_, 10);
+  heap.Free(buffer_b_, 10);
+  heap.Alloc(buffer_c_, 40);
+  heap.Free(buffer_c_, 40);
+  heap.Free(buffer_a_, 10);
+
+  const HeapSimulator::Result result = heap.Finish();
+  EXPECT_EQ(50, heap.lower_bound());
+  EXPECT_EQ(50, result.heap_size);
+  EXPECT_LE(heap.num_trials(), options.max_trials);
+  EXPECT_TRUE(IsValidPlacement(result, {{buffer_b_, 0, 4},
+                                        {buffer_d_, 1, 2},
+                                        {buffer_a_, 3, 7},
+                                        {buffer_c_, 5, 6}}));
+}
+
+TEST_F(IntervalPackingHeapTest, ColocatedAndZeroSized) {
+  // a and c are colocated, so c must go where a is, next to b.
+  IntervalPackingHeap heap(/*alignment=*/1);
+  heap.Alloc(buffer_a_, 40);
+  heap.Free(buffer_a_, 40);
+  heap.Alloc(buffer_b_, 20);
+  heap.Alloc(buffer_d_, 0);
+  heap.ShareWith(buffer_c_, buffer_a_, 40);
+  heap.Free(buffer_c_, 40);
+  heap.Free(buffer_b_, 20);
+  heap.Free(buffer_d_, 0);
+
+  const HeapSimulator::Result result = heap.Finish();
+  EXPECT_EQ(60, heap.lower_bound());
+  EXPECT_EQ(60, result.heap_size);
+  EXPECT_EQ(result.chunk_map.at(buffer_a_).offset,
+            result.chunk_map.at(buffer_c_).offset);
+  EXPECT_EQ(0, result.chunk_map.at(buffer_d_).offset);
+  EXPECT_EQ(0, result.chunk_map.at(buffer_d_).size);
+}
+
 class IntervalTreeTest : public ::testing::Test {};
 
 TEST_F(IntervalTreeTest, InsertAndRemove) {
@@ -64,95 +64,98 @@ static bool IsOrContainsIllegalInstr(const HloInstruction* instr) {
 }
 
 StatusOr<bool> HloConstantFolding::Run(HloModule* module) {
+  XLA_VLOG_LINES(2,
+                 "HloConstantFolding::Run(), before:\n" + module->ToString());
+  TF_ASSIGN_OR_RETURN(bool changed, HloComputationPass::Run(module));
+  XLA_VLOG_LINES(2, "HloConstantFolding::Run(), after:\n" + module->ToString());
+  return changed;
+}
+
+StatusOr<bool> HloConstantFolding::RunOnComputation(
+    HloComputation* computation) {
   // Limit the constant folding to 0 iterations to skip folding loops. This
   // retains the behavior from before while loop support in HloEvaluator and may
   // be revised.
   auto evaluator = absl::make_unique<HloEvaluator>(/*max_loop_iterations=*/0);
-
-  XLA_VLOG_LINES(2,
-                 "HloConstantFolding::Run(), before:\n" + module->ToString());
   bool changed = false;
 
-  for (auto* computation : module->MakeNonfusionComputations()) {
-    for (auto instruction : computation->MakeInstructionPostOrder()) {
-      // Skip dead code.
-      if (instruction->user_count() == 0 &&
-          computation->root_instruction() != instruction) {
-        continue;
-      }
-
-      // Skip instructions with non-constant operands.
-      if (!hlo_query::AllOperandsAreConstants(*instruction)) {
-        continue;
-      }
+  for (auto instruction : computation->MakeInstructionPostOrder()) {
+    // Skip dead code.
+    if (instruction->user_count() == 0 &&
+        computation->root_instruction() != instruction) {
+      continue;
+    }
 
-      // Don't fold Constant, Parameter, and Tuple instructions.  Tuple
-      // constants are not directly supported by any backends, hence folding
-      // Tuple is not useful and would in fact be expanded back into kTuple by
-      // Algebraic Simplifier.
-      //
-      // (We do allow folding subcomputations that contain these instructions.)
-      if (instruction->opcode() == HloOpcode::kParameter ||
-          instruction->opcode() == HloOpcode::kConstant ||
-          instruction->opcode() == HloOpcode::kTuple) {
-        continue;
-      }
+    // Skip instructions with non-constant operands.
+    if (!hlo_query::AllOperandsAreConstants(*instruction)) {
+      continue;
+    }
 
-      // Broadcasts dramatically increase the size of constants, which is often
-      // detrimental to performance and memory capacity, so do not fold
-      // broadcasts.
-      if (instruction->opcode() == HloOpcode::kBroadcast ||
-          instruction->opcode() == HloOpcode::kIota) {
-        continue;
-      }
+    // Don't fold Constant, Parameter, and Tuple instructions.  Tuple
+    // constants are not directly supported by any backends, hence folding
+    // Tuple is not useful and would in fact be expanded back into kTuple by
+    // Algebraic Simplifier.
+    //
+    // (We do allow folding subcomputations that contain these instructions.)
+    if (instruction->opcode() == HloOpcode::kParameter ||
+        instruction->opcode() == HloOpcode::kConstant ||
+        instruction->opcode() == HloOpcode::kTuple) {
+      continue;
+    }
 
-      // Check for instructions that we can't fold even if they appear inside of
-      // a subcomputation (e.g. a kCall).
-      if (IsOrContainsIllegalInstr(instruction)) {
-        continue;
-      }
+    // Broadcasts dramatically increase the size of constants, which is often
+    // detrimental to performance and memory capacity, so do not fold
+    // broadcasts.
+    if (instruction->opcode() == HloOpcode::kBroadcast ||
+        instruction->opcode() == HloOpcode::kIota) {
+      continue;
+    }
 
-      // Don't constant-fold side-effecting instructions or instructions which
-      // contain side-effecting instructions.
-      if (instruction->HasSideEffect()) {
-        continue;
-      }
+    // Check for instructions that we can't fold even if they appear inside of
+    // a subcomputation (e.g. a kCall).
+    if (IsOrContainsIllegalInstr(instruction)) {
+      continue;
+    }
 
-      // Don't constant fold unless it's a net positive or the output is small.
-      if (instruction->shape().IsArray()) {
-        int64 elements_in_removed_operands = 0;
-        for (HloInstruction* operand : instruction->operands()) {
-          if (operand->user_count() == 1 && operand->shape().IsArray()) {
-            elements_in_removed_operands +=
-                ShapeUtil::ElementsIn(operand->shape());
-          }
-        }
-        int64 elements_in_constant =
-            ShapeUtil::ElementsIn(instruction->shape());
+    // Don't constant-fold side-effecting instructions or instructions which
+    // contain side-effecting instructions.
+    if (instruction->HasSideEffect()) {
+      continue;
+    }
 
-        static const int64 kMaximumConstantSizeElements = 45 * 1000 * 1000;
-        if (elements_in_constant > elements_in_removed_operands &&
-            elements_in_constant > kMaximumConstantSizeElements) {
-          continue;
+    // Don't constant fold unless it's a net positive or the output is small.
+    if (instruction->shape().IsArray()) {
+      int64 elements_in_removed_operands = 0;
+      for (HloInstruction* operand : instruction->operands()) {
+        if (operand->user_count() == 1 && operand->shape().IsArray()) {
+          elements_in_removed_operands +=
+              ShapeUtil::ElementsIn(operand->shape());
         }
       }
+      int64 elements_in_constant =
+          ShapeUtil::ElementsIn(instruction->shape());
 
-      Literal result;
-      // Currently we skip unimplemented operations.
-      // TODO(b/35975797): Fold constant computations for more operations.
-      if (!evaluator->TryEvaluate(instruction, &result)) {
-        VLOG(2) << "Constant folding failed for instruction: "
-                << instruction->ToString();
+      static const int64 kMaximumConstantSizeElements = 45 * 1000 * 1000;
+      if (elements_in_constant > elements_in_removed_operands &&
+          elements_in_constant > kMaximumConstantSizeElements) {
         continue;
       }
-      VLOG(4) << "Constant folded: " << instruction->ToString();
+    }
 
-      TF_RETURN_IF_ERROR(computation->ReplaceWithNewInstruction(
-          instruction, HloInstruction::CreateConstant(std::move(result))));
-      changed = true;
+    Literal result;
+    // Currently we skip unimplemented operations.
+    // TODO(b/35975797): Fold constant computations for more operations.
+    if (!evaluator->TryEvaluate(instruction, &result)) {
+      VLOG(2) << "Constant folding failed for instruction: "
+              << instruction->ToString();
+      continue;
     }
+    VLOG(4) << "Constant folded: " << instruction->ToString();
+
+    TF_RETURN_IF_ERROR(computation->ReplaceWithNewInstruction(
+        instruction, HloInstruction::CreateConstant(std::move(result))));
+    changed = true;
   }
-  XLA_VLOG_LINES(2, "HloConstantFolding::Run(), after:\n" + module->ToString());
   return changed;
 }
 
@@ -23,13 +23,16 @@ namespace xla {
 
 // A pass which performs constant folding in order to avoid unnecessary
 // computation on constants.
-class HloConstantFolding : public HloModulePass {
+class HloConstantFolding : public HloComputationPass {
  public:
   absl::string_view name() const override { return "constant_folding"; }
 
   // Run constant folding operations on the given module. Returns whether the
   // module was changed (constant expressions folded).
   StatusOr<bool> Run(HloModule* module) override;
+
+  // Run constant folding operations on the given computation.
+  StatusOr<bool> RunOnComputation(HloComputation* computation) override;
 };
 
 }  // namespace xla
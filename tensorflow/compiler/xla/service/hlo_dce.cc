@@ -74,21 +74,23 @@ StatusOr<bool> HloDCE::RunOnComputation(
 }
 
 StatusOr<bool> HloDCE::Run(HloModule* module) {
-  bool changed = false;
-
   VLOG(2) << "Before dce:";
   XLA_VLOG_LINES(2, module->ToString());
 
-  // Run DCE on each computation.
-  for (auto* computation : module->MakeComputationPostOrder()) {
-    TF_ASSIGN_OR_RETURN(
-        bool changed_for_computation,
-        RunOnComputation(computation, remove_cross_partition_collective_ops_));
-    changed |= changed_for_computation;
-  }
+  // Run DCE on each computation, then remove the dead computations.
+  TF_ASSIGN_OR_RETURN(bool changed, HloComputationPass::Run(module));
+
+  VLOG(2) << "After dce:";
+  XLA_VLOG_LINES(2, module->ToString());
+
+  return changed;
+}
+
+StatusOr<bool> HloDCE::FinishRun(HloModule* module) {
+  bool changed = false;
 
-  // Now DCE HloComputations.  First, collect the computations that are
-  // referenced by some remaining instruction.
+  // Collect the computations that are referenced by some remaining
+  // instruction.
   absl::flat_hash_set<HloComputation*> live_computations;
   if (HloComputation* entry_computation = module->entry_computation()) {
     live_computations.insert(entry_computation);
@@ -108,10 +110,6 @@ StatusOr<bool> HloDCE::Run(HloModule* module) {
       changed = true;
     }
   }
-
-  VLOG(2) << "After dce:";
-  XLA_VLOG_LINES(2, module->ToString());
-
   return changed;
 }
 
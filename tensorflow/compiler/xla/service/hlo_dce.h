@@ -33,7 +33,10 @@ namespace xla {
 //
 // This pass does not remove dead parameter instructions, as parameter
 // instructions cannot be deleted.
-class HloDCE : public HloModulePass {
+//
+// Dead instructions are removed from independent computations concurrently
+// when the pass is given a thread pool.
+class HloDCE : public HloComputationPass {
  public:
   HloDCE() : remove_cross_partition_collective_ops_(false) {}
   explicit HloDCE(bool remove_cross_partition_collective_ops)
@@ -45,11 +48,23 @@ class HloDCE : public HloModulePass {
   // Run DCE on a computation.
   StatusOr<bool> RunOnComputation(HloComputation* computation,
                                   bool remove_cross_partition_collective_ops);
+  StatusOr<bool> RunOnComputation(HloComputation* computation) override {
+    return RunOnComputation(computation,
+                            remove_cross_partition_collective_ops_);
+  }
 
   // Run the pass on the given module. Returns whether the module was changed
   // (instructions were removed).
   StatusOr<bool> Run(HloModule* module) override;
 
+ protected:
+  std::vector<HloComputation*> GetComputations(HloModule* module) override {
+    return module->MakeComputationPostOrder();
+  }
+
+  // Removes the computations which are no longer called.
+  StatusOr<bool> FinishRun(HloModule* module) override;
+
  private:
   bool remove_cross_partition_collective_ops_;
 };
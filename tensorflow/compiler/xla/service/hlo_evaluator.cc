@@ -47,8 +47,12 @@ limitations under the License.
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/window_util.h"
 #include "tensorflow/core/lib/core/bitmap.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/types.h"
@@ -229,6 +233,49 @@ HloEvaluator::HloEvaluator(int64 max_loop_iterations)
       });
 }
 
+/*static*/ bool HloEvaluator::HaveSameDenseLayout(
+    const Literal& result, absl::Span<const Literal* const> operands) {
+  if (!LayoutUtil::IsDenseArray(result.shape())) {
+    return false;
+  }
+  return absl::c_all_of(operands, [&](const Literal* operand) {
+    return LayoutUtil::IsDenseArray(operand->shape()) &&
+           LayoutUtil::Equal(operand->shape().layout(),
+                             result.shape().layout());
+  });
+}
+
+/*static*/ void HloEvaluator::ParallelForChunks(
+    int64 n, const std::function<void(int64, int64)>& fn,
+    int64 cost_per_element) {
+  // Below this cost, scheduling work on other threads costs more than it
+  // saves.
+  constexpr int64 kMinCostPerChunk = 1 << 15;
+  static tensorflow::thread::ThreadPool* pool =
+      new tensorflow::thread::ThreadPool(tensorflow::Env::Default(),
+                                         "hlo_evaluator",
+                                         tensorflow::port::MaxParallelism());
+  const int64 max_chunks = std::min<int64>(
+      pool->NumThreads() + 1,
+      n * std::max<int64>(cost_per_element, 1) / kMinCostPerChunk);
+  if (max_chunks <= 1) {
+    fn(0, n);
+    return;
+  }
+  const int64 chunk_size = CeilOfRatio(n, max_chunks);
+  const int64 num_chunks = CeilOfRatio(n, chunk_size);
+  // The calling thread populates the first chunk itself.
+  tensorflow::BlockingCounter counter(num_chunks - 1);
+  for (int64 begin = chunk_size; begin < n; begin += chunk_size) {
+    pool->Schedule([&fn, &counter, begin, chunk_size, n] {
+      fn(begin, std::min(n, begin + chunk_size));
+      counter.DecrementCount();
+    });
+  }
+  fn(0, chunk_size);
+  counter.Wait();
+}
+
 StatusOr<Literal> HloEvaluator::Evaluate(
     const HloComputation& computation,
     absl::Span<const Literal* const> arg_literals) {
@@ -2278,6 +2325,263 @@ static bool IsScalarAdd(HloComputation* computation) {
   return false;
 }
 
+// A reduction computation which applies a single binary operation to its
+// accumulator and element parameters.
+struct ScalarBinaryReducer {
+  HloOpcode opcode;
+  // Whether the accumulator, i.e. parameter 0, is the left operand.
+  bool accumulator_is_lhs;
+};
+
+static absl::optional<ScalarBinaryReducer> MatchScalarBinaryReducer(
+    HloComputation* computation, PrimitiveType type) {
+  const HloInstruction* root = computation->root_instruction();
+  switch (root->opcode()) {
+    case HloOpcode::kAdd:
+    case HloOpcode::kMultiply:
+    case HloOpcode::kMaximum:
+    case HloOpcode::kMinimum:
+    case HloOpcode::kAnd:
+    case HloOpcode::kOr:
+      break;
+    default:
+      return absl::nullopt;
+  }
+  if (computation->num_parameters() != 2) {
+    return absl::nullopt;
+  }
+  const HloInstruction* lhs = root->operand(0);
+  const HloInstruction* rhs = root->operand(1);
+  if (lhs->opcode() != HloOpcode::kParameter ||
+      rhs->opcode() != HloOpcode::kParameter || lhs == rhs) {
+    return absl::nullopt;
+  }
+  for (const HloInstruction* instruction : {root, lhs, rhs}) {
+    if (!ShapeUtil::IsScalarWithElementType(instruction->shape(), type)) {
+      return absl::nullopt;
+    }
+  }
+  return ScalarBinaryReducer{root->opcode(), lhs->parameter_number() == 0};
+}
+
+using ParallelForFn = void (*)(int64, const std::function<void(int64, int64)>&,
+                               int64);
+
+// Reduces the dimensions `dimensions_to_reduce` of the dense, dim0-major
+// `input` into `result` by folding `op` over the elements of each output.
+// The elements are folded in the same order as in the general reduction,
+// with the last reduced dimension varying fastest.
+template <typename NativeT, typename AccumT, typename BinaryOp>
+static void ReduceDenseArray(const Literal& input, AccumT init,
+                             absl::Span<const int64> dimensions_to_reduce,
+                             const BinaryOp& op, ParallelForFn parallel_for,
+                             Literal* result) {
+  const Shape& shape = input.shape();
+  const int64 rank = shape.rank();
+  const NativeT* input_data = input.data<NativeT>().data();
+  std::vector<int64> strides(rank);
+  std::vector<int64> kept_dims;
+  std::vector<int64> reduced_dims;
+  int64 stride = 1;
+  int64 reduced_count = 1;
+  for (int64 dim = rank - 1; dim >= 0; --dim) {
+    strides[dim] = stride;
+    stride *= shape.dimensions(dim);
+  }
+  for (int64 dim = 0; dim < rank; ++dim) {
+    if (absl::c_linear_search(dimensions_to_reduce, dim)) {
+      reduced_dims.push_back(dim);
+      reduced_count *= shape.dimensions(dim);
+    } else {
+      kept_dims.push_back(dim);
+    }
+  }
+  const int64 inner_dim = reduced_dims.empty() ? -1 : reduced_dims.back();
+  const int64 inner_size = inner_dim < 0 ? 1 : shape.dimensions(inner_dim);
+  const int64 inner_stride = inner_dim < 0 ? 0 : strides[inner_dim];
+
+  absl::Span<NativeT> output = result->data<NativeT>();
+  auto reduce_outputs = [&](int64 begin, int64 end) {
+    std::vector<int64> reduced_index(reduced_dims.size());
+    for (int64 i = begin; i < end; ++i) {
+      // The offset of the first input element folded into output i.
+      int64 offset = 0;
+      int64 remainder = i;
+      for (int64 k = kept_dims.size() - 1; k >= 0; --k) {
+        const int64 dim_size = shape.dimensions(kept_dims[k]);
+        offset += (remainder % dim_size) * strides[kept_dims[k]];
+        remainder /= dim_size;
+      }
+      AccumT accumulator = init;
+      std::fill(reduced_index.begin(), reduced_index.end(), 0);
+      while (reduced_count > 0) {
+        const NativeT* inner = input_data + offset;
+        for (int64 j = 0; j < inner_size; ++j) {
+          accumulator =
+              op(accumulator, static_cast<AccumT>(inner[j * inner_stride]));
+        }
+        // Steps the outer reduced dimensions, last one fastest.
+        int64 r = static_cast<int64>(reduced_dims.size()) - 2;
+        for (; r >= 0; --r) {
+          const int64 dim = reduced_dims[r];
+          offset += strides[dim];
+          if (++reduced_index[r] < shape.dimensions(dim)) {
+            break;
+          }
+          offset -= reduced_index[r] * strides[dim];
+          reduced_index[r] = 0;
+        }
+        if (r < 0) {
+          break;
+        }
+      }
+      output[i] = static_cast<NativeT>(accumulator);
+    }
+  };
+  parallel_for(output.size(), reduce_outputs,
+               /*cost_per_element=*/reduced_count);
+}
+
+template <typename NativeT,
+          typename std::enable_if<std::is_integral<NativeT>::value>::type* =
+              nullptr>
+static bool ReduceWithScalarBinaryOp(
+    const Literal& input, const Literal& init,
+    absl::Span<const int64> dimensions_to_reduce, ScalarBinaryReducer reducer,
+    ParallelForFn parallel_for, Literal* result) {
+  // These operations are commutative on integers, so the order of the
+  // accumulator and the element does not matter.
+  const NativeT init_value = init.Get<NativeT>({});
+  auto reduce = [&](auto op) {
+    ReduceDenseArray<NativeT, NativeT>(input, init_value, dimensions_to_reduce,
+                                       op, parallel_for, result);
+    return true;
+  };
+  switch (reducer.opcode) {
+    case HloOpcode::kAdd:
+      return reduce([](NativeT lhs, NativeT rhs) {
+        return NativeT(ToArithmeticSafeType(lhs) + ToArithmeticSafeType(rhs));
+      });
+    case HloOpcode::kMultiply:
+      return reduce([](NativeT lhs, NativeT rhs) {
+        return NativeT(ToArithmeticSafeType(lhs) * ToArithmeticSafeType(rhs));
+      });
+    case HloOpcode::kMaximum:
+      return reduce(
+          [](NativeT lhs, NativeT rhs) { return std::max(lhs, rhs); });
+    case HloOpcode::kMinimum:
+      return reduce(
+          [](NativeT lhs, NativeT rhs) { return std::min(lhs, rhs); });
+    case HloOpcode::kAnd:
+      return reduce([](NativeT lhs, NativeT rhs) { return lhs & rhs; });
+    case HloOpcode::kOr:
+      return reduce([](NativeT lhs, NativeT rhs) { return lhs | rhs; });
+    default:
+      return false;
+  }
+}
+
+template <typename NativeT, typename std::enable_if<std::is_floating_point<
+                                NativeT>::value>::type* = nullptr>
+static bool ReduceWithScalarBinaryOp(
+    const Literal& input, const Literal& init,
+    absl::Span<const int64> dimensions_to_reduce, ScalarBinaryReducer reducer,
+    ParallelForFn parallel_for, Literal* result) {
+  const NativeT init_value = init.Get<NativeT>({});
+  // Maximum and minimum pick their left operand among equal values, such as
+  // -0 and +0, so they keep the order of the accumulator and the element.
+  auto reduce_ordered = [&](auto op) {
+    if (reducer.accumulator_is_lhs) {
+      ReduceDenseArray<NativeT, NativeT>(input, init_value,
+                                         dimensions_to_reduce, op,
+                                         parallel_for, result);
+    } else {
+      ReduceDenseArray<NativeT, NativeT>(
+          input, init_value, dimensions_to_reduce,
+          [&op](NativeT accumulator, NativeT element) {
+            return op(element, accumulator);
+          },
+          parallel_for, result);
+    }
+    return true;
+  };
+  switch (reducer.opcode) {
+    case HloOpcode::kAdd:
+      // Like the general reduction, accumulates floating point sums in
+      // double precision.
+      ReduceDenseArray<NativeT, double>(
+          input, static_cast<double>(init_value), dimensions_to_reduce,
+          [](double lhs, double rhs) { return lhs + rhs; }, parallel_for,
+          result);
+      return true;
+    case HloOpcode::kMultiply:
+      return reduce_ordered(
+          [](NativeT lhs, NativeT rhs) { return NativeT(lhs * rhs); });
+    case HloOpcode::kMaximum:
+      return reduce_ordered([](NativeT lhs, NativeT rhs) {
+        return ((lhs >= rhs) || std::isnan(lhs)) ? lhs : rhs;
+      });
+    case HloOpcode::kMinimum:
+      return reduce_ordered([](NativeT lhs, NativeT rhs) {
+        return ((lhs <= rhs) || std::isnan(lhs)) ? lhs : rhs;
+      });
+    default:
+      return false;
+  }
+}
+
+// Evaluates a reduction of a single dense array with a scalar binary
+// operation directly over the array's storage, instead of evaluating the
+// reduction computation once per element. Returns false, without touching
+// `result`, if the reduction is not of this form.
+static bool TryReduceWithScalarBinaryOp(
+    const Literal& input, const Literal& init,
+    absl::Span<const int64> dimensions_to_reduce, HloComputation* function,
+    ParallelForFn parallel_for, Literal* result) {
+  const Shape& shape = input.shape();
+  const PrimitiveType type = shape.element_type();
+  if (!LayoutUtil::IsDenseArray(shape) ||
+      !LayoutUtil::IsMonotonicWithDim0Major(shape.layout()) ||
+      !LayoutUtil::IsMonotonicWithDim0Major(result->shape().layout()) ||
+      result->shape().element_type() != type ||
+      init.shape().element_type() != type) {
+    return false;
+  }
+  absl::optional<ScalarBinaryReducer> reducer =
+      MatchScalarBinaryReducer(function, type);
+  if (!reducer.has_value()) {
+    return false;
+  }
+  switch (type) {
+    case PRED:
+      return ReduceWithScalarBinaryOp<bool>(input, init, dimensions_to_reduce,
+                                            *reducer, parallel_for, result);
+    case S32:
+      return ReduceWithScalarBinaryOp<int32>(input, init, dimensions_to_reduce,
+                                             *reducer, parallel_for, result);
+    case S64:
+      return ReduceWithScalarBinaryOp<int64>(input, init, dimensions_to_reduce,
+                                             *reducer, parallel_for, result);
+    case U32:
+      return ReduceWithScalarBinaryOp<uint32>(input, init,
+                                              dimensions_to_reduce, *reducer,
+                                              parallel_for, result);
+    case U64:
+      return ReduceWithScalarBinaryOp<uint64>(input, init,
+                                              dimensions_to_reduce, *reducer,
+                                              parallel_for, result);
+    case F32:
+      return ReduceWithScalarBinaryOp<float>(input, init, dimensions_to_reduce,
+                                             *reducer, parallel_for, result);
+    case F64:
+      return ReduceWithScalarBinaryOp<double>(input, init,
+                                              dimensions_to_reduce, *reducer,
+                                              parallel_for, result);
+    default:
+      return false;
+  }
+}
+
 // Run a single step of an inner loop while running reduction, which applies
 // the user-provided computation on the accumulator and the output element
 // (until the reduction is completed, the output element is also used as
@@ -2457,13 +2761,19 @@ Status HloEvaluator::HandleReduce(HloInstruction* instr) {
     results[i] = Literal(is_tuple ? out_shape.tuple_shapes(i) : out_shape);
   }
 
-  TF_RETURN_IF_ERROR(ShapeUtil::ForEachIndexWithStatus(
-      output_shape, [&](absl::Span<const int64> output_index) {
-        return GenerateReduceOutputElement(
-            is_tuple, output_index, init_values, input_args,
-            absl::Span<Literal>(results), function, &embedded_evaluator,
-            arg_dim_steps, arg_dim_counts, result_to_arg_index);
-      }));
+  const bool reduced_dense_array =
+      !is_tuple && TryReduceWithScalarBinaryOp(
+                       *input_args[0], *init_values[0], dimensions_to_reduce,
+                       function, &ParallelForChunks, &results[0]);
+  if (!reduced_dense_array) {
+    TF_RETURN_IF_ERROR(ShapeUtil::ForEachIndexWithStatus(
+        output_shape, [&](absl::Span<const int64> output_index) {
+          return GenerateReduceOutputElement(
+              is_tuple, output_index, init_values, input_args,
+              absl::Span<Literal>(results), function, &embedded_evaluator,
+              arg_dim_steps, arg_dim_counts, result_to_arg_index);
+        }));
+  }
 
   if (is_tuple) {
     Literal tuple_result(inferred_return_shape);
@@ -326,23 +326,57 @@ class HloEvaluator : public DfsHloVisitorWithDefault {
   bool use_fast_path_ = false;
 
  private:
-  template <typename ReturnT, typename NativeT>
+  template <typename ReturnT, typename NativeT, typename UnaryOp>
   static StatusOr<Literal> ElementWiseUnaryOpImpl(
-      HloInstruction* instruction,
-      const std::function<ReturnT(NativeT)>& unary_op,
+      HloInstruction* instruction, const UnaryOp& unary_op,
       const Literal& operand_literal) {
     const auto shape = instruction->shape();
     const auto* operand = instruction->operand(0);
     TF_RET_CHECK(ShapeUtil::SameDimensions(shape, operand->shape()));
 
     Literal result(shape);
+    if (HaveSameDenseLayout(result, {&operand_literal})) {
+      absl::Span<const NativeT> operand_data = operand_literal.data<NativeT>();
+      PopulateLinear<ReturnT>(&result, [&](int64 i) {
+        return static_cast<ReturnT>(unary_op(operand_data[i]));
+      });
+      return std::move(result);
+    }
     TF_RETURN_IF_ERROR(
         result.Populate<ReturnT>([&](absl::Span<const int64> multi_index) {
-          return unary_op(operand_literal.Get<NativeT>(multi_index));
+          return static_cast<ReturnT>(
+              unary_op(operand_literal.Get<NativeT>(multi_index)));
         }));
     return std::move(result);
   }
 
+  // Returns true if `result` and all `operands` are dense arrays with the same
+  // layout, so that elementwise operations can iterate over their linear
+  // element storage instead of over multi-dimensional indices.
+  static bool HaveSameDenseLayout(const Literal& result,
+                                  absl::Span<const Literal* const> operands);
+
+  // Calls `fn(begin, end)` on contiguous chunks covering [0, n). Large ranges
+  // are split across a thread pool. `cost_per_element` is the number of
+  // elements of work each index of the range stands for.
+  static void ParallelForChunks(int64 n,
+                                const std::function<void(int64, int64)>& fn,
+                                int64 cost_per_element = 1);
+
+  // Sets the element at each linear index i of `result` to `generator(i)`.
+  // The loop over each chunk is free of indexing overhead, so that the
+  // compiler can inline and vectorize `generator` where possible.
+  template <typename ReturnT, typename Generator>
+  static void PopulateLinear(Literal* result, const Generator& generator) {
+    absl::Span<ReturnT> data = result->data<ReturnT>();
+    ParallelForChunks(data.size(), [&](int64 begin, int64 end) {
+      ReturnT* out = data.data();
+      for (int64 i = begin; i < end; ++i) {
+        out[i] = generator(i);
+      }
+    });
+  }
+
   // Map from a primitive type to its associated (templated) DfsHloVisitor.
   std::unique_ptr<DfsHloVisitor> typed_visitors_[PrimitiveType_ARRAYSIZE];
 
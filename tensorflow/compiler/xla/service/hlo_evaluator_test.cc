@@ -14,7 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/compiler/xla/service/hlo_evaluator.h"
 
+#include <cmath>
 #include <initializer_list>
+#include <limits>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -359,6 +361,33 @@ TEST_F(HloEvaluatorTest, DoesMultiply) {
   TestBinaryOp(HloOpcode::kMultiply, std::move(expected), std::move(lhs),
                std::move(rhs));
 }
+// Large operands are evaluated in parallel chunks over the linear storage.
+TEST_F(HloEvaluatorTest, DoesMultiplyLarge) {
+  Array2D<float> lhs(512, 300);
+  Array2D<float> rhs(512, 300);
+  Array2D<float> expected(512, 300);
+  for (int64 i = 0; i < 512; ++i) {
+    for (int64 j = 0; j < 300; ++j) {
+      lhs(i, j) = i - 256.0f;
+      rhs(i, j) = j * 0.5f;
+      expected(i, j) = lhs(i, j) * rhs(i, j);
+    }
+  }
+  TestBinaryOp(HloOpcode::kMultiply,
+               LiteralUtil::CreateR2FromArray2D<float>(expected),
+               LiteralUtil::CreateR2FromArray2D<float>(lhs),
+               LiteralUtil::CreateR2FromArray2D<float>(rhs));
+}
+// Operands whose layout differs from the result's are evaluated by index.
+TEST_F(HloEvaluatorTest, DoesSubtractMixedLayouts) {
+  auto lhs = LiteralUtil::CreateR2<int32>({{1, 2, 3}, {4, 5, 6}})
+                 .Relayout(LayoutUtil::MakeLayout({0, 1}));
+  auto rhs = LiteralUtil::CreateR2<int32>({{10, 20, 30}, {40, 50, 60}});
+  auto expected =
+      LiteralUtil::CreateR2<int32>({{-9, -18, -27}, {-36, -45, -54}});
+  TestBinaryOp(HloOpcode::kSubtract, std::move(expected), std::move(lhs),
+               std::move(rhs));
+}
 // Verifies that HloEvaluator evaluates a HLO instruction that performs
 // element-wise divide with 2 operands.
 TEST_F(HloEvaluatorTest, DoesDivideInt64) {
@@ -2624,6 +2653,91 @@ TEST_P(HloEvaluatorBf16Test, ReduceAdd) {
   EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
 }
 
+TEST_F(HloEvaluatorTest, ReduceNonMinorDimensions) {
+  const char* hlo_text = R"(
+HloModule ReduceNonMinorDimensions
+
+add_s32 {
+  lhs = s32[] parameter(0)
+  rhs = s32[] parameter(1)
+  ROOT add = s32[] add(lhs, rhs)
+}
+
+max_s32 {
+  lhs = s32[] parameter(0)
+  rhs = s32[] parameter(1)
+  ROOT max = s32[] maximum(lhs, rhs)
+}
+
+ENTRY main {
+  arg = s32[2,2,3] parameter(0)
+  zero = s32[] constant(0)
+  min = s32[] constant(-2147483648)
+  sum = s32[2] reduce(arg, zero), dimensions={0,2}, to_apply=add_s32
+  max = s32[2,3] reduce(arg, min), dimensions={1}, to_apply=max_s32
+  ROOT tuple = (s32[2], s32[2,3]) tuple(sum, max)
+}
+)";
+  auto arg = LiteralUtil::CreateR3<int32>(
+      {{{1, 2, 3}, {4, 5, 6}}, {{7, -8, 9}, {-10, 11, 12}}});
+  auto expected = LiteralUtil::MakeTupleFromSlices(
+      {LiteralUtil::CreateR1<int32>({14, 28}),
+       LiteralUtil::CreateR2<int32>({{4, 5, 6}, {7, 11, 12}})});
+  TF_ASSERT_OK_AND_ASSIGN(m_, ParseAndReturnVerifiedModule(hlo_text));
+  TF_ASSERT_OK_AND_ASSIGN(Literal result, Evaluate({&arg}));
+  EXPECT_TRUE(LiteralTestUtil::Equal(expected, result));
+}
+
+// The order of the reducer's parameters decides which of two equal values is
+// kept, which is observable for signed zeros.
+TEST_F(HloEvaluatorTest, ReduceMaxKeepsReducerOperandOrder) {
+  const char* hlo_text = R"(
+HloModule ReduceMaxKeepsReducerOperandOrder
+
+max_f32 {
+  lhs = f32[] parameter(0)
+  rhs = f32[] parameter(1)
+  ROOT max = f32[] maximum(rhs, lhs)
+}
+
+ENTRY main {
+  arg = f32[2,2] parameter(0)
+  init = f32[] constant(-inf)
+  ROOT max = f32[2] reduce(arg, init), dimensions={1}, to_apply=max_f32
+}
+)";
+  auto arg = LiteralUtil::CreateR2<float>(
+      {{-0.0f, 0.0f}, {1.0f, std::numeric_limits<float>::quiet_NaN()}});
+  TF_ASSERT_OK_AND_ASSIGN(m_, ParseAndReturnVerifiedModule(hlo_text));
+  TF_ASSERT_OK_AND_ASSIGN(Literal result, Evaluate({&arg}));
+  EXPECT_EQ(result.Get<float>({0}), 0.0f);
+  EXPECT_FALSE(std::signbit(result.Get<float>({0})));
+  EXPECT_TRUE(std::isnan(result.Get<float>({1})));
+}
+
+TEST_F(HloEvaluatorTest, ReduceZeroSizedDimension) {
+  const char* hlo_text = R"(
+HloModule ReduceZeroSizedDimension
+
+mul_f32 {
+  lhs = f32[] parameter(0)
+  rhs = f32[] parameter(1)
+  ROOT mul = f32[] multiply(lhs, rhs)
+}
+
+ENTRY main {
+  arg = f32[3,0] parameter(0)
+  one = f32[] constant(1)
+  ROOT prod = f32[3] reduce(arg, one), dimensions={1}, to_apply=mul_f32
+}
+)";
+  auto arg = LiteralUtil::CreateR2FromArray2D<float>(Array2D<float>(3, 0));
+  TF_ASSERT_OK_AND_ASSIGN(m_, ParseAndReturnVerifiedModule(hlo_text));
+  TF_ASSERT_OK_AND_ASSIGN(Literal result, Evaluate({&arg}));
+  EXPECT_TRUE(
+      LiteralTestUtil::Equal(LiteralUtil::CreateR1<float>({1, 1, 1}), result));
+}
+
 TEST_P(HloEvaluatorBf16Test, ReduceWindowMax) {
   HloComputation::Builder b(TestName());
 
@@ -145,22 +145,7 @@ class HloEvaluatorTypedVisitor : public DfsHloVisitorWithDefault {
  public:
   explicit HloEvaluatorTypedVisitor(HloEvaluator* p) : parent_(p) {}
 
-  // The following higher-order functions convert a function with ElementwiseT
-  // to a function with ReturnT.
-  std::function<ReturnT(ReturnT)> ConvertUnaryFunction(
-      const std::function<ElementwiseT(ElementwiseT)>& unary_op) {
-    return [&unary_op](ReturnT arg) {
-      return static_cast<ReturnT>(unary_op(static_cast<ElementwiseT>(arg)));
-    };
-  }
-  std::function<ReturnT(ReturnT, ReturnT)> ConvertBinaryFunction(
-      const std::function<ElementwiseT(ElementwiseT, ElementwiseT)>&
-          binary_op) {
-    return [&binary_op](ReturnT arg1, ReturnT arg2) {
-      return static_cast<ReturnT>(binary_op(static_cast<ElementwiseT>(arg1),
-                                            static_cast<ElementwiseT>(arg2)));
-    };
-  }
+  // Converts a function with ElementwiseT to a function with ReturnT.
   std::function<ReturnT(ReturnT, ReturnT, ReturnT)> ConvertTernaryFunction(
       const std::function<ElementwiseT(ElementwiseT, ElementwiseT,
                                        ElementwiseT)>& ternary_op) {
@@ -2857,23 +2842,29 @@ class HloEvaluatorTypedVisitor : public DfsHloVisitorWithDefault {
     return std::move(result);
   }
 
-  StatusOr<Literal> ElementWiseUnaryOp(
-      HloInstruction* instruction,
-      const std::function<ElementwiseT(ElementwiseT)>& unary_op) {
+  // The elementwise operations are templated on the type of the operation, so
+  // that it is inlined into the loops over the operands' storage.
+  template <typename UnaryOp>
+  StatusOr<Literal> ElementWiseUnaryOp(HloInstruction* instruction,
+                                       const UnaryOp& unary_op) {
     const Literal& operand_literal =
         parent_->GetEvaluatedLiteralFor(instruction->operand(0));
     TF_ASSIGN_OR_RETURN(
         auto result_literal,
         (HloEvaluator::ElementWiseUnaryOpImpl<ReturnT, ReturnT>(
-            instruction, ConvertUnaryFunction(unary_op), operand_literal)));
+            instruction,
+            [&unary_op](ReturnT arg) {
+              return static_cast<ReturnT>(static_cast<ElementwiseT>(
+                  unary_op(static_cast<ElementwiseT>(arg))));
+            },
+            operand_literal)));
 
     return std::move(result_literal);
   }
 
-  StatusOr<Literal> ElementWiseBinaryOp(
-      HloInstruction* instruction,
-      const std::function<ElementwiseT(ElementwiseT, ElementwiseT)>&
-          binary_op) {
+  template <typename BinaryOp>
+  StatusOr<Literal> ElementWiseBinaryOp(HloInstruction* instruction,
+                                        const BinaryOp& binary_op) {
     const auto shape = instruction->shape();
     const auto* lhs = instruction->operand(0);
     const auto* rhs = instruction->operand(1);
@@ -2883,13 +2874,26 @@ class HloEvaluatorTypedVisitor : public DfsHloVisitorWithDefault {
     const Literal& lhs_literal = parent_->GetEvaluatedLiteralFor(lhs);
     const Literal& rhs_literal = parent_->GetEvaluatedLiteralFor(rhs);
 
+    auto op = [&binary_op](ReturnT lhs_elem, ReturnT rhs_elem) {
+      return static_cast<ReturnT>(static_cast<ElementwiseT>(
+          binary_op(static_cast<ElementwiseT>(lhs_elem),
+                    static_cast<ElementwiseT>(rhs_elem))));
+    };
+
     Literal result(shape);
+    if (HloEvaluator::HaveSameDenseLayout(result,
+                                          {&lhs_literal, &rhs_literal})) {
+      const ReturnT* lhs_data = lhs_literal.data<ReturnT>().data();
+      const ReturnT* rhs_data = rhs_literal.data<ReturnT>().data();
+      HloEvaluator::PopulateLinear<ReturnT>(
+          &result, [&](int64 i) { return op(lhs_data[i], rhs_data[i]); });
+      return std::move(result);
+    }
 
     TF_RETURN_IF_ERROR(
         result.Populate<ReturnT>([&](absl::Span<const int64> multi_index) {
-          return ConvertBinaryFunction(binary_op)(
-              lhs_literal.Get<ReturnT>(multi_index),
-              rhs_literal.Get<ReturnT>(multi_index));
+          return op(lhs_literal.Get<ReturnT>(multi_index),
+                    rhs_literal.Get<ReturnT>(multi_index));
         }));
     return std::move(result);
   }
@@ -2911,6 +2915,16 @@ class HloEvaluatorTypedVisitor : public DfsHloVisitorWithDefault {
     const Literal& ehs_literal = parent_->GetEvaluatedLiteralFor(ehs);
 
     Literal result(shape);
+    if (HloEvaluator::HaveSameDenseLayout(
+            result, {&lhs_literal, &rhs_literal, &ehs_literal})) {
+      const LhsType* lhs_data = lhs_literal.data<LhsType>().data();
+      const RhsType* rhs_data = rhs_literal.data<RhsType>().data();
+      const EhsType* ehs_data = ehs_literal.data<EhsType>().data();
+      HloEvaluator::PopulateLinear<ReturnT>(&result, [&](int64 i) {
+        return ternary_op(lhs_data[i], rhs_data[i], ehs_data[i]);
+      });
+      return std::move(result);
+    }
 
     TF_RETURN_IF_ERROR(
         result.Populate<ReturnT>([&](absl::Span<const int64> multi_index) {
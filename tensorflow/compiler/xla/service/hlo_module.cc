@@ -101,18 +101,22 @@ HloComputation* HloModule::AddComputationInternal(
     // next_unique_id_ to the one greater than the max unique id of any
     // instruction (or the computation) to avoid ID collisions.
     computation_name_uniquer_.GetUniqueName(computation->name());
+    int next_unique_id = computation->unique_id() + 1;
     for (auto* instruction : computation->instructions()) {
       instruction_name_uniquer_.GetUniqueName(instruction->name());
-      next_unique_id_ = std::max(next_unique_id_, instruction->unique_id() + 1);
+      next_unique_id = std::max(next_unique_id, instruction->unique_id() + 1);
     }
-    if (next_unique_id_ < computation->unique_id() + 1) {
-      next_unique_id_ = computation->unique_id() + 1;
+    int current = next_unique_id_.load();
+    while (current < next_unique_id &&
+           !next_unique_id_.compare_exchange_weak(current, next_unique_id)) {
     }
   }
 
   computation->set_parent(this);
+  HloComputation* added = computation.get();
+  tensorflow::mutex_lock lock(computations_mutex_);
   computations_.push_back(std::move(computation));
-  return computations_.back().get();
+  return added;
 }
 
 HloComputation* HloModule::AddEntryComputation(
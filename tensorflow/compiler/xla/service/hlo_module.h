@@ -264,12 +264,8 @@ class HloModule {
   // Returns the NameUniquer for uniquing instruction names in this module.
   NameUniquer& instruction_name_uniquer() { return instruction_name_uniquer_; }
 
-  // Assign a new unique dense id for an instruction
-  int NewUniqueInstructionId() {
-    int result = next_unique_id_;
-    next_unique_id_++;
-    return result;
-  }
+  // Assign a new unique dense id for an instruction. Thread-safe.
+  int NewUniqueInstructionId() { return next_unique_id_++; }
 
   // input_output_alias_config indicates the list of aliased buffers that are
   // expected from the module.
@@ -384,7 +380,11 @@ class HloModule {
   // unique per module.
   NameUniquer computation_name_uniquer_{/*separator=*/"."};
   NameUniquer instruction_name_uniquer_{/*separator=*/"."};
-  int next_unique_id_ = 0;
+  std::atomic<int> next_unique_id_{0};
+
+  // Guards additions to computations_, which passes running on different
+  // computations concurrently may make.
+  tensorflow::mutex computations_mutex_;
 
   // Used to keep track of the next unique module id that should be assigned.
   static std::atomic<int> next_unique_module_id_;
@@ -0,0 +1,99 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/hlo_pass_interface.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+
+namespace xla {
+
+StatusOr<bool> HloComputationPass::Run(HloModule* module) {
+  const std::vector<HloComputation*> computations = GetComputations(module);
+  bool changed = false;
+  if (thread_pool_ != nullptr && thread_pool_->NumThreads() > 1 &&
+      computations.size() > 1) {
+    TF_ASSIGN_OR_RETURN(changed, RunInParallel(computations, module));
+  } else {
+    for (HloComputation* computation : computations) {
+      TF_ASSIGN_OR_RETURN(bool computation_changed,
+                          RunOnComputation(computation));
+      changed |= computation_changed;
+    }
+  }
+  TF_ASSIGN_OR_RETURN(bool finish_changed, FinishRun(module));
+  return changed || finish_changed;
+}
+
+StatusOr<bool> HloComputationPass::RunInParallel(
+    absl::Span<HloComputation* const> computations, HloModule* module) {
+  // The depth of a computation is the length of the longest chain of calls
+  // from it. Computations of the same depth never call one another, and
+  // nothing they call is processed while they are.
+  absl::flat_hash_map<const HloComputation*, int64> depths;
+  for (const HloComputation* computation : module->MakeComputationPostOrder()) {
+    int64 depth = 0;
+    for (const HloInstruction* instruction : computation->instructions()) {
+      for (const HloComputation* callee : instruction->called_computations()) {
+        depth = std::max(depth, depths[callee] + 1);
+      }
+    }
+    depths[computation] = depth;
+  }
+  std::vector<std::vector<int64>> levels;
+  for (int64 i = 0; i < computations.size(); ++i) {
+    const int64 depth = depths[computations[i]];
+    if (levels.size() <= depth) {
+      levels.resize(depth + 1);
+    }
+    levels[depth].push_back(i);
+  }
+
+  std::vector<Status> statuses(computations.size());
+  std::vector<char> changed(computations.size(), false);
+  auto run = [&](int64 i) {
+    StatusOr<bool> result = RunOnComputation(computations[i]);
+    if (result.ok()) {
+      changed[i] = result.ValueOrDie();
+    } else {
+      statuses[i] = result.status();
+    }
+  };
+  for (const std::vector<int64>& level : levels) {
+    if (level.size() == 1) {
+      run(level[0]);
+    } else if (level.size() > 1) {
+      tensorflow::BlockingCounter counter(level.size());
+      for (int64 i : level) {
+        thread_pool_->Schedule([&run, &counter, i] {
+          run(i);
+          counter.DecrementCount();
+        });
+      }
+      counter.Wait();
+    }
+    // Stop at the first failing computation, in the order given.
+    for (int64 i : level) {
+      TF_RETURN_IF_ERROR(statuses[i]);
+    }
+  }
+  return std::any_of(changed.begin(), changed.end(),
+                     [](char c) { return c != 0; });
+}
+
+}  // namespace xla
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/statusor.h"
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace xla {
 
@@ -43,6 +44,11 @@ class HloPassInterface {
   virtual StatusOr<bool> RunOnModuleGroup(HloModuleGroup* module_group) = 0;
 
   virtual bool IsPassPipeline() { return false; }
+
+  // Sets a thread pool which the pass may use to process independent parts of
+  // the HLO concurrently, or null to run sequentially. The pool must outlive
+  // any runs of the pass. Passes which don't run in parallel ignore it.
+  virtual void SetThreadPool(tensorflow::thread::ThreadPool* thread_pool) {}
 };
 
 // Base class for passes which are module-scoped.
@@ -68,6 +74,50 @@ class HloModulePass : public HloPassInterface {
   virtual void UpdateLayout(Shape* shape) {}
 };
 
+// Base class for passes which transform each computation of a module
+// independently of the others, such as simplifiers and dead code elimination.
+// Given a thread pool, the pass runs on independent computations concurrently.
+//
+// RunOnComputation may read any computation called, directly or not, by its
+// computation, and may add instructions to its computation and embedded
+// computations to the module, but must not modify any other computation, nor
+// read the module's list of computations. Computations are processed callees
+// first; a computation is never processed while a computation it calls is.
+//
+// When run in parallel, the names and unique ids given to new instructions
+// depend on the order in which threads create them.
+class HloComputationPass : public HloModulePass {
+ public:
+  // Runs the pass on one computation. Returns whether it was modified.
+  virtual StatusOr<bool> RunOnComputation(HloComputation* computation) = 0;
+
+  // Runs RunOnComputation on each computation returned by GetComputations(),
+  // then FinishRun().
+  StatusOr<bool> Run(HloModule* module) override;
+
+  void SetThreadPool(tensorflow::thread::ThreadPool* thread_pool) override {
+    thread_pool_ = thread_pool;
+  }
+
+ protected:
+  // Returns the computations to run the pass on, in post order. Defaults to
+  // the non-fusion computations.
+  virtual std::vector<HloComputation*> GetComputations(HloModule* module) {
+    return module->MakeNonfusionComputations();
+  }
+
+  // Runs after all the computations were processed, sequentially, for work
+  // which spans computations. Returns whether the module was modified.
+  virtual StatusOr<bool> FinishRun(HloModule* module) { return false; }
+
+ private:
+  // Runs the computations concurrently, one call depth at a time.
+  StatusOr<bool> RunInParallel(absl::Span<HloComputation* const> computations,
+                               HloModule* module);
+
+  tensorflow::thread::ThreadPool* thread_pool_ = nullptr;
+};
+
 // Base class for passes which are module-group scoped. These passes cannot run
 // on an HLO module.
 class HloModuleGroupPass : public HloPassInterface {
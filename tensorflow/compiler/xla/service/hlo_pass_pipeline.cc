@@ -67,6 +67,9 @@ StatusOr<bool> HloPassPipeline::RunPassesInternal(
     if (!pass->IsPassPipeline()) {
       compilation_stats_->StartPass(pass_name);
     }
+    if (thread_pool_ != nullptr) {
+      pass->SetThreadPool(thread_pool_);
+    }
     TF_ASSIGN_OR_RETURN(bool pass_changed, RunHelper(pass, hlo));
     changed |= pass_changed;
     TF_RETURN_IF_ERROR(RunInvariantCheckers(hlo, pass_name));
@@ -83,6 +83,13 @@ class HloPassPipeline : public HloPassInterface {
 
   bool IsPassPipeline() override { return true; }
 
+  // Sets the thread pool on which the passes of the pipeline, including those
+  // of nested pipelines, run their independent work. Computation passes (see
+  // HloComputationPass) then process independent computations concurrently.
+  void SetThreadPool(tensorflow::thread::ThreadPool* thread_pool) override {
+    thread_pool_ = thread_pool;
+  }
+
  private:
   // Returns the set of passes which are enabled. DebugOptions can selectively
   // disable passes via --xla_disable_hlo_passes flag.
@@ -127,6 +134,7 @@ class HloPassPipeline : public HloPassInterface {
   std::vector<std::unique_ptr<HloPassInterface>> passes_;
   std::vector<std::unique_ptr<HloPassInterface>> invariant_checkers_;
   bool run_called_ = false;
+  tensorflow::thread::ThreadPool* thread_pool_ = nullptr;
 
   CompilationStats* compilation_stats_;
   // Default stats instance for when one is not passed in the constructor.
@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/service/hlo_pass_pipeline.h"
 
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
 #include "tensorflow/compiler/xla/service/hlo_computation.h"
 #include "tensorflow/compiler/xla/service/hlo_instruction.h"
 #include "tensorflow/compiler/xla/service/hlo_module.h"
@@ -22,6 +25,9 @@ limitations under the License.
 #include "tensorflow/compiler/xla/tests/hlo_test_base.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace xla {
 namespace {
@@ -95,6 +101,39 @@ class BarBlowerUpper : public HloModulePass {
   }
 };
 
+// A computation pass which replaces adds with multiplies, and checks that the
+// computations called by a computation are processed before it.
+class AddToMultiplyComputationPass : public HloComputationPass {
+ public:
+  absl::string_view name() const override { return "add2multiply"; }
+
+  StatusOr<bool> RunOnComputation(HloComputation* computation) override {
+    bool changed = false;
+    for (HloInstruction* instruction :
+         computation->MakeInstructionPostOrder()) {
+      for (HloComputation* callee : instruction->called_computations()) {
+        tensorflow::mutex_lock lock(mu_);
+        EXPECT_TRUE(processed_.contains(callee)) << callee->name();
+      }
+      if (instruction->opcode() == HloOpcode::kAdd) {
+        TF_RETURN_IF_ERROR(computation->ReplaceWithNewInstruction(
+            instruction, HloInstruction::CreateBinary(
+                             instruction->shape(), HloOpcode::kMultiply,
+                             instruction->mutable_operand(0),
+                             instruction->mutable_operand(1))));
+        changed = true;
+      }
+    }
+    tensorflow::mutex_lock lock(mu_);
+    processed_.insert(computation);
+    return changed;
+  }
+
+ private:
+  tensorflow::mutex mu_;
+  absl::flat_hash_set<const HloComputation*> processed_;
+};
+
 TEST_F(HloPassPipelineTest, ModulePassChanged) {
   // Test an HLO module pass which changes a module.
   const string module_str = R"(
@@ -255,5 +294,57 @@ ENTRY main {
       ::testing::HasSubstr("Module group pass cannot be run on a module"));
 }
 
+TEST_F(HloPassPipelineTest, ComputationPassRunsInParallel) {
+  // Many reducers called by one computation, itself called by the entry.
+  constexpr int kNumReducers = 16;
+  string module_str = "HloModule ComputationPassRunsInParallel\n";
+  string reduces;
+  for (int i = 0; i < kNumReducers; ++i) {
+    absl::StrAppendFormat(&module_str,
+                          "add%d {\n"
+                          "  x%d = f32[] parameter(0)\n"
+                          "  y%d = f32[] parameter(1)\n"
+                          "  ROOT sum%d = f32[] add(x%d, y%d)\n"
+                          "}\n",
+                          i, i, i, i, i, i);
+    absl::StrAppendFormat(&reduces,
+                          "  r%d = f32[] reduce(p, zero), dimensions={0}, "
+                          "to_apply=add%d\n",
+                          i, i);
+  }
+  absl::StrAppend(&module_str, "caller {\n", "  p = f32[4] parameter(0)\n",
+                  "  zero = f32[] constant(0)\n", reduces,
+                  "  ROOT total = f32[] add(r0, r1)\n", "}\n",
+                  "ENTRY main {\n", "  a = f32[4] parameter(0)\n",
+                  "  c = f32[] call(a), to_apply=caller\n",
+                  "  ROOT d = f32[] add(c, c)\n", "}\n");
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<VerifiedHloModule> module,
+                          ParseAndReturnVerifiedModule(module_str));
+
+  tensorflow::thread::ThreadPool thread_pool(tensorflow::Env::Default(),
+                                             TestName(), /*num_threads=*/4);
+  HloPassPipeline pipeline(TestName());
+  pipeline.AddPass<AddToMultiplyComputationPass>();
+  pipeline.SetThreadPool(&thread_pool);
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, pipeline.Run(module.get()));
+  EXPECT_TRUE(changed);
+
+  // All the new instructions got distinct names and ids.
+  absl::flat_hash_set<string> names;
+  absl::flat_hash_set<int> ids;
+  int num_multiplies = 0;
+  for (const HloComputation* computation : module->computations()) {
+    for (const HloInstruction* instruction : computation->instructions()) {
+      EXPECT_NE(instruction->opcode(), HloOpcode::kAdd);
+      num_multiplies += instruction->opcode() == HloOpcode::kMultiply;
+      EXPECT_TRUE(names.insert(instruction->name()).second)
+          << instruction->name();
+      EXPECT_TRUE(ids.insert(instruction->unique_id()).second)
+          << instruction->name();
+    }
+  }
+  EXPECT_EQ(num_multiplies, kNumReducers + 2);
+}
+
 }  // namespace
 }  // namespace xla
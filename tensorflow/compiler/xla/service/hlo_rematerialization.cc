@@ -371,7 +371,9 @@ class MemoryUsageTracker {
       const HloRematerialization::CompactShapeFunction& compact_shape_function,
       const TuplePointsToAnalysis& points_to_analysis,
       const InstructionList& instruction_list,
-      HloRematerialization::RematerializationMode mode);
+      HloRematerialization::RematerializationMode mode,
+      const HloRematerialization::RecomputeCostFunction&
+          recompute_cost_function);
 
   // Starts the placement of the given instruction. This adds the sizes of the
   // LogicalBuffers defined by the instruction to the current memory
@@ -381,8 +383,8 @@ class MemoryUsageTracker {
   // EndInstruction memory for dead operand(s) is freed.
   Status BeginInstruction(Item* item);
 
-  int64 RematerializationCost(const std::vector<Item*>& items,
-                              int64 memory_reduced, int64 memory_limit_bytes) {
+  double RematerializationCost(const std::vector<Item*>& items,
+                               int64 memory_reduced, int64 memory_limit_bytes) {
     // If none of the users of any 'item' have been placed in the
     // sequence (as tracked by memory_tracker), then rematerialization of
     // 'item' is a zero-cost move of 'item->instruction' in the sequence.
@@ -401,10 +403,30 @@ class MemoryUsageTracker {
     }
 
     CHECK_GT(memory_reduced, 0);
+    if (recompute_cost_function_ != nullptr) {
+      // Return the cost of recomputing the items per byte of memory saved.
+      double recompute_cost = 0.0;
+      for (auto* item : items) {
+        recompute_cost += RecomputeCost(item->instruction);
+      }
+      return recompute_cost / memory_reduced;
+    }
     // Return the inverse of the benefit of rematerialization.
     return memory_limit_bytes / memory_reduced;
   }
 
+  // Returns the estimated cost of recomputing 'instruction', caching the
+  // result. Must only be called if a recompute cost function was provided.
+  double RecomputeCost(HloInstruction* instruction) {
+    auto it = recompute_cost_.find(instruction);
+    if (it == recompute_cost_.end()) {
+      it = recompute_cost_
+               .emplace(instruction, recompute_cost_function_(instruction))
+               .first;
+    }
+    return it->second;
+  }
+
   // Finishes the placement of the current instruction. This frees any dead
   // operands or dead result of the instruction. This must be called after
   // each call to BeginInstruction.
@@ -631,6 +653,13 @@ class MemoryUsageTracker {
   Item* in_progress_item_ = nullptr;
 
   HloRematerialization::RematerializationMode mode_;
+
+  // Estimates the cost of recomputing an instruction. May be nullptr.
+  const HloRematerialization::RecomputeCostFunction& recompute_cost_function_;
+
+  // A map that caches the recompute cost of each instruction.
+  absl::flat_hash_map<const HloInstruction*, double> recompute_cost_;
+
   // All buffers in the computation.
   std::vector<Buffer> buffers_;
 };
@@ -641,12 +670,14 @@ MemoryUsageTracker::MemoryUsageTracker(
     const HloRematerialization::CompactShapeFunction& compact_shape_function,
     const TuplePointsToAnalysis& points_to_analysis,
     const InstructionList& instruction_list,
-    HloRematerialization::RematerializationMode mode)
+    HloRematerialization::RematerializationMode mode,
+    const HloRematerialization::RecomputeCostFunction& recompute_cost_function)
     : computation_(computation),
       instruction_list_(instruction_list),
       size_function_(size_function),
       compact_shape_function_(compact_shape_function),
-      mode_(mode) {
+      mode_(mode),
+      recompute_cost_function_(recompute_cost_function) {
   PointsToSet::BufferSet live_out_set =
       points_to_analysis.GetPointsToSet(computation_->root_instruction())
           .CreateFlattenedSet();
@@ -1180,7 +1211,7 @@ MemoryUsageTracker::PickRematerializationCandidates(
     absl::flat_hash_map<const HloInstruction*, bool>* rematerializable_map,
     int min_block_size, int max_block_size) {
   std::vector<Item*> best_items;
-  int64 best_cost = 0;
+  double best_cost = 0;
   RematStrategy best_strategy;
 
   VLOG(5) << "Picking candidate block with size in [" << min_block_size << ", "
@@ -1268,7 +1299,7 @@ MemoryUsageTracker::PickRematerializationCandidates(
       const int64 memory_reduced = MemoryReducedIfRematerialized(block);
 
       if (memory_reduced > 0) {
-        const int cost =
+        const double cost =
             RematerializationCost(block, memory_reduced, memory_limit_bytes);
 
         VLOG(5) << "Candidate block of size " << block.size()
@@ -1532,7 +1563,8 @@ StatusOr<int64> HloRematerialization::ComputePeakMemory(
   InstructionList instruction_list(order);
   MemoryUsageTracker tracker(computation, size_function_,
                              compact_shape_function_, *points_to_analysis_,
-                             instruction_list, mode_);
+                             instruction_list, mode_,
+                             recompute_cost_function_);
   int64 peak_memory = tracker.memory_usage();
   for (auto* item = instruction_list.first(); item != nullptr;
        item = instruction_list.next(item)) {
@@ -1576,7 +1608,7 @@ StatusOr<bool> HloRematerialization::RematerializeComputation(
   InstructionList instruction_list(schedule->sequence(computation));
   MemoryUsageTracker memory_tracker(
       computation, size_function_, compact_shape_function_,
-      *points_to_analysis_, instruction_list, mode_);
+      *points_to_analysis_, instruction_list, mode_, recompute_cost_function_);
   bool changed = false;
 
   // If the rematerialization makes the source instruction dead, then the
@@ -1742,6 +1774,9 @@ StatusOr<bool> HloRematerialization::Run(HloModule* module) {
   net_instructions_added_ = 0;
 
   TF_RET_CHECK(module->has_schedule());
+  TF_RET_CHECK(recompute_cost_function_ == nullptr ||
+               mode_ == RematerializationMode::kRecomputeOnly)
+      << "A recompute cost function is only supported in recompute-only mode";
   TF_ASSIGN_OR_RETURN(points_to_analysis_, TuplePointsToAnalysis::Run(module));
 
   // Adjust memory limit to account for the output of the entry
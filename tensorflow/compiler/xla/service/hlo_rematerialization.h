@@ -42,6 +42,10 @@ class HloRematerialization : public HloModulePass {
 
   using CompactShapeFunction = std::function<StatusOr<Shape>(const Shape&)>;
 
+  // Returns the estimated cost of recomputing the given instruction, in units
+  // which are consistent across instructions (e.g. seconds).
+  using RecomputeCostFunction = std::function<double(HloInstruction*)>;
+
   // Helper struct that communicates the before / after sizes for the
   // rematerialization process.
   struct RematerializationSizes {
@@ -80,12 +84,18 @@ class HloRematerialization : public HloModulePass {
   //
   //   compact_shape_function: Function which returns the compact form of a
   //   shape. If nullptr is provided, an default identity function is used.
+  //
+  //   recompute_cost_function: Function which estimates the cost of
+  //     recomputing an instruction. If provided, candidates are ranked by
+  //     recompute cost per byte of memory saved, rather than by memory saved
+  //     alone. Only supported in kRecomputeOnly mode.
   explicit HloRematerialization(
       const ShapeSizeFunction& size_function, int64 memory_limit_bytes,
       RematerializationSizes* sizes, RematerializationPass pass_location,
       int block_size_limit,
       CompactShapeFunction compact_shape_function = nullptr,
-      RematerializationMode mode = RematerializationMode::kRecomputeAndCompress)
+      RematerializationMode mode = RematerializationMode::kRecomputeAndCompress,
+      RecomputeCostFunction recompute_cost_function = nullptr)
       : size_function_(size_function),
         memory_limit_bytes_(memory_limit_bytes),
         sizes_(sizes),
@@ -94,7 +104,8 @@ class HloRematerialization : public HloModulePass {
         compact_shape_function_(compact_shape_function == nullptr
                                     ? DefaultCompactShapeFunction
                                     : std::move(compact_shape_function)),
-        mode_(mode) {}
+        mode_(mode),
+        recompute_cost_function_(std::move(recompute_cost_function)) {}
   ~HloRematerialization() override = default;
 
   absl::string_view name() const override { return "rematerialization"; }
@@ -185,6 +196,9 @@ class HloRematerialization : public HloModulePass {
   int max_rematerialized_block_size_ = 0;
 
   RematerializationMode mode_;
+
+  // Estimates the cost of recomputing an instruction. May be nullptr.
+  const RecomputeCostFunction recompute_cost_function_;
 };
 
 }  // namespace xla
@@ -40,8 +40,10 @@ using ::testing::_;
 // RematerializationTestBase for more.
 class HloRematerializationTest : public RematerializationTestBase {
  protected:
-  StatusOr<bool> RunHloRematerialization(int64 memory_limit_bytes,
-                                         HloModule* module) {
+  StatusOr<bool> RunHloRematerialization(
+      int64 memory_limit_bytes, HloModule* module,
+      HloRematerialization::RecomputeCostFunction recompute_cost_function =
+          nullptr) {
     TF_EXPECT_OK(verifier().Run(module).status());
     HloMemoryScheduler scheduler(
         [](const BufferValue& buffer) { return ByteSizeOf(buffer.shape()); },
@@ -51,7 +53,12 @@ class HloRematerializationTest : public RematerializationTestBase {
         ByteSizeOf, memory_limit_bytes,
         /*sizes=*/nullptr,
         HloRematerialization::RematerializationPass::kPreFusion,
-        /*block_size_limit=*/1);
+        /*block_size_limit=*/1, /*compact_shape_function=*/nullptr,
+        recompute_cost_function == nullptr
+            ? HloRematerialization::RematerializationMode::
+                  kRecomputeAndCompress
+            : HloRematerialization::RematerializationMode::kRecomputeOnly,
+        std::move(recompute_cost_function));
     return remat.Run(module);
   }
 };
@@ -444,6 +451,82 @@ TEST_F(HloRematerializationTest, CopyNotRematerialized) {
   EXPECT_EQ(count_copies(entry_computation), 1);
 }
 
+// Module in which rematerializing either of the broadcasts 'a' and 'b' saves
+// the same amount of memory.
+const char* const kTwoEquivalentCandidatesHlo = R"(
+HloModule TwoEquivalentCandidates
+
+add {
+  lhs = f32[] parameter(0)
+  rhs = f32[] parameter(1)
+  ROOT add = f32[] add(lhs, rhs)
+}
+
+ENTRY entry {
+  p = f32[] parameter(0)
+  a = f32[4096] broadcast(p), dimensions={}
+  b = f32[4096] broadcast(p), dimensions={}
+  ab = f32[4096] add(a, b)
+  big = f32[8,4096] broadcast(ab), dimensions={1}
+  zero = f32[] constant(0)
+  r = f32[4096] reduce(big, zero), dimensions={0}, to_apply=add
+  ra = f32[4096] add(r, a)
+  ROOT rab = f32[4096] add(ra, b)
+}
+)";
+
+TEST_F(HloRematerializationTest, RecomputeCostPicksCheapestCandidate) {
+  // 'a', 'b' and 'ab' (16KB each) are live alongside 'big' (128KB), and
+  // rematerializing one of 'a' and 'b' is enough to fit the limit. The
+  // output (16KB) is allocated by the caller, so is added to the limit.
+  const int64 kMemoryLimitBytes = (168 + 16) * 1024;
+  for (const char* cheap : {"a", "b"}) {
+    TF_ASSERT_OK_AND_ASSIGN(
+        auto module, ParseAndReturnVerifiedModule(kTwoEquivalentCandidatesHlo));
+    HloComputation* computation = module->entry_computation();
+    const HloInstruction* a = computation->GetInstructionWithName("a");
+    const HloInstruction* b = computation->GetInstructionWithName("b");
+    const std::string cheap_name = cheap;
+    auto recompute_cost = [&cheap_name](HloInstruction* instruction) {
+      return instruction->name() == cheap_name ? 1.0 : 100.0;
+    };
+
+    TF_ASSERT_OK_AND_ASSIGN(bool changed,
+                            RunHloRematerialization(kMemoryLimitBytes,
+                                                    module.get(),
+                                                    recompute_cost));
+    EXPECT_TRUE(changed);
+
+    const HloInstruction* rab = computation->root_instruction();
+    const HloInstruction* ra = rab->operand(0);
+    if (cheap_name == "a") {
+      EXPECT_THAT(ra->operand(1), op::Broadcast(::testing::Ne(nullptr)));
+      EXPECT_NE(ra->operand(1), a);
+      EXPECT_EQ(rab->operand(1), b);
+    } else {
+      EXPECT_EQ(ra->operand(1), a);
+      EXPECT_THAT(rab->operand(1), op::Broadcast(::testing::Ne(nullptr)));
+      EXPECT_NE(rab->operand(1), b);
+    }
+  }
+}
+
+TEST_F(HloRematerializationTest, RecomputeCostRequiresRecomputeOnlyMode) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto module, ParseAndReturnVerifiedModule(kTwoEquivalentCandidatesHlo));
+  HloMemoryScheduler scheduler(
+      [](const BufferValue& buffer) { return ByteSizeOf(buffer.shape()); },
+      ComputationSchedulerToModuleScheduler(DefaultMemoryScheduler));
+  TF_ASSERT_OK(scheduler.Run(module.get()).status());
+  HloRematerialization remat(
+      ByteSizeOf, /*memory_limit_bytes=*/0, /*sizes=*/nullptr,
+      HloRematerialization::RematerializationPass::kPreFusion,
+      /*block_size_limit=*/1, /*compact_shape_function=*/nullptr,
+      HloRematerialization::RematerializationMode::kRecomputeAndCompress,
+      [](HloInstruction*) { return 1.0; });
+  EXPECT_FALSE(remat.Run(module.get()).ok());
+}
+
 class IndirectUseTest : public HloRematerializationTest,
                         public ::testing::WithParamInterface<bool> {};
 
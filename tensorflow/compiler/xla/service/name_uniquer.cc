@@ -95,8 +95,11 @@ string NameUniquer::GetUniqueName(absl::string_view prefix) {
     }
   }
 
-  SequentialIdGenerator& id_generator = generated_names_[root];
-  numeric_suffix = id_generator.RegisterId(numeric_suffix);
+  {
+    tensorflow::mutex_lock lock(mu_);
+    SequentialIdGenerator& id_generator = generated_names_[root];
+    numeric_suffix = id_generator.RegisterId(numeric_suffix);
+  }
   if (numeric_suffix == 0) {
     return has_numeric_suffix ? absl::StrCat(root, separator_, 0) : root;
   }
@@ -23,6 +23,8 @@ limitations under the License.
 #include "absl/strings/string_view.h"
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 namespace xla {
 
@@ -31,6 +33,9 @@ namespace xla {
 // GetUniqueName are guaranteed to be distinct for this instance of the class.
 // Note that the names will be sanitized to match regexp
 // "[a-zA-Z_][a-zA-Z0-9_.-]*".
+//
+// GetUniqueName is thread-safe, so that passes can add instructions to
+// different computations of a module concurrently.
 class NameUniquer {
  public:
   // The separator must contain allowed characters only: "[a-zA-Z0-9_.-]".
@@ -78,7 +83,9 @@ class NameUniquer {
 
   // Map from name prefix to the generator data structure which tracks used
   // identifiers and generates new ones.
-  absl::flat_hash_map<string, SequentialIdGenerator> generated_names_;
+  tensorflow::mutex mu_;
+  absl::flat_hash_map<string, SequentialIdGenerator> generated_names_
+      TF_GUARDED_BY(mu_);
 
   TF_DISALLOW_COPY_AND_ASSIGN(NameUniquer);
 };
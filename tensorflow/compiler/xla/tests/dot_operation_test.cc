@@ -1704,5 +1704,89 @@ void DOT_ReorderContracting(int num_iters) {
 
 BENCHMARK(DOT_ReorderContracting);
 
+// Measures small square matrix multiplies.  On CPU, `use_runtime` raises the
+// threshold for emitting the dot as an inline tiled kernel to zero, so that
+// the two implementations can be compared against each other.
+void DOT_SmallMatMul(int num_iters, int size, int use_runtime) {
+  tensorflow::testing::StopTiming();
+
+  se::Platform* platform = PlatformUtil::GetDefaultPlatform().ValueOrDie();
+  auto executors = PlatformUtil::GetStreamExecutors(platform).ValueOrDie();
+  se::StreamExecutorMemoryAllocator allocator(platform, executors);
+
+  xla::LocalClientOptions client_options;
+  client_options.set_platform(platform);
+  auto client =
+      ClientLibrary::GetOrCreateLocalClient(client_options).ValueOrDie();
+
+  int device_ordinal = client->default_device_ordinal();
+
+  Array2D<float> lhs_arr(size, size);
+  Array2D<float> rhs_arr(size, size);
+  lhs_arr.FillIota(0);
+  rhs_arr.FillIota(1);
+  XlaBuilder builder("SmallMatMul");
+  auto lhs =
+      Parameter(&builder, 0, ShapeUtil::MakeShape(F32, {size, size}), "lhs");
+  auto rhs =
+      Parameter(&builder, 1, ShapeUtil::MakeShape(F32, {size, size}), "rhs");
+  Dot(lhs, rhs);
+  auto computation = builder.Build().ConsumeValueOrDie();
+
+  ScopedShapedBuffer buffer0 =
+      client
+          ->LiteralToShapedBuffer(
+              LiteralUtil::CreateR2FromArray2D<float>(lhs_arr), device_ordinal)
+          .ConsumeValueOrDie();
+  ScopedShapedBuffer buffer1 =
+      client
+          ->LiteralToShapedBuffer(
+              LiteralUtil::CreateR2FromArray2D<float>(rhs_arr), device_ordinal)
+          .ConsumeValueOrDie();
+
+  ExecutableBuildOptions build_options;
+  if (use_runtime) {
+    (*build_options.mutable_debug_options()
+          ->mutable_xla_backend_extra_options())["xla_llvm_ir_gemm_max_cost"] =
+        "0";
+  }
+  TF_ASSERT_OK_AND_ASSIGN(
+      auto executables,
+      client->Compile(computation,
+                      {&buffer0.on_host_shape(), &buffer1.on_host_shape()},
+                      build_options));
+  auto executable = std::move(executables[0]);
+
+  se::Stream stream(executors[device_ordinal]);
+  stream.Init();
+
+  ExecutableRunOptions options;
+  options.set_allocator(&allocator);
+
+  const std::vector<const ShapedBuffer*> arguments = {&buffer0, &buffer1};
+  const int kWarmups = 2;
+  for (int i = 0; i < kWarmups; ++i) {
+    ASSERT_IS_OK(executable->Run(arguments, options));
+  }
+
+  tensorflow::testing::ItemsProcessed(static_cast<int64>(num_iters) * size *
+                                      size * size);
+  tensorflow::testing::UseRealTime();
+  tensorflow::testing::StartTiming();
+  for (int i = 0; i < num_iters; ++i) {
+    ASSERT_IS_OK(executable->Run(arguments, options));
+  }
+}
+
+BENCHMARK(DOT_SmallMatMul)
+    ->ArgPair(8, 0)
+    ->ArgPair(8, 1)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(32, 0)
+    ->ArgPair(32, 1)
+    ->ArgPair(64, 0)
+    ->ArgPair(64, 1);
+
 }  // namespace
 }  // namespace xla
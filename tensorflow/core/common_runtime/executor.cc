@@ -67,6 +67,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/annotated_traceme.h"
 #include "tensorflow/core/profiler/lib/connected_traceme.h"
 #include "tensorflow/core/profiler/lib/scoped_annotation.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -337,6 +338,8 @@ class ExecutorState {
   const bool log_memory_;
 
   int64 step_id_;
+  // Start time of the step for profiler::TraceMe::EndStep(), or 0.
+  uint64 step_begin_time_ = 0;
   // Not owned.
   RendezvousInterface* rendezvous_;
   CollectiveExecutor* collective_executor_ = nullptr;
@@ -425,6 +428,7 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
 
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::RunAsync(Executor::DoneCallback done) {
+  step_begin_time_ = profiler::TraceMe::BeginStep();
   TaggedNodeSeq ready;
 
   // Ask the device to fill in the device context map.
@@ -1199,6 +1203,8 @@ void ExecutorState<PropagatorStateType>::Finish() {
   mu_.unlock();
   int64 step_id = step_id_;
   CHECK(done_cb != nullptr);
+  // Keeps the sampled traces of the step if it was slow.
+  profiler::TraceMe::EndStep(step_begin_time_);
   Device* device = immutable_state_.params().device;
 
   if (vlog_ && !status.ok() && VLOG_IS_ON(1)) {
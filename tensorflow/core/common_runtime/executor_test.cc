@@ -44,6 +44,8 @@ limitations under the License.
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/platform/tracing.h"
+#include "tensorflow/core/profiler/lib/profiler_session.h"
+#include "tensorflow/core/profiler/profiler_options.pb.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -432,8 +434,10 @@ TEST_F(ExecutorTest, NoInputTensors) {
 
 // Create a graph that is 'depth' deep. At each level, fan-in and fan-out a
 // maximum of 'width' nodes. All nodes are no-ops and all dependencies are
-// control dependencies.
-static void BM_executor(int iters, int width, int depth) {
+// control dependencies. If 'sampling_period' is positive, runs the graph in a
+// profiler session which samples one in 'sampling_period' host traces.
+static void RunExecutorBenchmark(int iters, int width, int depth,
+                                 int sampling_period) {
   testing::StopTiming();
 #ifdef PLATFORM_GOOGLE
   BenchmarkUseRealTime();
@@ -471,10 +475,30 @@ static void BM_executor(int iters, int width, int depth) {
   SetBenchmarkItemsProcessed(cur * static_cast<int64>(iters));
 #endif  // PLATFORM_GOOGLE
   FixupSourceAndSinkEdges(g);
+  std::unique_ptr<ProfilerSession> profiler_session;
+  if (sampling_period > 0) {
+    ProfileOptions options = ProfilerSession::DefaultOptions();
+    // Trace all ops, including cheap ones.
+    options.set_host_tracer_level(3);
+    options.set_host_tracer_sampling_period(sampling_period);
+    options.set_slow_step_threshold_us(10000);
+    profiler_session = ProfilerSession::Create(options);
+    TF_CHECK_OK(profiler_session->Status());
+  }
   testing::StartTiming();
   test::Benchmark("cpu", g).Run(iters);
 }
 
+static void BM_executor(int iters, int width, int depth) {
+  RunExecutorBenchmark(iters, width, depth, /*sampling_period=*/0);
+}
+
+// Same as BM_executor, with host traces sampled as in an always-on profiler
+// session.
+static void BM_executor_sampled_traces(int iters, int width, int depth) {
+  RunExecutorBenchmark(iters, width, depth, /*sampling_period=*/100);
+}
+
 // Tall skinny graphs
 BENCHMARK(BM_executor)->ArgPair(16, 1024);
 BENCHMARK(BM_executor)->ArgPair(32, 8192);
@@ -486,6 +510,10 @@ BENCHMARK(BM_executor)->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->ArgPair(1024, 1024);
 
+BENCHMARK(BM_executor_sampled_traces)->ArgPair(16, 1024);
+BENCHMARK(BM_executor_sampled_traces)->ArgPair(1024, 16);
+BENCHMARK(BM_executor_sampled_traces)->ArgPair(1024, 1024);
+
 static void BM_const_identity(int iters, int width, int outputs_per_const) {
 #ifdef PLATFORM_GOOGL
   BenchmarkUseRealTime();
@@ -144,6 +144,16 @@ auto* xla_compilation_time_usecs = monitoring::Counter<0>::New(
     "/tensorflow/core/xla_compilation_time_usecs",
     "The total time spent on compiling XLA graphs in microseconds.");
 
+auto* xla_compilation_cache_lookups = monitoring::Counter<1>::New(
+    "/tensorflow/core/xla_compilation_cache_lookups",
+    "The number of lookups of XLA JIT compilation caches, by whether they "
+    "found a compiled executable.",
+    "result");
+
+auto* xla_compilation_cache_evictions = monitoring::Counter<0>::New(
+    "/tensorflow/core/xla_compilation_cache_evictions",
+    "The number of executables evicted from XLA JIT compilation caches.");
+
 auto* mlir_import_failure_count = monitoring::Counter<0>::New(
     "/tensorflow/mlir/import_failure_count",
     "The number of jobs that failed during mlir import or verification.");
@@ -274,6 +284,18 @@ void UpdateXlaCompilationTime(const uint64 compilation_time_usecs) {
   }
 }
 
+void UpdateXlaCompilationCacheLookup(bool hit) {
+  static auto* hit_cell = xla_compilation_cache_lookups->GetCell("hit");
+  static auto* miss_cell = xla_compilation_cache_lookups->GetCell("miss");
+  (hit ? hit_cell : miss_cell)->IncrementBy(1);
+}
+
+void IncrementXlaCompilationCacheEvictions() {
+  static auto* xla_compilation_cache_evictions_cell =
+      xla_compilation_cache_evictions->GetCell();
+  xla_compilation_cache_evictions_cell->IncrementBy(1);
+}
+
 void IncrementMLIRImportFailureCount() {
   static auto* mlir_import_failure_count_cell =
       mlir_import_failure_count->GetCell();
@@ -120,6 +120,13 @@ void UpdateGrapplerPassTime(const string& pass_name,
 // Updates the metrics stored about time XLA spents compiling graphs.
 void UpdateXlaCompilationTime(const uint64 compilation_time_usecs);
 
+// Updates the metrics stored about lookups of the XLA JIT compilation cache,
+// which either find a compiled executable (a hit) or not (a miss).
+void UpdateXlaCompilationCacheLookup(bool hit);
+
+// Increments the number of executables evicted from XLA JIT compilation caches.
+void IncrementXlaCompilationCacheEvictions();
+
 // Increment the number of jobs that failed during import to mlir.
 void IncrementMLIRImportFailureCount();
 
@@ -105,7 +105,8 @@ typedef Eigen::SyclDevice SYCLDevice;
 // Concatenates 'inputs' into a single tensor along the zeroth dimension.
 // Requires that all elements of 'inputs' have element type T. Writes to
 // 'output' using 'context' for the allocation to ensure proper device
-// placement.
+// placement. If 'output' already holds a tensor of type T and of the
+// concatenated shape, writes into its buffer instead of allocating.
 template <typename T>
 Status Concat(OpKernelContext* context, const gtl::ArraySlice<Tensor> inputs,
               Tensor* output) {
@@ -143,8 +144,11 @@ Status Concat(OpKernelContext* context, const gtl::ArraySlice<Tensor> inputs,
 
   TensorShape output_shape(input_shape);
   output_shape.set_dim(0, output_dim0);
-  TF_RETURN_IF_ERROR(
-      context->allocate_temp(DataTypeToEnum<T>::value, output_shape, output));
+  if (!output->IsInitialized() || output->dtype() != DataTypeToEnum<T>::value ||
+      output->shape() != output_shape) {
+    TF_RETURN_IF_ERROR(
+        context->allocate_temp(DataTypeToEnum<T>::value, output_shape, output));
+  }
   if (output->NumElements() > 0) {
     auto output_flat = output->shaped<T, 2>({1, output->NumElements()});
 #if (defined(GOOGLE_CUDA) && GOOGLE_CUDA) || \
@@ -309,6 +313,34 @@ Status Split(OpKernelContext* context, const Tensor& input,
   return split_status;
 }
 
+// Splits 'input' along the zeroth dimension into tensors with zeroth-dimension
+// sizes 'sizes', which must add up to the zeroth-dimension size of 'input'.
+// If all of the splits are aligned, they are slices that share the buffer of
+// 'input', which stays alive until the last of them is released, and nothing
+// is copied. Otherwise copies, like tensor::Split().
+Status SplitIntoSlices(const Tensor& input, const gtl::ArraySlice<int64> sizes,
+                       std::vector<Tensor>* outputs) {
+  std::vector<Tensor> slices;
+  slices.reserve(sizes.size());
+  int64 position = 0;
+  for (const int64 size : sizes) {
+    if (size < 0 || position + size > input.dim_size(0)) {
+      break;
+    }
+    Tensor slice = input.Slice(position, position + size);
+    if (!slice.IsAligned()) {
+      break;
+    }
+    slices.push_back(std::move(slice));
+    position += size;
+  }
+  if (slices.size() != sizes.size() || position != input.dim_size(0)) {
+    return tensor::Split(input, sizes, outputs);
+  }
+  *outputs = std::move(slices);
+  return Status::OK();
+}
+
 // Wrapper class to allow both lock-free construction and concurrent updates on
 // a shared 'status'.
 class ThreadSafeStatus {
@@ -397,6 +429,7 @@ class BatchResource : public ResourceBase {
     }
 
     new_resource->fhandle_ = fhandle;
+    new_resource->max_pooled_batch_inputs_ = num_batch_threads;
 
     *resource = std::move(new_resource);
     return Status::OK();
@@ -533,6 +566,48 @@ class BatchResource : public ResourceBase {
     return batch_size;
   }
 
+  // Sets 'tensor' to a tensor of 'dtype' and 'shape' that the 'input_index'th
+  // inputs of a batch are concatenated into. Large batch inputs are pooled:
+  // the buffer of an earlier batch's input is handed out again once nothing
+  // else refers to it, rather than allocating (and page faulting) a fresh one
+  // for every batch.
+  Status AllocateBatchInput(OpKernelContext* context, size_t input_index,
+                            DataType dtype, const TensorShape& shape,
+                            Tensor* tensor) const {
+    const bool pooled = max_pooled_batch_inputs_ > 0 &&
+                        shape.num_elements() * DataTypeSize(dtype) >=
+                            kMinPooledBatchInputBytes;
+    if (!pooled) {
+      return context->allocate_temp(dtype, shape, tensor);
+    }
+
+    mutex_lock l(batch_input_pool_mu_);
+    if (batch_input_pool_.size() <= input_index) {
+      batch_input_pool_.resize(input_index + 1);
+    }
+    std::vector<Tensor>& pool = batch_input_pool_[input_index];
+    // Only the pool refers to a tensor whose reference count is one, and the
+    // pool only hands out references under 'batch_input_pool_mu_'.
+    Tensor* idle = nullptr;
+    for (Tensor& pooled_tensor : pool) {
+      if (!pooled_tensor.RefCountIsOne()) {
+        continue;
+      }
+      if (pooled_tensor.dtype() == dtype && pooled_tensor.shape() == shape) {
+        *tensor = pooled_tensor;
+        return Status::OK();
+      }
+      idle = &pooled_tensor;
+    }
+    TF_RETURN_IF_ERROR(context->allocate_temp(dtype, shape, tensor));
+    if (pool.size() < max_pooled_batch_inputs_) {
+      pool.push_back(*tensor);
+    } else if (idle != nullptr) {
+      *idle = *tensor;
+    }
+    return Status::OK();
+  }
+
   Status ConcatInputTensors(const Batch& batch, OpKernelContext* context,
                             std::vector<Tensor>* concatenated_tensors) const {
     if (batch.num_tasks() == 0) {
@@ -550,6 +625,14 @@ class BatchResource : public ResourceBase {
 
     // Process each input one at a time (the typical case has just one).
     for (int i = 0; i < num_inputs; ++i) {
+      const Tensor& first_input = batch.task(0).inputs.at(i);
+      // A single task without padding makes up the whole batch, so its input
+      // can be used as is.
+      if (batch.num_tasks() == 1 && padding_amount == 0) {
+        concatenated_tensors->push_back(first_input);
+        continue;
+      }
+
       // Concatenate the tasks ith input tensors into a big output tensor.
       std::vector<Tensor> to_concatenate;
       to_concatenate.reserve(batch.num_tasks());
@@ -578,7 +661,11 @@ class BatchResource : public ResourceBase {
         }
       }
 
+      TensorShape batch_shape = first_input.shape();
+      batch_shape.set_dim(0, padded_batch_size);
       Tensor concatenated_tensor;
+      TF_RETURN_IF_ERROR(AllocateBatchInput(context, i, first_input.dtype(),
+                                            batch_shape, &concatenated_tensor));
       Status concat_status =
           Concat(context, to_concatenate, &concatenated_tensor);
       TF_RETURN_IF_ERROR(concat_status);
@@ -759,8 +846,10 @@ class BatchResource : public ResourceBase {
             "the 0th dimension sizes of the input tensors");
       }
 
+      // Hand out the tasks' outputs as slices of the batched output where
+      // possible, rather than copying them.
       std::vector<Tensor> split_tensor;
-      const Status split_status = tensor::Split(
+      const Status split_status = SplitIntoSlices(
           output_tensor, task_sizes_plus_optional_padding, &split_tensor);
       DCHECK(split_status.ok()) << split_status.ToString();
       if (!split_status.ok()) {
@@ -1026,6 +1115,18 @@ class BatchResource : public ResourceBase {
 
   std::vector<int32> allowed_batch_sizes_;
   FunctionLibraryRuntime::Handle fhandle_;
+
+  // Batch inputs smaller than this are not worth pooling.
+  static constexpr int64 kMinPooledBatchInputBytes = 256 << 10;
+
+  // The maximum number of buffers AllocateBatchInput() keeps per input. At
+  // most one batch per batch thread is being processed at any time.
+  size_t max_pooled_batch_inputs_ = 0;
+
+  // Buffers for concatenated batch inputs, per input index.
+  mutable mutex batch_input_pool_mu_;
+  mutable std::vector<std::vector<Tensor>> batch_input_pool_
+      TF_GUARDED_BY(batch_input_pool_mu_);
 };
 
 class BatchFunctionKernel : public AsyncOpKernel {
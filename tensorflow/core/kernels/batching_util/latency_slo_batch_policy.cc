@@ -0,0 +1,197 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/latency_slo_batch_policy.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace serving {
+
+namespace {
+
+// The number of task latencies that must be recorded before the observed p99
+// is used to adjust the latency budget.
+constexpr int kMinLatenciesForBudgetUpdate = 16;
+
+// Bounds and step sizes for the fraction of the latency target that batches
+// are formed against.
+constexpr double kMinBudgetScale = 0.1;
+constexpr double kBudgetDecreaseFactor = 0.9;
+constexpr double kBudgetIncreaseStep = 0.01;
+
+// The budget is only grown back when the observed p99 is below this fraction
+// of the target, so that it doesn't oscillate around the target.
+constexpr double kBudgetHeadroom = 0.9;
+
+// Fits latency = intercept + slope * batch_size to the weighted sums. Returns
+// false if no batch has been recorded.
+bool FitLatency(double weight, double sum_size, double sum_size_squared,
+                double sum_latency, double sum_size_latency, double* intercept,
+                double* slope) {
+  if (weight <= 0) {
+    return false;
+  }
+  const double mean_size = sum_size / weight;
+  const double mean_latency = sum_latency / weight;
+  const double size_variance =
+      sum_size_squared / weight - mean_size * mean_size;
+  // With (almost) a single batch size observed the slope is undetermined. Use
+  // a line through the observed point that attributes half of the latency to
+  // per-batch overhead and half to per-element cost.
+  if (size_variance < 0.25) {
+    *intercept = mean_latency / 2;
+    *slope = mean_latency / (2 * std::max(mean_size, 1.0));
+    return true;
+  }
+  *slope = std::max(
+      0.0, (sum_size_latency / weight - mean_size * mean_latency) /
+               size_variance);
+  *intercept = std::max(0.0, mean_latency - *slope * mean_size);
+  return true;
+}
+
+}  // namespace
+
+LatencySloBatchPolicy::LatencySloBatchPolicy(const Options& options)
+    : options_(options) {
+  CHECK_GT(options_.latency_slo_micros, 0);
+  CHECK_GT(options_.max_batch_size, 0);
+  CHECK_GT(options_.smoothing_factor, 0);
+  CHECK_LE(options_.smoothing_factor, 1);
+  CHECK_GT(options_.latency_window_size, 0);
+  task_latencies_micros_.reserve(options_.latency_window_size);
+}
+
+void LatencySloBatchPolicy::RecordArrival(int size, uint64 now_micros) {
+  if (size <= 0) {
+    return;
+  }
+  if (has_last_arrival_) {
+    const double gap =
+        now_micros > last_arrival_micros_
+            ? static_cast<double>(now_micros - last_arrival_micros_) / size
+            : 0.0;
+    if (arrival_gap_micros_ < 0) {
+      arrival_gap_micros_ = gap;
+    } else {
+      arrival_gap_micros_ += options_.smoothing_factor *
+                             (gap - arrival_gap_micros_);
+    }
+  }
+  has_last_arrival_ = true;
+  last_arrival_micros_ = std::max(last_arrival_micros_, now_micros);
+}
+
+void LatencySloBatchPolicy::RecordBatch(int batch_size,
+                                        int64 processing_micros,
+                                        int64 task_latency_micros) {
+  const double decay = 1 - options_.smoothing_factor;
+  const double alpha = options_.smoothing_factor;
+  const double size = batch_size;
+  const double latency = processing_micros;
+  weight_ = decay * weight_ + alpha;
+  sum_size_ = decay * sum_size_ + alpha * size;
+  sum_size_squared_ = decay * sum_size_squared_ + alpha * size * size;
+  sum_latency_ = decay * sum_latency_ + alpha * latency;
+  sum_size_latency_ = decay * sum_size_latency_ + alpha * size * latency;
+
+  if (task_latencies_micros_.size() < options_.latency_window_size) {
+    task_latencies_micros_.push_back(task_latency_micros);
+  } else {
+    task_latencies_micros_[next_task_latency_] = task_latency_micros;
+    next_task_latency_ =
+        (next_task_latency_ + 1) % options_.latency_window_size;
+  }
+  UpdateBudgetScale(task_latency_micros);
+}
+
+bool LatencySloBatchPolicy::ShouldCloseBatch(int batch_size,
+                                             uint64 oldest_task_micros,
+                                             uint64 now_micros) const {
+  if (batch_size <= 0) {
+    return false;
+  }
+  if (batch_size >= options_.max_batch_size) {
+    return true;
+  }
+  double intercept, slope;
+  if (!FitLatency(weight_, sum_size_, sum_size_squared_, sum_latency_,
+                  sum_size_latency_, &intercept, &slope)) {
+    return true;
+  }
+  const double waited_micros =
+      now_micros > oldest_task_micros ? now_micros - oldest_task_micros : 0;
+  const double remaining_micros = LatencyBudgetMicros() - waited_micros -
+                                  (intercept + slope * batch_size);
+  if (remaining_micros <= 0) {
+    return true;
+  }
+  if (arrival_gap_micros_ < 0) {
+    // The arrival rate is unknown; wait until the budget runs out.
+    return false;
+  }
+  // Each additional unit of batch size costs 'arrival_gap_micros_' of waiting
+  // plus 'slope' of processing. Close the batch if not even one more unit fits
+  // in the remaining budget.
+  return remaining_micros < arrival_gap_micros_ + slope;
+}
+
+int64 LatencySloBatchPolicy::EstimatedProcessingMicros(int batch_size) const {
+  double intercept, slope;
+  if (!FitLatency(weight_, sum_size_, sum_size_squared_, sum_latency_,
+                  sum_size_latency_, &intercept, &slope)) {
+    return -1;
+  }
+  return std::llround(intercept + slope * batch_size);
+}
+
+int64 LatencySloBatchPolicy::ObservedP99LatencyMicros() const {
+  if (task_latencies_micros_.empty()) {
+    return 0;
+  }
+  std::vector<int64> latencies = task_latencies_micros_;
+  const size_t index = static_cast<size_t>(
+      std::ceil(0.99 * latencies.size())) - 1;
+  std::nth_element(latencies.begin(), latencies.begin() + index,
+                   latencies.end());
+  return latencies[index];
+}
+
+int64 LatencySloBatchPolicy::LatencyBudgetMicros() const {
+  return static_cast<int64>(budget_scale_ * options_.latency_slo_micros);
+}
+
+void LatencySloBatchPolicy::UpdateBudgetScale(int64 task_latency_micros) {
+  if (task_latencies_micros_.size() < kMinLatenciesForBudgetUpdate) {
+    return;
+  }
+  const int64 p99_micros = ObservedP99LatencyMicros();
+  // Only shrink the budget while tasks keep missing the target, so that a few
+  // old outliers that are still in the window don't drive it to the minimum.
+  if (p99_micros > options_.latency_slo_micros &&
+      task_latency_micros > options_.latency_slo_micros) {
+    budget_scale_ =
+        std::max(kMinBudgetScale, budget_scale_ * kBudgetDecreaseFactor);
+  } else if (p99_micros < kBudgetHeadroom * options_.latency_slo_micros) {
+    budget_scale_ = std::min(1.0, budget_scale_ + kBudgetIncreaseStep);
+  }
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,131 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_LATENCY_SLO_BATCH_POLICY_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_LATENCY_SLO_BATCH_POLICY_H_
+
+#include <vector>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Decides when an open batch should be closed so that batches are as large as
+// possible (which maximizes throughput) while the 99th percentile latency of
+// tasks, measured from enqueue to the end of batch processing, stays under a
+// target.
+//
+// The policy learns two things online:
+//  - The processing latency as a function of batch size, modeled as
+//    latency(n) = a + b * n and fitted by exponentially weighted least squares
+//    over the processed batches.
+//  - The task arrival rate, as an exponentially weighted average of the gap
+//    between arrivals per unit of task size.
+//
+// An open batch of size n whose oldest task has waited w is closed once it can
+// no longer grow: when w + latency(n) reaches the latency budget, or when the
+// largest size s the arrival rate can fill in time, i.e. the largest s with
+// w + (s - n) * gap + latency(s) <= budget, is not larger than n.
+//
+// The latency budget starts at the target and is scaled down multiplicatively
+// whenever the observed p99 latency exceeds the target (e.g. because batches
+// queue up behind busy threads), and scaled back up additively when there is
+// headroom.
+//
+// Until the first batch has been processed there is no latency estimate, and
+// batches are closed as soon as they are non-empty.
+//
+// Not thread-safe.
+class LatencySloBatchPolicy {
+ public:
+  struct Options {
+    // The target for the 99th percentile task latency, in microseconds.
+    int64 latency_slo_micros = 0;
+
+    // The size at which a batch is always closed.
+    int max_batch_size = 1000;
+
+    // The weight of the newest observation in the exponentially weighted
+    // estimates. Must be in (0, 1].
+    double smoothing_factor = 0.1;
+
+    // The number of most recent task latencies the p99 is computed over.
+    int latency_window_size = 256;
+  };
+
+  explicit LatencySloBatchPolicy(const Options& options);
+
+  // Records that tasks of total size `size` were enqueued at `now_micros`.
+  void RecordArrival(int size, uint64 now_micros);
+
+  // Records that a batch of size `batch_size` was processed in
+  // `processing_micros`, and that the oldest task in it completed
+  // `task_latency_micros` after it was enqueued.
+  void RecordBatch(int batch_size, int64 processing_micros,
+                   int64 task_latency_micros);
+
+  // Returns true if an open batch of size `batch_size`, whose oldest task was
+  // enqueued at `oldest_task_micros`, should be closed at `now_micros`.
+  bool ShouldCloseBatch(int batch_size, uint64 oldest_task_micros,
+                        uint64 now_micros) const;
+
+  // Returns the estimated processing latency of a batch of size `batch_size`,
+  // or -1 if no batch has been processed yet.
+  int64 EstimatedProcessingMicros(int batch_size) const;
+
+  // Returns the 99th percentile of the recorded task latencies, or 0 if none
+  // have been recorded.
+  int64 ObservedP99LatencyMicros() const;
+
+  // Returns the latency budget batches are currently formed against.
+  int64 LatencyBudgetMicros() const;
+
+ private:
+  // Adjusts 'budget_scale_' based on the observed p99 latency and the latency
+  // of the most recent task.
+  void UpdateBudgetScale(int64 task_latency_micros);
+
+  const Options options_;
+
+  // Exponentially weighted sums for the least squares fit of processing
+  // latency against batch size. 'weight_' is the sum of the weights.
+  double weight_ = 0;
+  double sum_size_ = 0;
+  double sum_size_squared_ = 0;
+  double sum_latency_ = 0;
+  double sum_size_latency_ = 0;
+
+  // Exponentially weighted average gap between arrivals, per unit of task
+  // size. Negative until two arrivals have been recorded.
+  double arrival_gap_micros_ = -1;
+  bool has_last_arrival_ = false;
+  uint64 last_arrival_micros_ = 0;
+
+  // A ring buffer of the most recent task latencies.
+  std::vector<int64> task_latencies_micros_;
+  int next_task_latency_ = 0;
+
+  // The fraction of the latency target batches are formed against.
+  double budget_scale_ = 1.0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(LatencySloBatchPolicy);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_LATENCY_SLO_BATCH_POLICY_H_
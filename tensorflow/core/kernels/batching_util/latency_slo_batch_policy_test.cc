@@ -0,0 +1,137 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/latency_slo_batch_policy.h"
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+LatencySloBatchPolicy::Options DefaultOptions() {
+  LatencySloBatchPolicy::Options options;
+  options.latency_slo_micros = 1000;
+  options.max_batch_size = 10;
+  return options;
+}
+
+// Teaches 'policy' that processing a batch of size n takes 100 + 50 * n
+// microseconds.
+void LearnLatencyCurve(LatencySloBatchPolicy* policy) {
+  for (int i = 0; i < 20; ++i) {
+    policy->RecordBatch(1, 150, 150);
+    policy->RecordBatch(9, 550, 550);
+  }
+}
+
+TEST(LatencySloBatchPolicyTest, ClosesBatchesWithoutLatencyEstimate) {
+  LatencySloBatchPolicy policy(DefaultOptions());
+  EXPECT_EQ(-1, policy.EstimatedProcessingMicros(1));
+  EXPECT_FALSE(policy.ShouldCloseBatch(0, 0, 0));
+  EXPECT_TRUE(policy.ShouldCloseBatch(1, 0, 0));
+}
+
+TEST(LatencySloBatchPolicyTest, ClosesFullBatches) {
+  LatencySloBatchPolicy policy(DefaultOptions());
+  LearnLatencyCurve(&policy);
+  EXPECT_TRUE(policy.ShouldCloseBatch(10, 0, 0));
+}
+
+TEST(LatencySloBatchPolicyTest, LearnsLatencyCurve) {
+  LatencySloBatchPolicy policy(DefaultOptions());
+  LearnLatencyCurve(&policy);
+  EXPECT_NEAR(150, policy.EstimatedProcessingMicros(1), 1);
+  EXPECT_NEAR(350, policy.EstimatedProcessingMicros(5), 1);
+  EXPECT_NEAR(600, policy.EstimatedProcessingMicros(10), 1);
+}
+
+TEST(LatencySloBatchPolicyTest, ExtrapolatesFromSingleBatchSize) {
+  LatencySloBatchPolicy policy(DefaultOptions());
+  policy.RecordBatch(4, 400, 400);
+  EXPECT_EQ(400, policy.EstimatedProcessingMicros(4));
+  EXPECT_EQ(600, policy.EstimatedProcessingMicros(8));
+}
+
+TEST(LatencySloBatchPolicyTest, WaitsUntilBudgetIsExhausted) {
+  LatencySloBatchPolicy policy(DefaultOptions());
+  LearnLatencyCurve(&policy);
+  // One task every 10 microseconds.
+  policy.RecordArrival(1, 0);
+  policy.RecordArrival(1, 10);
+
+  // A batch of 2 takes 200 microseconds, and each further task costs 10
+  // microseconds of waiting and 50 of processing.
+  EXPECT_FALSE(policy.ShouldCloseBatch(2, 0, 10));
+  EXPECT_FALSE(policy.ShouldCloseBatch(2, 0, 739));
+  EXPECT_TRUE(policy.ShouldCloseBatch(2, 0, 741));
+  EXPECT_TRUE(policy.ShouldCloseBatch(2, 0, 800));
+}
+
+TEST(LatencySloBatchPolicyTest, ClosesEarlyWhenBatchCannotGrow) {
+  LatencySloBatchPolicy policy(DefaultOptions());
+  LearnLatencyCurve(&policy);
+  // One task every 500 microseconds.
+  policy.RecordArrival(1, 0);
+  policy.RecordArrival(1, 500);
+
+  // A batch of 1 takes 150 microseconds, so it could wait for 850. But the
+  // next task would only arrive after another 500, and cost 50 to process.
+  EXPECT_FALSE(policy.ShouldCloseBatch(1, 500, 799));
+  EXPECT_TRUE(policy.ShouldCloseBatch(1, 500, 801));
+}
+
+TEST(LatencySloBatchPolicyTest, ObservedP99Latency) {
+  LatencySloBatchPolicy::Options options = DefaultOptions();
+  options.latency_window_size = 100;
+  LatencySloBatchPolicy policy(options);
+  EXPECT_EQ(0, policy.ObservedP99LatencyMicros());
+  for (int i = 1; i <= 200; ++i) {
+    policy.RecordBatch(1, 10, i);
+  }
+  // Only the latest 100 latencies, 101 to 200, are kept.
+  EXPECT_EQ(199, policy.ObservedP99LatencyMicros());
+}
+
+TEST(LatencySloBatchPolicyTest, AdaptsBudgetToObservedLatency) {
+  LatencySloBatchPolicy::Options options = DefaultOptions();
+  options.latency_window_size = 32;
+  LatencySloBatchPolicy policy(options);
+  EXPECT_EQ(1000, policy.LatencyBudgetMicros());
+
+  // Tasks miss the target, e.g. because batches queue up behind each other.
+  for (int i = 0; i < 16; ++i) {
+    policy.RecordBatch(1, 100, 2000);
+  }
+  EXPECT_EQ(900, policy.LatencyBudgetMicros());
+  policy.RecordBatch(1, 100, 2000);
+  EXPECT_EQ(810, policy.LatencyBudgetMicros());
+
+  // While the misses are still in the window, the budget stays put.
+  for (int i = 0; i < 31; ++i) {
+    policy.RecordBatch(1, 100, 100);
+  }
+  EXPECT_EQ(810, policy.LatencyBudgetMicros());
+
+  // Once they are gone, it grows back to the target.
+  for (int i = 0; i < 100; ++i) {
+    policy.RecordBatch(1, 100, 100);
+  }
+  EXPECT_EQ(1000, policy.LatencyBudgetMicros());
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -18,15 +18,18 @@ limitations under the License.
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <deque>
 #include <functional>
 #include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
+#include "tensorflow/core/kernels/batching_util/latency_slo_batch_policy.h"
 #include "tensorflow/core/kernels/batching_util/periodic_function.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -74,10 +77,22 @@ namespace serving {
 // dynamically, to accommodate e.g. versions of a model being brought up and
 // down over the lifetime of a server.
 //
-// The batch thread pool round-robins through the queues, running one batch
-// from a queue and then moving to the next queue. Each queue behaves like a
-// BasicBatchScheduler instance, in the sense that it has maximum batch size and
-// timeout parameters, which govern when a batch is eligible to be processed.
+// Each queue behaves like a BasicBatchScheduler instance, in the sense that it
+// has maximum batch size and timeout parameters, which govern when a batch is
+// eligible to be processed. When a batch thread becomes available, it takes a
+// batch from the queue selected as follows:
+//  - Queues with a higher 'priority' always go first, as long as they have an
+//    eligible batch.
+//  - Among queues of the same priority, the batch threads are shared by
+//    weighted fair queuing: over time, each backlogged queue gets to process a
+//    number of tasks proportional to its 'weight'. If no queue sets a 'weight'
+//    or 'priority', every batch counts the same regardless of its size, so
+//    this is plain round-robin: running one batch from a queue and then
+//    moving to the next queue.
+//  - Queues marked 'low_priority' are only served while all other queues are
+//    empty, i.e. don't even have tasks waiting for a batch to fill up. They
+//    soak up spare capacity without taking a thread from a latency-critical
+//    batch that is about to become eligible.
 //
 // Each queue is independently configured with a maximum size (in terms of the
 // maximum number of batches worth of enqueued tasks). For online serving, it is
@@ -95,10 +110,6 @@ namespace serving {
 // For bulk processing jobs and throughput-oriented benchmarks, you may want to
 // set the maximum queue size to a large value.
 //
-// TODO(b/26539183): Support queue servicing policies other than round-robin.
-// E.g. let each queue specify a "share" (an int >= 1), so e.g. with queues A
-// and B having shares 1 and 2 respectively, the servicing pattern is ABBABB...
-//
 //
 // PERFORMANCE TUNING: See README.md.
 //
@@ -193,6 +204,34 @@ class SharedBatchScheduler
     // submit batches whose size is in a small set of allowed sizes, that can be
     // done by adding padding in the process-batch callback.
     size_t max_execution_batch_size = 1000;
+
+    // If positive, the open batch is closed according to a latency target
+    // instead of 'batch_timeout_micros', which is then ignored: the queue
+    // learns how long batches of each size take to process, and the rate at
+    // which tasks arrive, and keeps growing the open batch for as long as the
+    // 99th percentile latency of its tasks, from Schedule() until the
+    // process-batch callback returns, is expected to stay under this target.
+    // See LatencySloBatchPolicy for details.
+    //
+    // This trades latency that would otherwise be spent idle for larger, more
+    // efficient batches at moderate load, and closes batches early when
+    // waiting would not let them grow.
+    int64 latency_slo_micros = 0;
+
+    // The priority class of the queue. Whenever a queue with a higher
+    // priority has a batch that is eligible to be processed, it is processed
+    // before any batch from a queue with a lower priority.
+    int priority = 0;
+
+    // The share of the batch threads this queue gets relative to other queues
+    // with the same priority, in terms of tasks processed, when they are all
+    // backlogged. E.g. with queues A and B having weights 1 and 2 and equally
+    // sized batches, the servicing pattern is ABBABB... Must be positive.
+    int weight = 1;
+
+    // If true, batches from this queue are only processed while no other queue
+    // has enqueued tasks, regardless of 'priority'.
+    bool low_priority = false;
   };
   Status AddQueue(const QueueOptions& options,
                   std::function<void(std::unique_ptr<Batch<TaskType>>)>
@@ -217,15 +256,50 @@ class SharedBatchScheduler
   // efficient removal of elements from the middle.)
   using QueueList = std::list<std::unique_ptr<internal::Queue<TaskType>>>;
 
+  // Returns iterators to all of 'queues_', in the order in which they should
+  // be asked for a batch to process: by decreasing priority, and within a
+  // priority class by increasing virtual start time, with ties broken
+  // round-robin starting at 'next_queue_to_schedule_'. Queues marked
+  // 'low_priority' come last.
+  std::vector<typename QueueList::iterator> QueuesInServiceOrder()
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns true if any queue not marked 'low_priority' has enqueued tasks.
+  bool RegularQueuesHaveTasks() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the virtual time at which 'queue' starts its next batch under
+  // weighted fair queuing: the later of the time its last batch finished and
+  // the current virtual time of its priority class, so that a queue that was
+  // idle doesn't get to make up for the service it missed.
+  double VirtualStartTime(const internal::Queue<TaskType>* queue) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns true if any queue has a non-default 'weight' or 'priority', in
+  // which case queues are charged for the tasks they process rather than for
+  // the batches.
+  bool QueuesHaveWeightsOrPriorities() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Accounts for 'queue' having been given a batch of size 'batch_size'.
+  void ChargeQueue(const internal::Queue<TaskType>* queue, size_t batch_size)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // All "active" queues, i.e. ones that either:
   //  - have not been removed, or
   //  - have been removed but are not yet empty.
   QueueList queues_ TF_GUARDED_BY(mu_);
 
-  // An iterator over 'queues_', pointing to the queue from which the next
-  // available batch thread should grab work.
+  // An iterator over 'queues_', pointing to the queue that the next available
+  // batch thread should prefer among queues that are otherwise equally
+  // entitled to run a batch.
   typename QueueList::iterator next_queue_to_schedule_ TF_GUARDED_BY(mu_);
 
+  // Weighted fair queuing state: the virtual time at which each queue's last
+  // batch finished, and the virtual time of each priority class, i.e. the
+  // virtual start time of the last batch taken from it.
+  std::unordered_map<const internal::Queue<TaskType>*, double>
+      queue_virtual_finish_times_ TF_GUARDED_BY(mu_);
+  std::unordered_map<int, double> priority_virtual_times_ TF_GUARDED_BY(mu_);
+
   // Used by idle batch threads to wait for work to enter the system. Notified
   // whenever a batch becomes schedulable.
   condition_variable schedulable_batch_cv_;
@@ -297,6 +371,11 @@ class Queue {
   // Returns the maximum allowed size of tasks submitted to the queue.
   size_t max_task_size() const { return options_.input_batch_size_limit; }
 
+  // Return the scheduling parameters of the queue; see QueueOptions.
+  int priority() const { return options_.priority; }
+  int weight() const { return options_.weight; }
+  bool low_priority() const { return options_.low_priority; }
+
   // Returns the maximum allowed size of tasks to be enqueued.
   // Returned value would be less than or equal to the maximum allowed input
   // size that's provided by caller of batch scheduler.
@@ -344,6 +423,10 @@ class Queue {
   // currently schedulable.
   bool IsOpenBatchSchedulable() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Informs 'slo_policy_', if any, of newly enqueued tasks of total size
+  // 'size'.
+  void RecordArrival(size_t size) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   const typename SharedBatchScheduler<TaskType>::QueueOptions options_;
 
   // The environment to use.
@@ -374,6 +457,18 @@ class Queue {
   // in 'batches_'. Valid iff that batch contains at least one task.
   uint64 open_batch_start_time_micros_ TF_GUARDED_BY(mu_);
 
+  // Decides when to close the open batch if 'options_.latency_slo_micros' is
+  // positive; null otherwise.
+  std::unique_ptr<LatencySloBatchPolicy> slo_policy_ TF_GUARDED_BY(mu_);
+
+  // If 'slo_policy_' is set, the times at which the first task was added to
+  // each of the closed batches in 'batches_', front to back, and to each batch
+  // being processed, keyed by the batch's TraceMe context id. Used to measure
+  // the latency of the oldest task in each batch.
+  std::deque<uint64> closed_batch_start_times_micros_ TF_GUARDED_BY(mu_);
+  std::unordered_map<uint64, uint64> processing_batch_start_times_micros_
+      TF_GUARDED_BY(mu_);
+
   // Whether this queue contains a batch that is eligible to be scheduled.
   // Used to keep track of when to call 'schedulable_batch_callback_'.
   bool schedulable_batch_ TF_GUARDED_BY(mu_) = false;
@@ -472,6 +567,10 @@ Status SharedBatchScheduler<TaskType>::AddQueue(
         "max_enqueued_batches must be non-negative; was ",
         options.max_enqueued_batches);
   }
+  if (options.weight <= 0) {
+    return errors::InvalidArgument("weight must be positive; was ",
+                                   options.weight);
+  }
 
   if (options.enable_large_batch_splitting &&
       options.split_input_task_func == nullptr) {
@@ -537,38 +636,42 @@ void SharedBatchScheduler<TaskType>::ThreadLogic() {
   {
     mutex_lock l(mu_);
 
-    const int num_queues = queues_.size();
-    for (int num_queues_tried = 0;
-         batch_to_process == nullptr && num_queues_tried < num_queues;
-         ++num_queues_tried) {
-      DCHECK(next_queue_to_schedule_ != queues_.end());
+    // Low-priority queues are only served while the others are empty.
+    const bool defer_low_priority_queues = RegularQueuesHaveTasks();
+    for (const typename QueueList::iterator queue_it : QueuesInServiceOrder()) {
+      internal::Queue<TaskType>* queue = queue_it->get();
 
       // If a closed queue responds to ScheduleBatch() with nullptr, the queue
       // will never yield any further batches so we can drop it. To avoid a
       // race, we take a snapshot of the queue's closedness state *before*
       // calling ScheduleBatch().
-      const bool queue_closed = (*next_queue_to_schedule_)->closed();
+      const bool queue_closed = queue->closed();
 
-      // Ask '*next_queue_to_schedule_' if it wants us to process a batch.
-      batch_to_process = (*next_queue_to_schedule_)->ScheduleBatch();
+      // Ask 'queue' if it wants us to process a batch.
+      if (!(queue->low_priority() && defer_low_priority_queues)) {
+        batch_to_process = queue->ScheduleBatch();
+      }
       if (batch_to_process != nullptr) {
-        queue_for_batch = next_queue_to_schedule_->get();
+        queue_for_batch = queue;
+        ChargeQueue(queue, batch_to_process->size());
+        // Break ties between queues round-robin, starting after this one.
+        next_queue_to_schedule_ = std::next(queue_it);
+        break;
       }
 
-      // Advance 'next_queue_to_schedule_'.
-      if (queue_closed && (*next_queue_to_schedule_)->IsEmpty() &&
-          batch_to_process == nullptr) {
+      if (queue_closed && queue->IsEmpty()) {
         // We've encountered a closed queue with no work to do. Drop it.
-        DCHECK_NE(queue_for_batch, next_queue_to_schedule_->get());
-        next_queue_to_schedule_ = queues_.erase(next_queue_to_schedule_);
-      } else {
-        ++next_queue_to_schedule_;
-      }
-      if (next_queue_to_schedule_ == queues_.end() && !queues_.empty()) {
-        // We've hit the end. Wrap to the first queue.
-        next_queue_to_schedule_ = queues_.begin();
+        queue_virtual_finish_times_.erase(queue);
+        if (next_queue_to_schedule_ == queue_it) {
+          ++next_queue_to_schedule_;
+        }
+        queues_.erase(queue_it);
       }
     }
+    if (next_queue_to_schedule_ == queues_.end()) {
+      // We've hit the end. Wrap to the first queue.
+      next_queue_to_schedule_ = queues_.begin();
+    }
 
     if (batch_to_process == nullptr) {
       // We couldn't find any work to do. Wait until a new batch becomes
@@ -582,6 +685,95 @@ void SharedBatchScheduler<TaskType>::ThreadLogic() {
   queue_for_batch->ProcessBatch(std::move(batch_to_process));
 }
 
+template <typename TaskType>
+std::vector<typename SharedBatchScheduler<TaskType>::QueueList::iterator>
+SharedBatchScheduler<TaskType>::QueuesInServiceOrder() {
+  struct Candidate {
+    typename QueueList::iterator queue_it;
+    bool low_priority;
+    int priority;
+    double virtual_start_time;
+  };
+  std::vector<Candidate> candidates;
+  candidates.reserve(queues_.size());
+  auto queue_it = next_queue_to_schedule_;
+  for (size_t i = 0; i < queues_.size(); ++i, ++queue_it) {
+    if (queue_it == queues_.end()) {
+      queue_it = queues_.begin();
+    }
+    const internal::Queue<TaskType>* queue = queue_it->get();
+    candidates.push_back({queue_it, queue->low_priority(), queue->priority(),
+                          VirtualStartTime(queue)});
+  }
+  // The candidates are in round-robin order, which a stable sort preserves
+  // among equals.
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     if (a.low_priority != b.low_priority) {
+                       return b.low_priority;
+                     }
+                     if (a.priority != b.priority) {
+                       return a.priority > b.priority;
+                     }
+                     return a.virtual_start_time < b.virtual_start_time;
+                   });
+  std::vector<typename QueueList::iterator> order;
+  order.reserve(candidates.size());
+  for (const Candidate& candidate : candidates) {
+    order.push_back(candidate.queue_it);
+  }
+  return order;
+}
+
+template <typename TaskType>
+bool SharedBatchScheduler<TaskType>::RegularQueuesHaveTasks() const {
+  for (const auto& queue : queues_) {
+    if (!queue->low_priority() && queue->NumEnqueuedTasks() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename TaskType>
+double SharedBatchScheduler<TaskType>::VirtualStartTime(
+    const internal::Queue<TaskType>* queue) const {
+  double virtual_start_time = 0;
+  auto finish_it = queue_virtual_finish_times_.find(queue);
+  if (finish_it != queue_virtual_finish_times_.end()) {
+    virtual_start_time = finish_it->second;
+  }
+  auto priority_it = priority_virtual_times_.find(queue->priority());
+  if (priority_it != priority_virtual_times_.end()) {
+    virtual_start_time = std::max(virtual_start_time, priority_it->second);
+  }
+  return virtual_start_time;
+}
+
+template <typename TaskType>
+bool SharedBatchScheduler<TaskType>::QueuesHaveWeightsOrPriorities() const {
+  const QueueOptions default_options;
+  for (const auto& queue : queues_) {
+    if (queue->weight() != default_options.weight ||
+        queue->priority() != default_options.priority) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename TaskType>
+void SharedBatchScheduler<TaskType>::ChargeQueue(
+    const internal::Queue<TaskType>* queue, size_t batch_size) {
+  const size_t cost = QueuesHaveWeightsOrPriorities()
+                          ? std::max<size_t>(batch_size, 1)
+                          : size_t{1};
+  const double virtual_start_time = VirtualStartTime(queue);
+  priority_virtual_times_[queue->priority()] = virtual_start_time;
+  queue_virtual_finish_times_[queue] =
+      virtual_start_time + static_cast<double>(cost) / queue->weight();
+}
+
 namespace internal {
 
 template <typename TaskType>
@@ -595,6 +787,13 @@ Queue<TaskType>::Queue(
       schedulable_batch_callback_(schedulable_batch_callback) {
   // Create an initial, open batch.
   batches_.emplace_back(new Batch<TaskType>);
+
+  if (options_.latency_slo_micros > 0) {
+    LatencySloBatchPolicy::Options slo_options;
+    slo_options.latency_slo_micros = options_.latency_slo_micros;
+    slo_options.max_batch_size = max_execution_batch_size();
+    slo_policy_.reset(new LatencySloBatchPolicy(slo_options));
+  }
 }
 
 template <typename TaskType>
@@ -644,7 +843,9 @@ Status Queue<TaskType>::ScheduleWithoutSplit(std::unique_ptr<TaskType>* task) {
         [&] { return strings::StrCat("Schedule:", (*task)->size()); },
         profiler::ContextType::kSharedBatchScheduler,
         batches_.back()->traceme_context_id());
+    const size_t task_size = (*task)->size();
     batches_.back()->AddTask(std::move(*task));
+    RecordArrival(task_size);
 
     if (!schedulable_batch_) {
       if (batches_.size() > 1 || IsOpenBatchSchedulable()) {
@@ -718,6 +919,7 @@ Status Queue<TaskType>::ScheduleWithSplit(std::unique_ptr<TaskType>* task) {
       TF_RETURN_IF_ERROR(SplitInputBatchIntoSubtasks(task, &output_tasks));
     }
 
+    RecordArrival(input_task_size);
     for (int i = 0; i < output_tasks.size(); ++i) {
       if (batches_.back()->size() + output_tasks[i]->size() >
           options_.max_execution_batch_size) {
@@ -784,6 +986,12 @@ std::unique_ptr<Batch<TaskType>> Queue<TaskType>::ScheduleBatch() {
       ++num_batches_being_processed_;
       batch_to_schedule = std::move(batches_.front());
       batches_.pop_front();
+      if (slo_policy_ != nullptr) {
+        const uint64 context_id = batch_to_schedule->traceme_context_id();
+        processing_batch_start_times_micros_[context_id] =
+            closed_batch_start_times_micros_.front();
+        closed_batch_start_times_micros_.pop_front();
+      }
     } else {
       schedulable_batch_ = false;
     }
@@ -798,10 +1006,22 @@ void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
       [&batch] { return strings::StrCat("ProcessBatch:", batch->size()); },
       profiler::ContextType::kSharedBatchScheduler,
       batch->traceme_context_id());
+  const uint64 batch_context_id = batch->traceme_context_id();
+  const int batch_size = batch->size();
+  const uint64 start_time_micros = env_->NowMicros();
   process_batch_callback_(std::move(batch));
+  const uint64 end_time_micros = env_->NowMicros();
 
   {
     mutex_lock l(mu_);
+    if (slo_policy_ != nullptr) {
+      auto it = processing_batch_start_times_micros_.find(batch_context_id);
+      DCHECK(it != processing_batch_start_times_micros_.end());
+      const uint64 oldest_task_micros = std::min(it->second, start_time_micros);
+      processing_batch_start_times_micros_.erase(it);
+      slo_policy_->RecordBatch(batch_size, end_time_micros - start_time_micros,
+                               end_time_micros - oldest_task_micros);
+    }
     --num_batches_being_processed_;
     if (empty_notification_ != nullptr && IsEmptyInternal()) {
       empty_notification_->Notify();
@@ -839,6 +1059,9 @@ bool Queue<TaskType>::IsEmptyInternal() const {
 
 template <typename TaskType>
 void Queue<TaskType>::StartNewBatch() {
+  if (slo_policy_ != nullptr) {
+    closed_batch_start_times_micros_.push_back(open_batch_start_time_micros_);
+  }
   batches_.back()->Close();
   batches_.emplace_back(new Batch<TaskType>(++traceme_context_id_counter_));
 }
@@ -860,11 +1083,24 @@ bool Queue<TaskType>::IsOpenBatchSchedulable() const {
   if (open_batch->empty()) {
     return false;
   }
+  if (slo_policy_ != nullptr) {
+    return closed_ ||
+           slo_policy_->ShouldCloseBatch(open_batch->size(),
+                                         open_batch_start_time_micros_,
+                                         env_->NowMicros());
+  }
   return closed_ || open_batch->size() >= max_execution_batch_size() ||
          env_->NowMicros() >=
              open_batch_start_time_micros_ + options_.batch_timeout_micros;
 }
 
+template <typename TaskType>
+void Queue<TaskType>::RecordArrival(size_t size) {
+  if (slo_policy_ != nullptr) {
+    slo_policy_->RecordArrival(size, env_->NowMicros());
+  }
+}
+
 template <typename TaskType>
 QueueHandle<TaskType>::QueueHandle(
     std::shared_ptr<SharedBatchScheduler<TaskType>> scheduler,
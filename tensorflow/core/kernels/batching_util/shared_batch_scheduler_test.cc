@@ -254,6 +254,67 @@ TEST(SharedBatchSchedulerTest, ObeysTimeout) {
   stop_teardown.Notify();
 }
 
+TEST(SharedBatchSchedulerTest, ObeysLatencySlo) {
+  // Set up a fake clock, which only advances when we explicitly tell it to.
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    Notification first_batch_processed, second_batch_processed;
+    auto callback = [&env, &first_batch_processed, &second_batch_processed](
+                        std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      // Every batch takes 100 microseconds to process.
+      env.AdvanceByMicroseconds(100);
+      if (!first_batch_processed.HasBeenNotified()) {
+        EXPECT_EQ(1, batch->size());
+        first_batch_processed.Notify();
+      } else {
+        EXPECT_EQ(2, batch->size());
+        second_batch_processed.Notify();
+      }
+    };
+
+    SharedBatchScheduler<FakeTask>::Options options;
+    options.num_batch_threads = 1;
+    options.env = &env;
+    std::shared_ptr<SharedBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(SharedBatchScheduler<FakeTask>::Create(options, &scheduler));
+    SharedBatchScheduler<FakeTask>::QueueOptions queue_options;
+    queue_options.input_batch_size_limit = 10;
+    // Ignored in favor of the latency target.
+    queue_options.batch_timeout_micros = 10 * 1000 * 1000;  // 10 seconds
+    queue_options.max_enqueued_batches = 2;
+    queue_options.latency_slo_micros = 1000;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, callback, &queue));
+
+    // Without a latency estimate, the first batch is processed right away.
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    first_batch_processed.WaitForNotification();
+    // Let the queue record the first batch's latency.
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+
+    // Tasks arrive every 100 microseconds, and the queue estimates that a
+    // batch of n takes 50 + 50 * n microseconds. The open batch keeps growing
+    // until another 100 microseconds of waiting and 50 of processing no
+    // longer fit in the target.
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    env.AdvanceByMicroseconds(100);
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    env.AdvanceByMicroseconds(600);
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    EXPECT_FALSE(second_batch_processed.HasBeenNotified());
+    env.AdvanceByMicroseconds(1);
+    second_batch_processed.WaitForNotification();
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
 TEST(SharedBatchSchedulerTest, ObeysTimeoutWithRealClock) {
   Notification first_batch_processed, second_batch_processed;
   auto callback = [&first_batch_processed, &second_batch_processed](
@@ -407,6 +468,218 @@ TEST(SharedBatchSchedulerTest, Fairness) {
   stop_teardown.Notify();
 }
 
+// Records the order in which batches from several queues are processed, as a
+// string with one character per batch. The first batch to be processed is not
+// recorded; it blocks the (single) batch thread until Unblock() is called, so
+// that tests can build up a backlog behind it.
+class BatchOrderRecorder {
+ public:
+  explicit BatchOrderRecorder(int num_batches_to_record)
+      : num_batches_to_record_(num_batches_to_record) {}
+
+  std::function<void(std::unique_ptr<Batch<FakeTask>>)> Callback(
+      char queue_name) {
+    return [this, queue_name](std::unique_ptr<Batch<FakeTask>> batch) {
+      if (!blocked_.HasBeenNotified()) {
+        blocked_.Notify();
+        unblock_.WaitForNotification();
+        return;
+      }
+      mutex_lock l(mu_);
+      order_ += queue_name;
+      if (order_.size() == num_batches_to_record_) {
+        all_recorded_.Notify();
+      }
+    };
+  }
+
+  void WaitUntilBlocked() { blocked_.WaitForNotification(); }
+  void Unblock() { unblock_.Notify(); }
+  void WaitUntilAllRecorded() { all_recorded_.WaitForNotification(); }
+
+  string order() {
+    mutex_lock l(mu_);
+    return order_;
+  }
+
+ private:
+  const int num_batches_to_record_;
+  Notification blocked_, unblock_, all_recorded_;
+  mutex mu_;
+  string order_ TF_GUARDED_BY(mu_);
+};
+
+TEST(SharedBatchSchedulerTest, HigherPriorityQueuesGoFirst) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    BatchOrderRecorder recorder(5);
+    SharedBatchScheduler<FakeTask>::Options options;
+    options.num_batch_threads = 1;
+    options.env = &env;
+    std::shared_ptr<SharedBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(SharedBatchScheduler<FakeTask>::Create(options, &scheduler));
+    SharedBatchScheduler<FakeTask>::QueueOptions queue_options;
+    queue_options.input_batch_size_limit = 10;
+    queue_options.batch_timeout_micros = 0;
+    queue_options.max_enqueued_batches = 100;
+    std::unique_ptr<BatchScheduler<FakeTask>> low_queue, high_queue;
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, recorder.Callback('L'),
+                                     &low_queue));
+    queue_options.priority = 1;
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, recorder.Callback('H'),
+                                     &high_queue));
+
+    TF_ASSERT_OK(ScheduleTask(10, low_queue.get()));
+    recorder.WaitUntilBlocked();
+    for (int i = 0; i < 3; ++i) {
+      TF_ASSERT_OK(ScheduleTask(10, low_queue.get()));
+    }
+    for (int i = 0; i < 2; ++i) {
+      TF_ASSERT_OK(ScheduleTask(10, high_queue.get()));
+    }
+    recorder.Unblock();
+    recorder.WaitUntilAllRecorded();
+    EXPECT_EQ("HHLLL", recorder.order());
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(SharedBatchSchedulerTest, WeightedFairQueuing) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    BatchOrderRecorder recorder(9);
+    SharedBatchScheduler<FakeTask>::Options options;
+    options.num_batch_threads = 1;
+    options.env = &env;
+    std::shared_ptr<SharedBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(SharedBatchScheduler<FakeTask>::Create(options, &scheduler));
+    SharedBatchScheduler<FakeTask>::QueueOptions queue_options;
+    queue_options.input_batch_size_limit = 10;
+    queue_options.batch_timeout_micros = 0;
+    queue_options.max_enqueued_batches = 100;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue_a, queue_b;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback('A'), &queue_a));
+    queue_options.weight = 2;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback('B'), &queue_b));
+
+    // Queue A already got a batch in, so B goes first.
+    TF_ASSERT_OK(ScheduleTask(10, queue_a.get()));
+    recorder.WaitUntilBlocked();
+    for (int i = 0; i < 3; ++i) {
+      TF_ASSERT_OK(ScheduleTask(10, queue_a.get()));
+    }
+    for (int i = 0; i < 6; ++i) {
+      TF_ASSERT_OK(ScheduleTask(10, queue_b.get()));
+    }
+    recorder.Unblock();
+    recorder.WaitUntilAllRecorded();
+    EXPECT_EQ("BBABBABBA", recorder.order());
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(SharedBatchSchedulerTest, DefaultOptionsRoundRobinRegardlessOfBatchSize) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    BatchOrderRecorder recorder(6);
+    SharedBatchScheduler<FakeTask>::Options options;
+    options.num_batch_threads = 1;
+    options.env = &env;
+    std::shared_ptr<SharedBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(SharedBatchScheduler<FakeTask>::Create(options, &scheduler));
+    SharedBatchScheduler<FakeTask>::QueueOptions queue_options;
+    queue_options.input_batch_size_limit = 10;
+    queue_options.batch_timeout_micros = 0;
+    queue_options.max_enqueued_batches = 100;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue_a, queue_b;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback('A'), &queue_a));
+    queue_options.input_batch_size_limit = 1;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback('B'), &queue_b));
+
+    // Queue A's batches are ten times larger than B's, but without weights or
+    // priorities each batch counts the same.
+    TF_ASSERT_OK(ScheduleTask(10, queue_a.get()));
+    recorder.WaitUntilBlocked();
+    for (int i = 0; i < 3; ++i) {
+      TF_ASSERT_OK(ScheduleTask(10, queue_a.get()));
+    }
+    for (int i = 0; i < 3; ++i) {
+      TF_ASSERT_OK(ScheduleTask(1, queue_b.get()));
+    }
+    recorder.Unblock();
+    recorder.WaitUntilAllRecorded();
+    EXPECT_EQ("BABABA", recorder.order());
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(SharedBatchSchedulerTest, LowPriorityQueueWaitsForOtherQueuesToEmpty) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    BatchOrderRecorder recorder(2);
+    SharedBatchScheduler<FakeTask>::Options options;
+    options.num_batch_threads = 1;
+    options.env = &env;
+    std::shared_ptr<SharedBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(SharedBatchScheduler<FakeTask>::Create(options, &scheduler));
+    SharedBatchScheduler<FakeTask>::QueueOptions queue_options;
+    queue_options.input_batch_size_limit = 10;
+    queue_options.batch_timeout_micros = 100;
+    queue_options.max_enqueued_batches = 100;
+    std::unique_ptr<BatchScheduler<FakeTask>> regular_queue, low_queue;
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, recorder.Callback('R'),
+                                     &regular_queue));
+    queue_options.batch_timeout_micros = 0;
+    queue_options.low_priority = true;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback('L'), &low_queue));
+
+    TF_ASSERT_OK(ScheduleTask(10, regular_queue.get()));
+    recorder.WaitUntilBlocked();
+
+    // The low-priority batch is eligible right away, but has to wait while
+    // the regular queue has a batch filling up.
+    TF_ASSERT_OK(ScheduleTask(1, low_queue.get()));
+    TF_ASSERT_OK(ScheduleTask(1, regular_queue.get()));
+    recorder.Unblock();
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    EXPECT_EQ("", recorder.order());
+
+    env.AdvanceByMicroseconds(100);
+    recorder.WaitUntilAllRecorded();
+    EXPECT_EQ("RL", recorder.order());
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
 TEST(SharedBatchSchedulerTest, ConstMethods) {
   for (const int max_enqueued_batches : {1, 2, 5}) {
     Notification processing, proceed;
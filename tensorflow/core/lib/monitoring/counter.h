@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/monitoring/collection_registry.h"
 #include "tensorflow/core/lib/monitoring/metric_def.h"
+#include "tensorflow/core/lib/monitoring/per_cpu.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -50,21 +51,25 @@ namespace monitoring {
 // to which both cells belong) and performance (since map indexing and
 // associated locking are both avoided).
 //
+// The value is split into per-CPU shards that are summed when read, so that
+// increments from many threads don't contend on a single cache line.
+//
 // This class is thread-safe.
 class CounterCell {
  public:
-  explicit CounterCell(int64 value) : value_(value) {}
+  explicit CounterCell(int64 value) { shards_[0].store(value); }
   ~CounterCell() {}
 
   // Atomically increments the value by step.
   // REQUIRES: Step be non-negative.
   void IncrementBy(int64 step);
 
-  // Retrieves the current value.
+  // Retrieves the current value. Increments that race with this call may or
+  // may not be included.
   int64 value() const;
 
  private:
-  std::atomic<int64> value_;
+  internal::PerCpu<std::atomic<int64>> shards_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(CounterCell);
 };
@@ -147,10 +152,16 @@ class Counter {
 
 inline void CounterCell::IncrementBy(const int64 step) {
   DCHECK_LE(0, step) << "Must not decrement cumulative metrics.";
-  value_ += step;
+  shards_.Local().fetch_add(step, std::memory_order_relaxed);
 }
 
-inline int64 CounterCell::value() const { return value_; }
+inline int64 CounterCell::value() const {
+  int64 value = 0;
+  for (int i = 0; i < shards_.size(); ++i) {
+    value += shards_[i].load(std::memory_order_relaxed);
+  }
+  return value;
+}
 
 template <int NumLabels>
 template <typename... MetricDefArgs>
@@ -15,7 +15,13 @@ limitations under the License.
 
 #include "tensorflow/core/lib/monitoring/counter.h"
 
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace monitoring {
@@ -94,6 +100,63 @@ TEST(LabeledCounterTest, SameName) {
   delete same_counter;
 }
 
+// Runs `fn` on `num_threads` threads and waits for all of them to finish.
+void RunOnThreads(int num_threads, const std::function<void()>& fn) {
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(
+        Env::Default()->StartThread(ThreadOptions(), "counter_test", fn));
+  }
+}
+
+auto* concurrent_counter =
+    Counter<0>::New("/tensorflow/test/concurrent_counter",
+                    "Counter incremented from many threads.");
+
+TEST(UnlabeledCounterTest, ConcurrentIncrements) {
+  auto* cell = concurrent_counter->GetCell();
+  RunOnThreads(8, [cell]() {
+    for (int i = 0; i < 1000; ++i) {
+      cell->IncrementBy(3);
+    }
+  });
+  EXPECT_EQ(24000, cell->value());
+}
+
+TEST(CounterCellTest, KeepsInitialValue) {
+  CounterCell cell(17);
+  EXPECT_EQ(17, cell.value());
+  cell.IncrementBy(5);
+  EXPECT_EQ(22, cell.value());
+}
+
+// Every thread increments the same cell `iters` times. With per-CPU shards the
+// time per increment should stay flat as threads are added, instead of growing
+// with the contention on a single atomic.
+void BM_CounterIncrement(int iters, int num_threads) {
+  testing::StopTiming();
+  testing::UseRealTime();
+  CounterCell cell(0);
+  testing::StartTiming();
+  RunOnThreads(num_threads, [&cell, iters]() {
+    for (int i = 0; i < iters; ++i) {
+      cell.IncrementBy(1);
+    }
+  });
+  testing::StopTiming();
+  CHECK_EQ(static_cast<int64>(iters) * num_threads, cell.value());
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_threads);
+}
+
+BENCHMARK(BM_CounterIncrement)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64);
+
 }  // namespace
 }  // namespace monitoring
 }  // namespace tensorflow
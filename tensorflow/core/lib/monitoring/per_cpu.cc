@@ -0,0 +1,70 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/monitoring/per_cpu.h"
+
+#include <atomic>
+
+#include "tensorflow/core/platform/cpu_info.h"
+
+namespace tensorflow {
+namespace monitoring {
+namespace internal {
+
+namespace {
+
+// Caps the memory of a cell on machines with many cores. Beyond this, CPUs
+// share shards, which only costs some contention.
+constexpr int kMaxCpuShards = 16;
+
+int ComputeNumCpuShards() {
+  int num_cpus = port::NumTotalCPUs();
+  if (num_cpus == port::kUnknownCPU) {
+    num_cpus = port::NumSchedulableCPUs();
+  }
+  int num_shards = 1;
+  while (num_shards < num_cpus && num_shards < kMaxCpuShards) {
+    num_shards *= 2;
+  }
+  return num_shards;
+}
+
+// Threads on platforms where the current CPU can't be identified are spread
+// over the shards round-robin instead.
+int ThreadShard() {
+  static std::atomic<int> next_shard{0};
+  thread_local const int shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed);
+  return shard;
+}
+
+}  // namespace
+
+int NumCpuShards() {
+  static const int num_shards = ComputeNumCpuShards();
+  return num_shards;
+}
+
+int CurrentCpuShard() {
+  int cpu = port::GetCurrentCPU();
+  if (cpu < 0) {
+    cpu = ThreadShard();
+  }
+  return cpu & (NumCpuShards() - 1);
+}
+
+}  // namespace internal
+}  // namespace monitoring
+}  // namespace tensorflow
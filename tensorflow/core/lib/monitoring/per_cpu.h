@@ -0,0 +1,117 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_LIB_MONITORING_PER_CPU_H_
+#define TENSORFLOW_CORE_LIB_MONITORING_PER_CPU_H_
+
+#include <atomic>
+#include <new>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mem.h"
+
+namespace tensorflow {
+namespace monitoring {
+namespace internal {
+
+// Returns the number of shards per-CPU metric cells are split into. This is a
+// power of two, at least 1, and constant for the lifetime of the process.
+int NumCpuShards();
+
+// Returns the shard in [0, NumCpuShards()) the calling thread should update.
+// Threads running on the same CPU map to the same shard, so that concurrent
+// updates from different CPUs rarely touch the same cache line.
+int CurrentCpuShard();
+
+// An array of one T per CPU shard. Each element is aligned to, and padded to,
+// its own cache line(s), so that updating one shard doesn't invalidate the
+// others.
+//
+// Writers update Local(); readers merge all shards. The elements are value
+// initialized, so e.g. PerCpu<std::atomic<int64>> starts out with all zeros. T
+// is responsible for its own thread-safety, typically by only holding atomics.
+template <typename T>
+class PerCpu {
+ public:
+  // Shards are over-aligned, which operator new only honors from C++17 on.
+  PerCpu()
+      : num_shards_(NumCpuShards()),
+        shards_(static_cast<Shard*>(port::AlignedMalloc(
+            num_shards_ * sizeof(Shard), alignof(Shard)))) {
+    for (int i = 0; i < num_shards_; ++i) {
+      new (&shards_[i]) Shard();
+    }
+  }
+
+  ~PerCpu() {
+    for (int i = 0; i < num_shards_; ++i) {
+      shards_[i].~Shard();
+    }
+    port::AlignedFree(shards_);
+  }
+
+  // Returns the element for the calling thread's shard.
+  T& Local() { return shards_[CurrentCpuShard()].value; }
+
+  int size() const { return num_shards_; }
+
+  T& operator[](int i) { return shards_[i].value; }
+  const T& operator[](int i) const { return shards_[i].value; }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  // The alignment also rounds the size of a shard up to whole cache lines.
+  struct alignas(kCacheLineSize) Shard {
+    T value;
+  };
+
+  const int num_shards_;
+  Shard* const shards_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PerCpu);
+};
+
+// Lock-free read-modify-write operations on doubles, which std::atomic doesn't
+// provide before C++20. They are cheap as long as the target is rarely
+// updated concurrently, e.g. because it is only updated from one CPU shard.
+inline void AtomicAdd(std::atomic<double>* target, double delta) {
+  double current = target->load(std::memory_order_relaxed);
+  while (!target->compare_exchange_weak(current, current + delta,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+inline void AtomicMin(std::atomic<double>* target, double value) {
+  double current = target->load(std::memory_order_relaxed);
+  while (value < current &&
+         !target->compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+inline void AtomicMax(std::atomic<double>* target, double value) {
+  double current = target->load(std::memory_order_relaxed);
+  while (value > current &&
+         !target->compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace internal
+}  // namespace monitoring
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_LIB_MONITORING_PER_CPU_H_
@@ -44,10 +44,9 @@ class ExplicitBuckets : public Buckets {
     // We augment the bucket limits so that all boundaries are within [-DBL_MAX,
     // DBL_MAX].
     //
-    // Since we use ThreadSafeHistogram, we don't have to explicitly add
-    // -DBL_MAX, because it uses these limits as upper-bounds, so
-    // bucket_count[0] is always the number of elements in
-    // [-DBL_MAX, bucket_limits[0]).
+    // Since SamplerCell uses these limits as upper-bounds, we don't have to
+    // explicitly add -DBL_MAX, because bucket_count[0] is always the number of
+    // elements in [-DBL_MAX, bucket_limits[0]).
     if (bucket_limits_.back() != DBL_MAX) {
       bucket_limits_.push_back(DBL_MAX);
     }
@@ -96,6 +95,51 @@ class ExponentialBuckets : public Buckets {
 
 }  // namespace
 
+SamplerCell::SamplerCell(const std::vector<double>& bucket_limits)
+    : bucket_limits_(bucket_limits) {
+  CHECK_GT(bucket_limits_.size(), 0);
+  for (int i = 0; i < shards_.size(); ++i) {
+    Shard& shard = shards_[i];
+    // Same initial values as histogram::Histogram::Clear().
+    shard.min.store(bucket_limits_.back());
+    shard.max.store(-DBL_MAX);
+    shard.buckets.reset(new std::atomic<int64>[bucket_limits_.size()]());
+  }
+}
+
+HistogramProto SamplerCell::value() const {
+  double min = bucket_limits_.back();
+  double max = -DBL_MAX;
+  int64 num = 0;
+  double sum = 0;
+  double sum_squares = 0;
+  std::vector<int64> buckets(bucket_limits_.size(), 0);
+  for (int i = 0; i < shards_.size(); ++i) {
+    const Shard& shard = shards_[i];
+    min = std::min(min, shard.min.load(std::memory_order_relaxed));
+    max = std::max(max, shard.max.load(std::memory_order_relaxed));
+    num += shard.num.load(std::memory_order_relaxed);
+    sum += shard.sum.load(std::memory_order_relaxed);
+    sum_squares += shard.sum_squares.load(std::memory_order_relaxed);
+    for (size_t b = 0; b < buckets.size(); ++b) {
+      buckets[b] += shard.buckets[b].load(std::memory_order_relaxed);
+    }
+  }
+
+  // Matches histogram::Histogram::EncodeToProto() with preserve_zero_buckets.
+  HistogramProto pb;
+  pb.set_min(min);
+  pb.set_max(max);
+  pb.set_num(num);
+  pb.set_sum(sum);
+  pb.set_sum_squares(sum_squares);
+  for (size_t b = 0; b < buckets.size(); ++b) {
+    pb.add_bucket_limit(bucket_limits_[b]);
+    pb.add_bucket(buckets[b]);
+  }
+  return pb;
+}
+
 // static
 std::unique_ptr<Buckets> Buckets::Explicit(std::vector<double> bucket_limits) {
   return std::unique_ptr<Buckets>(
@@ -29,13 +29,18 @@ limitations under the License.
 
 #include <float.h>
 
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <memory>
+#include <vector>
 
 #include "tensorflow/core/framework/summary.pb.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/histogram/histogram.h"
 #include "tensorflow/core/lib/monitoring/collection_registry.h"
 #include "tensorflow/core/lib/monitoring/metric_def.h"
+#include "tensorflow/core/lib/monitoring/per_cpu.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
@@ -51,22 +56,40 @@ namespace monitoring {
 // to which both cells belong) and performance (since map indexing and
 // associated locking are both avoided).
 //
+// The histogram is split into per-CPU shards that are merged when read. Adding
+// a sample only does relaxed atomic updates on the calling CPU's shard, so it
+// never blocks and scales with the number of threads.
+//
 // This class is thread-safe.
 class SamplerCell {
  public:
-  SamplerCell(const std::vector<double>& bucket_limits)
-      : histogram_(bucket_limits) {}
+  SamplerCell(const std::vector<double>& bucket_limits);
 
   ~SamplerCell() {}
 
-  // Atomically adds a sample.
+  // Adds a sample without taking any locks.
   void Add(double sample);
 
-  // Returns the current histogram value as a proto.
+  // Returns the current histogram value as a proto. The fields of a sample
+  // that is added concurrently may be only partially reflected, e.g. counted
+  // in its bucket but not yet in the sum.
   HistogramProto value() const;
 
  private:
-  histogram::ThreadSafeHistogram histogram_;
+  // The samples added on one CPU shard, with the semantics of
+  // histogram::Histogram.
+  struct Shard {
+    std::atomic<int64> num;
+    std::atomic<double> sum;
+    std::atomic<double> sum_squares;
+    std::atomic<double> min;
+    std::atomic<double> max;
+    // One count per bucket limit.
+    std::unique_ptr<std::atomic<int64>[]> buckets;
+  };
+
+  const std::vector<double> bucket_limits_;
+  internal::PerCpu<Shard> shards_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(SamplerCell);
 };
@@ -194,12 +217,20 @@ class Sampler {
 //  Implementation details follow. API readers may skip.
 ////
 
-inline void SamplerCell::Add(const double sample) { histogram_.Add(sample); }
-
-inline HistogramProto SamplerCell::value() const {
-  HistogramProto pb;
-  histogram_.EncodeToProto(&pb, true /* preserve_zero_buckets */);
-  return pb;
+inline void SamplerCell::Add(const double sample) {
+  // The last limit is DBL_MAX, but larger samples (and NaNs) still need a
+  // bucket.
+  const size_t bucket = std::min<size_t>(
+      std::upper_bound(bucket_limits_.begin(), bucket_limits_.end(), sample) -
+          bucket_limits_.begin(),
+      bucket_limits_.size() - 1);
+  Shard& shard = shards_.Local();
+  shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  shard.num.fetch_add(1, std::memory_order_relaxed);
+  internal::AtomicAdd(&shard.sum, sample);
+  internal::AtomicAdd(&shard.sum_squares, sample * sample);
+  internal::AtomicMin(&shard.min, sample);
+  internal::AtomicMax(&shard.max, sample);
 }
 
 template <int NumLabels>
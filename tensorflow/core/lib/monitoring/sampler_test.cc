@@ -15,7 +15,14 @@ limitations under the License.
 
 #include "tensorflow/core/lib/monitoring/sampler.h"
 
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace monitoring {
@@ -121,6 +128,80 @@ TEST(ExplicitSamplerTest, SameName) {
   delete same_sampler;
 }
 
+// Runs `fn(thread_index)` on `num_threads` threads and waits for all of them
+// to finish.
+void RunOnThreads(int num_threads, const std::function<void(int)>& fn) {
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(Env::Default()->StartThread(
+        ThreadOptions(), "sampler_test", [&fn, i]() { fn(i); }));
+  }
+}
+
+auto* concurrent_sampler =
+    Sampler<0>::New({"/tensorflow/test/concurrent_sampler",
+                     "Sampler added to from many threads."},
+                    Buckets::Explicit({10.0, 100.0, 1000.0}));
+
+TEST(UnlabeledSamplerTest, ConcurrentAdds) {
+  // The samples are integers, so the sums don't depend on the order in which
+  // the shards are merged.
+  const int kNumThreads = 8;
+  const int kSamplesPerThread = 500;
+  Histogram expected({10.0, 100.0, 1000.0, DBL_MAX});
+  for (int t = 0; t < kNumThreads; ++t) {
+    for (int i = 0; i < kSamplesPerThread; ++i) {
+      expected.Add(t * kSamplesPerThread + i - 100);
+    }
+  }
+
+  auto* cell = concurrent_sampler->GetCell();
+  RunOnThreads(kNumThreads, [cell](int t) {
+    for (int i = 0; i < kSamplesPerThread; ++i) {
+      cell->Add(t * kSamplesPerThread + i - 100);
+    }
+  });
+
+  EqHistograms(expected, cell->value());
+}
+
+TEST(SamplerCellTest, SamplesBeyondLastLimit) {
+  SamplerCell cell({1.0, DBL_MAX});
+  cell.Add(std::numeric_limits<double>::infinity());
+  const HistogramProto pb = cell.value();
+  EXPECT_EQ(1, pb.num());
+  ASSERT_EQ(2, pb.bucket_size());
+  EXPECT_EQ(0, pb.bucket(0));
+  EXPECT_EQ(1, pb.bucket(1));
+}
+
+// Every thread adds `iters` samples to the same cell. Adding a sample doesn't
+// take a lock and only touches the calling CPU's shard, so the time per sample
+// should stay flat as threads are added.
+void BM_SamplerAdd(int iters, int num_threads) {
+  testing::StopTiming();
+  testing::UseRealTime();
+  SamplerCell cell(Buckets::Exponential(1, 2, 20)->explicit_bounds());
+  testing::StartTiming();
+  RunOnThreads(num_threads, [&cell, iters](int t) {
+    for (int i = 0; i < iters; ++i) {
+      cell.Add(i & 0xffff);
+    }
+  });
+  testing::StopTiming();
+  CHECK_EQ(static_cast<int64>(iters) * num_threads, cell.value().num());
+  testing::ItemsProcessed(static_cast<int64>(iters) * num_threads);
+}
+
+BENCHMARK(BM_SamplerAdd)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64);
+
 }  // namespace
 }  // namespace monitoring
 }  // namespace tensorflow
@@ -46,6 +46,8 @@ namespace {
 class HostTracer : public ProfilerInterface {
  public:
   explicit HostTracer(int host_trace_level);
+  // Samples host traces instead of recording all of them.
+  explicit HostTracer(const TraceMeRecorder::SamplingOptions& sampling_options);
   ~HostTracer() override;
 
   // Starts recording TraceMes.
@@ -64,6 +66,10 @@ class HostTracer : public ProfilerInterface {
   // Level of host tracing.
   const int host_trace_level_;
 
+  // True if sampling host traces.
+  const bool sampling_ = false;
+  TraceMeRecorder::SamplingOptions sampling_options_;
+
   // True if currently recording.
   bool recording_ = false;
 
@@ -77,13 +83,19 @@ class HostTracer : public ProfilerInterface {
 HostTracer::HostTracer(int host_trace_level)
     : host_trace_level_(host_trace_level) {}
 
+HostTracer::HostTracer(const TraceMeRecorder::SamplingOptions& sampling_options)
+    : host_trace_level_(sampling_options.level),
+      sampling_(true),
+      sampling_options_(sampling_options) {}
+
 HostTracer::~HostTracer() { Stop().IgnoreError(); }
 
 Status HostTracer::Start() {
   if (recording_) {
     return errors::Internal("TraceMeRecorder already started");
   }
-  recording_ = TraceMeRecorder::Start(host_trace_level_);
+  recording_ = sampling_ ? TraceMeRecorder::StartSampling(sampling_options_)
+                         : TraceMeRecorder::Start(host_trace_level_);
   if (!recording_) {
     return errors::Internal("Failed to start TraceMeRecorder");
   }
@@ -158,6 +170,18 @@ Status HostTracer::CollectData(XSpace* space) {
 std::unique_ptr<ProfilerInterface> CreateHostTracer(
     const ProfileOptions& options) {
   if (options.host_tracer_level() == 0) return nullptr;
+  if (options.host_tracer_sampling_period() > 1) {
+    TraceMeRecorder::SamplingOptions sampling_options;
+    sampling_options.level = options.host_tracer_level();
+    sampling_options.sampling_period = options.host_tracer_sampling_period();
+    if (options.host_tracer_ring_buffer_size() > 0) {
+      sampling_options.ring_buffer_size =
+          options.host_tracer_ring_buffer_size();
+    }
+    sampling_options.slow_step_threshold_ns =
+        options.slow_step_threshold_us() * EnvTime::kMicrosToNanos;
+    return absl::make_unique<HostTracer>(sampling_options);
+  }
   return absl::make_unique<HostTracer>(options.host_tracer_level());
 }
 
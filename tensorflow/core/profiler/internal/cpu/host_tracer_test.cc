@@ -113,6 +113,40 @@ TEST(HostTracerTest, CollectsTraceMeEventsAsRunMetadata) {
               MakeNodeStats("incomplete", thread_id, "key1=value1,key2"))));
 }
 
+TEST(HostTracerTest, CollectsSlowStepsWhenSampling) {
+  uint32 thread_id = Env::Default()->GetCurrentThreadId();
+
+  ProfileOptions options = ProfilerSession::DefaultOptions();
+  options.set_host_tracer_sampling_period(2);
+  options.set_host_tracer_ring_buffer_size(4);
+  options.set_slow_step_threshold_us(1);
+  auto tracer = CreateHostTracer(options);
+
+  TF_ASSERT_OK(tracer->Start());
+  const uint64 begin_time = TraceMe::BeginStep();
+  for (int i = 0; i < 100; ++i) {
+    TraceMe traceme("slow_step");
+  }
+  Env::Default()->SleepForMicroseconds(10);
+  TraceMe::EndStep(begin_time);
+  // Enough sampled activities to overwrite the ring buffer.
+  for (int i = 0; i < 100; ++i) {
+    TraceMe traceme("after");
+  }
+  TF_ASSERT_OK(tracer->Stop());
+
+  RunMetadata run_metadata;
+  TF_ASSERT_OK(tracer->CollectData(&run_metadata));
+  ASSERT_EQ(run_metadata.step_stats().dev_stats_size(), 1);
+  const auto& node_stats = run_metadata.step_stats().dev_stats(0).node_stats();
+  EXPECT_THAT(node_stats, ::testing::Contains(EqualsNodeStats(
+                              MakeNodeStats("slow_step", thread_id))));
+  EXPECT_THAT(node_stats, ::testing::Contains(EqualsNodeStats(
+                              MakeNodeStats("after", thread_id))));
+  // Sampling bounds the events kept for the thread.
+  EXPECT_LE(node_stats.size(), 8);
+}
+
 TEST(HostTracerTest, CollectsTraceMeEventsAsXSpace) {
   uint32 thread_id;
   std::string thread_name = "MyThreadName";
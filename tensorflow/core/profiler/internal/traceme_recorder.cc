@@ -19,14 +19,17 @@ limitations under the License.
 #include <algorithm>
 #include <atomic>
 #include <new>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
@@ -34,6 +37,8 @@ namespace profiler {
 namespace internal {
 
 std::atomic<int> g_trace_level(TraceMeRecorder::kTracingDisabled);
+std::atomic<int> g_sampling_period(1);
+std::atomic<uint64> g_slow_step_threshold_ns(0);
 
 // g_trace_level implementation must be lock-free for faster execution of the
 // TraceMe API. This can be commented (if compilation is failing) but execution
@@ -44,6 +49,67 @@ static_assert(ATOMIC_INT_LOCK_FREE == 2, "Assumed atomic<int> was lock free");
 
 namespace {
 
+// In sampling mode, the number of most recent events each thread keeps. 0 when
+// recording every event. Only modified while TraceMeRecorder::mutex_ is held.
+std::atomic<int> g_ring_buffer_size(0);
+
+// In sampling mode, bounds the memory held for threads that exited.
+constexpr size_t kMaxOrphanedThreadsWhileSampling = 64;
+
+// Returns the events in `events` that ended (or, for begin events, started)
+// at or after start_time.
+std::vector<TraceMeRecorder::Event> EventsSince(
+    const std::vector<TraceMeRecorder::Event>& events, uint64 start_time) {
+  std::vector<TraceMeRecorder::Event> result;
+  for (const auto& event : events) {
+    if (std::max(event.start_time, event.end_time) >= start_time) {
+      result.push_back(event);
+    }
+  }
+  return result;
+}
+
+// Returns the time of an event, for ordering.
+uint64 EventTime(const TraceMeRecorder::Event& event) {
+  return event.start_time != 0 ? event.start_time : event.end_time;
+}
+
+// Adds the events of `snapshot` that are not in `events` yet, e.g. because the
+// ring buffers overwrote them, keeping the events of each thread in time order.
+void MergeEvents(TraceMeRecorder::Events&& snapshot,
+                 TraceMeRecorder::Events* events) {
+  for (auto& thread_snapshot : snapshot) {
+    auto thread = std::find_if(events->begin(), events->end(),
+                               [&](const TraceMeRecorder::ThreadEvents& t) {
+                                 return t.thread.tid ==
+                                        thread_snapshot.thread.tid;
+                               });
+    if (thread == events->end()) {
+      events->push_back(std::move(thread_snapshot));
+      continue;
+    }
+    absl::flat_hash_set<std::tuple<uint64, uint64, uint64>> known;
+    for (const auto& event : thread->events) {
+      known.insert({event.activity_id, event.start_time, event.end_time});
+    }
+    bool merged = false;
+    for (auto& event : thread_snapshot.events) {
+      if (known.insert({event.activity_id, event.start_time, event.end_time})
+              .second) {
+        thread->events.push_back(std::move(event));
+        merged = true;
+      }
+    }
+    if (merged) {
+      std::stable_sort(thread->events.begin(), thread->events.end(),
+                       [](const TraceMeRecorder::Event& a,
+                          const TraceMeRecorder::Event& b) {
+                         return EventTime(a) < EventTime(b);
+                       });
+    }
+  }
+}
+
 // A single-producer single-consumer queue of Events.
 //
 // Implemented as a linked-list of blocks containing numbered slots, with start
@@ -168,6 +234,56 @@ class EventQueue {
   std::atomic<size_t> end_;  // Atomic: also read by consumer thread.
 };
 
+// A fixed-capacity buffer of the most recent Events, used in sampling mode.
+//
+// Unlike EventQueue, the events are read while the owner thread keeps
+// recording, so Push and the readers synchronize on a mutex. Push is only
+// called for sampled activities, and the mutex is only contended while a
+// snapshot is taken.
+class EventRing {
+ public:
+  // Adds an event, overwriting the oldest one once `capacity` events are
+  // buffered. Only called by the owner thread.
+  void Push(TraceMeRecorder::Event&& event, size_t capacity) {
+    mutex_lock lock(mutex_);
+    if (events_.size() < capacity) {
+      events_.push_back(std::move(event));
+    } else {
+      events_[next_] = std::move(event);
+      next_ = (next_ + 1) % events_.size();
+    }
+  }
+
+  // Returns copies of the events that ended (or, for begin events, started) at
+  // or after start_time, oldest first.
+  std::vector<TraceMeRecorder::Event> Copy(uint64 start_time) {
+    mutex_lock lock(mutex_);
+    Rotate();
+    return EventsSince(events_, start_time);
+  }
+
+  // Retrieves and removes all events, oldest first.
+  std::vector<TraceMeRecorder::Event> PopAll() {
+    mutex_lock lock(mutex_);
+    Rotate();
+    std::vector<TraceMeRecorder::Event> result;
+    std::swap(result, events_);
+    return result;
+  }
+
+ private:
+  // Moves the oldest event to the front.
+  void Rotate() TF_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    std::rotate(events_.begin(), events_.begin() + next_, events_.end());
+    next_ = 0;
+  }
+
+  mutex mutex_;
+  std::vector<TraceMeRecorder::Event> events_ TF_GUARDED_BY(mutex_);
+  // Once the buffer is full, the slot of the oldest event.
+  size_t next_ TF_GUARDED_BY(mutex_) = 0;
+};
+
 }  // namespace
 
 // To avoid unnecessary synchronization between threads, each thread has a
@@ -190,15 +306,35 @@ class TraceMeRecorder::ThreadLocalRecorder {
   }
 
   // Record is only called from the owner thread.
-  void Record(TraceMeRecorder::Event&& event) { queue_.Push(std::move(event)); }
+  void Record(TraceMeRecorder::Event&& event) {
+    const int ring_buffer_size =
+        g_ring_buffer_size.load(std::memory_order_relaxed);
+    if (TF_PREDICT_TRUE(ring_buffer_size == 0)) {
+      queue_.Push(std::move(event));
+    } else {
+      ring_.Push(std::move(event), ring_buffer_size);
+    }
+  }
 
   // Clear is called from the control thread when tracing starts/stops, or from
   // the owner thread when it shuts down (see destructor).
-  TraceMeRecorder::ThreadEvents Clear() { return {info_, queue_.PopAll()}; }
+  TraceMeRecorder::ThreadEvents Clear() {
+    TraceMeRecorder::ThreadEvents events = {info_, queue_.PopAll()};
+    for (auto& event : ring_.PopAll()) {
+      events.events.push_back(std::move(event));
+    }
+    return events;
+  }
+
+  // Snapshot is called from the control thread in sampling mode.
+  TraceMeRecorder::ThreadEvents Snapshot(uint64 start_time) {
+    return {info_, ring_.Copy(start_time)};
+  }
 
  private:
   TraceMeRecorder::ThreadInfo info_;
   EventQueue queue_;
+  EventRing ring_;
 };
 
 /*static*/ TraceMeRecorder* TraceMeRecorder::Get() {
@@ -217,6 +353,10 @@ void TraceMeRecorder::UnregisterThread(uint32 tid) {
   if (it != threads_.end()) {
     auto events = it->second->Clear();
     if (!events.events.empty()) {
+      if (g_ring_buffer_size.load(std::memory_order_relaxed) > 0 &&
+          orphaned_events_.size() >= kMaxOrphanedThreadsWhileSampling) {
+        orphaned_events_.erase(orphaned_events_.begin());
+      }
       orphaned_events_.push_back(std::move(events));
     }
     threads_.erase(it);
@@ -254,6 +394,30 @@ bool TraceMeRecorder::StartRecording(int level) {
   return started;
 }
 
+bool TraceMeRecorder::StartSamplingRecording(const SamplingOptions& options) {
+  DCHECK_GE(options.level, 1);
+  DCHECK_GE(options.sampling_period, 1);
+  DCHECK_GE(options.ring_buffer_size, 1);
+  mutex_lock lock(mutex_);
+  // The trace level is only changed while holding mutex_.
+  if (internal::g_trace_level.load(std::memory_order_acquire) !=
+      kTracingDisabled) {
+    return false;
+  }
+  // We may have old events in buffers because Record() raced with Stop().
+  Clear();
+  slow_steps_.clear();
+  g_ring_buffer_size.store(std::max(1, options.ring_buffer_size),
+                           std::memory_order_relaxed);
+  internal::g_slow_step_threshold_ns.store(options.slow_step_threshold_ns,
+                                           std::memory_order_relaxed);
+  internal::g_sampling_period.store(std::max(1, options.sampling_period),
+                                    std::memory_order_relaxed);
+  internal::g_trace_level.store(std::max(0, options.level),
+                                std::memory_order_release);
+  return true;
+}
+
 void TraceMeRecorder::Record(Event event) {
   static thread_local ThreadLocalRecorder thread_local_recorder;
   thread_local_recorder.Record(std::move(event));
@@ -267,9 +431,81 @@ TraceMeRecorder::Events TraceMeRecorder::StopRecording() {
           kTracingDisabled, std::memory_order_acq_rel) != kTracingDisabled) {
     events = Clear();
   }
+  for (auto& slow_step : slow_steps_) {
+    MergeEvents(std::move(slow_step), &events);
+  }
+  slow_steps_.clear();
+  internal::g_slow_step_threshold_ns.store(0, std::memory_order_relaxed);
+  internal::g_sampling_period.store(1, std::memory_order_relaxed);
+  g_ring_buffer_size.store(0, std::memory_order_relaxed);
   return events;
 }
 
+TraceMeRecorder::Events TraceMeRecorder::SnapshotRecording(uint64 start_time) {
+  mutex_lock lock(mutex_);
+  return SnapshotLocked(start_time);
+}
+
+void TraceMeRecorder::RecordSlowStep(uint64 begin_time) {
+  const uint64 threshold =
+      internal::g_slow_step_threshold_ns.load(std::memory_order_relaxed);
+  if (threshold == 0 || NowNanos() - begin_time < threshold) {
+    return;
+  }
+  mutex_lock lock(mutex_);
+  Events snapshot = SnapshotLocked(begin_time);
+  if (snapshot.empty()) {
+    return;
+  }
+  if (slow_steps_.size() >= kMaxSlowSteps) {
+    slow_steps_.erase(slow_steps_.begin());
+  }
+  slow_steps_.push_back(std::move(snapshot));
+}
+
+TraceMeRecorder::Events TraceMeRecorder::SnapshotLocked(uint64 start_time) {
+  TraceMeRecorder::Events result;
+  if (g_ring_buffer_size.load(std::memory_order_relaxed) == 0) {
+    return result;
+  }
+  for (const auto& orphaned : orphaned_events_) {
+    TraceMeRecorder::ThreadEvents events = {
+        orphaned.thread, EventsSince(orphaned.events, start_time)};
+    if (!events.events.empty()) {
+      result.push_back(std::move(events));
+    }
+  }
+  for (const auto& entry : threads_) {
+    TraceMeRecorder::ThreadEvents events = entry.second->Snapshot(start_time);
+    if (!events.events.empty()) {
+      result.push_back(std::move(events));
+    }
+  }
+  return result;
+}
+
+/*static*/ bool TraceMeRecorder::SampleActivity() {
+  // The gap to the next sampled activity is drawn uniformly from
+  // [1, 2 * period - 1], so that the samples don't alias with activities that
+  // repeat with a fixed period, e.g. the ops of a step.
+  thread_local static uint64 rng_state = random::New64() | 1;
+  thread_local static int64 countdown = 0;
+  if (--countdown > 0) {
+    return false;
+  }
+  const int64 period =
+      internal::g_sampling_period.load(std::memory_order_relaxed);
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  countdown = 1 + rng_state % std::max<int64>(1, 2 * period - 1);
+  return true;
+}
+
+/*static*/ uint64 TraceMeRecorder::NowNanos() {
+  return Env::Default()->NowNanos();
+}
+
 /*static*/ uint64 TraceMeRecorder::NewActivityId() {
   // Activity IDs: To avoid contention over a counter, the top 32 bits identify
   // the originating thread, the bottom 32 bits name the event within a thread.
@@ -34,6 +34,14 @@ namespace internal {
 // Modified by TraceMeRecorder singleton when tracing starts/stops.
 TF_EXPORT extern std::atomic<int> g_trace_level;
 
+// In sampling mode, one in g_sampling_period activities started on a thread is
+// recorded. 1 when recording every activity.
+TF_EXPORT extern std::atomic<int> g_sampling_period;
+
+// In sampling mode, steps which take at least this long keep a snapshot of
+// their events. 0 when slow steps aren't recorded.
+TF_EXPORT extern std::atomic<uint64> g_slow_step_threshold_ns;
+
 }  // namespace internal
 
 // TraceMeRecorder is a singleton repository of TraceMe events.
@@ -47,6 +55,13 @@ TF_EXPORT extern std::atomic<int> g_trace_level;
 // events. TraceMe::ActivityStart records begin events, and TraceMe::ActivityEnd
 // records end events. The profiler then stops the recorder and finds start/end
 // pairs. (Unpaired start/end events are discarded at that point).
+//
+// Alternatively, StartSampling() enables an always-on mode with bounded cost:
+// only one in N activities per thread is recorded, and each thread only keeps
+// its most recent events in a fixed-size ring buffer. Snapshot() returns the
+// buffered events without stopping. The executor brackets each step with
+// BeginStep() and EndStep(), which snapshot the events of slow steps so that
+// Stop() still returns them after the ring buffers moved on.
 class TraceMeRecorder {
  public:
   // An Event is either the start of a TraceMe, the end of a TraceMe, or both.
@@ -67,6 +82,21 @@ class TraceMeRecorder {
   };
   using Events = std::vector<ThreadEvents>;
 
+  struct SamplingOptions {
+    // Only traces <= level are recorded. Must be >= 1.
+    int level = 1;
+    // One in sampling_period activities started on each thread is recorded.
+    int sampling_period = 100;
+    // The number of most recent events each thread keeps.
+    int ring_buffer_size = 1024;
+    // If positive, EndStep() snapshots the events of steps that took at least
+    // this long. The most recent kMaxSlowSteps snapshots are kept.
+    uint64 slow_step_threshold_ns = 0;
+  };
+
+  // The number of slow step snapshots kept in sampling mode.
+  static constexpr size_t kMaxSlowSteps = 16;
+
   // Starts recording of TraceMe().
   // Only traces <= level will be recorded.
   // Level must be >= 0. If level is 0, no traces will be recorded.
@@ -74,13 +104,56 @@ class TraceMeRecorder {
 
   // Stops recording and returns events recorded since Start().
   // Events passed to Record after Stop has started will be dropped.
+  // In sampling mode, returns the events still in the ring buffers, and those
+  // of the slow steps.
   static Events Stop() { return Get()->StopRecording(); }
 
+  // Starts recording a sample of TraceMe() into per-thread ring buffers. Like
+  // Start(), fails if recording is already active.
+  static bool StartSampling(const SamplingOptions& options) {
+    return Get()->StartSamplingRecording(options);
+  }
+
+  // Returns a copy of the buffered events that ended (or, for begin events,
+  // started) at or after start_time, and keeps sampling. Returns no events if
+  // not in sampling mode.
+  static Events Snapshot(uint64 start_time = 0) {
+    return Get()->SnapshotRecording(start_time);
+  }
+
+  // Returns the start time of a step to pass to EndStep(), or 0 if slow steps
+  // aren't recorded. Racy, but cheap!
+  static inline uint64 BeginStep() {
+    return TF_PREDICT_TRUE(internal::g_slow_step_threshold_ns.load(
+                               std::memory_order_relaxed) == 0)
+               ? 0
+               : NowNanos();
+  }
+
+  // Snapshots the events of the step started at begin_time if it took at least
+  // the slow step threshold. Does nothing if begin_time is 0.
+  static inline void EndStep(uint64 begin_time) {
+    if (TF_PREDICT_FALSE(begin_time != 0)) {
+      Get()->RecordSlowStep(begin_time);
+    }
+  }
+
   // Returns whether we're currently recording. Racy, but cheap!
   static inline bool Active(int level = 1) {
     return internal::g_trace_level.load(std::memory_order_acquire) >= level;
   }
 
+  // Returns whether an activity at level that starts now should be recorded.
+  // Same as Active(level), except that in sampling mode only one in
+  // sampling_period activities is. Used by TraceMe before it formats the name,
+  // so that activities that aren't sampled cost almost nothing.
+  static inline bool ShouldRecordActivity(int level = 1) {
+    return Active(level) &&
+           (TF_PREDICT_TRUE(internal::g_sampling_period.load(
+                                std::memory_order_relaxed) <= 1) ||
+            SampleActivity());
+  }
+
   // Default value for trace_level_ when tracing is disabled
   static constexpr int kTracingDisabled = -1;
 
@@ -93,6 +166,12 @@ class TraceMeRecorder {
  private:
   class ThreadLocalRecorder;
 
+  // Returns true for one in g_sampling_period calls on each thread.
+  static bool SampleActivity();
+
+  // Returns the current time in ns since the Unix epoch.
+  static uint64 NowNanos();
+
   // Returns singleton.
   static TraceMeRecorder* Get();
 
@@ -104,7 +183,13 @@ class TraceMeRecorder {
   void UnregisterThread(uint32 tid);
 
   bool StartRecording(int level);
+  bool StartSamplingRecording(const SamplingOptions& options);
   Events StopRecording();
+  Events SnapshotRecording(uint64 start_time);
+  void RecordSlowStep(uint64 begin_time);
+
+  // Copies the buffered events that ended (or started) at or after start_time.
+  Events SnapshotLocked(uint64 start_time) TF_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   // Gathers events from all active threads, and clears their buffers.
   Events Clear() TF_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
@@ -114,8 +199,11 @@ class TraceMeRecorder {
   // thread. While active, a ThreadLocalRecorder stores trace events.
   absl::flat_hash_map<uint32, ThreadLocalRecorder*> threads_
       TF_GUARDED_BY(mutex_);
-  // Events from threads that died during recording.
+  // Events from threads that died during recording. In sampling mode, only
+  // those of the most recently exited threads are kept.
   TraceMeRecorder::Events orphaned_events_ TF_GUARDED_BY(mutex_);
+  // Snapshots of the most recent slow steps, oldest first.
+  std::vector<Events> slow_steps_ TF_GUARDED_BY(mutex_);
 };
 
 }  // namespace profiler
@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/platform/types.h"
 
@@ -192,6 +193,129 @@ TEST(RecorderTest, Multithreaded) {
   }
 }
 
+TEST(RecorderTest, SamplingKeepsMostRecentEvents) {
+  uint64 start_time = Env::Default()->NowNanos();
+  uint64 end_time = start_time + kNanosInSec;
+
+  TraceMeRecorder::SamplingOptions options;
+  options.sampling_period = 1;
+  options.ring_buffer_size = 3;
+  ASSERT_TRUE(TraceMeRecorder::StartSampling(options));
+  EXPECT_FALSE(TraceMeRecorder::Start(/*level=*/1));
+  for (int i = 0; i < 5; ++i) {
+    TraceMeRecorder::Record({static_cast<uint64>(i), absl::StrCat(i),
+                             start_time, end_time});
+  }
+
+  // Snapshots don't remove the events.
+  for (int i = 0; i < 2; ++i) {
+    auto results = TraceMeRecorder::Snapshot();
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_THAT(results[0].events,
+                ElementsAre(Named("2"), Named("3"), Named("4")));
+  }
+  auto results = TraceMeRecorder::Stop();
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_THAT(results[0].events,
+              ElementsAre(Named("2"), Named("3"), Named("4")));
+  EXPECT_TRUE(TraceMeRecorder::Snapshot().empty());
+}
+
+TEST(RecorderTest, SnapshotSinceStartTime) {
+  TraceMeRecorder::SamplingOptions options;
+  options.sampling_period = 1;
+  ASSERT_TRUE(TraceMeRecorder::StartSampling(options));
+  TraceMeRecorder::Record({1, "old", 100, 200});
+  TraceMeRecorder::Record({2, "old_begin", 150, 0});
+  TraceMeRecorder::Record({3, "overlapping", 250, 400});
+  TraceMeRecorder::Record({4, "new_begin", 350, 0});
+  TraceMeRecorder::Record({2, "", 0, 500});
+
+  auto results = TraceMeRecorder::Snapshot(/*start_time=*/300);
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_THAT(results[0].events,
+              ElementsAre(Named("overlapping"), Named("new_begin"), Named("")));
+  TraceMeRecorder::Stop();
+}
+
+TEST(RecorderTest, SlowStepsOutliveRingBuffers) {
+  TraceMeRecorder::SamplingOptions options;
+  options.sampling_period = 1;
+  options.ring_buffer_size = 2;
+  options.slow_step_threshold_ns = 1000;
+  ASSERT_TRUE(TraceMeRecorder::StartSampling(options));
+
+  // A fast step isn't kept.
+  uint64 begin_time = TraceMeRecorder::BeginStep();
+  ASSERT_NE(begin_time, 0);
+  TraceMeRecorder::Record({1, "fast", begin_time, begin_time});
+  TraceMeRecorder::EndStep(Env::Default()->NowNanos());
+
+  begin_time = TraceMeRecorder::BeginStep();
+  TraceMeRecorder::Record({2, "slow1", begin_time, begin_time + 1});
+  TraceMeRecorder::Record({3, "slow2", begin_time + 1, begin_time + 2});
+  Env::Default()->SleepForMicroseconds(10);
+  TraceMeRecorder::EndStep(begin_time);
+
+  // Later events overwrite the ring buffer, but not the slow step.
+  const uint64 later = Env::Default()->NowNanos();
+  TraceMeRecorder::Record({4, "later1", later, later});
+  TraceMeRecorder::Record({5, "later2", later + 1, later + 1});
+  auto results = TraceMeRecorder::Stop();
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_THAT(results[0].events,
+              ElementsAre(Named("slow1"), Named("slow2"), Named("later1"),
+                          Named("later2")));
+
+  // Steps aren't timed unless sampling with a slow step threshold.
+  EXPECT_EQ(TraceMeRecorder::BeginStep(), 0);
+}
+
+TEST(RecorderTest, SamplesOneInPeriodActivities) {
+  constexpr int kNumActivities = 10000;
+  TraceMeRecorder::SamplingOptions options;
+  options.sampling_period = 10;
+  ASSERT_TRUE(TraceMeRecorder::StartSampling(options));
+  int num_sampled = 0;
+  for (int i = 0; i < kNumActivities; ++i) {
+    if (TraceMeRecorder::ShouldRecordActivity()) ++num_sampled;
+  }
+  TraceMeRecorder::Stop();
+  EXPECT_GT(num_sampled, 900);
+  EXPECT_LT(num_sampled, 1100);
+
+  // Regular recording isn't sampled.
+  ASSERT_TRUE(TraceMeRecorder::Start(/*level=*/1));
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(TraceMeRecorder::ShouldRecordActivity());
+  }
+  TraceMeRecorder::Stop();
+  EXPECT_FALSE(TraceMeRecorder::ShouldRecordActivity());
+}
+
+// Mimics TraceMe: formats a name and records an event for every activity that
+// should be recorded. Arg 0 is the cost with tracing disabled, arg 1 with every
+// activity recorded into the ring buffers, and larger args sample one in that
+// many activities.
+void BM_RecordActivity(int iters, int sampling_period) {
+  if (sampling_period > 0) {
+    TraceMeRecorder::SamplingOptions options;
+    options.sampling_period = sampling_period;
+    TraceMeRecorder::StartSampling(options);
+  }
+  for (int i = 0; i < iters; ++i) {
+    if (TraceMeRecorder::ShouldRecordActivity()) {
+      uint64 now = Env::Default()->NowNanos();
+      TraceMeRecorder::Record({/*activity_id=*/0, absl::StrCat("activity:", i),
+                               now, now});
+    }
+  }
+  testing::StopTiming();
+  TraceMeRecorder::Stop();
+}
+
+BENCHMARK(BM_RecordActivity)->Arg(0)->Arg(1)->Arg(100)->Arg(1000);
+
 }  // namespace
 }  // namespace profiler
 }  // namespace tensorflow
@@ -51,6 +51,9 @@ class ProfilerSession {
     options.set_python_tracer_level(0);
     options.set_enable_hlo_proto(false);
     options.set_include_dataset_ops(true);
+    options.set_host_tracer_sampling_period(0);
+    options.set_host_tracer_ring_buffer_size(0);
+    options.set_slow_step_threshold_us(0);
     return options;
   }
 
@@ -90,7 +90,7 @@ class TraceMe {
   explicit TraceMe(absl::string_view name, int level = 1) {
     DCHECK_GE(level, 1);
 #if !defined(IS_MOBILE_PLATFORM)
-    if (TF_PREDICT_FALSE(TraceMeRecorder::Active(level))) {
+    if (TF_PREDICT_FALSE(TraceMeRecorder::ShouldRecordActivity(level))) {
       new (&no_init_.name) std::string(name);
       start_time_ = EnvTime::NowNanos();
     }
@@ -105,7 +105,7 @@ class TraceMe {
   explicit TraceMe(std::string&& name, int level = 1) {
     DCHECK_GE(level, 1);
 #if !defined(IS_MOBILE_PLATFORM)
-    if (TF_PREDICT_FALSE(TraceMeRecorder::Active(level))) {
+    if (TF_PREDICT_FALSE(TraceMeRecorder::ShouldRecordActivity(level))) {
       new (&no_init_.name) std::string(std::move(name));
       start_time_ = EnvTime::NowNanos();
     }
@@ -142,7 +142,7 @@ class TraceMe {
   explicit TraceMe(NameGeneratorT name_generator, int level = 1) {
     DCHECK_GE(level, 1);
 #if !defined(IS_MOBILE_PLATFORM)
-    if (TF_PREDICT_FALSE(TraceMeRecorder::Active(level))) {
+    if (TF_PREDICT_FALSE(TraceMeRecorder::ShouldRecordActivity(level))) {
       new (&no_init_.name) std::string(name_generator());
       start_time_ = EnvTime::NowNanos();
     }
@@ -202,7 +202,7 @@ class TraceMe {
   // Returns the activity ID, which is used to stop the activity.
   static uint64 ActivityStart(absl::string_view name, int level = 1) {
 #if !defined(IS_MOBILE_PLATFORM)
-    if (TF_PREDICT_FALSE(TraceMeRecorder::Active(level))) {
+    if (TF_PREDICT_FALSE(TraceMeRecorder::ShouldRecordActivity(level))) {
       uint64 activity_id = TraceMeRecorder::NewActivityId();
       TraceMeRecorder::Record({activity_id, std::string(name),
                                /*start_time=*/EnvTime::NowNanos(),
@@ -231,7 +231,7 @@ class TraceMe {
   template <typename NameGeneratorT>
   static void InstantActivity(NameGeneratorT name_generator, int level = 1) {
 #if !defined(IS_MOBILE_PLATFORM)
-    if (TF_PREDICT_FALSE(TraceMeRecorder::Active(level))) {
+    if (TF_PREDICT_FALSE(TraceMeRecorder::ShouldRecordActivity(level))) {
       uint64 now = EnvTime::NowNanos();
       TraceMeRecorder::Record({kCompleteActivity, name_generator(),
                                /*start_time=*/now, /*end_time=*/now});
@@ -255,6 +255,23 @@ class TraceMe {
 #endif
   }
 
+  // Brackets a step, e.g. an executor run, so that the events of slow steps are
+  // kept when sampling (see TraceMeRecorder::SamplingOptions). BeginStep()
+  // returns the value to pass to EndStep().
+  static uint64 BeginStep() {
+#if !defined(IS_MOBILE_PLATFORM)
+    return TraceMeRecorder::BeginStep();
+#else
+    return 0;
+#endif
+  }
+
+  static void EndStep(uint64 begin_time) {
+#if !defined(IS_MOBILE_PLATFORM)
+    TraceMeRecorder::EndStep(begin_time);
+#endif
+  }
+
  private:
   // Activity ID or start time used when tracing is disabled.
   constexpr static uint64 kUntracedActivity = 0;
@@ -21,6 +21,8 @@ limitations under the License.
 #include <type_traits>
 #include <utility>
 
+#include "tensorflow/lite/minimal_logging.h"
+
 namespace tflite {
 namespace {
 
@@ -31,14 +33,15 @@ constexpr int32_t kNodeNotAssigned = std::numeric_limits<int32_t>::max();
 ArenaPlanner::ArenaPlanner(TfLiteContext* context,
                            std::unique_ptr<GraphInfo> graph_info,
                            bool preserve_inputs, bool preserve_intermediates,
-                           int tensor_alignment)
+                           int tensor_alignment, int max_cached_plans)
     : context_(context),
       graph_info_(std::move(graph_info)),
       arena_(kDefaultArenaAlignment),
       persistent_arena_(kDefaultArenaAlignment),
       preserve_inputs_(preserve_inputs),
       preserve_intermediates_(preserve_intermediates),
-      tensor_alignment_(tensor_alignment) {}
+      tensor_alignment_(tensor_alignment),
+      max_cached_plans_(max_cached_plans) {}
 
 ArenaPlanner::~ArenaPlanner() {}
 
@@ -78,6 +81,9 @@ TfLiteStatus ArenaPlanner::ResetAllocationsAfter(int node) {
 TfLiteStatus ArenaPlanner::PlanAllocations() {
   // Invalidate any existing data.
   TF_LITE_ENSURE_STATUS(ResetAllocations());
+  // Cached plans depend on the graph structure.
+  cached_plans_.clear();
+  cached_plans_order_.clear();
   // Maybe other verb instead of 'Assigned'
   alloc_node_.assign(graph_info_->num_tensors(), kNodeNotAssigned);
   dealloc_node_.assign(graph_info_->num_tensors(), kNodeNotAssigned);
@@ -102,7 +108,9 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
       return kTfLiteOk;
     }
     TF_LITE_ENSURE(context_, dealloc_node_[tensor] == kNodeNotAssigned);
-    dealloc_node_[tensor] = node;
+    // Nodes running at the same time as the last user may still be using the
+    // memory which would be reused.
+    dealloc_node_[tensor] = graph_info_->last_concurrent_node(node);
     return kTfLiteOk;
   };
 
@@ -205,7 +213,7 @@ TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
     for (int j = 0; j < node_temporaries->size; ++j) {
       int tensor_index = node_temporaries->data[j];
       alloc_node_[tensor_index] = i;
-      dealloc_node_[tensor_index] = i;
+      dealloc_node_[tensor_index] = graph_info_->last_concurrent_node(i);
     }
   }
 
@@ -300,7 +308,55 @@ std::vector<int32_t> ArenaPlanner::CreateTensorAllocationVector(int first_node,
   return tensor_order;
 }
 
+ArenaPlanner::PlanKey ArenaPlanner::CreatePlanKey(
+    int last_node, const std::vector<int32_t>& tensors) {
+  PlanKey key;
+  key.reserve(tensors.size() * 5 + 1);
+  key.push_back(last_node);
+  for (int32_t tensor_index : tensors) {
+    const TfLiteTensor& tensor = *graph_info_->tensor(tensor_index);
+    if (tensor.allocation_type == kTfLiteArenaRw ||
+        tensor.allocation_type == kTfLiteArenaRwPersistent) {
+      key.push_back(tensor_index);
+      key.push_back(tensor.allocation_type);
+      key.push_back(tensor.bytes);
+      key.push_back(alloc_node_[tensor_index]);
+      key.push_back(dealloc_node_[tensor_index]);
+    }
+  }
+  return key;
+}
+
 TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
+  // Plans computed from scratch only depend on the sizes and lifetimes of the
+  // planned tensors, and can be reused when those are the same as before.
+  const bool plan_from_scratch = first_node == 0 &&
+                                 arena_.ordered_allocs().empty() &&
+                                 persistent_arena_.ordered_allocs().empty();
+  const bool use_cached_plans = plan_from_scratch && max_cached_plans_ > 0;
+  PlanKey plan_key;
+  if (use_cached_plans) {
+    std::vector<int32_t> tensors;
+    for (int i = 0; i < static_cast<int>(graph_info_->num_tensors()); ++i) {
+      if (alloc_node_[i] >= first_node && alloc_node_[i] <= last_node) {
+        tensors.push_back(i);
+      }
+    }
+    plan_key = CreatePlanKey(last_node, tensors);
+    const auto it = cached_plans_.find(plan_key);
+    if (it != cached_plans_.end()) {
+      const CachedPlan& plan = it->second;
+      for (const auto& alloc : plan.tensor_allocs) {
+        allocs_[alloc.tensor] = alloc;
+      }
+      TF_LITE_ENSURE_STATUS(arena_.RestorePlan(plan.arena_allocs));
+      TF_LITE_ENSURE_STATUS(
+          persistent_arena_.RestorePlan(plan.persistent_arena_allocs));
+      num_cached_plan_hits_++;
+      return kTfLiteOk;
+    }
+  }
+
   // Indices of tensors in order their allocation offsets will be calculated.
   const std::vector<int32_t> tensor_order =
       CreateTensorAllocationVector(first_node, last_node);
@@ -314,9 +370,34 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
     }
   }
 
+  // Place tensors planned offline first, and fit the others around them.
+  bool use_offline_plan = false;
+  if (plan_from_scratch && !offline_offsets_.empty()) {
+    use_offline_plan = IsOfflinePlanValid(tensor_order);
+    if (!use_offline_plan) {
+      TFLITE_LOG_PROD_ONCE(TFLITE_LOG_INFO,
+                           "Offline memory plan doesn't match the tensor sizes "
+                           "or execution plan, planning memory at runtime.");
+    }
+  }
+  if (use_offline_plan) {
+    for (const auto& tensor_index : tensor_order) {
+      if (IsOfflinePlanned(tensor_index)) {
+        TF_LITE_ENSURE_STATUS(arena_.AllocateAt(
+            context_, offline_offsets_[tensor_index],
+            graph_info_->tensor(tensor_index)->bytes, tensor_index,
+            alloc_node_[tensor_index], dealloc_node_[tensor_index],
+            &allocs_[tensor_index]));
+      }
+    }
+  }
+
   // Vector of ids of already allocated tensors, ordered by offset.
   for (const auto& tensor_index : tensor_order) {
     TfLiteTensor& tensor = *graph_info_->tensor(tensor_index);
+    if (use_offline_plan && IsOfflinePlanned(tensor_index)) {
+      continue;
+    }
     if (tensor.allocation_type == kTfLiteArenaRw) {
       TF_LITE_ENSURE_STATUS(
           arena_.Allocate(context_, tensor_alignment_, tensor.bytes,
@@ -331,9 +412,81 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
           &allocs_[tensor_index]));
     }
   }
+
+  if (use_cached_plans) {
+    if (cached_plans_.size() >= static_cast<size_t>(max_cached_plans_)) {
+      cached_plans_.erase(cached_plans_order_.front());
+      cached_plans_order_.pop_front();
+    }
+    CachedPlan plan;
+    for (const auto& tensor_index : tensor_order) {
+      const TfLiteTensor& tensor = *graph_info_->tensor(tensor_index);
+      if (tensor.allocation_type == kTfLiteArenaRw ||
+          tensor.allocation_type == kTfLiteArenaRwPersistent) {
+        plan.tensor_allocs.push_back(allocs_[tensor_index]);
+      }
+    }
+    plan.arena_allocs = arena_.ordered_allocs();
+    plan.persistent_arena_allocs = persistent_arena_.ordered_allocs();
+    cached_plans_order_.push_back(
+        cached_plans_.emplace(std::move(plan_key), std::move(plan)).first);
+  }
   return kTfLiteOk;
 }
 
+TfLiteStatus ArenaPlanner::SetOfflinePlannedOffsets(
+    std::vector<int32_t> offsets) {
+  TF_LITE_ENSURE(context_, offsets.size() <= graph_info_->num_tensors());
+  offline_offsets_ = std::move(offsets);
+  cached_plans_.clear();
+  cached_plans_order_.clear();
+  return kTfLiteOk;
+}
+
+bool ArenaPlanner::IsOfflinePlanned(int tensor_index) {
+  return tensor_index < static_cast<int>(offline_offsets_.size()) &&
+         offline_offsets_[tensor_index] >= 0 &&
+         graph_info_->tensor(tensor_index)->allocation_type == kTfLiteArenaRw;
+}
+
+bool ArenaPlanner::IsOfflinePlanValid(const std::vector<int32_t>& tensors) {
+  std::vector<int32_t> planned_tensors;
+  for (int32_t tensor_index : tensors) {
+    if (IsOfflinePlanned(tensor_index)) {
+      if (offline_offsets_[tensor_index] % tensor_alignment_ != 0) {
+        return false;
+      }
+      planned_tensors.push_back(tensor_index);
+    }
+  }
+  std::sort(planned_tensors.begin(), planned_tensors.end(),
+            [this](int32_t idx1, int32_t idx2) {
+              return offline_offsets_[idx1] < offline_offsets_[idx2];
+            });
+
+  // Offline offsets were computed for specific tensor sizes and lifetimes, and
+  // can't be trusted if the graph was resized or modified by delegates: check
+  // that no two tensors used at the same time overlap in the arena.
+  for (size_t i = 0; i < planned_tensors.size(); ++i) {
+    const int32_t tensor1 = planned_tensors[i];
+    const size_t end1 =
+        offline_offsets_[tensor1] + graph_info_->tensor(tensor1)->bytes;
+    for (size_t j = i + 1; j < planned_tensors.size(); ++j) {
+      const int32_t tensor2 = planned_tensors[j];
+      if (static_cast<size_t>(offline_offsets_[tensor2]) >= end1) {
+        break;
+      }
+      if (graph_info_->tensor(tensor1)->bytes != 0 &&
+          graph_info_->tensor(tensor2)->bytes != 0 &&
+          alloc_node_[tensor1] <= dealloc_node_[tensor2] &&
+          alloc_node_[tensor2] <= dealloc_node_[tensor1]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 TfLiteStatus ArenaPlanner::ResolveTensorAllocation(int tensor_index) {
   TfLiteTensor& tensor = *graph_info_->tensor(tensor_index);
   if (tensor.allocation_type == kTfLiteArenaRw) {
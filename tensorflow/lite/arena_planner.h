@@ -16,6 +16,8 @@ limitations under the License.
 #define TENSORFLOW_LITE_ARENA_PLANNER_H_
 
 #include <cstdint>
+#include <deque>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -28,6 +30,8 @@ limitations under the License.
 namespace tflite {
 
 constexpr const int kDefaultArenaAlignment = 64;
+// Maximum number of allocation plans an ArenaPlanner keeps for reuse.
+constexpr const int kDefaultMaxCachedPlans = 16;
 struct AllocationInfo;
 
 // A memory planner that makes all the allocations using arenas.
@@ -43,15 +47,27 @@ struct AllocationInfo;
 // execution. Since dynamic tensors don't have sizes until after the
 // corresponding operation is executed, this class supports incremental
 // planning.
+//
+// If nodes run concurrently (see GraphInfo::last_concurrent_node()), tensors
+// are kept allocated until all the nodes which may run at the same time as
+// their last user have run.
+//
+// Allocation plans computed from scratch are cached, keyed by the sizes and
+// lifetimes of the planned tensors, so that switching back and forth between
+// a few input shapes (e.g. variable sequence lengths) doesn't redo the
+// placement of every tensor each time. A cached plan only restores tensor
+// offsets: nodes are still prepared for the new shapes before planning.
 class ArenaPlanner : public MemoryPlanner {
  public:
   // Ownership of 'context' is not taken and it must remain util the
   // ArenaPlanner is destroyed. If 'preserve_inputs' is true the inputs to the
   // graph will not share memory with any other tensor, effectively preserving
   // them until the end of inference.
+  // At most 'max_cached_plans' allocation plans are kept for reuse.
   ArenaPlanner(TfLiteContext* context, std::unique_ptr<GraphInfo> graph_info,
                bool preserve_inputs, bool preserve_intermediates,
-               int tensor_alignment);
+               int tensor_alignment,
+               int max_cached_plans = kDefaultMaxCachedPlans);
   ~ArenaPlanner() override;
   ArenaPlanner(const ArenaPlanner&) = delete;
   ArenaPlanner& operator=(const ArenaPlanner&) = delete;
@@ -67,7 +83,38 @@ class ArenaPlanner : public MemoryPlanner {
   // Returns the base arena location for a given allocation type.
   std::intptr_t BasePointer(TfLiteAllocationType type);
 
+  // Returns the number of times an allocation plan was reused from the cache.
+  int num_cached_plan_hits() const { return num_cached_plan_hits_; }
+
+  // Sets offsets of tensors in the non-persistent arena computed offline, e.g.
+  // from the "OfflineMemoryAllocation" model metadata, with -1 for tensors to
+  // be planned at runtime. Offline offsets are used when planning from
+  // scratch, unless they conflict with the sizes or lifetimes of tensors at
+  // runtime; remaining tensors are fit around them.
+  TfLiteStatus SetOfflinePlannedOffsets(std::vector<int32_t> offsets);
+
  private:
+  // An allocation plan for the tensors of an interval of nodes.
+  struct CachedPlan {
+    // Allocations of all planned tensors, including empty ones.
+    std::vector<ArenaAllocWithUsageInterval> tensor_allocs;
+    // Allocation plans of the arenas, ordered by offset.
+    std::vector<ArenaAllocWithUsageInterval> arena_allocs;
+    std::vector<ArenaAllocWithUsageInterval> persistent_arena_allocs;
+  };
+  using PlanKey = std::vector<size_t>;
+
+  // Returns the key identifying the allocation plan for the given tensors.
+  PlanKey CreatePlanKey(int last_node, const std::vector<int32_t>& tensors);
+
+  // Returns true if the tensor is in the non-persistent arena and has an
+  // offline planned offset.
+  bool IsOfflinePlanned(int tensor_index);
+
+  // Returns true if offline planned offsets of the given tensors are aligned
+  // and don't overlap for tensors used at the same time.
+  bool IsOfflinePlanValid(const std::vector<int32_t>& tensors);
+
   // Make sure all the arenas have reserved enough memory to store all their
   // tensors.
   TfLiteStatus Commit();
@@ -131,6 +178,16 @@ class ArenaPlanner : public MemoryPlanner {
 
   // Number of bytes that tensor buffers should be aligned to.
   int tensor_alignment_;
+
+  // Previously computed allocation plans, and their keys in insertion order
+  // for eviction.
+  int max_cached_plans_;
+  std::map<PlanKey, CachedPlan> cached_plans_;
+  std::deque<std::map<PlanKey, CachedPlan>::iterator> cached_plans_order_;
+  int num_cached_plan_hits_ = 0;
+
+  // Offline planned arena offsets, indexed by tensor.
+  std::vector<int32_t> offline_offsets_;
 };
 
 }  // namespace tflite
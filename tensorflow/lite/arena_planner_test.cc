@@ -109,12 +109,24 @@ class TestGraph {
     variables_ = variables;
   }
 
+  // Sets the last node which may run at the same time as each node.
+  void SetLastConcurrentNodes(const std::vector<int>& last_concurrent_nodes) {
+    last_concurrent_nodes_ = last_concurrent_nodes;
+  }
+
+  size_t last_concurrent_node(size_t index) {
+    return index < last_concurrent_nodes_.size()
+               ? last_concurrent_nodes_[index]
+               : index;
+  }
+
   void Swap(TestGraph* other) {
     std::swap(nodes_, other->nodes_);
     std::swap(tensors_, other->tensors_);
     std::swap(inputs_, other->inputs_);
     std::swap(outputs_, other->outputs_);
     std::swap(variables_, other->variables_);
+    std::swap(last_concurrent_nodes_, other->last_concurrent_nodes_);
   }
 
  private:
@@ -123,6 +135,7 @@ class TestGraph {
   std::vector<int> inputs_;
   std::vector<int> outputs_;
   std::vector<int> variables_;
+  std::vector<int> last_concurrent_nodes_;
 };
 
 // The GraphInfo for a TestGraph.
@@ -144,6 +157,9 @@ class TestGraphInfo : public GraphInfo {
   const std::vector<int>& variables() const override {
     return graph_->variables();
   }
+  size_t last_concurrent_node(size_t index) const override {
+    return graph_->last_concurrent_node(index);
+  }
 
  private:
   TestGraph* graph_;
@@ -710,6 +726,136 @@ TEST_F(ArenaPlannerTest, GraphWithIntermediates) {
   EXPECT_EQ(GetOffset(2), GetOffsetAfter(5));
 }
 
+TEST_F(ArenaPlannerTest, CachedPlans) {
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2}, {}},   // First op
+                      {{2, 0}, {4}, {5}},  // Second op, with temporary
+                      {{4}, {3}, {}}       // Third op
+                  },
+                  {3});
+  SetGraph(&graph);
+  auto plan = [&]() {
+    CHECK(planner_->ResetAllocations() == kTfLiteOk);
+    Execute(0, 10);
+    std::vector<std::ptrdiff_t> offsets;
+    for (int i = 0; i < graph.tensors()->size(); ++i) {
+      offsets.push_back(GetOffset(i));
+    }
+    return offsets;
+  };
+
+  const std::vector<std::ptrdiff_t> original_offsets = plan();
+  EXPECT_EQ(planner_->num_cached_plan_hits(), 0);
+
+  // A different tensor size requires a new plan.
+  (*graph.tensors())[2].bytes = 100;
+  const std::vector<std::ptrdiff_t> resized_offsets = plan();
+  EXPECT_EQ(planner_->num_cached_plan_hits(), 0);
+  EXPECT_EQ(GetOffset(2), 0);
+
+  // Going back to previous sizes reuses the previous plans.
+  (*graph.tensors())[2].bytes = 9;
+  EXPECT_EQ(plan(), original_offsets);
+  EXPECT_EQ(planner_->num_cached_plan_hits(), 1);
+  (*graph.tensors())[2].bytes = 100;
+  EXPECT_EQ(plan(), resized_offsets);
+  EXPECT_EQ(planner_->num_cached_plan_hits(), 2);
+
+  // Cached plans are dropped when the graph changes.
+  CHECK(planner_->PlanAllocations() == kTfLiteOk);
+  plan();
+  EXPECT_EQ(planner_->num_cached_plan_hits(), 2);
+}
+
+TEST_F(ArenaPlannerTest, OfflinePlannedOffsets) {
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2}, {}},   // First op
+                      {{2, 0}, {4}, {5}},  // Second op, with temporary
+                      {{4}, {3}, {}}       // Third op
+                  },
+                  {3});
+  SetGraph(&graph);
+  auto plan = [&](std::vector<int32_t> offsets) {
+    CHECK(planner_->SetOfflinePlannedOffsets(std::move(offsets)) == kTfLiteOk);
+    CHECK(planner_->ResetAllocations() == kTfLiteOk);
+    Execute(0, 10);
+    std::vector<std::ptrdiff_t> result;
+    for (int i = 0; i < graph.tensors()->size(); ++i) {
+      result.push_back(GetOffset(i));
+    }
+    return result;
+  };
+  const std::vector<std::ptrdiff_t> runtime_offsets = plan({});
+
+  // Tensors 2 and 3 share their offset since they are never used at the same
+  // time. Tensors 4 and 5 are planned at runtime, around the others.
+  plan({32, 64, 0, 0, -1, -1});
+  EXPECT_EQ(GetOffset(0), 32);
+  EXPECT_EQ(GetOffset(1), 64);
+  EXPECT_EQ(GetOffset(2), 0);
+  EXPECT_EQ(GetOffset(3), 0);
+  // Tensors 0, 2, 4 and 5 are used by the second op.
+  for (int i : {4, 5}) {
+    for (int j : {0, 2, 4, 5}) {
+      if (i != j) {
+        EXPECT_TRUE(GetOffset(i) >= GetOffsetAfter(j) ||
+                    GetOffset(j) >= GetOffsetAfter(i))
+            << i << " overlaps " << j;
+      }
+    }
+  }
+
+  // Inputs 0 and 1 can't share memory, nor can misaligned offsets be used:
+  // the runtime plan is used instead.
+  EXPECT_EQ(plan({0, 0, -1, -1, -1, -1}), runtime_offsets);
+  EXPECT_EQ(plan({1, -1, -1, -1, -1, -1}), runtime_offsets);
+
+  // Offsets planned for smaller tensors conflict once tensors are resized.
+  plan({0, 32, 64, 64, -1, -1});
+  EXPECT_EQ(GetOffset(2), 64);
+  (*graph.tensors())[0].bytes = 48;
+  CHECK(planner_->ResetAllocations() == kTfLiteOk);
+  Execute(0, 10);
+  EXPECT_NE(GetOffset(1), 32);
+}
+
+TEST_F(ArenaPlannerTest, ConcurrentNodes) {
+  TestGraph graph({0},
+                  {
+                      /* in, out, tmp */
+                      {{0}, {1, 2}, {}},  // First op
+                      {{1}, {3}, {6}},    // Second op, with temporary
+                      {{2}, {4}, {}},     // Third op
+                      {{3, 4}, {5}, {}}   // Fourth op
+                  },
+                  {5});
+  auto overlap = [this](int tensor1, int tensor2) {
+    return GetOffset(tensor1) < GetOffsetAfter(tensor2) &&
+           GetOffset(tensor2) < GetOffsetAfter(tensor1);
+  };
+
+  // Run one at a time, the third op reuses the memory of tensors freed by the
+  // second.
+  SetGraph(&graph);
+  Execute(0, 10);
+  EXPECT_TRUE(overlap(4, 1) || overlap(4, 6));
+
+  // Run at the same time, the second and third ops may not share memory.
+  graph.SetLastConcurrentNodes({0, 2, 2, 3});
+  SetGraph(&graph);
+  Execute(0, 10);
+  for (int i : {1, 3, 6}) {
+    for (int j : {2, 4}) {
+      EXPECT_FALSE(overlap(i, j)) << i << " overlaps " << j;
+    }
+  }
+  EXPECT_FALSE(overlap(3, 6));
+}
+
 }  // namespace
 }  // namespace tflite
 
@@ -0,0 +1,28 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_CORE_API_OFFLINE_MEMORY_ALLOCATION_H_
+#define TENSORFLOW_LITE_CORE_API_OFFLINE_MEMORY_ALLOCATION_H_
+
+namespace tflite {
+
+// Name of the model metadata holding tensor arena offsets planned offline.
+// Shared by TFLite and TFLite Micro. The metadata buffer is an int32 array:
+// [version, subgraph index, number of offsets, offset of each tensor], where
+// an offset of -1 leaves the tensor to the runtime planner.
+constexpr char kOfflineMemoryAllocationMetadata[] = "OfflineMemoryAllocation";
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_CORE_API_OFFLINE_MEMORY_ALLOCATION_H_
@@ -23,6 +23,8 @@ limitations under the License.
 #include "tensorflow/lite/core/api/tensor_utils.h"
 #include "tensorflow/lite/delegates/nnapi/nnapi_delegate.h"
 #include "tensorflow/lite/graph_info.h"
+#include "tensorflow/lite/kernels/cpu_backend_context.h"
+#include "tensorflow/lite/kernels/cpu_backend_threadpool.h"
 #include "tensorflow/lite/minimal_logging.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 #include "tensorflow/lite/util.h"
@@ -140,6 +142,78 @@ const char* GetTFLiteOpName(const TfLiteRegistration& op_reg) {
   return tflite::EnumNamesBuiltinOperator()[op_reg.builtin_code];
 }
 
+// Returns true if the node may run at the same time as other nodes. Kernels
+// of delegates, control flow and custom operators may share state with other
+// nodes or subgraphs, and always run on their own.
+bool MayRunConcurrently(const TfLiteNode& node,
+                        const TfLiteRegistration& registration) {
+  if (node.delegate != nullptr) {
+    return false;
+  }
+  switch (registration.builtin_code) {
+    case tflite::BuiltinOperator_CUSTOM:
+    case tflite::BuiltinOperator_DELEGATE:
+    case tflite::BuiltinOperator_IF:
+    case tflite::BuiltinOperator_WHILE:
+      return false;
+    default:
+      return true;
+  }
+}
+
+// The maximum number of tasks a concurrent step is split into. Each task needs
+// a CpuBackendContext of its own, with its own ruy and gemmlowp contexts and
+// caches, and graphs rarely have more independent branches than this.
+constexpr int kMaxConcurrentStepTasks = 4;
+
+// Invokes every `stride`-th node of a concurrent step, starting at
+// `first_execution_plan_index`, with a CPU backend context of its own.
+class ConcurrentStepTask : public cpu_backend_threadpool::Task {
+ public:
+  ConcurrentStepTask(Subgraph* subgraph,
+                     const std::vector<int>* execution_plan,
+                     int first_execution_plan_index,
+                     int last_execution_plan_index, int stride,
+                     CpuBackendContext* cpu_backend_context)
+      : subgraph_(subgraph),
+        execution_plan_(execution_plan),
+        first_execution_plan_index_(first_execution_plan_index),
+        last_execution_plan_index_(last_execution_plan_index),
+        stride_(stride),
+        cpu_backend_context_(cpu_backend_context) {}
+
+  void Run() override {
+    CpuBackendContext::ScopedThreadLocalOverride scoped_cpu_backend_context(
+        cpu_backend_context_);
+    for (int i = first_execution_plan_index_; i <= last_execution_plan_index_;
+         i += stride_) {
+      auto& node_and_registration =
+          subgraph_->nodes_and_registration()[(*execution_plan_)[i]];
+      const TfLiteRegistration& registration = node_and_registration.second;
+      if (registration.invoke == nullptr ||
+          registration.invoke(subgraph_->context(),
+                              &node_and_registration.first) != kTfLiteOk) {
+        failed_execution_plan_index_ = i;
+        return;
+      }
+    }
+  }
+
+  // Returns the execution plan index of the node which failed, or -1.
+  int failed_execution_plan_index() const {
+    return failed_execution_plan_index_;
+  }
+
+ private:
+  Subgraph* subgraph_;
+  const std::vector<int>* execution_plan_;
+  int first_execution_plan_index_;
+  int last_execution_plan_index_;
+  int stride_;
+  CpuBackendContext* cpu_backend_context_;
+  int failed_execution_plan_index_ = -1;
+};
+
 }  // namespace
 
 // A trivial implementation of GraphInfo around the Interpreter.
@@ -174,11 +248,32 @@ class InterpreterInfo : public GraphInfo {
   const std::vector<int>& variables() const override {
     return subgraph_->variables();
   }
-
  public:
   Subgraph* subgraph_;
 };
 
+// The graph as the memory planner sees it: nodes in the order Invoke() runs
+// them, which is grouped into concurrent steps if there are any.
+class InvocationInfo : public InterpreterInfo {
+ public:
+  explicit InvocationInfo(Subgraph* subgraph) : InterpreterInfo(subgraph) {}
+
+  size_t num_nodes() const override {
+    return subgraph_->invocation_plan().size();
+  }
+  const TfLiteNode& node(size_t index) const override {
+    int node_index = subgraph_->invocation_plan()[index];
+    return subgraph_->nodes_and_registration()[node_index].first;
+  }
+  size_t node_index(size_t index) const override {
+    return subgraph_->invocation_plan()[index];
+  }
+  size_t last_concurrent_node(size_t index) const override {
+    const std::vector<int>& step_ends = subgraph_->concurrent_step_ends_;
+    return index < step_ends.size() ? step_ends[index] : index;
+  }
+};
+
 Subgraph::Subgraph(ErrorReporter* error_reporter,
                    TfLiteExternalContext** external_contexts,
                    std::vector<std::unique_ptr<Subgraph>>* subgraphs,
@@ -366,6 +461,7 @@ TfLiteStatus Subgraph::ReplaceNodeSubsetsWithDelegateKernels(
       node_subsets.size());
 
   execution_plan_.clear();
+  ClearConcurrentSteps();
 
   for (auto& node_subset : node_subsets) {
     // Subsets claimed by the delegate should have a "macro" op created, the
@@ -730,6 +826,7 @@ TfLiteStatus Subgraph::AddNodeWithParameters(
   // Copying of registration is required to support unresolved custom ops.
   node_and_reg.second = *registration;
   execution_plan_.push_back(new_node_index);
+  ClearConcurrentSteps();
   return kTfLiteOk;
 }
 
@@ -748,6 +845,28 @@ TfLiteStatus Subgraph::ResizeInputTensor(int tensor_index,
                  tensor_index < context_.tensors_size && tensor_index >= 0);
   TfLiteTensor* tensor = &context_.tensors[tensor_index];
 
+  // Round up unknown dimensions to buckets, so that similar shapes share the
+  // same tensor sizes and memory plan.
+  const TfLiteIntArray* dims_signature = tensor->dims_signature;
+  if (!input_shape_buckets_.empty() && dims_signature != nullptr &&
+      dims_signature->size == static_cast<int>(dims.size())) {
+    std::vector<int> bucketed_dims = dims;
+    bool rounded = false;
+    for (size_t idx = 0; idx < dims.size(); idx++) {
+      if (dims_signature->data[idx] != -1) continue;
+      const auto bucket =
+          std::lower_bound(input_shape_buckets_.begin(),
+                           input_shape_buckets_.end(), dims[idx]);
+      if (bucket != input_shape_buckets_.end() && *bucket != dims[idx]) {
+        bucketed_dims[idx] = *bucket;
+        rounded = true;
+      }
+    }
+    if (rounded) {
+      return ResizeInputTensor(tensor_index, bucketed_dims);
+    }
+  }
+
   // Short-circuit the state change if the dimensions don't change, avoiding
   // unnecessary (re)allocations.
   //
@@ -830,13 +949,18 @@ TfLiteStatus Subgraph::PrepareOpsStartingAt(
   if (first_execution_plan_index == 0) {
     has_dynamic_tensors_ = false;
   }
+  const std::vector<int>& execution_plan = invocation_plan();
   for (int execution_plan_index = first_execution_plan_index;
-       execution_plan_index < execution_plan_.size(); execution_plan_index++) {
-    int node_index = execution_plan_[execution_plan_index];
+       execution_plan_index < execution_plan.size(); execution_plan_index++) {
+    int node_index = execution_plan[execution_plan_index];
     TfLiteNode& node = nodes_and_registration_[node_index].first;
     const TfLiteRegistration& registration =
         nodes_and_registration_[node_index].second;
     EnsureTensorsVectorCapacity();
+    // Nodes are prepared again even if the memory planner then reuses a cached
+    // plan for these shapes: Prepare() computes the output shapes the plan is
+    // looked up with, and kernels keep a single shape-dependent OpData per
+    // node which can't be saved and restored per shape.
     if (OpPrepare(registration, &node) != kTfLiteOk) {
       return ReportOpError(&context_, node, registration, node_index,
                            "failed to prepare");
@@ -857,10 +981,16 @@ TfLiteStatus Subgraph::PrepareOpsStartingAt(
 
 TfLiteStatus Subgraph::PrepareOpsAndTensors() {
   if (!memory_planner_) {
-    memory_planner_.reset(new ArenaPlanner(
-        &context_, std::unique_ptr<GraphInfo>(new InterpreterInfo(this)),
+    std::unique_ptr<ArenaPlanner> arena_planner(new ArenaPlanner(
+        &context_, std::unique_ptr<GraphInfo>(new InvocationInfo(this)),
         /*preserve_inputs=*/true, /*preserve_intermediates*/ false,
         kDefaultTensorAlignment));
+    if (!offline_planned_offsets_.empty()) {
+      TF_LITE_ENSURE_STATUS(
+          arena_planner->SetOfflinePlannedOffsets(offline_planned_offsets_));
+    }
+    memory_planner_ = std::move(arena_planner);
+    ScheduleConcurrentSteps();
     memory_planner_->PlanAllocations();
   }
 
@@ -901,18 +1031,37 @@ TfLiteStatus Subgraph::Invoke() {
     applied_nnapi_delegate_ = true;
   }
 
+  // Steps of independent nodes run concurrently, unless tensors are resized
+  // while running, which requires preparing nodes one after another, or
+  // operators are profiled.
+  const bool run_concurrent_steps =
+      HasConcurrentSteps() && !has_dynamic_tensors_ && !profiler_ &&
+      CpuBackendContext::GetFromContext(&context_)->max_num_threads() > 1;
+
   // Invocations are always done in node order.
   // Note that calling Invoke repeatedly will cause the original memory plan to
   // be reused, unless either ResizeInputTensor() or AllocateTensors() has been
   // called.
+  const std::vector<int>& execution_plan = invocation_plan();
   for (int execution_plan_index = 0;
-       execution_plan_index < execution_plan_.size(); execution_plan_index++) {
+       execution_plan_index < execution_plan.size(); execution_plan_index++) {
     if (execution_plan_index == next_execution_plan_index_to_prepare_) {
       TF_LITE_ENSURE_STATUS(PrepareOpsAndTensors());
       TF_LITE_ENSURE(&context_, next_execution_plan_index_to_prepare_ >=
                                     execution_plan_index);
     }
-    int node_index = execution_plan_[execution_plan_index];
+    if (run_concurrent_steps &&
+        concurrent_step_ends_[execution_plan_index] > execution_plan_index) {
+      if (IsCancelled()) {
+        ReportError("Client requested cancel during Invoke()");
+        return kTfLiteError;
+      }
+      TF_LITE_ENSURE_STATUS(InvokeConcurrentStep(
+          execution_plan_index, concurrent_step_ends_[execution_plan_index]));
+      execution_plan_index = concurrent_step_ends_[execution_plan_index];
+      continue;
+    }
+    int node_index = execution_plan[execution_plan_index];
     TfLiteNode& node = nodes_and_registration_[node_index].first;
     const TfLiteRegistration& registration =
         nodes_and_registration_[node_index].second;
@@ -921,21 +1070,7 @@ TfLiteStatus Subgraph::Invoke() {
     if (profiler_) op_name = GetTFLiteOpName(registration);
     TFLITE_SCOPED_TAGGED_OPERATOR_PROFILE(profiler_.get(), op_name, node_index);
 
-    // TODO(ycling): This is an extra loop through inputs to check if the data
-    // need to be copied from Delegate buffer to raw memory, which is often not
-    // needed. We may want to cache this in prepare to know if this needs to be
-    // done for a node or not.
-    for (int i = 0; i < node.inputs->size; ++i) {
-      int tensor_index = node.inputs->data[i];
-      if (tensor_index == kTfLiteOptionalTensor) {
-        continue;
-      }
-      TfLiteTensor* tensor = &tensors_[tensor_index];
-      if (tensor->delegate && tensor->delegate != node.delegate &&
-          tensor->data_is_stale) {
-        TF_LITE_ENSURE_STATUS(EnsureTensorDataIsReadable(tensor_index));
-      }
-    }
+    TF_LITE_ENSURE_STATUS(EnsureInputDataIsReadable(node));
 
     if (check_cancelled_func_ != nullptr &&
         check_cancelled_func_(cancellation_data_)) {
@@ -974,6 +1109,183 @@ TfLiteStatus Subgraph::Invoke() {
   return status;
 }
 
+TfLiteStatus Subgraph::EnsureInputDataIsReadable(const TfLiteNode& node) {
+  // TODO(ycling): This is an extra loop through inputs to check if the data
+  // need to be copied from Delegate buffer to raw memory, which is often not
+  // needed. We may want to cache this in prepare to know if this needs to be
+  // done for a node or not.
+  for (int i = 0; i < node.inputs->size; ++i) {
+    int tensor_index = node.inputs->data[i];
+    if (tensor_index == kTfLiteOptionalTensor) {
+      continue;
+    }
+    TfLiteTensor* tensor = &tensors_[tensor_index];
+    if (tensor->delegate && tensor->delegate != node.delegate &&
+        tensor->data_is_stale) {
+      TF_LITE_ENSURE_STATUS(EnsureTensorDataIsReadable(tensor_index));
+    }
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::InvokeConcurrentStep(int first_execution_plan_index,
+                                            int last_execution_plan_index) {
+  const std::vector<int>& execution_plan = concurrent_execution_plan_;
+  for (int i = first_execution_plan_index; i <= last_execution_plan_index;
+       ++i) {
+    TF_LITE_ENSURE_STATUS(EnsureInputDataIsReadable(
+        nodes_and_registration_[execution_plan[i]].first));
+  }
+  EnsureTensorsVectorCapacity();
+
+  // Each task runs its operators on a single thread, with a context of its
+  // own, and the threads of the interpreter's context are shared by tasks.
+  // A node always runs in the same task, so its prepacked weights are cached
+  // in one context only.
+  CpuBackendContext* cpu_backend_context =
+      CpuBackendContext::GetFromContext(&context_);
+  const int num_tasks =
+      std::min({last_execution_plan_index - first_execution_plan_index + 1,
+                cpu_backend_context->max_num_threads(),
+                kMaxConcurrentStepTasks});
+  while (concurrent_step_contexts_.size() < static_cast<size_t>(num_tasks)) {
+    CpuBackendContext* task_context = new CpuBackendContext;
+    task_context->SetMaxNumThreads(1);
+    task_context->SetUseCaching(cpu_backend_context->use_caching());
+    concurrent_step_contexts_.emplace_back(task_context);
+  }
+  std::vector<ConcurrentStepTask> tasks;
+  tasks.reserve(num_tasks);
+  for (int i = 0; i < num_tasks; ++i) {
+    tasks.emplace_back(
+        this, &execution_plan, first_execution_plan_index + i,
+        last_execution_plan_index, num_tasks,
+        static_cast<CpuBackendContext*>(concurrent_step_contexts_[i].get()));
+  }
+  cpu_backend_threadpool::Execute(num_tasks, tasks.data(),
+                                  cpu_backend_context);
+
+  // Report the first failure in execution plan order.
+  int failed_execution_plan_index = -1;
+  for (const ConcurrentStepTask& task : tasks) {
+    const int index = task.failed_execution_plan_index();
+    if (index >= 0 && (failed_execution_plan_index < 0 ||
+                       index < failed_execution_plan_index)) {
+      failed_execution_plan_index = index;
+    }
+  }
+  if (failed_execution_plan_index >= 0) {
+    const int node_index = execution_plan[failed_execution_plan_index];
+    return ReportOpError(&context_, nodes_and_registration_[node_index].first,
+                         nodes_and_registration_[node_index].second,
+                         node_index, "failed to invoke");
+  }
+  return kTfLiteOk;
+}
+
+void Subgraph::ClearConcurrentSteps() {
+  concurrent_execution_plan_.clear();
+  concurrent_step_ends_.clear();
+}
+
+void Subgraph::ScheduleConcurrentSteps() {
+  ClearConcurrentSteps();
+  if (!inter_op_parallelism_) {
+    return;
+  }
+
+  // A node runs in a later step than the nodes writing its inputs, and than
+  // the nodes reading or writing its outputs. Variable inputs may be updated
+  // in place, and are treated as outputs too. Nodes which can't run
+  // concurrently run alone, after all nodes before them in the plan.
+  std::vector<int> last_write_step(tensors_.size(), -1);
+  std::vector<int> last_read_step(tensors_.size(), -1);
+  const int num_nodes = execution_plan_.size();
+  std::vector<int> steps(num_nodes);
+  int num_steps = 0;
+  int first_open_step = 0;
+  for (int i = 0; i < num_nodes; ++i) {
+    const auto& node_and_registration =
+        nodes_and_registration_[execution_plan_[i]];
+    const TfLiteNode& node = node_and_registration.first;
+    std::vector<int> inputs, outputs;
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index == kTfLiteOptionalTensor) continue;
+      inputs.push_back(tensor_index);
+      if (tensors_[tensor_index].is_variable) outputs.push_back(tensor_index);
+    }
+    for (const TfLiteIntArray* array : {node.outputs, node.intermediates}) {
+      if (array == nullptr) continue;
+      for (int tensor_index : TfLiteIntArrayView(array)) {
+        if (tensor_index != kTfLiteOptionalTensor) {
+          outputs.push_back(tensor_index);
+        }
+      }
+    }
+
+    int step = first_open_step;
+    for (int tensor_index : inputs) {
+      step = std::max(step, last_write_step[tensor_index] + 1);
+    }
+    for (int tensor_index : outputs) {
+      step = std::max({step, last_write_step[tensor_index] + 1,
+                       last_read_step[tensor_index] + 1});
+    }
+    if (!MayRunConcurrently(node, node_and_registration.second)) {
+      step = std::max(step, num_steps);
+      first_open_step = step + 1;
+    }
+    for (int tensor_index : inputs) {
+      last_read_step[tensor_index] =
+          std::max(last_read_step[tensor_index], step);
+    }
+    for (int tensor_index : outputs) {
+      last_write_step[tensor_index] = step;
+    }
+    steps[i] = step;
+    num_steps = std::max(num_steps, step + 1);
+  }
+  if (num_steps == num_nodes) {
+    // No two nodes can run at the same time.
+    return;
+  }
+
+  std::vector<int> order(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&steps](int i, int j) { return steps[i] < steps[j]; });
+  concurrent_execution_plan_.resize(num_nodes);
+  concurrent_step_ends_.resize(num_nodes);
+  for (int i = num_nodes - 1; i >= 0; --i) {
+    concurrent_execution_plan_[i] = execution_plan_[order[i]];
+    concurrent_step_ends_[i] =
+        i + 1 < num_nodes && steps[order[i + 1]] == steps[order[i]]
+            ? concurrent_step_ends_[i + 1]
+            : i;
+  }
+}
+
+TfLiteStatus Subgraph::SetInterOpParallelism(bool enable) {
+  if (inter_op_parallelism_ == enable) {
+    return kTfLiteOk;
+  }
+  if (state_ == kStateInvokableAndImmutable) {
+    ReportError("SetInterOpParallelism is disallowed when graph is immutable.");
+    return kTfLiteError;
+  }
+  inter_op_parallelism_ = enable;
+  if (!enable) {
+    concurrent_step_contexts_.clear();
+  }
+  if (memory_planner_) {
+    // Reschedule nodes and plan tensors again.
+    return EnsureMemoryAllocations();
+  }
+  return kTfLiteOk;
+}
+
 TfLiteStatus Subgraph::ResizeTensor(TfLiteContext* context,
                                     TfLiteTensor* tensor,
                                     TfLiteIntArray* new_size) {
@@ -1181,6 +1493,7 @@ TfLiteStatus Subgraph::SetExecutionPlan(const std::vector<int>& new_plan) {
                                   node_index < nodes_and_registration_.size());
   }
   execution_plan_ = new_plan;
+  ClearConcurrentSteps();
   return kTfLiteOk;
 }
 
@@ -1284,6 +1597,7 @@ TfLiteStatus Subgraph::UndoAllDelegates() {
   // Reset execution plan.
   execution_plan_ = pre_delegation_execution_plan_;
   pre_delegation_execution_plan_.clear();
+  ClearConcurrentSteps();
 
   // Delegate nodes are appended to nodes_and_registration_. Therefore,
   // cleanup nodes_and_registration_ to only contain nodes from
@@ -1341,6 +1655,7 @@ void Subgraph::EnsureTensorsVectorCapacity() {
 TfLiteStatus Subgraph::EnsureMemoryAllocations() {
   if (memory_planner_) {
     state_ = kStateUninvokable;
+    ScheduleConcurrentSteps();
     TF_LITE_ENSURE_OK(&context_, memory_planner_->PlanAllocations());
   }
   TF_LITE_ENSURE_OK(&context_, AllocateTensors());
@@ -18,6 +18,7 @@ limitations under the License.
 #include <cstdint>
 #include <cstdlib>
 #include <map>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -27,6 +28,7 @@ limitations under the License.
 #include "tensorflow/lite/core/macros.h"
 #include "tensorflow/lite/delegates/nnapi/nnapi_delegate.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/memory_planner.h"
 #include "tensorflow/lite/util.h"
 
@@ -44,6 +46,8 @@ class NNAPIDelegate;
 class Subgraph {
  public:
   friend class Interpreter;
+  friend class InterpreterInfo;
+  friend class InvocationInfo;
 
   Subgraph(ErrorReporter* error_reporter,
            TfLiteExternalContext** external_contexts,
@@ -231,6 +235,36 @@ class Subgraph {
   TfLiteStatus ResizeInputTensorStrict(int tensor_index,
                                        const std::vector<int>& dims);
 
+  // WARNING: Experimental interface, subject to change
+  // Makes subsequent calls to ResizeInputTensor() round up unknown dimensions
+  // (`-1` in `dims_signature`) to the smallest of `buckets` that fits them.
+  // `buckets` must be sorted in increasing order; dimensions larger than the
+  // last bucket are left as is. Inputs of shapes within the same buckets then
+  // share the tensor sizes, and thus the memory plan, and resizing between them
+  // doesn't require another AllocateTensors(). The caller is responsible for
+  // padding input data to the rounded shape, which can be read from the tensor.
+  // An empty `buckets` disables rounding.
+  void SetInputShapeBuckets(const std::vector<int>& buckets) {
+    input_shape_buckets_ = buckets;
+  }
+
+  // WARNING: This is an experimental API and subject to change.
+  // Sets arena offsets of non-persistent tensors computed offline, indexed by
+  // tensor, with -1 for tensors planned at runtime. Must be called before the
+  // first AllocateTensors(). Offsets which don't fit the tensors at runtime,
+  // e.g. after resizing inputs, are ignored in favor of runtime planning.
+  void SetOfflinePlannedOffsets(std::vector<int32_t> offsets) {
+    offline_planned_offsets_ = std::move(offsets);
+  }
+
+  // WARNING: This is an experimental API and subject to change.
+  // Enables running nodes which don't depend on each other concurrently, on
+  // the threads of the CPU backend context. Nodes are run in steps of
+  // independent nodes, and tensors used by nodes of the same step never share
+  // memory. The execution plan itself is left as is. If tensors were
+  // allocated, they are planned and allocated again.
+  TfLiteStatus SetInterOpParallelism(bool enable);
+
   // This releases memory held by non-persistent tensors. It does NOT re-perform
   // memory planning.
   // AllocateTensors needs to be called before next invocation.
@@ -572,6 +606,36 @@ class Subgraph {
   // Ensures the memory required is planned and allocated.
   TfLiteStatus EnsureMemoryAllocations();
 
+  // Groups the nodes of the execution plan into steps of nodes which don't
+  // depend on each other, if inter-op parallelism is enabled, into a copy of
+  // the plan in which the nodes of each step are contiguous. Called before
+  // the memory planner plans allocations.
+  void ScheduleConcurrentSteps();
+
+  // Drops the steps, e.g. because the execution plan they were made from
+  // changed.
+  void ClearConcurrentSteps();
+
+  // Returns true if the execution plan is grouped into steps.
+  bool HasConcurrentSteps() const {
+    return !concurrent_execution_plan_.empty();
+  }
+
+  // Returns the node indices in the order Invoke() runs them and the memory
+  // planner plans them: grouped into steps if there are any, otherwise the
+  // execution plan.
+  const std::vector<int>& invocation_plan() const {
+    return HasConcurrentSteps() ? concurrent_execution_plan_ : execution_plan_;
+  }
+
+  // Invokes the nodes of the invocation plan from `first_execution_plan_index`
+  // to `last_execution_plan_index` concurrently.
+  TfLiteStatus InvokeConcurrentStep(int first_execution_plan_index,
+                                    int last_execution_plan_index);
+
+  // Copies data of the node's inputs from delegate buffers if they are stale.
+  TfLiteStatus EnsureInputDataIsReadable(const TfLiteNode& node);
+
   // Returns true if cancellation function returns true.
   bool IsCancelled();
 
@@ -691,6 +755,26 @@ class Subgraph {
   // The value is invalid before `PrepareOpStartingAt` is called.
   bool has_dynamic_tensors_ = true;
 
+  // Sizes that unknown input dimensions are rounded up to by
+  // `ResizeInputTensor`, see `SetInputShapeBuckets`.
+  std::vector<int> input_shape_buckets_;
+
+  // Arena offsets of tensors planned offline, see `SetOfflinePlannedOffsets`.
+  std::vector<int32_t> offline_planned_offsets_;
+
+  // Whether independent nodes run concurrently, see `SetInterOpParallelism`.
+  bool inter_op_parallelism_ = false;
+
+  // The execution plan reordered into concurrent steps, and for each of its
+  // nodes, the index of the last node of its step. Both are empty if nodes
+  // run one at a time.
+  std::vector<int> concurrent_execution_plan_;
+  std::vector<int> concurrent_step_ends_;
+
+  // CPU backend contexts of the tasks running the nodes of a concurrent step.
+  std::vector<std::unique_ptr<TfLiteInternalBackendContext>>
+      concurrent_step_contexts_;
+
   // Reference to cancellation function that can cancel a request in the middle
   // of a call to Invoke(). When this function returns True, a kTfLiteError is
   // thrown by Invoke().
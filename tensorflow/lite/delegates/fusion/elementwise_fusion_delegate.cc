@@ -0,0 +1,618 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/delegates/fusion/elementwise_fusion_delegate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/context_util.h"
+#include "tensorflow/lite/kernels/internal/cppmath.h"
+#include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+
+namespace tflite {
+namespace fusion {
+namespace {
+
+// Number of elements processed by all fused operators at once. Blocks of
+// intermediate values stay in L1 cache from one operator to the next.
+constexpr int kBlockSize = 256;
+
+enum class OpType {
+  kAdd,
+  kSub,
+  kMul,
+  kRelu,
+  kRelu6,
+  kReluN1To1,
+  kTanh,
+  kLogistic,
+  // QUANTIZE and DEQUANTIZE, whose conversions happen on load and store.
+  kCopy,
+};
+
+struct QuantizationParams {
+  TfLiteType type = kTfLiteFloat32;
+  float scale = 1.0f;
+  int32_t zero_point = 0;
+};
+
+struct FusedOp {
+  OpType type;
+  int inputs[2] = {-1, -1};
+  int output;
+  // Fused activation of ADD, SUB and MUL.
+  float activation_min = -std::numeric_limits<float>::infinity();
+  float activation_max = std::numeric_limits<float>::infinity();
+  // Quantization of the output, which intermediate values are rounded to.
+  QuantizationParams output_params;
+};
+
+bool IsSupportedTensor(const TfLiteTensor& tensor) {
+  switch (tensor.type) {
+    case kTfLiteFloat32:
+      return true;
+    case kTfLiteInt8:
+    case kTfLiteUInt8: {
+      if (tensor.quantization.type != kTfLiteAffineQuantization ||
+          tensor.params.scale <= 0.0f) {
+        return false;
+      }
+      const auto* affine_quantization =
+          reinterpret_cast<const TfLiteAffineQuantization*>(
+              tensor.quantization.params);
+      return affine_quantization != nullptr &&
+             affine_quantization->scale != nullptr &&
+             affine_quantization->scale->size == 1;
+    }
+    default:
+      return false;
+  }
+}
+
+QuantizationParams GetQuantizationParams(const TfLiteTensor& tensor) {
+  QuantizationParams params;
+  params.type = tensor.type;
+  if (tensor.type != kTfLiteFloat32) {
+    params.scale = tensor.params.scale;
+    params.zero_point = tensor.params.zero_point;
+  }
+  return params;
+}
+
+bool GetActivationRange(TfLiteFusedActivation activation, float* min,
+                        float* max) {
+  switch (activation) {
+    case kTfLiteActNone:
+      return true;
+    case kTfLiteActRelu:
+      *min = 0.0f;
+      return true;
+    case kTfLiteActReluN1To1:
+      *min = -1.0f;
+      *max = 1.0f;
+      return true;
+    case kTfLiteActRelu6:
+      *min = 0.0f;
+      *max = 6.0f;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Fills `op` from the node, or returns false if the node can't be fused.
+bool CreateFusedOp(const TfLiteContext* context,
+                   const TfLiteRegistration* registration,
+                   const TfLiteNode* node, FusedOp* op) {
+  TfLiteFusedActivation activation = kTfLiteActNone;
+  int num_inputs = 1;
+  switch (registration->builtin_code) {
+    case kTfLiteBuiltinAdd:
+      op->type = OpType::kAdd;
+      activation =
+          reinterpret_cast<const TfLiteAddParams*>(node->builtin_data)
+              ->activation;
+      num_inputs = 2;
+      break;
+    case kTfLiteBuiltinSub:
+      op->type = OpType::kSub;
+      activation =
+          reinterpret_cast<const TfLiteSubParams*>(node->builtin_data)
+              ->activation;
+      num_inputs = 2;
+      break;
+    case kTfLiteBuiltinMul:
+      op->type = OpType::kMul;
+      activation =
+          reinterpret_cast<const TfLiteMulParams*>(node->builtin_data)
+              ->activation;
+      num_inputs = 2;
+      break;
+    case kTfLiteBuiltinRelu:
+      op->type = OpType::kRelu;
+      break;
+    case kTfLiteBuiltinRelu6:
+      op->type = OpType::kRelu6;
+      break;
+    case kTfLiteBuiltinReluN1To1:
+      op->type = OpType::kReluN1To1;
+      break;
+    case kTfLiteBuiltinTanh:
+      op->type = OpType::kTanh;
+      break;
+    case kTfLiteBuiltinLogistic:
+      op->type = OpType::kLogistic;
+      break;
+    case kTfLiteBuiltinQuantize:
+    case kTfLiteBuiltinDequantize:
+      op->type = OpType::kCopy;
+      break;
+    default:
+      return false;
+  }
+  if (node->inputs->size != num_inputs || node->outputs->size != 1 ||
+      !GetActivationRange(activation, &op->activation_min,
+                          &op->activation_max)) {
+    return false;
+  }
+
+  const TfLiteTensor& output = context->tensors[node->outputs->data[0]];
+  if (!IsSupportedTensor(output)) {
+    return false;
+  }
+  op->output = node->outputs->data[0];
+  op->output_params = GetQuantizationParams(output);
+  for (int i = 0; i < num_inputs; ++i) {
+    const int tensor_index = node->inputs->data[i];
+    if (tensor_index == kTfLiteOptionalTensor) {
+      return false;
+    }
+    const TfLiteTensor& input = context->tensors[tensor_index];
+    if (!IsSupportedTensor(input) ||
+        (op->type != OpType::kCopy && input.type != output.type)) {
+      return false;
+    }
+    op->inputs[i] = tensor_index;
+  }
+
+  if (num_inputs == 2) {
+    // Only single-element constants are broadcast, so that all non-constant
+    // tensors connected by fused operators have the same number of elements.
+    const TfLiteTensor& input1 = context->tensors[op->inputs[0]];
+    const TfLiteTensor& input2 = context->tensors[op->inputs[1]];
+    if (!HaveSameShapes(&input1, &input2) &&
+        !(NumElements(&input1) == 1 && IsConstantTensor(&input1)) &&
+        !(NumElements(&input2) == 1 && IsConstantTensor(&input2))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+void Dequantize(const T* input, int n, const QuantizationParams& params,
+                float* output) {
+  for (int i = 0; i < n; ++i) {
+    output[i] =
+        (static_cast<int32_t>(input[i]) - params.zero_point) * params.scale;
+  }
+}
+
+template <typename T>
+void Quantize(const float* input, int n, const QuantizationParams& params,
+              T* output) {
+  const int32_t min = std::numeric_limits<T>::min();
+  const int32_t max = std::numeric_limits<T>::max();
+  for (int i = 0; i < n; ++i) {
+    const int32_t value =
+        static_cast<int32_t>(TfLiteRound(input[i] / params.scale)) +
+        params.zero_point;
+    output[i] = static_cast<T>(std::min(max, std::max(min, value)));
+  }
+}
+
+// Rounds values to the nearest values representable in the given quantization.
+template <typename T>
+void RoundToQuantized(int n, const QuantizationParams& params, float* values) {
+  const float min = std::numeric_limits<T>::min();
+  const float max = std::numeric_limits<T>::max();
+  for (int i = 0; i < n; ++i) {
+    const float value = std::min(
+        max, std::max(min, TfLiteRound(values[i] / params.scale) +
+                               params.zero_point));
+    values[i] = (value - params.zero_point) * params.scale;
+  }
+}
+
+void Load(const TfLiteTensor& tensor, int64_t start, int n, float* output) {
+  const QuantizationParams params = GetQuantizationParams(tensor);
+  switch (tensor.type) {
+    case kTfLiteFloat32:
+      std::copy_n(GetTensorData<float>(&tensor) + start, n, output);
+      break;
+    case kTfLiteInt8:
+      Dequantize(GetTensorData<int8_t>(&tensor) + start, n, params, output);
+      break;
+    case kTfLiteUInt8:
+      Dequantize(GetTensorData<uint8_t>(&tensor) + start, n, params, output);
+      break;
+    default:
+      break;
+  }
+}
+
+void Store(const float* input, int64_t start, int n, TfLiteTensor* tensor) {
+  const QuantizationParams params = GetQuantizationParams(*tensor);
+  switch (tensor->type) {
+    case kTfLiteFloat32:
+      std::copy_n(input, n, GetTensorData<float>(tensor) + start);
+      break;
+    case kTfLiteInt8:
+      Quantize(input, n, params, GetTensorData<int8_t>(tensor) + start);
+      break;
+    case kTfLiteUInt8:
+      Quantize(input, n, params, GetTensorData<uint8_t>(tensor) + start);
+      break;
+    default:
+      break;
+  }
+}
+
+// Computes `n` elements of the operator's output.
+void Compute(const FusedOp& op, int n, const float* input1,
+             const float* input2, float* output) {
+  switch (op.type) {
+    case OpType::kAdd:
+      for (int i = 0; i < n; ++i) output[i] = input1[i] + input2[i];
+      break;
+    case OpType::kSub:
+      for (int i = 0; i < n; ++i) output[i] = input1[i] - input2[i];
+      break;
+    case OpType::kMul:
+      for (int i = 0; i < n; ++i) output[i] = input1[i] * input2[i];
+      break;
+    case OpType::kRelu:
+      for (int i = 0; i < n; ++i) output[i] = std::max(0.0f, input1[i]);
+      break;
+    case OpType::kRelu6:
+      for (int i = 0; i < n; ++i) {
+        output[i] = std::min(6.0f, std::max(0.0f, input1[i]));
+      }
+      break;
+    case OpType::kReluN1To1:
+      for (int i = 0; i < n; ++i) {
+        output[i] = std::min(1.0f, std::max(-1.0f, input1[i]));
+      }
+      break;
+    case OpType::kTanh:
+      for (int i = 0; i < n; ++i) output[i] = std::tanh(input1[i]);
+      break;
+    case OpType::kLogistic:
+      for (int i = 0; i < n; ++i) {
+        output[i] = 1.0f / (1.0f + std::exp(-input1[i]));
+      }
+      break;
+    case OpType::kCopy:
+      std::copy_n(input1, n, output);
+      break;
+  }
+  if (op.activation_min != -std::numeric_limits<float>::infinity() ||
+      op.activation_max != std::numeric_limits<float>::infinity()) {
+    for (int i = 0; i < n; ++i) {
+      output[i] =
+          std::min(op.activation_max, std::max(op.activation_min, output[i]));
+    }
+  }
+  switch (op.output_params.type) {
+    case kTfLiteInt8:
+      RoundToQuantized<int8_t>(n, op.output_params, output);
+      break;
+    case kTfLiteUInt8:
+      RoundToQuantized<uint8_t>(n, op.output_params, output);
+      break;
+    default:
+      break;
+  }
+}
+
+// Computes a partition of fused elementwise operators.
+class ElementwiseFusionKernel : public SimpleDelegateKernelInterface {
+ public:
+  TfLiteStatus Init(TfLiteContext* context,
+                    const TfLiteDelegateParams* params) override {
+    for (int node_index : TfLiteIntArrayView(params->nodes_to_replace)) {
+      TfLiteNode* node;
+      TfLiteRegistration* registration;
+      TF_LITE_ENSURE_STATUS(context->GetNodeAndRegistration(
+          context, node_index, &node, &registration));
+      FusedOp op;
+      TF_LITE_ENSURE(context,
+                     CreateFusedOp(context, registration, node, &op));
+      ops_.push_back(op);
+    }
+    for (int tensor_index : TfLiteIntArrayView(params->output_tensors)) {
+      outputs_.insert(tensor_index);
+    }
+    return kTfLiteOk;
+  }
+
+  TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) override {
+    folded_.clear();
+    folded_outputs_.clear();
+    folded_outputs_stored_ = false;
+    groups_.clear();
+    num_slots_ = 0;
+    scratch_.clear();
+
+    // Shapes of operator outputs, which aren't all tensors of the graph
+    // anymore.
+    std::unordered_map<int, const TfLiteIntArray*> dims;
+    auto get_dims = [&](int tensor_index) {
+      const auto it = dims.find(tensor_index);
+      return it != dims.end() ? it->second
+                              : context->tensors[tensor_index].dims;
+    };
+    auto is_constant = [&](int tensor_index) {
+      return folded_.count(tensor_index) != 0 ||
+             IsConstantTensor(&context->tensors[tensor_index]);
+    };
+
+    for (int i = 0; i < static_cast<int>(ops_.size()); ++i) {
+      const FusedOp& op = ops_[i];
+      const TfLiteIntArray* op_dims = get_dims(op.inputs[0]);
+      bool constant = is_constant(op.inputs[0]);
+      if (op.inputs[1] >= 0) {
+        const TfLiteIntArray* dims2 = get_dims(op.inputs[1]);
+        const bool broadcast1 = NumElements(op_dims) == 1;
+        const bool broadcast2 = NumElements(dims2) == 1;
+        TF_LITE_ENSURE(context, TfLiteIntArrayEqual(op_dims, dims2) ||
+                                    (broadcast1 && is_constant(op.inputs[0])) ||
+                                    (broadcast2 && is_constant(op.inputs[1])));
+        if (broadcast1 && !broadcast2) {
+          op_dims = dims2;
+        }
+        constant = constant && is_constant(op.inputs[1]);
+      }
+      dims[op.output] = op_dims;
+
+      if (outputs_.count(op.output) != 0) {
+        TfLiteTensor* output = &context->tensors[op.output];
+        if (constant) {
+          // Folded outputs are stored once, and must not be overwritten.
+          output->allocation_type = kTfLiteArenaRwPersistent;
+          folded_outputs_.push_back(op.output);
+        }
+        TF_LITE_ENSURE_STATUS(context->ResizeTensor(
+            context, output, TfLiteIntArrayCopy(op_dims)));
+      }
+      if (constant) {
+        TF_LITE_ENSURE_STATUS(Fold(context, op, NumElements(op_dims)));
+      } else {
+        AddToGroup(context, i, NumElements(op_dims));
+      }
+    }
+    return kTfLiteOk;
+  }
+
+  TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) override {
+    if (!folded_outputs_stored_) {
+      for (int tensor_index : folded_outputs_) {
+        const std::vector<float>& values = folded_[tensor_index];
+        Store(values.data(), 0, values.size(), &context->tensors[tensor_index]);
+      }
+      folded_outputs_stored_ = true;
+    }
+
+    for (const Group& group : groups_) {
+      for (const Operand& operand : group.broadcasts) {
+        float value;
+        LoadOperand(context, operand, 0, 1, &value);
+        std::fill_n(Slot(operand.slot), kBlockSize, value);
+      }
+      for (int64_t start = 0; start < group.size; start += kBlockSize) {
+        const int n = std::min<int64_t>(kBlockSize, group.size - start);
+        for (const Operand& operand : group.loads) {
+          LoadOperand(context, operand, start, n, Slot(operand.slot));
+        }
+        for (const GroupOp& group_op : group.ops) {
+          Compute(ops_[group_op.op], n, Slot(group_op.input_slots[0]),
+                  Slot(group_op.input_slots[1]), Slot(group_op.output_slot));
+        }
+        for (const Operand& operand : group.stores) {
+          Store(Slot(operand.slot), start, n,
+                &context->tensors[operand.tensor]);
+        }
+      }
+    }
+    return kTfLiteOk;
+  }
+
+ private:
+  // A tensor read or written by a group, held in a slot of the scratch buffer.
+  struct Operand {
+    int tensor;
+    int slot;
+  };
+
+  struct GroupOp {
+    int op;
+    int input_slots[2];
+    int output_slot;
+  };
+
+  // Non-constant operators whose outputs have the same number of elements,
+  // computed together block by block. Operators connected by a tensor always
+  // belong to the same group.
+  struct Group {
+    int64_t size;
+    std::vector<GroupOp> ops;
+    // Inputs loaded for each block, and single-element inputs loaded once.
+    std::vector<Operand> loads;
+    std::vector<Operand> broadcasts;
+    // Outputs of the partition, stored for each block.
+    std::vector<Operand> stores;
+    // Slots of the tensors used by the group.
+    std::unordered_map<int, int> slots;
+  };
+
+  float* Slot(int slot) {
+    return slot < 0 ? nullptr : scratch_.data() + slot * kBlockSize;
+  }
+
+  void LoadOperand(TfLiteContext* context, const Operand& operand,
+                   int64_t start, int n, float* output) {
+    const auto it = folded_.find(operand.tensor);
+    if (it != folded_.end()) {
+      std::copy_n(it->second.data() + start, n, output);
+    } else {
+      Load(context->tensors[operand.tensor], start, n, output);
+    }
+  }
+
+  int64_t InputSize(TfLiteContext* context, int tensor_index) {
+    const auto it = folded_.find(tensor_index);
+    return it != folded_.end() ? it->second.size()
+                               : NumElements(&context->tensors[tensor_index]);
+  }
+
+  // Computes the output of an operator with constant inputs.
+  TfLiteStatus Fold(TfLiteContext* context, const FusedOp& op, int64_t size) {
+    std::vector<float> inputs[2];
+    for (int i = 0; i < 2 && op.inputs[i] >= 0; ++i) {
+      const int64_t input_size = InputSize(context, op.inputs[i]);
+      inputs[i].resize(size);
+      if (input_size == size) {
+        LoadOperand(context, {op.inputs[i], -1}, 0, size, inputs[i].data());
+      } else {
+        TF_LITE_ENSURE_EQ(context, input_size, 1);
+        float value;
+        LoadOperand(context, {op.inputs[i], -1}, 0, 1, &value);
+        std::fill(inputs[i].begin(), inputs[i].end(), value);
+      }
+    }
+    std::vector<float>& output = folded_[op.output];
+    output.resize(size);
+    Compute(op, size, inputs[0].data(),
+            op.inputs[1] >= 0 ? inputs[1].data() : nullptr, output.data());
+    return kTfLiteOk;
+  }
+
+  void AddToGroup(TfLiteContext* context, int op_index, int64_t size) {
+    auto group =
+        std::find_if(groups_.begin(), groups_.end(),
+                     [size](const Group& g) { return g.size == size; });
+    if (group == groups_.end()) {
+      groups_.emplace_back();
+      group = groups_.end() - 1;
+      group->size = size;
+    }
+    auto get_slot = [&](int tensor_index) {
+      const auto it = group->slots.find(tensor_index);
+      if (it != group->slots.end()) {
+        return it->second;
+      }
+      const int slot = num_slots_++;
+      scratch_.resize(num_slots_ * kBlockSize);
+      group->slots[tensor_index] = slot;
+      return slot;
+    };
+
+    const FusedOp& op = ops_[op_index];
+    GroupOp group_op = {op_index, {-1, -1}, -1};
+    for (int i = 0; i < 2 && op.inputs[i] >= 0; ++i) {
+      const bool is_new = group->slots.count(op.inputs[i]) == 0;
+      group_op.input_slots[i] = get_slot(op.inputs[i]);
+      if (is_new) {
+        const int64_t input_size = InputSize(context, op.inputs[i]);
+        const Operand operand = {op.inputs[i], group_op.input_slots[i]};
+        if (input_size == 1 && size != 1) {
+          group->broadcasts.push_back(operand);
+        } else {
+          group->loads.push_back(operand);
+        }
+      }
+    }
+    group_op.output_slot = get_slot(op.output);
+    group->ops.push_back(group_op);
+    if (outputs_.count(op.output) != 0) {
+      group->stores.push_back({op.output, group_op.output_slot});
+    }
+  }
+
+  std::vector<FusedOp> ops_;
+  // Tensors used outside of the partition.
+  std::unordered_set<int> outputs_;
+
+  // Values of constant operator outputs, and those of them used outside of
+  // the partition, which are stored on the first invocation.
+  std::unordered_map<int, std::vector<float>> folded_;
+  std::vector<int> folded_outputs_;
+  bool folded_outputs_stored_ = false;
+
+  std::vector<Group> groups_;
+  int num_slots_ = 0;
+  std::vector<float> scratch_;
+};
+
+class ElementwiseFusionDelegate : public SimpleDelegateInterface {
+ public:
+  bool IsNodeSupportedByDelegate(const TfLiteRegistration* registration,
+                                 const TfLiteNode* node,
+                                 TfLiteContext* context) const override {
+    FusedOp op;
+    return CreateFusedOp(context, registration, node, &op);
+  }
+
+  TfLiteStatus Initialize(TfLiteContext* context) override { return kTfLiteOk; }
+
+  const char* Name() const override {
+    static constexpr char kName[] = "ElementwiseFusionDelegate";
+    return kName;
+  }
+
+  std::unique_ptr<SimpleDelegateKernelInterface> CreateDelegateKernelInterface()
+      override {
+    return std::unique_ptr<SimpleDelegateKernelInterface>(
+        new ElementwiseFusionKernel());
+  }
+
+  SimpleDelegateInterface::Options DelegateOptions() const override {
+    SimpleDelegateInterface::Options options;
+    // Single operators are better served by the builtin kernels.
+    options.min_nodes_per_partition = 2;
+    return options;
+  }
+};
+
+}  // namespace
+
+TfLiteDelegateUniquePtr CreateElementwiseFusionDelegate() {
+  return TfLiteDelegateFactory::Create(std::unique_ptr<SimpleDelegateInterface>(
+      new ElementwiseFusionDelegate()));
+}
+
+}  // namespace fusion
+}  // namespace tflite
@@ -0,0 +1,49 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_DELEGATES_FUSION_ELEMENTWISE_FUSION_DELEGATE_H_
+#define TENSORFLOW_LITE_DELEGATES_FUSION_ELEMENTWISE_FUSION_DELEGATE_H_
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/delegates/utils/simple_delegate.h"
+
+namespace tflite {
+namespace fusion {
+
+// Creates a delegate which fuses adjacent elementwise operators into single
+// kernels, applied with Interpreter::ModifyGraphWithDelegate() after the
+// model is loaded.
+//
+// Supported operators are ADD, SUB and MUL (without broadcasting, except for
+// single-element constants), RELU, RELU6, RELU_N1_TO_1, TANH, LOGISTIC,
+// QUANTIZE and DEQUANTIZE, on float32, int8 and uint8 tensors. Each partition
+// of at least two such operators is computed by a single kernel, which loops
+// over blocks of elements and applies all of the operators to a block while it
+// is in cache, rather than traversing each intermediate tensor in memory.
+// Intermediate tensors only used inside a partition are never materialized.
+//
+// Quantized tensors are dequantized when loaded and quantized when stored.
+// Intermediate quantized tensors are rounded to their quantized values, so the
+// results match the unfused quantized kernels to within rounding of the
+// fixed-point arithmetic those use.
+//
+// Operators whose inputs are all constant are evaluated once, on the first
+// invocation after tensors are allocated, and their outputs are kept in the
+// persistent arena.
+TfLiteDelegateUniquePtr CreateElementwiseFusionDelegate();
+
+}  // namespace fusion
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_DELEGATES_FUSION_ELEMENTWISE_FUSION_DELEGATE_H_
@@ -0,0 +1,225 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/delegates/fusion/elementwise_fusion_delegate.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/builtin_op_kernels.h"
+#include "tensorflow/lite/testing/util.h"
+
+namespace tflite {
+namespace fusion {
+namespace {
+
+constexpr int kNumElements = 1000;
+
+template <typename T>
+T* MallocParams(TfLiteFusedActivation activation) {
+  T* params = reinterpret_cast<T*>(malloc(sizeof(T)));
+  params->activation = activation;
+  return params;
+}
+
+// Builds interpreters for a model, with and without fusion, and compares
+// their outputs.
+class ElementwiseFusionTest : public ::testing::Test {
+ protected:
+  // Applies the delegate to the second interpreter, checks that it is left
+  // with `num_fused_nodes` nodes, and allocates tensors of both.
+  void Fuse(int num_fused_nodes) {
+    ASSERT_EQ(fused_->ModifyGraphWithDelegate(delegate_.get()), kTfLiteOk);
+    EXPECT_EQ(fused_->execution_plan().size(), num_fused_nodes);
+    ASSERT_EQ(reference_->AllocateTensors(), kTfLiteOk);
+    ASSERT_EQ(fused_->AllocateTensors(), kTfLiteOk);
+  }
+
+  template <typename T>
+  void SetInput(const std::vector<T>& values) {
+    for (Interpreter* interpreter : {reference_.get(), fused_.get()}) {
+      std::copy(values.begin(), values.end(),
+                interpreter->typed_input_tensor<T>(0));
+    }
+  }
+
+  // Invokes both interpreters twice and checks that outputs differ by at most
+  // `tolerance`.
+  template <typename T>
+  void CheckOutputs(float tolerance) {
+    for (int i = 0; i < 2; ++i) {
+      ASSERT_EQ(reference_->Invoke(), kTfLiteOk);
+      ASSERT_EQ(fused_->Invoke(), kTfLiteOk);
+      for (int output = 0; output < reference_->outputs().size(); ++output) {
+        const T* expected = reference_->typed_output_tensor<T>(output);
+        const T* actual = fused_->typed_output_tensor<T>(output);
+        for (int j = 0; j < kNumElements; ++j) {
+          ASSERT_NEAR(expected[j], actual[j], tolerance)
+              << "output " << output << " element " << j;
+        }
+      }
+    }
+  }
+
+  std::unique_ptr<Interpreter> reference_{new Interpreter};
+  std::unique_ptr<Interpreter> fused_{new Interpreter};
+  TfLiteDelegateUniquePtr delegate_ = CreateElementwiseFusionDelegate();
+};
+
+TEST_F(ElementwiseFusionTest, FloatChain) {
+  // output = relu6(tanh(input + 0.5) * input)
+  static const float kHalf = 0.5f;
+  for (Interpreter* interpreter : {reference_.get(), fused_.get()}) {
+    interpreter->AddTensors(5);
+    interpreter->SetInputs({0});
+    interpreter->SetOutputs({4});
+    TfLiteQuantizationParams quant;
+    for (int i : {0, 2, 3, 4}) {
+      interpreter->SetTensorParametersReadWrite(i, kTfLiteFloat32, "",
+                                                {1, kNumElements}, quant);
+    }
+    interpreter->SetTensorParametersReadOnly(
+        1, kTfLiteFloat32, "half", {1}, quant,
+        reinterpret_cast<const char*>(&kHalf), sizeof(kHalf));
+    interpreter->AddNodeWithParameters(
+        {0, 1}, {2}, nullptr, 0, MallocParams<TfLiteAddParams>(kTfLiteActNone),
+        ops::builtin::Register_ADD());
+    interpreter->AddNodeWithParameters({2}, {3}, nullptr, 0, nullptr,
+                                       ops::builtin::Register_TANH());
+    interpreter->AddNodeWithParameters(
+        {3, 0}, {4}, nullptr, 0, MallocParams<TfLiteMulParams>(kTfLiteActRelu6),
+        ops::builtin::Register_MUL());
+  }
+  Fuse(/*num_fused_nodes=*/1);
+
+  std::vector<float> input(kNumElements);
+  for (int i = 0; i < kNumElements; ++i) {
+    input[i] = (i - kNumElements / 2) / 100.0f;
+  }
+  SetInput(input);
+  CheckOutputs<float>(1e-5f);
+}
+
+TEST_F(ElementwiseFusionTest, ConstantFolding) {
+  // folded = relu(a + b), output = folded * input
+  static std::vector<float> a(kNumElements), b(kNumElements);
+  for (int i = 0; i < kNumElements; ++i) {
+    a[i] = i * 0.01f - 3.0f;
+    b[i] = 1.0f;
+  }
+  for (Interpreter* interpreter : {reference_.get(), fused_.get()}) {
+    interpreter->AddTensors(6);
+    interpreter->SetInputs({0});
+    interpreter->SetOutputs({4, 5});
+    TfLiteQuantizationParams quant;
+    for (int i : {0, 3, 4, 5}) {
+      interpreter->SetTensorParametersReadWrite(i, kTfLiteFloat32, "",
+                                                {kNumElements}, quant);
+    }
+    interpreter->SetTensorParametersReadOnly(
+        1, kTfLiteFloat32, "a", {kNumElements}, quant,
+        reinterpret_cast<const char*>(a.data()), a.size() * sizeof(float));
+    interpreter->SetTensorParametersReadOnly(
+        2, kTfLiteFloat32, "b", {kNumElements}, quant,
+        reinterpret_cast<const char*>(b.data()), b.size() * sizeof(float));
+    interpreter->AddNodeWithParameters(
+        {1, 2}, {3}, nullptr, 0, MallocParams<TfLiteAddParams>(kTfLiteActNone),
+        ops::builtin::Register_ADD());
+    interpreter->AddNodeWithParameters({3}, {4}, nullptr, 0, nullptr,
+                                       ops::builtin::Register_RELU());
+    interpreter->AddNodeWithParameters(
+        {4, 0}, {5}, nullptr, 0, MallocParams<TfLiteMulParams>(kTfLiteActNone),
+        ops::builtin::Register_MUL());
+  }
+  Fuse(/*num_fused_nodes=*/1);
+  // The folded output is computed once and kept.
+  EXPECT_EQ(fused_->tensor(4)->allocation_type, kTfLiteArenaRwPersistent);
+
+  std::vector<float> input(kNumElements);
+  for (int i = 0; i < kNumElements; ++i) {
+    input[i] = i % 7 - 3.0f;
+  }
+  SetInput(input);
+  CheckOutputs<float>(1e-6f);
+}
+
+TEST_F(ElementwiseFusionTest, QuantizedChain) {
+  // output = logistic(input + input), with int8 tensors.
+  for (Interpreter* interpreter : {reference_.get(), fused_.get()}) {
+    interpreter->AddTensors(3);
+    interpreter->SetInputs({0});
+    interpreter->SetOutputs({2});
+    const TfLiteQuantizationParams input_quant = {0.05f, 0};
+    const TfLiteQuantizationParams sum_quant = {0.1f, -10};
+    // LOGISTIC requires this output quantization.
+    const TfLiteQuantizationParams output_quant = {1.0f / 256, -128};
+    interpreter->SetTensorParametersReadWrite(0, kTfLiteInt8, "input",
+                                              {kNumElements}, input_quant);
+    interpreter->SetTensorParametersReadWrite(1, kTfLiteInt8, "sum",
+                                              {kNumElements}, sum_quant);
+    interpreter->SetTensorParametersReadWrite(2, kTfLiteInt8, "output",
+                                              {kNumElements}, output_quant);
+    interpreter->AddNodeWithParameters(
+        {0, 0}, {1}, nullptr, 0, MallocParams<TfLiteAddParams>(kTfLiteActNone),
+        ops::builtin::Register_ADD());
+    interpreter->AddNodeWithParameters({1}, {2}, nullptr, 0, nullptr,
+                                       ops::builtin::Register_LOGISTIC());
+  }
+  Fuse(/*num_fused_nodes=*/1);
+
+  std::vector<int8_t> input(kNumElements);
+  for (int i = 0; i < kNumElements; ++i) {
+    input[i] = i % 256 - 128;
+  }
+  SetInput(input);
+  // Fixed-point kernels round intermediate results differently.
+  CheckOutputs<int8_t>(1);
+}
+
+TEST_F(ElementwiseFusionTest, SingleOperatorIsNotFused) {
+  for (Interpreter* interpreter : {reference_.get(), fused_.get()}) {
+    interpreter->AddTensors(2);
+    interpreter->SetInputs({0});
+    interpreter->SetOutputs({1});
+    TfLiteQuantizationParams quant;
+    interpreter->SetTensorParametersReadWrite(0, kTfLiteFloat32, "input",
+                                              {kNumElements}, quant);
+    interpreter->SetTensorParametersReadWrite(1, kTfLiteFloat32, "output",
+                                              {kNumElements}, quant);
+    interpreter->AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr,
+                                       ops::builtin::Register_TANH());
+  }
+  Fuse(/*num_fused_nodes=*/1);
+  EXPECT_EQ(fused_->node_and_registration(fused_->execution_plan()[0])
+                ->second.builtin_code,
+            kTfLiteBuiltinTanh);
+}
+
+}  // namespace
+}  // namespace fusion
+}  // namespace tflite
+
+int main(int argc, char** argv) {
+  ::tflite::LogToStderr();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -353,6 +353,110 @@ TEST(Conv2D, SparseWeights) {
       .Test(xnnpack_delegate.get());
 }
 
+enum class WeightsType {
+  kFP32,
+  kFP16,
+  kSparse,
+};
+
+class SharedDelegateTest : public testing::TestWithParam<WeightsType> {};
+
+TEST_P(SharedDelegateTest, Conv2D) {
+  std::unique_ptr<TfLiteDelegate, decltype(&TfLiteXNNPackDelegateDelete)>
+      xnnpack_delegate(TfLiteXNNPackDelegateCreate(nullptr),
+                       TfLiteXNNPackDelegateDelete);
+
+  std::random_device random_device;
+  auto rng = std::mt19937(random_device());
+  auto batch_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(2, 4), std::ref(rng));
+  auto input_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(10, 25), std::ref(rng));
+  auto kernel_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(3, 5), std::ref(rng));
+  auto stride_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(2, 3), std::ref(rng));
+  auto channel_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(1, 16), std::ref(rng));
+
+  Conv2DTester tester;
+  tester.BatchSize(batch_rng())
+      .InputHeight(input_rng())
+      .InputWidth(input_rng())
+      .InputChannels(channel_rng())
+      .OutputChannels(channel_rng())
+      .KernelHeight(kernel_rng())
+      .KernelWidth(kernel_rng())
+      .StrideHeight(stride_rng())
+      .StrideWidth(stride_rng())
+      .SharedDelegate();
+  switch (GetParam()) {
+    case WeightsType::kFP32:
+      break;
+    case WeightsType::kFP16:
+      tester.FP16Weights();
+      break;
+    case WeightsType::kSparse:
+      tester.SparseWeights();
+      break;
+  }
+  tester.Test(xnnpack_delegate.get());
+}
+
+INSTANTIATE_TEST_SUITE_P(Conv2D, SharedDelegateTest,
+                         testing::Values(WeightsType::kFP32,
+                                         WeightsType::kFP16,
+                                         WeightsType::kSparse));
+
+class LazyPackingTest : public testing::TestWithParam<WeightsType> {};
+
+TEST_P(LazyPackingTest, Conv2D) {
+  std::unique_ptr<TfLiteDelegate, decltype(&TfLiteXNNPackDelegateDelete)>
+      xnnpack_delegate(TfLiteXNNPackDelegateCreate(nullptr),
+                       TfLiteXNNPackDelegateDelete);
+
+  std::random_device random_device;
+  auto rng = std::mt19937(random_device());
+  auto batch_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(2, 4), std::ref(rng));
+  auto input_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(10, 25), std::ref(rng));
+  auto kernel_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(3, 5), std::ref(rng));
+  auto stride_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(2, 3), std::ref(rng));
+  auto channel_rng =
+      std::bind(std::uniform_int_distribution<int32_t>(1, 16), std::ref(rng));
+
+  Conv2DTester tester;
+  tester.BatchSize(batch_rng())
+      .InputHeight(input_rng())
+      .InputWidth(input_rng())
+      .InputChannels(channel_rng())
+      .OutputChannels(channel_rng())
+      .KernelHeight(kernel_rng())
+      .KernelWidth(kernel_rng())
+      .StrideHeight(stride_rng())
+      .StrideWidth(stride_rng())
+      .LazyPacking();
+  switch (GetParam()) {
+    case WeightsType::kFP32:
+      break;
+    case WeightsType::kFP16:
+      tester.FP16Weights();
+      break;
+    case WeightsType::kSparse:
+      tester.SparseWeights();
+      break;
+  }
+  tester.Test(xnnpack_delegate.get());
+}
+
+INSTANTIATE_TEST_SUITE_P(Conv2D, LazyPackingTest,
+                         testing::Values(WeightsType::kFP32,
+                                         WeightsType::kFP16,
+                                         WeightsType::kSparse));
+
 TEST(Conv2D, ReluActivation) {
   std::unique_ptr<TfLiteDelegate, decltype(&TfLiteXNNPackDelegateDelete)>
       xnnpack_delegate(TfLiteXNNPackDelegateCreate(nullptr),
@@ -19,11 +19,13 @@ limitations under the License.
 #include <cstdint>
 #include <functional>
 #include <random>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include <gtest/gtest.h>
 #include <fp16.h>
 #include "flatbuffers/flatbuffers.h"  // from @flatbuffers
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model.h"
@@ -62,6 +64,41 @@ void Conv2DTester::Test(TfLiteDelegate* delegate) const {
 
   ASSERT_EQ(delegate_interpreter->ModifyGraphWithDelegate(delegate), kTfLiteOk);
 
+  std::unique_ptr<Interpreter> shared_interpreter;
+  if (SharedDelegate()) {
+    ASSERT_EQ(
+        InterpreterBuilder(model, ::tflite::ops::builtin::BuiltinOpResolver())(
+            &shared_interpreter),
+        kTfLiteOk);
+    ASSERT_TRUE(shared_interpreter);
+    ASSERT_EQ(shared_interpreter->AllocateTensors(), kTfLiteOk);
+    ASSERT_EQ(shared_interpreter->ModifyGraphWithDelegate(delegate),
+              kTfLiteOk);
+    // Both interpreters use the same compiled subgraph, with a single copy of
+    // the packed weights.
+    ASSERT_EQ(TfLiteXNNPackDelegateNumRuntimes(delegate), 1);
+  }
+
+  std::unique_ptr<TfLiteDelegate, decltype(&TfLiteXNNPackDelegateDelete)>
+      lazy_delegate(nullptr, TfLiteXNNPackDelegateDelete);
+  std::unique_ptr<Interpreter> lazy_interpreter;
+  if (LazyPacking()) {
+    TfLiteXNNPackDelegateOptions options =
+        TfLiteXNNPackDelegateOptionsDefault();
+    options.flags = TFLITE_XNNPACK_DELEGATE_FLAG_LAZY_PACKING;
+    lazy_delegate.reset(TfLiteXNNPackDelegateCreate(&options));
+    ASSERT_EQ(
+        InterpreterBuilder(model, ::tflite::ops::builtin::BuiltinOpResolver())(
+            &lazy_interpreter),
+        kTfLiteOk);
+    ASSERT_TRUE(lazy_interpreter);
+    ASSERT_EQ(lazy_interpreter->AllocateTensors(), kTfLiteOk);
+    ASSERT_EQ(lazy_interpreter->ModifyGraphWithDelegate(lazy_delegate.get()),
+              kTfLiteOk);
+    // No runtime, and so no packed weights, until the first invocation.
+    ASSERT_EQ(TfLiteXNNPackDelegateNumRuntimes(lazy_delegate.get()), 0);
+  }
+
   std::random_device random_device;
   auto rng = std::mt19937(random_device());
   auto input_rng =
@@ -79,14 +116,60 @@ void Conv2DTester::Test(TfLiteDelegate* delegate) const {
             default_input_data +
                 BatchSize() * InputHeight() * InputWidth() * InputChannels(),
             delegate_input_data);
+  if (SharedDelegate()) {
+    float* shared_input_data = shared_interpreter->typed_tensor<float>(
+        shared_interpreter->inputs()[0]);
+    std::copy(default_input_data,
+              default_input_data +
+                  BatchSize() * InputHeight() * InputWidth() * InputChannels(),
+              shared_input_data);
+  }
+  if (LazyPacking()) {
+    float* lazy_input_data = lazy_interpreter->typed_tensor<float>(
+        lazy_interpreter->inputs()[0]);
+    std::copy(default_input_data,
+              default_input_data +
+                  BatchSize() * InputHeight() * InputWidth() * InputChannels(),
+              lazy_input_data);
+  }
 
   ASSERT_EQ(default_interpreter->Invoke(), kTfLiteOk);
-  ASSERT_EQ(delegate_interpreter->Invoke(), kTfLiteOk);
+  if (LazyPacking()) {
+    ASSERT_EQ(lazy_interpreter->Invoke(), kTfLiteOk);
+    ASSERT_EQ(TfLiteXNNPackDelegateNumRuntimes(lazy_delegate.get()), 1);
+  }
+  if (SharedDelegate()) {
+    // Sequential invocations reuse the runtime, which is set up again for the
+    // tensors of each interpreter.
+    ASSERT_EQ(shared_interpreter->Invoke(), kTfLiteOk);
+    ASSERT_EQ(delegate_interpreter->Invoke(), kTfLiteOk);
+    ASSERT_EQ(TfLiteXNNPackDelegateNumRuntimes(delegate), 1);
+
+    TfLiteStatus shared_status = kTfLiteError;
+    std::thread shared_thread(
+        [&]() { shared_status = shared_interpreter->Invoke(); });
+    const TfLiteStatus delegate_status = delegate_interpreter->Invoke();
+    shared_thread.join();
+    ASSERT_EQ(delegate_status, kTfLiteOk);
+    ASSERT_EQ(shared_status, kTfLiteOk);
+    // Concurrent invocations need at most one runtime each.
+    ASSERT_LE(TfLiteXNNPackDelegateNumRuntimes(delegate), 2);
+  } else {
+    ASSERT_EQ(delegate_interpreter->Invoke(), kTfLiteOk);
+  }
 
   float* default_output_data = default_interpreter->typed_tensor<float>(
       default_interpreter->outputs()[0]);
   float* delegate_output_data = delegate_interpreter->typed_tensor<float>(
       delegate_interpreter->outputs()[0]);
+  float* shared_output_data =
+      SharedDelegate() ? shared_interpreter->typed_tensor<float>(
+                             shared_interpreter->outputs()[0])
+                       : delegate_output_data;
+  float* lazy_output_data =
+      LazyPacking() ? lazy_interpreter->typed_tensor<float>(
+                          lazy_interpreter->outputs()[0])
+                    : delegate_output_data;
 
   for (int32_t i = 0; i < BatchSize(); i++) {
     for (int32_t y = 0; y < OutputHeight(); y++) {
@@ -101,6 +184,16 @@ void Conv2DTester::Test(TfLiteDelegate* delegate) const {
               << " / " << OutputHeight() << ", x position " << x << " / "
               << OutputWidth() << ", channel " << c << " / "
               << OutputChannels();
+          ASSERT_EQ(delegate_output_data[index], shared_output_data[index])
+              << "batch " << i << " / " << BatchSize() << ", y position " << y
+              << " / " << OutputHeight() << ", x position " << x << " / "
+              << OutputWidth() << ", channel " << c << " / "
+              << OutputChannels();
+          ASSERT_EQ(delegate_output_data[index], lazy_output_data[index])
+              << "batch " << i << " / " << BatchSize() << ", y position " << y
+              << " / " << OutputHeight() << ", x position " << x << " / "
+              << OutputWidth() << ", channel " << c << " / "
+              << OutputChannels();
         }
       }
     }
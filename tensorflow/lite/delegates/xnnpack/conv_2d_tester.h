@@ -162,6 +162,27 @@ class Conv2DTester {
 
   inline bool SparseWeights() const { return sparse_weights_; }
 
+  // Apply the XNNPACK delegate to a second interpreter created from the same
+  // model, check that both share the packed weights, and run both delegated
+  // interpreters sequentially and concurrently.
+  inline Conv2DTester& SharedDelegate() {
+    shared_delegate_ = true;
+    return *this;
+  }
+
+  inline bool SharedDelegate() const { return shared_delegate_; }
+
+  // Also apply an XNNPACK delegate created with
+  // TFLITE_XNNPACK_DELEGATE_FLAG_LAZY_PACKING to another interpreter created
+  // from the same model, check that it doesn't pack the weights before the
+  // first invocation, and that its outputs match those of `delegate`.
+  inline Conv2DTester& LazyPacking() {
+    lazy_packing_ = true;
+    return *this;
+  }
+
+  inline bool LazyPacking() const { return lazy_packing_; }
+
   inline Conv2DTester& SamePadding() {
     padding_ = ::tflite::Padding_SAME;
     return *this;
@@ -221,6 +242,8 @@ class Conv2DTester {
   int32_t dilation_width_ = 1;
   bool fp16_weights_ = false;
   bool sparse_weights_ = false;
+  bool shared_delegate_ = false;
+  bool lazy_packing_ = false;
   ::tflite::Padding padding_ = ::tflite::Padding_VALID;
   ::tflite::ActivationFunctionType activation_ =
       ::tflite::ActivationFunctionType_NONE;
@@ -21,6 +21,7 @@ limitations under the License.
 #include <cstring>
 #include <limits>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -39,8 +40,9 @@ namespace tflite {
 namespace xnnpack {
 namespace {
 
-// Forward declaration.
+// Forward declarations.
 TfLiteStatus DelegatePrepare(TfLiteContext* context, TfLiteDelegate* delegate);
+class CompiledSubgraph;
 
 class Delegate {
   friend class Subgraph;
@@ -53,12 +55,16 @@ class Delegate {
           pthreadpool_create(static_cast<size_t>(options->num_threads)));
     }
 #endif
+    if (options != nullptr) {
+      flags_ = options->flags;
+    }
     TFLITE_LOG_PROD_ONCE(tflite::TFLITE_LOG_INFO,
                          "Created TensorFlow Lite XNNPACK delegate for CPU.");
   }
 
   TfLiteIntArray* PrepareOpsToDelegate(TfLiteContext* context);
   TfLiteDelegate* tflite_delegate() { return &delegate_; }
+  std::mutex& prepare_mutex() { return prepare_mutex_; }
 
   pthreadpool_t threadpool() const {
 #if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
@@ -68,6 +74,14 @@ class Delegate {
 #endif
   }
 
+  bool lazy_packing() const {
+    return (flags_ & TFLITE_XNNPACK_DELEGATE_FLAG_LAZY_PACKING) != 0;
+  }
+
+  // Returns the number of XNNPACK runtimes of all the compiled subgraphs in
+  // use by the interpreters the delegate is applied to.
+  size_t NumRuntimes();
+
  private:
   TfLiteDelegate delegate_ = {
       reinterpret_cast<void*>(this),  // .data_
@@ -79,16 +93,34 @@ class Delegate {
   };
 
   // Unpacked data for quasi-static tensors, i.e. tensors produced by
-  // dequantizing or unpacking static buffers.
-  std::vector<char> static_unpacked_data_;
-  // Mapping from a tensor index for a quasi-static tensor to the offset to
-  // its unpacked data within static_unpacked_data_.
-  std::unordered_map<int, size_t> static_unpacked_data_map_;
+  // dequantizing or unpacking static buffers, keyed by the address of the
+  // static buffer they were unpacked from. The delegate holds only weak
+  // references: unpacked data is owned by the delegated subgraphs which use it.
+  // Thus, when the delegate is applied to several interpreters created from
+  // the same model (e.g. to serve concurrent requests), they all share a single
+  // copy of the unpacked weights, which is released with the last of them.
+  std::unordered_map<const void*, std::weak_ptr<char>> static_unpacked_data_;
+  // Mapping from a tensor index for a quasi-static tensor to its unpacked data
+  // in the graph currently being delegated.
+  std::unordered_map<int, std::shared_ptr<char>> static_unpacked_data_map_;
   // Set of indices of nodes which unpack static data, e.g. Dequantize
   // operators which convert FP16 static weights to FP32. These nodes are simply
   // ignored in the delegate implementation, because their outputs are
   // pre-unpacked in DelegatePrepare.
   std::unordered_set<int> static_unpack_nodes_;
+  // Compiled subgraphs, keyed by the partition of the model they were compiled
+  // from (see Subgraph::SharingKey). The delegate holds only weak references:
+  // compiled subgraphs are owned by the delegated subgraphs which use them.
+  // Thus, interpreters created from the same model share the compiled
+  // subgraphs, and the weights packed by XNNPACK, of their partitions.
+  std::unordered_map<std::string, std::weak_ptr<CompiledSubgraph>>
+      compiled_subgraphs_;
+  // Serializes delegation of graphs, so that a single delegate can be applied
+  // to multiple interpreters from different threads. Also guards
+  // compiled_subgraphs_.
+  std::mutex prepare_mutex_;
+  // Bitfield of TFLITE_XNNPACK_DELEGATE_FLAG_* options.
+  uint32_t flags_ = 0;
 #if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
   // Thread pool with smart-pointer for lifetime management.
   std::unique_ptr<pthreadpool, decltype(&pthreadpool_destroy)> threadpool_{
@@ -96,11 +128,115 @@ class Delegate {
 #endif
 };
 
+// The compiled form of a delegated partition of a model: the XNNPACK subgraph,
+// the quasi-static data it references, and the XNNPACK runtimes created from
+// it, which hold the weights packed by XNNPACK and the workspace for
+// intermediate values. It is shared by the delegated subgraphs of all the
+// interpreters created from the model, which only hold their input and output
+// tensors. Each invocation borrows an idle runtime, so that weights are packed
+// once per concurrent invocation rather than once per interpreter.
+class CompiledSubgraph {
+ public:
+  // An XNNPACK runtime, and the data of the external values it was last set up
+  // with.
+  struct Runtime {
+    std::unique_ptr<xnn_runtime, decltype(&xnn_delete_runtime)> runtime{
+        nullptr, &xnn_delete_runtime};
+    bool set_up = false;
+    std::vector<void*> external_data;
+  };
+
+  CompiledSubgraph(
+      std::unique_ptr<xnn_subgraph, decltype(&xnn_delete_subgraph)> subgraph,
+      pthreadpool_t threadpool, std::vector<int>&& externals,
+      std::vector<std::shared_ptr<char>>&& static_data)
+      : subgraph_(std::move(subgraph)),
+        threadpool_(threadpool),
+        externals_(std::move(externals)),
+        static_data_(std::move(static_data)) {}
+
+  // TFLite Tensor IDs == XNNPACK Value IDs of input/output tensors for the
+  // delegated subgraph.
+  const std::vector<int>& externals() const { return externals_; }
+
+  // Returns an idle runtime, preferably one last set up with `external_data`,
+  // or creates one if all of them are in use. Returns null on failure.
+  std::unique_ptr<Runtime> AcquireRuntime(
+      TfLiteContext* context, const std::vector<void*>& external_data) {
+    {
+      std::lock_guard<std::mutex> lock(runtimes_mutex_);
+      if (!idle_runtimes_.empty()) {
+        auto it = std::find_if(
+            idle_runtimes_.begin(), idle_runtimes_.end(),
+            [&](const std::unique_ptr<Runtime>& runtime) {
+              return runtime->set_up &&
+                     runtime->external_data == external_data;
+            });
+        if (it == idle_runtimes_.end()) {
+          --it;
+        }
+        std::unique_ptr<Runtime> runtime = std::move(*it);
+        idle_runtimes_.erase(it);
+        return runtime;
+      }
+    }
+
+    // Creating the runtime packs the weights.
+    std::unique_ptr<Runtime> runtime(new Runtime);
+    {
+      std::lock_guard<std::mutex> lock(subgraph_mutex_);
+      xnn_runtime_t runtime_ptr = nullptr;
+      const xnn_status status = xnn_create_runtime_v2(
+          subgraph_.get(), threadpool_, /*flags=*/0, &runtime_ptr);
+      if (status != xnn_status_success) {
+        TF_LITE_KERNEL_LOG(context, "failed to create XNNPACK runtime");
+        return nullptr;
+      }
+      runtime->runtime.reset(runtime_ptr);
+    }
+    std::lock_guard<std::mutex> lock(runtimes_mutex_);
+    num_runtimes_++;
+    return runtime;
+  }
+
+  // Returns a runtime obtained from AcquireRuntime to the idle runtimes.
+  void ReleaseRuntime(std::unique_ptr<Runtime> runtime) {
+    std::lock_guard<std::mutex> lock(runtimes_mutex_);
+    idle_runtimes_.push_back(std::move(runtime));
+  }
+
+  size_t num_runtimes() {
+    std::lock_guard<std::mutex> lock(runtimes_mutex_);
+    return num_runtimes_;
+  }
+
+ private:
+  // XNNPACK Subgraph, kept to create runtimes for concurrent invocations.
+  // Runtimes are created from it one at a time.
+  std::mutex subgraph_mutex_;
+  std::unique_ptr<xnn_subgraph, decltype(&xnn_delete_subgraph)> subgraph_;
+  // Thread pool of the delegate, which outlives the compiled subgraph.
+  pthreadpool_t threadpool_;
+  std::vector<int> externals_;
+  // Unpacked quasi-static data (possibly shared with other compiled
+  // subgraphs) referenced by the subgraph.
+  std::vector<std::shared_ptr<char>> static_data_;
+  std::mutex runtimes_mutex_;
+  std::vector<std::unique_ptr<Runtime>> idle_runtimes_;
+  size_t num_runtimes_ = 0;
+};
+
+// Appends the bytes of `value` to `key`.
+template <typename T>
+void AppendToKey(const T& value, std::string* key) {
+  key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
 class Subgraph {
  public:
   static Subgraph* Create(TfLiteContext* context,
                           const TfLiteDelegateParams* params,
-                          const Delegate* delegate) {
+                          Delegate* delegate) {
     // Convert subgraph inputs and outputs to hash sets for faster lookup.
     const std::unordered_set<int> inputs(
         &params->input_tensors->data[0],
@@ -121,19 +257,6 @@ class Subgraph {
       return nullptr;
     }
 
-    xnn_subgraph_t subgraph_ptr = nullptr;
-    xnn_status status = xnn_create_subgraph(
-        /*external_value_ids=*/context->tensors_size, /*flags=*/0,
-        &subgraph_ptr);
-    if (status != xnn_status_success) {
-      TF_LITE_KERNEL_LOG(context, "failed to create XNNPACK subgraph");
-      return nullptr;
-    }
-
-    // Smart pointer to automatically release subgraph on exit.
-    std::unique_ptr<xnn_subgraph, decltype(&xnn_delete_subgraph)> subgraph(
-        subgraph_ptr, &xnn_delete_subgraph);
-
     // Detect which tensors are used as inputs or outputs of any subgraph nodes.
     // -1 denotes tensor not used in the subgraph. These indexes will be
     // filtered out and removed later.
@@ -182,6 +305,36 @@ class Subgraph {
                   tensors.end());
     std::sort(tensors.begin(), tensors.end());
 
+    // Reuse the partition compiled for another interpreter, if it is still
+    // alive.
+    const std::string key = SharingKey(context, params, tensors, delegate);
+    if (!key.empty()) {
+      const auto it = delegate->compiled_subgraphs_.find(key);
+      if (it != delegate->compiled_subgraphs_.end()) {
+        std::shared_ptr<CompiledSubgraph> compiled = it->second.lock();
+        if (compiled != nullptr) {
+          return new Subgraph(std::move(compiled));
+        }
+      }
+    }
+
+    xnn_subgraph_t subgraph_ptr = nullptr;
+    xnn_status status = xnn_create_subgraph(
+        /*external_value_ids=*/context->tensors_size, /*flags=*/0,
+        &subgraph_ptr);
+    if (status != xnn_status_success) {
+      TF_LITE_KERNEL_LOG(context, "failed to create XNNPACK subgraph");
+      return nullptr;
+    }
+
+    // Smart pointer to automatically release subgraph on exit.
+    std::unique_ptr<xnn_subgraph, decltype(&xnn_delete_subgraph)> subgraph(
+        subgraph_ptr, &xnn_delete_subgraph);
+
+    // Unpacked quasi-static data referenced by the XNNPACK subgraph. It is kept
+    // alive for as long as the compiled subgraph exists.
+    std::vector<std::shared_ptr<char>> static_data;
+
     // XNNPACK Value IDs for TFLite tensors
     std::vector<uint32_t> xnnpack_tensors(tensors.back() + 1);
     for (int t : tensors) {
@@ -201,7 +354,8 @@ class Subgraph {
         // Check for quasi-static data.
         const auto it = delegate->static_unpacked_data_map_.find(t);
         if (it != delegate->static_unpacked_data_map_.end()) {
-          data = delegate->static_unpacked_data_.data() + it->second;
+          data = it->second.get();
+          static_data.push_back(it->second);
         }
       }
       if (inputs.count(t) != 0) {
@@ -230,7 +384,7 @@ class Subgraph {
 
     // Create a set of quasi-static tensors for VisitNode function
     std::unordered_set<int> quasi_static_tensors;
-    for (const std::pair<const int, size_t>& entry :
+    for (const std::pair<const int, std::shared_ptr<char>>& entry :
          delegate->static_unpacked_data_map_) {
       quasi_static_tensors.insert(entry.first);
     }
@@ -257,46 +411,103 @@ class Subgraph {
       }
     }
 
-    xnn_runtime_t runtime_ptr = nullptr;
-    status = xnn_create_runtime_v2(subgraph.get(), delegate->threadpool(),
-                                   /*flags=*/0, &runtime_ptr);
-    if (status != xnn_status_success) {
-      TF_LITE_KERNEL_LOG(context, "failed to create XNNPACK runtime");
-      return nullptr;
+    std::vector<int> sorted_externals(externals.begin(), externals.end());
+    std::sort(sorted_externals.begin(), sorted_externals.end());
+    std::shared_ptr<CompiledSubgraph> compiled(new CompiledSubgraph(
+        std::move(subgraph), delegate->threadpool(),
+        std::move(sorted_externals), std::move(static_data)));
+    // Creating a runtime packs the weights.
+    if (!delegate->lazy_packing()) {
+      std::unique_ptr<CompiledSubgraph::Runtime> runtime =
+          compiled->AcquireRuntime(context, {});
+      if (runtime == nullptr) {
+        return nullptr;
+      }
+      compiled->ReleaseRuntime(std::move(runtime));
     }
-
-    return new Subgraph(runtime_ptr, std::move(externals));
+    if (!key.empty()) {
+      delegate->compiled_subgraphs_[key] = compiled;
+    }
+    return new Subgraph(std::move(compiled));
   }
 
-  TfLiteStatus Prepare(TfLiteContext* context) { return kTfLiteOk; }
-
-  TfLiteStatus Invoke(TfLiteContext* context) {
-    if (first_run_) {
-      std::vector<xnn_external_value> external_values;
-      for (int t : externals_) {
-        xnn_external_value value = {0};
-        value.id = static_cast<uint32_t>(t);
-        value.data = context->tensors[t].data.raw;
-        external_values.push_back(value);
+  // Returns the key under which the compiled form of the partition `params`,
+  // with tensors `tensors`, is shared between interpreters, or an empty string
+  // if it can't be shared. Interpreters keep their model alive, so the address
+  // of a static tensor identifies the model, and the nodes and the indices,
+  // shapes and static data of the tensors then identify the partition.
+  static std::string SharingKey(TfLiteContext* context,
+                                const TfLiteDelegateParams* params,
+                                const std::vector<int>& tensors,
+                                const Delegate* delegate) {
+    const void* model_data = nullptr;
+    for (size_t t = 0; t < context->tensors_size && model_data == nullptr;
+         t++) {
+      if (context->tensors[t].allocation_type == kTfLiteMmapRo) {
+        model_data = context->tensors[t].data.raw_const;
       }
+    }
+    if (model_data == nullptr) {
+      return std::string();
+    }
 
-      const xnn_status status = xnn_setup_runtime(
-          runtime_.get(), external_values.size(), external_values.data());
-      if (status != xnn_status_success) {
-        TF_LITE_KERNEL_LOG(context, "failed to setup XNNPACK runtime");
-        return kTfLiteError;
+    std::string key;
+    AppendToKey(model_data, &key);
+    AppendToKey(context->tensors_size, &key);
+    for (int i = 0; i < params->nodes_to_replace->size; i++) {
+      const int node_index = params->nodes_to_replace->data[i];
+      TfLiteNode* node = nullptr;
+      TfLiteRegistration* registration = nullptr;
+      if (context->GetNodeAndRegistration(context, node_index, &node,
+                                          &registration) != kTfLiteOk) {
+        return std::string();
       }
+      AppendToKey(node_index, &key);
+      AppendToKey(registration->builtin_code, &key);
+      for (int k = 0; k < node->inputs->size; k++) {
+        AppendToKey(node->inputs->data[k], &key);
+      }
+      for (int k = 0; k < node->outputs->size; k++) {
+        AppendToKey(node->outputs->data[k], &key);
+      }
+    }
+    for (int t : tensors) {
+      const TfLiteTensor& tensor = context->tensors[t];
+      AppendToKey(t, &key);
+      AppendToKey(tensor.type, &key);
+      for (int d = 0; d < tensor.dims->size; d++) {
+        AppendToKey(tensor.dims->data[d], &key);
+      }
+      const void* data = nullptr;
+      if (tensor.allocation_type == kTfLiteMmapRo) {
+        data = tensor.data.raw_const;
+      } else {
+        const auto it = delegate->static_unpacked_data_map_.find(t);
+        if (it != delegate->static_unpacked_data_map_.end()) {
+          data = it->second.get();
+        }
+      }
+      AppendToKey(data, &key);
+    }
+    return key;
+  }
+
+  TfLiteStatus Prepare(TfLiteContext* context) { return kTfLiteOk; }
 
-      first_run_ = false;
+  TfLiteStatus Invoke(TfLiteContext* context) {
+    const std::vector<int>& externals = compiled_->externals();
+    for (size_t i = 0; i < externals.size(); i++) {
+      external_data_[i] = context->tensors[externals[i]].data.raw;
     }
 
-    const xnn_status status = xnn_invoke_runtime(runtime_.get());
-    if (status != xnn_status_success) {
-      TF_LITE_KERNEL_LOG(context, "failed to invoke XNNPACK runtime");
+    std::unique_ptr<CompiledSubgraph::Runtime> runtime =
+        compiled_->AcquireRuntime(context, external_data_);
+    if (runtime == nullptr) {
       return kTfLiteError;
     }
-
-    return kTfLiteOk;
+    const TfLiteStatus status = Invoke(context, runtime.get());
+    compiled_->ReleaseRuntime(std::move(runtime));
+    return status;
   }
 
   static TfLiteStatus CalculatePadding(TfLiteContext* context,
@@ -2577,24 +2788,87 @@ class Subgraph {
   }
 
  private:
-  Subgraph(xnn_runtime_t runtime, std::unordered_set<int>&& externals)
-      : runtime_(runtime, &xnn_delete_runtime), externals_(externals) {}
+  explicit Subgraph(std::shared_ptr<CompiledSubgraph> compiled)
+      : compiled_(std::move(compiled)),
+        external_data_(compiled_->externals().size()) {}
+
+  // Runs `runtime` on the input and output tensors of the interpreter, which
+  // are in external_data_, setting it up for them first if needed.
+  TfLiteStatus Invoke(TfLiteContext* context,
+                      CompiledSubgraph::Runtime* runtime) {
+    if (!runtime->set_up || runtime->external_data != external_data_) {
+      const std::vector<int>& externals = compiled_->externals();
+      std::vector<xnn_external_value> external_values;
+      for (size_t i = 0; i < externals.size(); i++) {
+        xnn_external_value value = {0};
+        value.id = static_cast<uint32_t>(externals[i]);
+        value.data = external_data_[i];
+        external_values.push_back(value);
+      }
 
-  // XNNPACK Runtime (subgraph + workspace) with smart-pointer for lifetime
-  // management.
-  std::unique_ptr<xnn_runtime, decltype(&xnn_delete_runtime)> runtime_{
-      nullptr, &xnn_delete_runtime};
-  // TFLite Tensor IDs == XNNPACK Value IDs of input/output tensors for the
-  // delegated subgraph.
-  std::unordered_set<int> externals_;
-  bool first_run_{true};
+      runtime->set_up = false;
+      const xnn_status status =
+          xnn_setup_runtime(runtime->runtime.get(), external_values.size(),
+                            external_values.data());
+      if (status != xnn_status_success) {
+        TF_LITE_KERNEL_LOG(context, "failed to setup XNNPACK runtime");
+        return kTfLiteError;
+      }
+      runtime->set_up = true;
+      runtime->external_data = external_data_;
+    }
+
+    const xnn_status status = xnn_invoke_runtime(runtime->runtime.get());
+    if (status != xnn_status_success) {
+      TF_LITE_KERNEL_LOG(context, "failed to invoke XNNPACK runtime");
+      return kTfLiteError;
+    }
+
+    return kTfLiteOk;
+  }
+
+  // The compiled form of the delegated partition, possibly shared with other
+  // interpreters.
+  std::shared_ptr<CompiledSubgraph> compiled_;
+  // The data of the input and output tensors of the interpreter, in the order
+  // of compiled_->externals().
+  std::vector<void*> external_data_;
 };
 
+size_t Delegate::NumRuntimes() {
+  std::lock_guard<std::mutex> lock(prepare_mutex_);
+  size_t num_runtimes = 0;
+  for (const auto& entry : compiled_subgraphs_) {
+    std::shared_ptr<CompiledSubgraph> compiled = entry.second.lock();
+    if (compiled != nullptr) {
+      num_runtimes += compiled->num_runtimes();
+    }
+  }
+  return num_runtimes;
+}
+
 TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
-  // Clear previous data, in case the delegate is reused without re-creation.
+  // Clear per-graph data, in case the delegate is reused without re-creation.
+  // Unpacked data and compiled subgraphs which are no longer used by any
+  // interpreter are dropped too.
   static_unpacked_data_map_.clear();
-  static_unpacked_data_.clear();
   static_unpack_nodes_.clear();
+  for (auto it = static_unpacked_data_.begin();
+       it != static_unpacked_data_.end();) {
+    if (it->second.expired()) {
+      it = static_unpacked_data_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto it = compiled_subgraphs_.begin();
+       it != compiled_subgraphs_.end();) {
+    if (it->second.expired()) {
+      it = compiled_subgraphs_.erase(it);
+    } else {
+      ++it;
+    }
+  }
 
   TfLiteIntArray* execution_plan = nullptr;
   if (context->GetExecutionPlan(context, &execution_plan) != kTfLiteOk) {
@@ -2748,15 +3022,21 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
     }
     const size_t tensor_elements = output_tensor.bytes / sizeof(float);
 
-    // Align to XNN_EXTRA_BYTES bytes
-    while (static_unpacked_data_.size() % XNN_EXTRA_BYTES != 0) {
-      static_unpacked_data_.push_back(0);
+    // Reuse data unpacked for another interpreter, if it is still alive.
+    const auto cached_it = static_unpacked_data_.find(input_tensor.data.raw);
+    if (cached_it != static_unpacked_data_.end()) {
+      std::shared_ptr<char> cached_data = cached_it->second.lock();
+      if (cached_data != nullptr) {
+        static_unpacked_data_map_[t] = std::move(cached_data);
+        continue;
+      }
     }
-    const size_t tensor_offset = static_unpacked_data_.size();
-    static_unpacked_data_.resize(tensor_offset + context->tensors[t].bytes);
 
-    float* unpacked_data =
-        reinterpret_cast<float*>(static_unpacked_data_.data() + tensor_offset);
+    // XNNPACK kernels may read up to XNN_EXTRA_BYTES past the end of data.
+    std::shared_ptr<char> tensor_data(
+        new char[output_tensor.bytes + XNN_EXTRA_BYTES],
+        std::default_delete<char[]>());
+    float* unpacked_data = reinterpret_cast<float*>(tensor_data.get());
     switch (registration->builtin_code) {
       case kTfLiteBuiltinDequantize: {
         if (input_tensor.type != kTfLiteFloat16) {
@@ -2823,7 +3103,8 @@ TfLiteIntArray* Delegate::PrepareOpsToDelegate(TfLiteContext* context) {
         return nullptr;  // Hard error.
     }
 
-    static_unpacked_data_map_[t] = tensor_offset;
+    static_unpacked_data_[input_tensor.data.raw] = tensor_data;
+    static_unpacked_data_map_[t] = std::move(tensor_data);
   }
 
   // Add nodes that unpack static data consumed by delegated nodes.
@@ -2896,9 +3177,13 @@ const TfLiteRegistration kSubgraphRegistration = {
 };
 
 TfLiteStatus DelegatePrepare(TfLiteContext* context, TfLiteDelegate* delegate) {
+  ::tflite::xnnpack::Delegate* xnnpack_delegate =
+      static_cast<::tflite::xnnpack::Delegate*>(delegate->data_);
+  // Subgraphs are created within ReplaceNodeSubsetsWithDelegateKernels and
+  // consume the per-graph state produced by PrepareOpsToDelegate.
+  std::lock_guard<std::mutex> lock(xnnpack_delegate->prepare_mutex());
   TfLiteIntArray* ops_to_replace =
-      static_cast<::tflite::xnnpack::Delegate*>(delegate->data_)
-          ->PrepareOpsToDelegate(context);
+      xnnpack_delegate->PrepareOpsToDelegate(context);
   const TfLiteStatus status = context->ReplaceNodeSubsetsWithDelegateKernels(
       context, kSubgraphRegistration, ops_to_replace, delegate);
   TfLiteIntArrayFree(ops_to_replace);
@@ -2925,6 +3210,11 @@ TfLiteDelegate* TfLiteXNNPackDelegateCreate(
   return xnnpack_delegate ? xnnpack_delegate->tflite_delegate() : nullptr;
 }
 
+size_t TfLiteXNNPackDelegateNumRuntimes(TfLiteDelegate* delegate) {
+  return static_cast<::tflite::xnnpack::Delegate*>(delegate->data_)
+      ->NumRuntimes();
+}
+
 void TfLiteXNNPackDelegateDelete(TfLiteDelegate* delegate) {
   if (delegate != nullptr) {
     delete static_cast<::tflite::xnnpack::Delegate*>(delegate->data_);
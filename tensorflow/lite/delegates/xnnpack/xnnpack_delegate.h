@@ -22,10 +22,19 @@ limitations under the License.
 extern "C" {
 #endif  // __cplusplus
 
+// Pack the weights of each delegated subgraph on its first invocation rather
+// than when the delegate is applied. Models then load faster and never touch
+// the weights of subgraphs they don't run, at the cost of a slower first
+// inference.
+#define TFLITE_XNNPACK_DELEGATE_FLAG_LAZY_PACKING 0x00000001
+
 typedef struct {
   // Number of threads to use in the thread pool.
   // 0 or negative value means no thread pool used.
   int32_t num_threads;
+  // Bitfield with any combination of the following binary options:
+  // - TFLITE_XNNPACK_DELEGATE_FLAG_LAZY_PACKING
+  uint32_t flags;
 } TfLiteXNNPackDelegateOptions;
 
 // Returns a structure with the default XNNPack delegate options.
@@ -33,10 +42,18 @@ TfLiteXNNPackDelegateOptions TfLiteXNNPackDelegateOptionsDefault();
 
 // Creates a new delegate instance that need to be destroyed with
 // `TfLiteXNNPackDelegateDelete` when delegate is no longer used by TFLite.
+// A delegate may be applied to several interpreters created from the same
+// model. The delegated subgraphs, and the weights unpacked by the delegate and
+// packed by XNNPACK, are then shared between them: weights are packed once per
+// concurrent invocation of a subgraph rather than once per interpreter.
 // When `options` is set to `nullptr`, the following default values are used:
 TfLiteDelegate* TfLiteXNNPackDelegateCreate(
     const TfLiteXNNPackDelegateOptions* options);
 
+// Returns the number of XNNPACK runtimes, each holding a copy of the packed
+// weights of a subgraph, in use by the interpreters the delegate is applied to.
+size_t TfLiteXNNPackDelegateNumRuntimes(TfLiteDelegate* delegate);
+
 // Destroys a delegate created with `TfLiteXNNPackDelegateCreate` call.
 void TfLiteXNNPackDelegateDelete(TfLiteDelegate* delegate);
 
@@ -0,0 +1,303 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/experimental/batching/batching_interpreter.h"
+
+#include <cstring>
+#include <utility>
+
+namespace tflite {
+namespace batching {
+
+std::unique_ptr<BatchingInterpreter> BatchingInterpreter::Create(
+    std::unique_ptr<Interpreter> interpreter, const Options& options,
+    ErrorReporter* error_reporter) {
+  if (interpreter == nullptr) {
+    TF_LITE_REPORT_ERROR(error_reporter, "Missing interpreter.");
+    return nullptr;
+  }
+  if (options.max_batch_size < 1) {
+    TF_LITE_REPORT_ERROR(error_reporter, "Invalid max batch size %d.",
+                         options.max_batch_size);
+    return nullptr;
+  }
+  if (options.batch_timeout_micros < 0) {
+    TF_LITE_REPORT_ERROR(error_reporter, "Invalid batch timeout %lld us.",
+                         static_cast<long long>(options.batch_timeout_micros));
+    return nullptr;
+  }
+  if (!options.allowed_batch_sizes.empty()) {
+    int last_batch_size = 0;
+    for (int batch_size : options.allowed_batch_sizes) {
+      if (batch_size <= last_batch_size) {
+        TF_LITE_REPORT_ERROR(error_reporter,
+                             "Allowed batch sizes must be strictly "
+                             "increasing positive numbers.");
+        return nullptr;
+      }
+      last_batch_size = batch_size;
+    }
+    if (last_batch_size != options.max_batch_size) {
+      TF_LITE_REPORT_ERROR(error_reporter,
+                           "Largest allowed batch size %d differs from max "
+                           "batch size %d.",
+                           last_batch_size, options.max_batch_size);
+      return nullptr;
+    }
+  }
+
+  std::unique_ptr<BatchingInterpreter> batching_interpreter(
+      new BatchingInterpreter(std::move(interpreter), options,
+                              error_reporter));
+  // Validate the model, and allocate the interpreter for the smallest batch
+  // size.
+  const int batch_size = batching_interpreter->PaddedBatchSize(1);
+  if (batching_interpreter->ResizeInterpreter(batch_size) != kTfLiteOk) {
+    return nullptr;
+  }
+  batching_interpreter->batching_thread_ =
+      std::thread(&BatchingInterpreter::ProcessBatches,
+                  batching_interpreter.get());
+  return batching_interpreter;
+}
+
+BatchingInterpreter::BatchingInterpreter(
+    std::unique_ptr<Interpreter> interpreter, const Options& options,
+    ErrorReporter* error_reporter)
+    : options_(options),
+      error_reporter_(error_reporter),
+      interpreter_(std::move(interpreter)) {}
+
+BatchingInterpreter::~BatchingInterpreter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  queue_cv_.notify_all();
+  if (batching_thread_.joinable()) {
+    batching_thread_.join();
+  }
+}
+
+TfLiteStatus BatchingInterpreter::Invoke(const std::vector<const void*>& inputs,
+                                         const std::vector<void*>& outputs,
+                                         int batch_size) {
+  if (inputs.size() != inputs_size() || outputs.size() != outputs_size()) {
+    TF_LITE_REPORT_ERROR(error_reporter_,
+                         "Expected %d inputs and %d outputs, got %d and %d.",
+                         static_cast<int>(inputs_size()),
+                         static_cast<int>(outputs_size()),
+                         static_cast<int>(inputs.size()),
+                         static_cast<int>(outputs.size()));
+    return kTfLiteError;
+  }
+  if (batch_size < 1 || batch_size > options_.max_batch_size) {
+    TF_LITE_REPORT_ERROR(error_reporter_,
+                         "Request batch size %d is outside of [1, %d].",
+                         batch_size, options_.max_batch_size);
+    return kTfLiteError;
+  }
+
+  Request request;
+  request.inputs = &inputs;
+  request.outputs = &outputs;
+  request.batch_size = batch_size;
+  request.enqueue_time = std::chrono::steady_clock::now();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (stopping_) {
+    TF_LITE_REPORT_ERROR(error_reporter_,
+                         "Batching interpreter is shutting down.");
+    return kTfLiteError;
+  }
+  queue_.push_back(&request);
+  queued_elements_ += batch_size;
+  queue_cv_.notify_one();
+  done_cv_.wait(lock, [&request]() { return request.done; });
+  return request.status;
+}
+
+BatchingInterpreter::Stats BatchingInterpreter::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+TfLiteStatus BatchingInterpreter::ResizeInterpreter(int batch_size) {
+  if (batch_size == interpreter_batch_size_) {
+    return kTfLiteOk;
+  }
+  Interpreter* interpreter = interpreter_.get();
+  // Don't run a half-resized interpreter if resizing fails.
+  interpreter_batch_size_ = 0;
+
+  for (int input : interpreter->inputs()) {
+    const TfLiteTensor* tensor = interpreter->tensor(input);
+    if (tensor->type == kTfLiteString || tensor->dims->size == 0) {
+      TF_LITE_REPORT_ERROR(error_reporter_,
+                           "Input tensor %d can't be batched: string and "
+                           "scalar tensors are not supported.",
+                           input);
+      return kTfLiteError;
+    }
+    std::vector<int> dims(tensor->dims->data,
+                          tensor->dims->data + tensor->dims->size);
+    dims[0] = batch_size;
+    if (interpreter->ResizeInputTensor(input, dims) != kTfLiteOk) {
+      TF_LITE_REPORT_ERROR(error_reporter_,
+                           "Failed to resize input tensor %d to batch size "
+                           "%d.",
+                           input, batch_size);
+      return kTfLiteError;
+    }
+  }
+  if (interpreter->AllocateTensors() != kTfLiteOk) {
+    TF_LITE_REPORT_ERROR(error_reporter_,
+                         "Failed to allocate tensors for batch size %d.",
+                         batch_size);
+    return kTfLiteError;
+  }
+
+  std::vector<size_t> input_element_bytes;
+  for (int input : interpreter->inputs()) {
+    input_element_bytes.push_back(interpreter->tensor(input)->bytes /
+                                  batch_size);
+  }
+  std::vector<size_t> output_element_bytes;
+  for (int output : interpreter->outputs()) {
+    const TfLiteTensor* tensor = interpreter->tensor(output);
+    if (tensor->type == kTfLiteString ||
+        tensor->allocation_type == kTfLiteDynamic || tensor->dims->size == 0 ||
+        tensor->dims->data[0] != batch_size) {
+      TF_LITE_REPORT_ERROR(error_reporter_,
+                           "Output tensor %d can't be split: outputs must be "
+                           "static-shaped non-string tensors with a leading "
+                           "batch dimension.",
+                           output);
+      return kTfLiteError;
+    }
+    output_element_bytes.push_back(tensor->bytes / batch_size);
+  }
+
+  if (input_element_bytes_.empty() && output_element_bytes_.empty()) {
+    input_element_bytes_ = std::move(input_element_bytes);
+    output_element_bytes_ = std::move(output_element_bytes);
+  } else if (input_element_bytes != input_element_bytes_ ||
+             output_element_bytes != output_element_bytes_) {
+    TF_LITE_REPORT_ERROR(error_reporter_,
+                         "Batch size %d changes the size of batch elements.",
+                         batch_size);
+    return kTfLiteError;
+  }
+
+  interpreter_batch_size_ = batch_size;
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.num_resizes++;
+  return kTfLiteOk;
+}
+
+int BatchingInterpreter::PaddedBatchSize(int num_elements) const {
+  for (int batch_size : options_.allowed_batch_sizes) {
+    if (batch_size >= num_elements) {
+      return batch_size;
+    }
+  }
+  return num_elements;
+}
+
+void BatchingInterpreter::ProcessBatches() {
+  const std::chrono::microseconds batch_timeout(options_.batch_timeout_micros);
+  std::vector<Request*> batch;
+  while (true) {
+    batch.clear();
+    int num_elements = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queue_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      // Wait for the batch to fill up, but no longer than the oldest request
+      // is allowed to wait.
+      queue_cv_.wait_until(
+          lock, queue_.front()->enqueue_time + batch_timeout, [this]() {
+            return stopping_ || queued_elements_ >= options_.max_batch_size;
+          });
+      while (!queue_.empty() && num_elements + queue_.front()->batch_size <=
+                                    options_.max_batch_size) {
+        Request* request = queue_.front();
+        queue_.pop_front();
+        queued_elements_ -= request->batch_size;
+        num_elements += request->batch_size;
+        batch.push_back(request);
+      }
+    }
+
+    const TfLiteStatus status = RunBatch(batch, num_elements);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (Request* request : batch) {
+        request->status = status;
+        request->done = true;
+      }
+      stats_.num_requests += batch.size();
+      stats_.num_batches += 1;
+      stats_.num_batch_elements += num_elements;
+      stats_.num_padding_elements +=
+          PaddedBatchSize(num_elements) - num_elements;
+    }
+    done_cv_.notify_all();
+  }
+}
+
+TfLiteStatus BatchingInterpreter::RunBatch(const std::vector<Request*>& batch,
+                                           int num_elements) {
+  const int batch_size = PaddedBatchSize(num_elements);
+  TF_LITE_ENSURE_STATUS(ResizeInterpreter(batch_size));
+  Interpreter* interpreter = interpreter_.get();
+
+  for (size_t i = 0; i < inputs_size(); i++) {
+    const size_t element_bytes = input_element_bytes_[i];
+    char* data = interpreter->tensor(interpreter->inputs()[i])->data.raw;
+    for (const Request* request : batch) {
+      const size_t bytes = request->batch_size * element_bytes;
+      std::memcpy(data, (*request->inputs)[i], bytes);
+      data += bytes;
+    }
+    std::memset(data, 0, (batch_size - num_elements) * element_bytes);
+  }
+
+  TF_LITE_ENSURE_STATUS(interpreter->Invoke());
+
+  for (size_t i = 0; i < outputs_size(); i++) {
+    const size_t element_bytes = output_element_bytes_[i];
+    const TfLiteTensor* tensor = interpreter->tensor(interpreter->outputs()[i]);
+    if (tensor->bytes != batch_size * element_bytes) {
+      TF_LITE_REPORT_ERROR(error_reporter_,
+                           "Output %d changed size during invocation.",
+                           static_cast<int>(i));
+      return kTfLiteError;
+    }
+    const char* data = tensor->data.raw_const;
+    for (const Request* request : batch) {
+      const size_t bytes = request->batch_size * element_bytes;
+      std::memcpy((*request->outputs)[i], data, bytes);
+      data += bytes;
+    }
+  }
+  return kTfLiteOk;
+}
+
+}  // namespace batching
+}  // namespace tflite
@@ -0,0 +1,185 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_BATCHING_BATCHING_INTERPRETER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_BATCHING_BATCHING_INTERPRETER_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/stderr_reporter.h"
+
+namespace tflite {
+namespace batching {
+
+// Opt-in layer which merges concurrent single-request invocations of a model
+// into batched invocations of TFLite interpreters.
+//
+// All inputs and outputs of the model must be non-string tensors whose first
+// dimension is the batch dimension. Requests are queued, and a background
+// thread concatenates queued requests along the batch dimension once either
+// `max_batch_size` batch elements are queued, or the oldest queued request
+// waited for `batch_timeout_micros`. Batched outputs are split back per
+// request.
+//
+// All batches run on a single interpreter, whose inputs are resized in place
+// when the batch size changes. The arena planner keeps the memory plans of
+// recently used batch sizes (see kDefaultMaxCachedPlans), so switching back to
+// a batch size restores its plan rather than recomputing it.
+// `allowed_batch_sizes` bounds the number of distinct batch sizes by padding
+// batches to the nearest allowed size; a single allowed size avoids resizing
+// altogether, which matters for delegates that don't support dynamic tensors,
+// as those are reapplied after every resize.
+//
+// Example:
+//
+//   std::unique_ptr<FlatBufferModel> model = ...;
+//   ops::builtin::BuiltinOpResolver resolver;
+//   std::unique_ptr<Interpreter> interpreter;
+//   InterpreterBuilder(*model, resolver)(&interpreter);
+//   BatchingInterpreter::Options options;
+//   options.max_batch_size = 8;
+//   options.allowed_batch_sizes = {1, 2, 4, 8};
+//   std::unique_ptr<BatchingInterpreter> batching_interpreter =
+//       BatchingInterpreter::Create(std::move(interpreter), options);
+//
+//   // On any number of threads:
+//   batching_interpreter->Invoke({input_data}, {output_data});
+class BatchingInterpreter {
+ public:
+  struct Options {
+    // Maximum number of batch elements in a batched invocation. Requests
+    // larger than this are rejected.
+    int max_batch_size = 8;
+    // Maximum time (in microseconds) a request waits in the queue for other
+    // requests to batch with.
+    int64_t batch_timeout_micros = 1000;
+    // If non-empty, batches are padded with zeros to the smallest allowed batch
+    // size which fits them. Must be strictly increasing, and the last element
+    // must be equal to `max_batch_size`.
+    std::vector<int> allowed_batch_sizes;
+  };
+
+  // Cumulative statistics of the batching layer.
+  struct Stats {
+    // Number of requests processed.
+    int64_t num_requests = 0;
+    // Number of batched invocations of the underlying interpreter.
+    int64_t num_batches = 0;
+    // Number of batch elements processed, not counting padding.
+    int64_t num_batch_elements = 0;
+    // Number of padding batch elements added to fit allowed batch sizes.
+    int64_t num_padding_elements = 0;
+    // Number of times the interpreter was allocated for another batch size,
+    // including the initial allocation.
+    int64_t num_resizes = 0;
+  };
+
+  // Takes ownership of `interpreter`, which may have any batch size. Returns
+  // nullptr and reports the error if the model or options are not suitable for
+  // batching.
+  static std::unique_ptr<BatchingInterpreter> Create(
+      std::unique_ptr<Interpreter> interpreter, const Options& options,
+      ErrorReporter* error_reporter = DefaultErrorReporter());
+
+  // Waits for all queued requests to finish.
+  ~BatchingInterpreter();
+
+  BatchingInterpreter(const BatchingInterpreter&) = delete;
+  BatchingInterpreter& operator=(const BatchingInterpreter&) = delete;
+
+  // Runs `batch_size` batch elements through the model. `inputs[i]` points to
+  // the data of the i-th model input and `outputs[i]` to the buffer for the
+  // i-th model output, each holding exactly `batch_size` batch elements in the
+  // layout of the corresponding TFLite tensor. Blocks until the outputs are
+  // written. Safe to call concurrently from multiple threads.
+  TfLiteStatus Invoke(const std::vector<const void*>& inputs,
+                      const std::vector<void*>& outputs, int batch_size = 1);
+
+  // Number of model inputs and outputs.
+  size_t inputs_size() const { return input_element_bytes_.size(); }
+  size_t outputs_size() const { return output_element_bytes_.size(); }
+
+  // Size in bytes of a single batch element of the i-th input or output.
+  size_t input_element_bytes(int i) const { return input_element_bytes_[i]; }
+  size_t output_element_bytes(int i) const { return output_element_bytes_[i]; }
+
+  Stats stats() const;
+
+ private:
+  // A request waiting to be processed, owned by the calling thread.
+  struct Request {
+    const std::vector<const void*>* inputs;
+    const std::vector<void*>* outputs;
+    int batch_size;
+    std::chrono::steady_clock::time_point enqueue_time;
+    TfLiteStatus status = kTfLiteError;
+    bool done = false;
+  };
+
+  BatchingInterpreter(std::unique_ptr<Interpreter> interpreter,
+                      const Options& options, ErrorReporter* error_reporter);
+
+  // Resizes the inputs of the interpreter to the given batch size, if needed,
+  // allocates its tensors, and checks or records the per-element sizes of its
+  // inputs and outputs.
+  TfLiteStatus ResizeInterpreter(int batch_size);
+
+  // Returns the batch size to run `num_elements` batch elements with.
+  int PaddedBatchSize(int num_elements) const;
+
+  // Main loop of the batching thread.
+  void ProcessBatches();
+
+  // Runs a batch of requests with `num_elements` batch elements in total.
+  TfLiteStatus RunBatch(const std::vector<Request*>& batch, int num_elements);
+
+  const Options options_;
+  ErrorReporter* const error_reporter_;
+
+  std::vector<size_t> input_element_bytes_;
+  std::vector<size_t> output_element_bytes_;
+
+  // Only accessed by the batching thread after construction.
+  std::unique_ptr<Interpreter> interpreter_;
+  // Batch size the interpreter is allocated for, or 0 before the first resize.
+  int interpreter_batch_size_ = 0;
+
+  mutable std::mutex mutex_;
+  // Signaled when requests are queued, or when shutting down.
+  std::condition_variable queue_cv_;
+  // Signaled when batches are completed.
+  std::condition_variable done_cv_;
+  std::deque<Request*> queue_;
+  int queued_elements_ = 0;
+  bool stopping_ = false;
+  Stats stats_;
+
+  std::thread batching_thread_;
+};
+
+}  // namespace batching
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_BATCHING_BATCHING_INTERPRETER_H_
@@ -0,0 +1,189 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/experimental/batching/batching_interpreter.h"
+
+#include <cstdlib>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/builtin_op_kernels.h"
+#include "tensorflow/lite/testing/util.h"
+
+namespace tflite {
+namespace batching {
+namespace {
+
+constexpr int kElementSize = 3;
+
+// Creates an interpreter computing output = input + input for a float input of
+// shape [1, kElementSize].
+std::unique_ptr<Interpreter> CreateAddInterpreter() {
+  std::unique_ptr<Interpreter> interpreter(new Interpreter);
+  interpreter->AddTensors(2);
+  interpreter->SetInputs({0});
+  interpreter->SetOutputs({1});
+  TfLiteQuantizationParams quant;
+  interpreter->SetTensorParametersReadWrite(0, kTfLiteFloat32, "input",
+                                            {1, kElementSize}, quant);
+  interpreter->SetTensorParametersReadWrite(1, kTfLiteFloat32, "output",
+                                            {1, kElementSize}, quant);
+  TfLiteAddParams* params =
+      reinterpret_cast<TfLiteAddParams*>(malloc(sizeof(TfLiteAddParams)));
+  params->activation = kTfLiteActNone;
+  interpreter->AddNodeWithParameters({0, 0}, {1}, nullptr, 0, params,
+                                     ops::builtin::Register_ADD());
+  return interpreter;
+}
+
+TEST(BatchingInterpreterTest, InvalidOptions) {
+  BatchingInterpreter::Options options;
+  options.max_batch_size = 0;
+  EXPECT_EQ(BatchingInterpreter::Create(CreateAddInterpreter(), options),
+            nullptr);
+
+  options.max_batch_size = 4;
+  options.allowed_batch_sizes = {2, 1, 4};
+  EXPECT_EQ(BatchingInterpreter::Create(CreateAddInterpreter(), options),
+            nullptr);
+
+  options.allowed_batch_sizes = {1, 2};
+  EXPECT_EQ(BatchingInterpreter::Create(CreateAddInterpreter(), options),
+            nullptr);
+}
+
+TEST(BatchingInterpreterTest, SingleRequest) {
+  BatchingInterpreter::Options options;
+  options.batch_timeout_micros = 0;
+  std::unique_ptr<BatchingInterpreter> batching_interpreter =
+      BatchingInterpreter::Create(CreateAddInterpreter(), options);
+  ASSERT_NE(batching_interpreter, nullptr);
+  ASSERT_EQ(batching_interpreter->inputs_size(), 1);
+  ASSERT_EQ(batching_interpreter->outputs_size(), 1);
+  EXPECT_EQ(batching_interpreter->input_element_bytes(0),
+            kElementSize * sizeof(float));
+
+  const float input[kElementSize] = {1.0f, 2.0f, 3.0f};
+  float output[kElementSize] = {};
+  ASSERT_EQ(batching_interpreter->Invoke({input}, {output}), kTfLiteOk);
+  EXPECT_EQ(output[0], 2.0f);
+  EXPECT_EQ(output[1], 4.0f);
+  EXPECT_EQ(output[2], 6.0f);
+
+  // Requests can't exceed the max batch size or miss inputs.
+  std::vector<float> large_input(kElementSize * 9);
+  std::vector<float> large_output(kElementSize * 9);
+  EXPECT_EQ(batching_interpreter->Invoke({large_input.data()},
+                                         {large_output.data()},
+                                         /*batch_size=*/9),
+            kTfLiteError);
+  EXPECT_EQ(batching_interpreter->Invoke({}, {output}), kTfLiteError);
+}
+
+TEST(BatchingInterpreterTest, VaryingBatchSizes) {
+  BatchingInterpreter::Options options;
+  options.max_batch_size = 4;
+  options.batch_timeout_micros = 0;
+  std::unique_ptr<BatchingInterpreter> batching_interpreter =
+      BatchingInterpreter::Create(CreateAddInterpreter(), options);
+  ASSERT_NE(batching_interpreter, nullptr);
+
+  // The single interpreter is resized whenever the batch size changes.
+  for (int batch_size : {1, 3, 3, 1, 3}) {
+    std::vector<float> input(batch_size * kElementSize);
+    std::vector<float> output(batch_size * kElementSize);
+    for (int i = 0; i < input.size(); i++) {
+      input[i] = batch_size * 100 + i;
+    }
+    ASSERT_EQ(batching_interpreter->Invoke({input.data()}, {output.data()},
+                                           batch_size),
+              kTfLiteOk);
+    for (int i = 0; i < output.size(); i++) {
+      EXPECT_EQ(output[i], 2.0f * input[i]) << "batch size " << batch_size;
+    }
+  }
+
+  const BatchingInterpreter::Stats stats = batching_interpreter->stats();
+  EXPECT_EQ(stats.num_batches, 5);
+  EXPECT_EQ(stats.num_resizes, 4);
+}
+
+TEST(BatchingInterpreterTest, ConcurrentRequests) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumRequestsPerThread = 50;
+
+  BatchingInterpreter::Options options;
+  options.max_batch_size = 4;
+  options.batch_timeout_micros = 2000;
+  options.allowed_batch_sizes = {1, 2, 4};
+  std::unique_ptr<BatchingInterpreter> batching_interpreter =
+      BatchingInterpreter::Create(CreateAddInterpreter(), options);
+  ASSERT_NE(batching_interpreter, nullptr);
+
+  std::vector<int> num_failures(kNumThreads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int r = 0; r < kNumRequestsPerThread; r++) {
+        // Alternate between single-element and two-element requests.
+        const int batch_size = 1 + r % 2;
+        std::vector<float> input(batch_size * kElementSize);
+        std::vector<float> output(batch_size * kElementSize);
+        for (int i = 0; i < input.size(); i++) {
+          input[i] = t * 1000 + r * 10 + i;
+        }
+        if (batching_interpreter->Invoke({input.data()}, {output.data()},
+                                         batch_size) != kTfLiteOk) {
+          num_failures[t]++;
+          continue;
+        }
+        for (int i = 0; i < output.size(); i++) {
+          if (output[i] != 2.0f * input[i]) {
+            num_failures[t]++;
+            break;
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < kNumThreads; t++) {
+    EXPECT_EQ(num_failures[t], 0) << "thread " << t;
+  }
+
+  const BatchingInterpreter::Stats stats = batching_interpreter->stats();
+  EXPECT_EQ(stats.num_requests, kNumThreads * kNumRequestsPerThread);
+  EXPECT_EQ(stats.num_batch_elements,
+            kNumThreads * kNumRequestsPerThread * 3 / 2);
+  EXPECT_LE(stats.num_batches, stats.num_requests);
+  EXPECT_GE(stats.num_batches * options.max_batch_size,
+            stats.num_batch_elements + stats.num_padding_elements);
+}
+
+}  // namespace
+}  // namespace batching
+}  // namespace tflite
+
+int main(int argc, char** argv) {
+  ::tflite::LogToStderr();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -22,6 +22,8 @@ limitations under the License.
 
 namespace tflite {
 
+class PrepackedWeightsCache;
+
 // This is the base class for TF Lite internal backend contexts (like a
 // RUY-based cpu backend context class). A derived internal backend context is
 // generally a collection of utilities (i.e. a thread pool etc.) for TF Lite to
@@ -92,9 +94,20 @@ class ExternalCpuBackendContext : public TfLiteExternalContext {
     return internal_backend_context_.get();
   }
 
+  // The cache, not owned, in which kernels look up and store the prepacked
+  // forms of their constant weights. May be null.
+  void set_prepacked_weights_cache(PrepackedWeightsCache* cache) {
+    prepacked_weights_cache_ = cache;
+  }
+
+  PrepackedWeightsCache* prepacked_weights_cache() const {
+    return prepacked_weights_cache_;
+  }
+
  private:
   // Note the actual internal backend context object is lazily initialized.
   std::unique_ptr<TfLiteInternalBackendContext> internal_backend_context_;
+  PrepackedWeightsCache* prepacked_weights_cache_ = nullptr;
 
   ExternalCpuBackendContext(const ExternalCpuBackendContext&) = delete;
   ExternalCpuBackendContext& operator=(const ExternalCpuBackendContext&) =
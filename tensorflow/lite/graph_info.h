@@ -53,6 +53,11 @@ class GraphInfo {
 
   // Returns the indices of the variable tensors.
   virtual const std::vector<int>& variables() const = 0;
+
+  // Returns the index of the last node which may run at the same time as the
+  // node at `index`, for graphs executed with inter-operator parallelism.
+  // Nodes from `index` to the returned index may all be running at once.
+  virtual size_t last_concurrent_node(size_t index) const { return index; }
 };
 
 // Represents a subset of nodes in a TensorFlow Lite graph.
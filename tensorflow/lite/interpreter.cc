@@ -225,6 +225,10 @@ TfLiteStatus Interpreter::ResizeInputTensorStrict(
   return primary_subgraph().ResizeInputTensorStrict(tensor_index, dims);
 }
 
+void Interpreter::SetInputShapeBuckets(const std::vector<int>& buckets) {
+  primary_subgraph().SetInputShapeBuckets(buckets);
+}
+
 TfLiteStatus Interpreter::ReleaseNonPersistentMemory() {
   // TODO(b/138790287): We could do this for all subgraphs whose tensors have
   // been allocated. However, AllocateTensors() relies on Control Flow ops to
@@ -323,6 +327,28 @@ TfLiteStatus Interpreter::SetNumThreads(int num_threads) {
   return kTfLiteOk;
 }
 
+TfLiteStatus Interpreter::SetInterOpParallelism(bool enable) {
+  for (auto& subgraph : subgraphs_) {
+    TF_LITE_ENSURE_STATUS(subgraph->SetInterOpParallelism(enable));
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Interpreter::SetPrepackedWeightsCache(
+    PrepackedWeightsCache* cache) {
+  TfLiteExternalContext* external_context =
+      external_contexts_[kTfLiteCpuBackendContext];
+  if (external_context == nullptr ||
+      external_context->type != kTfLiteCpuBackendContext) {
+    error_reporter_->Report(
+        "SetPrepackedWeightsCache requires an ExternalCpuBackendContext.");
+    return kTfLiteError;
+  }
+  static_cast<ExternalCpuBackendContext*>(external_context)
+      ->set_prepacked_weights_cache(cache);
+  return kTfLiteOk;
+}
+
 void Interpreter::SetAllowFp16PrecisionForFp32(bool allow) {
   for (auto& subgraph : subgraphs_) {
     subgraph->context()->allow_fp32_relax_to_fp16 = allow;
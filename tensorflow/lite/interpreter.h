@@ -341,6 +341,14 @@ class Interpreter {
   TfLiteStatus ResizeInputTensorStrict(int tensor_index,
                                        const std::vector<int>& dims);
 
+  // WARNING: Experimental interface, subject to change
+  // Makes subsequent calls to ResizeInputTensor() and ResizeInputTensorStrict()
+  // round up unknown dimensions (`-1` in `dims_signature`) to the smallest of
+  // `buckets` (sorted in increasing order) that fits them, so that e.g.
+  // variable-length inputs of similar lengths share a memory plan. The caller
+  // must pad input data to the resulting tensor shape.
+  void SetInputShapeBuckets(const std::vector<int>& buckets);
+
   // This releases memory held by non-persistent tensors. It does NOT re-perform
   // memory planning.
   // AllocateTensors needs to be called before next invocation.
@@ -373,6 +381,25 @@ class Interpreter {
   /// available to itself.
   TfLiteStatus SetNumThreads(int num_threads);
 
+  /// Enable or disable running operators which don't depend on each other
+  /// concurrently, e.g. the branches of multi-tower models, on the threads set
+  /// by SetNumThreads(). Up to four operators run at once, using one thread
+  /// each; operators running alone use all threads as usual. Delegate
+  /// kernels, control flow and custom operators always run alone. Graphs with
+  /// dynamic tensors, or with a profiler set, run one operator at a time.
+  /// Returns an error if the graph was made immutable by a delegate.
+  /// WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetInterOpParallelism(bool enable);
+
+  /// Set the cache in which kernels look up the prepacked forms of their
+  /// constant weights, and store them after packing, e.g. to share packed
+  /// weights between interpreters of the same model or, with a cache file,
+  /// between runs. The cache must outlive the interpreter. Must be called
+  /// before the first Invoke(). Returns an error if the CPU backend context
+  /// set with SetExternalContext() isn't an ExternalCpuBackendContext.
+  /// WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetPrepackedWeightsCache(PrepackedWeightsCache* cache);
+
   /// Allow float16 precision for FP32 calculation when possible.
   /// default: not allow.
   /// WARNING: This is an experimental API and subject to change.
@@ -21,12 +21,16 @@ limitations under the License.
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <cstring>
+
 #include "tensorflow/lite/allocation.h"
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/core/api/error_reporter.h"
 #include "tensorflow/lite/core/api/flatbuffer_conversions.h"
+#include "tensorflow/lite/core/api/offline_memory_allocation.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
+#include "tensorflow/lite/minimal_logging.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 #include "tensorflow/lite/shared_library.h"
 #include "tensorflow/lite/tflite_with_xnnpack_optional.h"
@@ -110,6 +114,10 @@ TfLiteStatus ParseSparseIndexVector(const DimensionMetadata* src,
 
 const char* kEmptyTensorName = "";
 
+// Number of int32 values preceding the tensor offsets in the offline memory
+// allocation metadata: version, subgraph index and number of offsets.
+constexpr int kOfflineMemoryAllocationHeaderSize = 3;
+
 // Using weak symbols to create a delegate allows automatic injection of the
 // delegate simply by adding it as a dependency.
 // For flex delegate, see also the strong override in
@@ -548,6 +556,58 @@ TfLiteStatus InterpreterBuilder::ParseTensors(
   return status;
 }
 
+void InterpreterBuilder::ParseOfflineMemoryPlans(Interpreter* interpreter) {
+  if (!model_->metadata() || !model_->buffers()) {
+    return;
+  }
+  for (const Metadata* metadata : *model_->metadata()) {
+    if (!metadata->name() ||
+        std::strcmp(metadata->name()->c_str(),
+                    kOfflineMemoryAllocationMetadata) != 0) {
+      continue;
+    }
+    // Offline plans are only an optimization: the arena planner plans memory
+    // at runtime for subgraphs without one, so unusable plans are ignored.
+    const Buffer* buffer = metadata->buffer() < model_->buffers()->size()
+                               ? model_->buffers()->Get(metadata->buffer())
+                               : nullptr;
+    if (!buffer || !buffer->data() ||
+        buffer->data()->size() <
+            kOfflineMemoryAllocationHeaderSize * sizeof(int32_t)) {
+      TFLITE_LOG(TFLITE_LOG_WARNING,
+                 "Ignoring malformed offline memory allocation metadata.");
+      continue;
+    }
+    // The buffer isn't guaranteed to be aligned for int32_t.
+    std::vector<int32_t> values(buffer->data()->size() / sizeof(int32_t));
+    std::memcpy(values.data(), buffer->data()->data(),
+                values.size() * sizeof(int32_t));
+    const int version = values[0];
+    const int subgraph_index = values[1];
+    const int num_tensors = values[2];
+    if (version != 0) {
+      TFLITE_LOG(TFLITE_LOG_WARNING,
+                 "Ignoring offline memory allocation metadata with "
+                 "unsupported version %d.",
+                 version);
+      continue;
+    }
+    Subgraph* subgraph = interpreter->subgraph(subgraph_index);
+    if (subgraph == nullptr || num_tensors < 0 ||
+        static_cast<size_t>(num_tensors) != subgraph->tensors_size() ||
+        values.size() - kOfflineMemoryAllocationHeaderSize !=
+            subgraph->tensors_size()) {
+      TFLITE_LOG(TFLITE_LOG_WARNING,
+                 "Ignoring offline memory allocation metadata which doesn't "
+                 "match subgraph %d.",
+                 subgraph_index);
+      continue;
+    }
+    subgraph->SetOfflinePlannedOffsets(std::vector<int32_t>(
+        values.begin() + kOfflineMemoryAllocationHeaderSize, values.end()));
+  }
+}
+
 TfLiteStatus InterpreterBuilder::ApplyDelegates(Interpreter* interpreter,
                                                 int num_threads) {
   // Apply Flex delegate if applicable.
@@ -667,6 +727,8 @@ TfLiteStatus InterpreterBuilder::operator()(
     modified_subgraph->SetVariables(std::move(variables));
   }
 
+  ParseOfflineMemoryPlans(interpreter->get());
+
   if (num_fp32_tensors_ > 0) {
     (*interpreter)->lazy_delegate_provider_ =
         MaybeCreateXNNPACKDelegate(num_threads);
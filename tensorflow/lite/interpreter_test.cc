@@ -17,7 +17,11 @@ limitations under the License.
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -609,6 +613,48 @@ TEST(BasicInterpreter, ResizingTensorsStrict) {
   ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
 }
 
+TEST(BasicInterpreter, ResizingTensorsToBuckets) {
+  Interpreter interpreter;
+  ASSERT_EQ(interpreter.AddTensors(1), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInputs({0}), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetOutputs({0}), kTfLiteOk);
+
+  std::vector<int> dims_signature = {1, -1, 3};
+  ASSERT_EQ(interpreter.SetTensorParametersReadWrite(
+                0, kTfLiteFloat32, "", {1, 1, 3}, TfLiteQuantizationParams(),
+                false, &dims_signature),
+            kTfLiteOk);
+  interpreter.SetInputShapeBuckets({4, 8, 16});
+
+  int t = interpreter.inputs()[0];
+  TfLiteTensor* tensor = interpreter.tensor(t);
+
+  // Unknown dimensions are rounded up to the next bucket.
+  ASSERT_EQ(interpreter.ResizeInputTensorStrict(t, {1, 5, 3}), kTfLiteOk);
+  ASSERT_EQ(tensor->dims->size, 3);
+  EXPECT_EQ(tensor->dims->data[1], 8);
+  EXPECT_EQ(tensor->bytes, 24 * sizeof(float));
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+
+  // Resizing within the same bucket doesn't invalidate the allocation.
+  ASSERT_EQ(interpreter.ResizeInputTensor(t, {1, 7, 3}), kTfLiteOk);
+  EXPECT_EQ(tensor->dims->data[1], 8);
+  EXPECT_NE(tensor->data.raw, nullptr);
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+
+  // Known dimensions and dimensions past the last bucket are kept.
+  ASSERT_EQ(interpreter.ResizeInputTensor(t, {1, 17, 5}), kTfLiteOk);
+  EXPECT_EQ(tensor->dims->data[1], 17);
+  EXPECT_EQ(tensor->dims->data[2], 5);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+
+  // Rounding can be disabled.
+  interpreter.SetInputShapeBuckets({});
+  ASSERT_EQ(interpreter.ResizeInputTensor(t, {1, 5, 3}), kTfLiteOk);
+  EXPECT_EQ(tensor->dims->data[1], 5);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+}
+
 // Simple op that does input = output.
 TfLiteRegistration GetPassthroughOpRegistration() {
   TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
@@ -695,6 +741,114 @@ TEST(BasicInterpreter, OneOpInterpreter) {
   ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
 }
 
+// Number of rendezvous ops which started running.
+std::atomic<int> num_rendezvous_ops_started(0);
+
+// Op that does output = input, once two rendezvous ops are running at the
+// same time. Fails if the other doesn't start within 10 seconds.
+TfLiteRegistration GetRendezvousOpRegistration() {
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+  reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+    const TfLiteTensor* input = GetInput(context, node, 0);
+    TfLiteTensor* output = GetOutput(context, node, 0);
+    return context->ResizeTensor(context, output,
+                                 TfLiteIntArrayCopy(input->dims));
+  };
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    ++num_rendezvous_ops_started;
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (num_rendezvous_ops_started < 2) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        return kTfLiteError;
+      }
+      std::this_thread::yield();
+    }
+    const TfLiteTensor* input = GetInput(context, node, 0);
+    TfLiteTensor* output = GetOutput(context, node, 0);
+    std::copy(input->data.f, input->data.f + NumElements(input),
+              output->data.f);
+    return kTfLiteOk;
+  };
+  return reg;
+}
+
+// Op that sums its inputs, of the same shape.
+TfLiteRegistration GetSumOpRegistration() {
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+  reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+    const TfLiteTensor* input = GetInput(context, node, 0);
+    TfLiteTensor* output = GetOutput(context, node, 0);
+    return context->ResizeTensor(context, output,
+                                 TfLiteIntArrayCopy(input->dims));
+  };
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    TfLiteTensor* output = GetOutput(context, node, 0);
+    std::fill(output->data.f, output->data.f + NumElements(output), 0.0f);
+    for (int i = 0; i < NumInputs(node); ++i) {
+      const TfLiteTensor* input = GetInput(context, node, i);
+      for (int j = 0; j < NumElements(output); ++j) {
+        output->data.f[j] += input->data.f[j];
+      }
+    }
+    return kTfLiteOk;
+  };
+  return reg;
+}
+
+TEST(BasicInterpreter, InterOpParallelism) {
+  Interpreter interpreter;
+  ASSERT_EQ(interpreter.AddTensors(5), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInputs({0}), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetOutputs({4}), kTfLiteOk);
+  TfLiteQuantizationParams quantized;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_EQ(interpreter.SetTensorParametersReadWrite(i, kTfLiteFloat32, "",
+                                                       {3}, quantized),
+              kTfLiteOk);
+  }
+
+  // Two branches computing tensor 0 + tensor 0, whose rendezvous ops only
+  // complete if they run at the same time.
+  TfLiteRegistration rendezvous = GetRendezvousOpRegistration();
+  TfLiteRegistration sum = GetSumOpRegistration();
+  ASSERT_EQ(interpreter.AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr,
+                                              &rendezvous),
+            kTfLiteOk);
+  ASSERT_EQ(
+      interpreter.AddNodeWithParameters({1}, {2}, nullptr, 0, nullptr, &sum),
+      kTfLiteOk);
+  ASSERT_EQ(interpreter.AddNodeWithParameters({0}, {3}, nullptr, 0, nullptr,
+                                              &rendezvous),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter.AddNodeWithParameters({2, 3}, {4}, nullptr, 0,
+                                              nullptr, &sum),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter.SetNumThreads(2), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInterOpParallelism(true), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+
+  // Independent nodes run next to each other, but the execution plan is left
+  // as is.
+  EXPECT_THAT(interpreter.execution_plan(), testing::ElementsAre(0, 1, 2, 3));
+
+  float* input = interpreter.typed_tensor<float>(0);
+  for (int i = 0; i < 3; ++i) {
+    input[i] = i + 1;
+  }
+  for (int run = 0; run < 2; ++run) {
+    num_rendezvous_ops_started = 0;
+    ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+    const float* output = interpreter.typed_tensor<float>(4);
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(output[i], 2 * (i + 1));
+    }
+  }
+
+  ASSERT_EQ(interpreter.SetInterOpParallelism(false), kTfLiteOk);
+  EXPECT_THAT(interpreter.execution_plan(), testing::ElementsAre(0, 1, 2, 3));
+}
+
 TEST(BasicInterpreter, ReleaseNonPersistentMemory) {
   Interpreter interpreter;
   ASSERT_EQ(interpreter.AddTensors(2), kTfLiteOk);
@@ -20,6 +20,7 @@ limitations under the License.
 #include <algorithm>
 #include <cstdint>
 #include <limits>
+#include <vector>
 
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
@@ -27,12 +28,15 @@ limitations under the License.
 #include "tensorflow/lite/kernels/internal/compatibility.h"
 #include "tensorflow/lite/kernels/internal/optimized/batch_matmul.h"
 #include "tensorflow/lite/kernels/internal/optimized/optimized_ops.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/batch_matmul.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/block_sparse.h"
 #include "tensorflow/lite/kernels/internal/reference/reference_ops.h"
 #include "tensorflow/lite/kernels/internal/tensor.h"
 #include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
 #include "tensorflow/lite/kernels/internal/tensor_utils.h"
 #include "tensorflow/lite/kernels/internal/types.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/kernels/prepacked_weights.h"
 
 namespace tflite {
 namespace ops {
@@ -65,6 +69,11 @@ struct OpData {
   int scratch_tensor_index;
   bool rhs_transposed;
   bool compute_row_sums = false;
+  // A constant RHS with sparsity parameters is packed once, transposed, as a
+  // block-sparse matrix.
+  bool is_sparse = false;
+  optimized_ops::BlockSparseMatrix<float> sparse_rhs;
+  optimized_ops::BlockSparseMatrix<int8_t> sparse_rhs_int8;
 };
 
 struct OpContext {
@@ -277,6 +286,80 @@ TfLiteStatus InitializeTemporaries(TfLiteContext* context, TfLiteNode* node,
   return kTfLiteOk;
 }
 
+// Returns the dense values of a sparse RHS in <C, B> (adjoint) order.
+template <typename T>
+std::vector<T> DensifyTransposedRhs(const TfLiteTensor* rhs, bool adj_y) {
+  const RuntimeShape rhs_shape = GetTensorShape(rhs);
+  std::vector<T> dense = optimized_ops::DensifySparseWeights(
+      *rhs->sparsity, rhs_shape, GetTensorData<T>(rhs));
+  if (adj_y) return dense;
+  const int rows = rhs_shape.Dims(0);
+  const int cols = rhs_shape.Dims(1);
+  std::vector<T> transposed(dense.size());
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      transposed[j * rows + i] = dense[i * cols + j];
+    }
+  }
+  return transposed;
+}
+
+// Checks that a RHS with sparsity parameters is supported by EvalSparse().
+TfLiteStatus CheckSparseRhs(TfLiteContext* context,
+                            const OpContext& op_context) {
+  const TfLiteTensor* lhs = op_context.lhs;
+  const TfLiteTensor* rhs = op_context.rhs;
+  TF_LITE_ENSURE_MSG(context,
+                     lhs->type == rhs->type && !op_context.params->adj_x &&
+                         NumDimensions(rhs) == 2 && IsConstantTensor(rhs),
+                     "Sparse BatchMatMul requires a constant 2D RHS of the "
+                     "LHS type and no LHS adjoint.");
+  if (rhs->type == kTfLiteInt8) {
+    // Stored zeros must be real zeros.
+    TF_LITE_ENSURE_EQ(context, rhs->params.zero_point, 0);
+  }
+  return kTfLiteOk;
+}
+
+// Packs a constant RHS with sparsity parameters on first use, or takes it
+// from the prepacked weights cache.
+void PackSparseRhs(TfLiteContext* context, const OpContext& op_context,
+                   OpData* op_data) {
+  const TfLiteTensor* rhs = op_context.rhs;
+  const bool adj_y = op_context.params->adj_y;
+  const int accum_depth = SizeOfDimension(rhs, adj_y ? 1 : 0);
+  const int num_units = SizeOfDimension(rhs, adj_y ? 0 : 1);
+  const int block_size =
+      optimized_ops::BlockSizeFromSparsity(*rhs->sparsity, accum_depth);
+  if (rhs->type == kTfLiteFloat32) {
+    GetOrPackBlockSparseMatrix(
+        context, rhs,
+        adj_y ? "batch_matmul/block_sparse/float32/adj_y"
+              : "batch_matmul/block_sparse/float32",
+        num_units, accum_depth, block_size,
+        [&](optimized_ops::BlockSparseMatrix<float>* matrix) {
+          const std::vector<float> dense =
+              DensifyTransposedRhs<float>(rhs, adj_y);
+          optimized_ops::PackBlockSparseMatrix(dense.data(), num_units,
+                                               accum_depth, block_size, matrix);
+        },
+        &op_data->sparse_rhs);
+  } else {
+    GetOrPackBlockSparseMatrix(
+        context, rhs,
+        adj_y ? "batch_matmul/block_sparse/int8/adj_y"
+              : "batch_matmul/block_sparse/int8",
+        num_units, accum_depth, block_size,
+        [&](optimized_ops::BlockSparseMatrix<int8_t>* matrix) {
+          const std::vector<int8_t> dense =
+              DensifyTransposedRhs<int8_t>(rhs, adj_y);
+          optimized_ops::PackBlockSparseMatrix(dense.data(), num_units,
+                                               accum_depth, block_size, matrix);
+        },
+        &op_data->sparse_rhs_int8);
+  }
+}
+
 TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_EQ(context, NumInputs(node), 2);
   TF_LITE_ENSURE_EQ(context, NumOutputs(node), 1);
@@ -343,6 +426,12 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
                             : extended_rhs_shape.Dims(output_rank - 2);
 
   TF_LITE_ENSURE_EQ(context, accum_dim_lhs, accum_dim_rhs);
+
+  op_data->is_sparse = rhs_data->sparsity != nullptr;
+  if (op_data->is_sparse) {
+    TF_LITE_ENSURE_STATUS(CheckSparseRhs(context, op_context));
+  }
+
   TfLiteStatus status =
       ResizeOutputTensor(context, extended_lhs_shape, extended_rhs_shape, adj_x,
                          adj_y, output_rank, output);
@@ -543,6 +632,33 @@ TfLiteTensor* GetTempLhs(TfLiteContext* context, TfLiteNode* node,
   return transposed_lhs;
 }
 
+// Multiplies by a sparse RHS, for every kernel type, since the dense kernels
+// cannot read its compressed values.
+TfLiteStatus EvalSparse(TfLiteContext* context, const OpData* op_data,
+                        const TfLiteTensor* lhs, TfLiteTensor* output) {
+  FullyConnectedParams op_params;
+  if (lhs->type == kTfLiteFloat32) {
+    optimized_ops::BatchMatMulSparseWeight(
+        op_params, op_data->sparse_rhs, GetTensorShape(lhs),
+        GetTensorData<float>(lhs), GetTensorShape(output),
+        GetTensorData<float>(output),
+        CpuBackendContext::GetFromContext(context));
+  } else {
+    op_params.input_offset = -lhs->params.zero_point;
+    op_params.output_offset = output->params.zero_point;
+    op_params.output_multiplier = op_data->output_multiplier;
+    op_params.output_shift = op_data->output_shift;
+    op_params.quantized_activation_min = op_data->output_activation_min;
+    op_params.quantized_activation_max = op_data->output_activation_max;
+    optimized_ops::BatchMatMulSparseWeight(
+        op_params, op_data->sparse_rhs_int8, GetTensorShape(lhs),
+        GetTensorData<int8_t>(lhs), GetTensorShape(output),
+        GetTensorData<int8_t>(output),
+        CpuBackendContext::GetFromContext(context));
+  }
+  return kTfLiteOk;
+}
+
 // Perform a batch matrix multiply on
 // LHS <..., A, B>  X  RHS<..., B, C>
 // where the leading dimensions of LHS and RHS obey broadcasting rules
@@ -561,6 +677,10 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   const TfLiteTensor* lhs = GetInput(context, node, kInputLHSTensor);
   const TfLiteTensor* rhs = GetInput(context, node, kInputRHSTensor);
   TfLiteTensor* output = GetOutput(context, node, kOutputTensor);
+  if (op_data->is_sparse) {
+    PackSparseRhs(context, op_context, op_data);
+    return EvalSparse(context, op_data, lhs, output);
+  }
   RuntimeShape orig_lhs_shape = GetTensorShape(lhs);
   RuntimeShape orig_rhs_shape = GetTensorShape(rhs);
 
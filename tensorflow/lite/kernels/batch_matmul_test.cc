@@ -275,6 +275,68 @@ TEST_P(BatchMatMulOpTest, Float32Test_BroadcastFromRHS) {
   EXPECT_THAT(model.GetOutputShape(), ElementsAreArray({3, 1, 4, 2}));
 }
 
+// The RHS is a constant with sparsity parameters.
+class SparseBatchMatMulOpModel : public SingleOpModel {
+ public:
+  SparseBatchMatMulOpModel(const TensorData& lhs, const TensorData& rhs,
+                           std::initializer_list<float> rhs_data,
+                           bool adj_y = false) {
+    lhs_id_ = AddInput(lhs);
+    rhs_id_ = AddConstSparseInput(rhs, rhs_data);
+    output_id_ = AddOutput(lhs.type);
+    SetBuiltinOp(BuiltinOperator_BATCH_MATMUL,
+                 BuiltinOptions_BatchMatMulOptions,
+                 CreateBatchMatMulOptions(builder_, /*adj_x=*/false, adj_y)
+                     .Union());
+    BuildInterpreter({GetShape(lhs_id_), GetShape(rhs_id_)});
+  }
+
+  int lhs() const { return lhs_id_; }
+  std::vector<float> GetOutput() { return ExtractVector<float>(output_id_); }
+  std::vector<int32_t> GetOutputShape() { return GetTensorShape(output_id_); }
+
+ protected:
+  int lhs_id_;
+  int rhs_id_;
+  int output_id_;
+};
+
+TEST_P(BatchMatMulOpTest, Float32Test_SparseRHS) {
+  TensorData rhs = {};
+  rhs.type = TensorType_FLOAT32;
+  rhs.shape = {4, 3};
+  rhs.traversal_order = {0, 1};
+  rhs.format = {kTfLiteDimDense, kTfLiteDimSparseCSR};
+  SparseBatchMatMulOpModel model({TensorType_FLOAT32, {2, 4}}, rhs,
+                                 {1, 0, 0,  //
+                                  0, 0, 2,  //
+                                  0, 0, 0,  //
+                                  3, 0, 1});
+  model.PopulateTensor<float>(model.lhs(), {1, 2, 3, 4, 5, 6, 7, 8});
+  model.Invoke();
+  EXPECT_THAT(model.GetOutput(), ElementsAreArray({13., 0., 8., 29., 0., 20.}));
+  EXPECT_THAT(model.GetOutputShape(), ElementsAreArray({2, 3}));
+}
+
+TEST_P(BatchMatMulOpTest, Float32Test_BlockSparseRHSAdjoint) {
+  TensorData rhs = {};
+  rhs.type = TensorType_FLOAT32;
+  rhs.shape = {3, 4};
+  rhs.traversal_order = {0, 1, 2};
+  rhs.format = {kTfLiteDimDense, kTfLiteDimSparseCSR};
+  rhs.block_map = {1};
+  rhs.block_size = {4};
+  SparseBatchMatMulOpModel model({TensorType_FLOAT32, {1, 2, 4}}, rhs,
+                                 {1, 0, 0, 3,  //
+                                  0, 0, 0, 0,  //
+                                  0, 2, 0, 1},
+                                 /*adj_y=*/true);
+  model.PopulateTensor<float>(model.lhs(), {1, 2, 3, 4, 5, 6, 7, 8});
+  model.Invoke();
+  EXPECT_THAT(model.GetOutput(), ElementsAreArray({13., 0., 8., 29., 0., 20.}));
+  EXPECT_THAT(model.GetOutputShape(), ElementsAreArray({1, 2, 3}));
+}
+
 INSTANTIATE_TEST_SUITE_P(
     BatchMatMulOpTest, BatchMatMulOpTest,
     ::testing::ValuesIn(SingleOpTest::GetKernelTags(*kKernelMap)));
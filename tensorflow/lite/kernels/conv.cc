@@ -30,6 +30,8 @@ limitations under the License.
 #include "tensorflow/lite/kernels/internal/optimized/multithreaded_conv.h"
 #endif
 #include "tensorflow/lite/kernels/internal/optimized/optimized_ops.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/block_sparse.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/conv.h"
 #include "tensorflow/lite/kernels/internal/quantization_util.h"
 #include "tensorflow/lite/kernels/internal/reference/conv.h"
 #include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
@@ -38,6 +40,7 @@ limitations under the License.
 #include "tensorflow/lite/kernels/internal/tensor_utils.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
 #include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/kernels/prepacked_weights.h"
 
 namespace tflite {
 namespace ops {
@@ -103,6 +106,13 @@ struct OpData {
   bool supports_multithreaded_kernel = false;
   bool is_hybrid_per_channel = false;
   bool compute_hybrid_row_sums = true;
+
+  // Filters with sparsity parameters are packed once as block-sparse
+  // [channels_out, filter_height * filter_width * channels_in] matrices, and
+  // used by every kernel type in place of the dense kernels.
+  bool is_sparse = false;
+  optimized_ops::BlockSparseMatrix<float> sparse_filter;
+  optimized_ops::BlockSparseMatrix<int8_t> sparse_filter_int8;
 };
 
 inline PaddingType RuntimePaddingType(TfLitePadding padding) {
@@ -223,13 +233,15 @@ static TfLiteStatus AllocateTemporaryTensorsIfRequired(TfLiteContext* context,
   // buffer to store the results.
   // This path is only used for float processing, so only create the buffer if
   // we're running with that data type.
-  data->need_hwcn_weights =
-      input->type == kTfLiteFloat32 && data->supports_multithreaded_kernel;
+  data->need_hwcn_weights = input->type == kTfLiteFloat32 &&
+                            data->supports_multithreaded_kernel &&
+                            !data->is_sparse;
 
   // We don't always need to allocate im2col. It is only used in some versions
   // of the optimized Conv. This test just mimics something that happens inside
   // optimized_ops.h, in order to avoid a DCHECK(!im2col_data).
   data->need_im2col =
+      !data->is_sparse &&
       IsIm2ColRequired(input, params, filter, data, is_hybrid, kernel_type);
 
   int temporaries_count = 0;
@@ -296,6 +308,42 @@ static TfLiteStatus AllocateTemporaryTensorsIfRequired(TfLiteContext* context,
   return kTfLiteOk;
 }
 
+// Packs a filter with sparsity parameters on first use, or takes it from the
+// prepacked weights cache.
+void PackSparseFilter(TfLiteContext* context, const TfLiteTensor* filter,
+                      OpData* data) {
+  const RuntimeShape filter_shape = GetTensorShape(filter);
+  const int channels_out = filter_shape.Dims(0);
+  const int channels_in = filter_shape.Dims(3);
+  const int cols = filter_shape.FlatSize() / channels_out;
+  // Blocks must not straddle two filter positions.
+  const int block_size =
+      optimized_ops::BlockSizeFromSparsity(*filter->sparsity, channels_in);
+  if (filter->type == kTfLiteFloat32) {
+    GetOrPackBlockSparseMatrix(
+        context, filter, "conv2d/block_sparse/float32", channels_out, cols,
+        block_size,
+        [&](optimized_ops::BlockSparseMatrix<float>* matrix) {
+          const std::vector<float> dense = optimized_ops::DensifySparseWeights(
+              *filter->sparsity, filter_shape, GetTensorData<float>(filter));
+          optimized_ops::PackBlockSparseMatrix(dense.data(), channels_out,
+                                               cols, block_size, matrix);
+        },
+        &data->sparse_filter);
+  } else {
+    GetOrPackBlockSparseMatrix(
+        context, filter, "conv2d/block_sparse/int8", channels_out, cols,
+        block_size,
+        [&](optimized_ops::BlockSparseMatrix<int8_t>* matrix) {
+          const std::vector<int8_t> dense = optimized_ops::DensifySparseWeights(
+              *filter->sparsity, filter_shape, GetTensorData<int8_t>(filter));
+          optimized_ops::PackBlockSparseMatrix(dense.data(), channels_out,
+                                               cols, block_size, matrix);
+        },
+        &data->sparse_filter_int8);
+  }
+}
+
 TfLiteStatus Prepare(KernelType kernel_type, TfLiteContext* context,
                      TfLiteNode* node) {
   auto* params = reinterpret_cast<TfLiteConvParams*>(node->builtin_data);
@@ -367,12 +415,34 @@ TfLiteStatus Prepare(KernelType kernel_type, TfLiteContext* context,
     }
   }
 
+  data->is_sparse = filter->sparsity != nullptr;
+  if (data->is_sparse) {
+    TF_LITE_ENSURE_MSG(
+        context,
+        (input_type == kTfLiteFloat32 && filter->type == kTfLiteFloat32) ||
+            (input_type == kTfLiteInt8 && filter->type == kTfLiteInt8),
+        "Sparse filters are only supported for float32 and int8 Conv2D.");
+    TF_LITE_ENSURE(context, IsConstantTensor(filter));
+    // Stored zeros must be real zeros, which per-channel quantization
+    // guarantees.
+    const auto* affine_quantization =
+        reinterpret_cast<TfLiteAffineQuantization*>(
+            filter->quantization.params);
+    if (filter->type == kTfLiteInt8 && affine_quantization &&
+        affine_quantization->zero_point) {
+      for (int i = 0; i < affine_quantization->zero_point->size; ++i) {
+        TF_LITE_ENSURE_EQ(context, affine_quantization->zero_point->data[i],
+                          0);
+      }
+    }
+  }
+
   // The multi-threaded kernel supports neither dilation nor hybrid kernels, and
   // is incompatible with mutable input filters that might change between evals.
   data->supports_multithreaded_kernel =
       (kernel_type == kMultithreadOptimized) &&
       (context->recommended_num_threads != 1) && !is_hybrid &&
-      (params->dilation_width_factor == 1) &&
+      !data->is_sparse && (params->dilation_width_factor == 1) &&
       (params->dilation_height_factor == 1) &&
       (filter->allocation_type != kTfLiteArenaRw) &&
       !IsDynamicTensor(filter);
@@ -928,6 +998,45 @@ void EvalHybrid(TfLiteContext* context, TfLiteNode* node,
   }
 }
 
+void EvalSparse(TfLiteContext* context, TfLiteConvParams* params,
+                OpData* data, const TfLiteTensor* input,
+                const TfLiteTensor* filter, const TfLiteTensor* bias,
+                TfLiteTensor* output) {
+  ConvParams op_params;
+  op_params.padding_type = RuntimePaddingType(params->padding);
+  op_params.padding_values.width = data->padding.width;
+  op_params.padding_values.height = data->padding.height;
+  op_params.stride_width = params->stride_width;
+  op_params.stride_height = params->stride_height;
+  op_params.dilation_width_factor = params->dilation_width_factor;
+  op_params.dilation_height_factor = params->dilation_height_factor;
+  const int filter_height = SizeOfDimension(filter, 1);
+  const int filter_width = SizeOfDimension(filter, 2);
+  if (input->type == kTfLiteFloat32) {
+    CalculateActivationRange(params->activation,
+                             &op_params.float_activation_min,
+                             &op_params.float_activation_max);
+    optimized_ops::ConvSparseWeight(
+        op_params, data->sparse_filter, filter_height, filter_width,
+        GetTensorShape(input), GetTensorData<float>(input),
+        GetTensorData<float>(bias), GetTensorShape(output),
+        GetTensorData<float>(output),
+        CpuBackendContext::GetFromContext(context));
+  } else {
+    op_params.input_offset = -input->params.zero_point;
+    op_params.output_offset = output->params.zero_point;
+    op_params.quantized_activation_min = data->output_activation_min;
+    op_params.quantized_activation_max = data->output_activation_max;
+    optimized_ops::ConvPerChannelSparseWeight(
+        op_params, data->per_channel_output_multiplier.data(),
+        data->per_channel_output_shift.data(), data->sparse_filter_int8,
+        filter_height, filter_width, GetTensorShape(input),
+        GetTensorData<int8_t>(input), GetTensorData<int32_t>(bias),
+        GetTensorShape(output), GetTensorData<int8_t>(output),
+        CpuBackendContext::GetFromContext(context));
+  }
+}
+
 template <KernelType kernel_type, TfLiteType input_type>
 TfLiteStatus EvalImpl(TfLiteContext* context, TfLiteNode* node) {
   auto* params = reinterpret_cast<TfLiteConvParams*>(node->builtin_data);
@@ -952,6 +1061,12 @@ TfLiteStatus EvalImpl(TfLiteContext* context, TfLiteNode* node) {
     data->have_weights_been_transposed = true;
   }
 
+  if (data->is_sparse) {
+    PackSparseFilter(context, filter, data);
+    EvalSparse(context, params, data, input, filter, bias, output);
+    return kTfLiteOk;
+  }
+
   TFLITE_DCHECK_EQ(input_type, input->type);
   switch (input_type) {  // Already know in/outtypes are same.
     case kTfLiteFloat32:
@@ -1701,6 +1701,116 @@ TEST_P(QuantizedConvolutionOpTest, SimpleTestExplicitQuantizedOp) {
                              }));
 }
 
+class SparseConvolutionOpModel : public SingleOpModel {
+ public:
+  SparseConvolutionOpModel(TfLiteRegistration* registration,
+                           const TensorData& input, const TensorData& filter,
+                           std::initializer_list<float> filter_data,
+                           int stride_width, int stride_height,
+                           enum Padding padding, int num_threads = 1) {
+    input_ = AddInput(input);
+    filter_ = AddConstSparseInput(filter, filter_data);
+    bias_ = AddInput({TensorType_FLOAT32, {filter.shape[0]}});
+    output_ = AddOutput({TensorType_FLOAT32, {}});
+
+    SetBuiltinOp(BuiltinOperator_CONV_2D, BuiltinOptions_Conv2DOptions,
+                 CreateConv2DOptions(builder_, padding, stride_width,
+                                     stride_height, ActivationFunctionType_NONE)
+                     .Union());
+    resolver_ = absl::make_unique<SingleOpResolver>(BuiltinOperator_CONV_2D,
+                                                    registration);
+    BuildInterpreter({GetShape(input_), GetShape(filter_), GetShape(bias_)},
+                     num_threads, /*allow_fp32_relax_to_fp16=*/false,
+                     /*apply_delegate=*/false);
+  }
+
+  void SetBias(std::initializer_list<float> f) { PopulateTensor(bias_, f); }
+  void SetInput(std::initializer_list<float> data) {
+    PopulateTensor(input_, data);
+  }
+  std::vector<float> GetOutput() { return ExtractVector<float>(output_); }
+
+ private:
+  int input_;
+  int filter_;
+  int bias_;
+  int output_;
+};
+
+TensorData SparseFilter(std::vector<int> shape) {
+  TensorData filter = {};
+  filter.type = TensorType_FLOAT32;
+  filter.shape = shape;
+  filter.traversal_order = {0, 1, 2, 3};
+  filter.format = {kTfLiteDimDense, kTfLiteDimSparseCSR, kTfLiteDimDense,
+                   kTfLiteDimDense};
+  return filter;
+}
+
+TEST_P(ConvolutionOpTest, SparsePaddingTest) {
+  // Same as PaddingTest, with the second filter pruned.
+  SparseConvolutionOpModel m(GetRegistration(),
+                             {TensorType_FLOAT32, {1, 2, 4, 1}},
+                             SparseFilter({3, 2, 2, 1}),
+                             {
+                                 1, 2, 3, 4,    // first 2x2 filter
+                                 0, 0, 0, 0,    // second 2x2 filter
+                                 -1, -1, 1, 1,  // third 2x2 filter
+                             },
+                             /*stride_width=*/1, /*stride_height=*/1,
+                             Padding_SAME);
+  m.SetInput({
+      1, 1, 1, 1,  // row = 1
+      2, 2, 3, 2,  // row = 2
+  });
+  m.SetBias({1, 2, 3});
+
+  m.Invoke();
+
+  EXPECT_THAT(m.GetOutput(), ElementsAreArray({
+                                 18, 2, 5,   // first row, left
+                                 22, 2, 6,   //
+                                 21, 2, 6,   //
+                                 8,  2, 4,   // first row, right
+                                 7,  2, -1,  // second row, left
+                                 9,  2, -2,  //
+                                 8,  2, -2,  //
+                                 3,  2, 1,   // second row, right
+                             }));
+}
+
+TEST_P(ConvolutionOpTest, SparsePointwiseTest) {
+  // Two 1x1 filters over 8 input channels, in blocks of 4.
+  TensorData filter = SparseFilter({2, 1, 1, 8});
+  filter.traversal_order = {0, 1, 2, 3, 4};
+  filter.format = {kTfLiteDimDense, kTfLiteDimDense, kTfLiteDimDense,
+                   kTfLiteDimSparseCSR};
+  filter.block_map = {3};
+  filter.block_size = {4};
+  SparseConvolutionOpModel m(GetRegistration(),
+                             {TensorType_FLOAT32, {1, 1, 3, 8}}, filter,
+                             {
+                                 1, 2, 3, 4, 0, 0, 0, 0,    // first filter
+                                 0, 0, 0, 0, 1, -1, 1, -1,  // second filter
+                             },
+                             /*stride_width=*/1, /*stride_height=*/1,
+                             Padding_VALID, /*num_threads=*/2);
+  m.SetInput({
+      1, 1, 1, 1, 1, 1, 1, 1,  // column = 1
+      1, 2, 3, 4, 5, 6, 7, 8,  // column = 2
+      0, 0, 0, 1, 2, 0, 0, 0,  // column = 3
+  });
+  m.SetBias({0, 1});
+
+  m.Invoke();
+
+  EXPECT_THAT(m.GetOutput(), ElementsAreArray({
+                                 10, 1,   // column = 1
+                                 30, -1,  // column = 2
+                                 4,  3,   // column = 3
+                             }));
+}
+
 INSTANTIATE_TEST_SUITE_P(
     ConvolutionOpTest, ConvolutionOpTest,
     ::testing::ValuesIn(SingleOpTest::GetKernelTags(*kKernelMap)));
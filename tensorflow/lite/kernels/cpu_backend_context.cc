@@ -26,11 +26,18 @@ limitations under the License.
 namespace {
 const int kDefaultNumThreadpoolThreads = 1;
 
+// Set by CpuBackendContext::ScopedThreadLocalOverride.
+thread_local tflite::CpuBackendContext* thread_local_override = nullptr;
+
 }  // namespace
 
 namespace tflite {
 
 CpuBackendContext* CpuBackendContext::GetFromContext(TfLiteContext* context) {
+  if (thread_local_override != nullptr) {
+    return thread_local_override;
+  }
+
   auto* external_context = static_cast<ExternalCpuBackendContext*>(
       context->GetExternalContext(context, kTfLiteCpuBackendContext));
 
@@ -54,6 +61,16 @@ CpuBackendContext* CpuBackendContext::GetFromContext(TfLiteContext* context) {
   return cpu_backend_context;
 }
 
+CpuBackendContext::ScopedThreadLocalOverride::ScopedThreadLocalOverride(
+    CpuBackendContext* cpu_backend_context)
+    : previous_(thread_local_override) {
+  thread_local_override = cpu_backend_context;
+}
+
+CpuBackendContext::ScopedThreadLocalOverride::~ScopedThreadLocalOverride() {
+  thread_local_override = previous_;
+}
+
 CpuBackendContext::CpuBackendContext()
     : TfLiteInternalBackendContext(),
       ruy_context_(new ruy::Context),
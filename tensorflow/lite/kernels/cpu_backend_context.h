@@ -29,6 +29,23 @@ class CpuBackendContext final : public TfLiteInternalBackendContext {
  public:
   static CpuBackendContext* GetFromContext(TfLiteContext* context);
 
+  // While an instance is in scope, GetFromContext() returns
+  // `cpu_backend_context` on the calling thread, whatever the TfLiteContext.
+  // Contexts aren't thread-safe, so the interpreter uses this to give each
+  // of the operators it runs concurrently a context of its own.
+  class ScopedThreadLocalOverride {
+   public:
+    explicit ScopedThreadLocalOverride(CpuBackendContext* cpu_backend_context);
+    ~ScopedThreadLocalOverride();
+
+   private:
+    CpuBackendContext* previous_;
+
+    ScopedThreadLocalOverride(const ScopedThreadLocalOverride&) = delete;
+    ScopedThreadLocalOverride& operator=(const ScopedThreadLocalOverride&) =
+        delete;
+  };
+
   CpuBackendContext();
   ~CpuBackendContext() override;
 
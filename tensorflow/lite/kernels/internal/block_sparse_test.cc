@@ -0,0 +1,279 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/block_sparse.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/lite/kernels/test_util.h"
+
+#ifdef BLOCK_SPARSE_BENCHMARKS
+#include "testing/base/public/benchmark.h"
+#include "tensorflow/lite/kernels/internal/tensor_utils.h"
+#endif  // BLOCK_SPARSE_BENCHMARKS
+
+namespace tflite {
+namespace optimized_ops {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+
+// Returns a rows x cols matrix in which each 1 x block_size block is zero with
+// probability `sparsity`.
+template <typename T>
+std::vector<T> RandomBlockSparseMatrix(int rows, int cols, int block_size,
+                                       float sparsity, std::mt19937* random) {
+  std::uniform_real_distribution<float> keep(0.0f, 1.0f);
+  std::uniform_int_distribution<int> value(-127, 127);
+  std::vector<T> matrix(rows * cols, 0);
+  for (int r = 0; r < rows; ++r) {
+    for (int block = 0; block < cols / block_size; ++block) {
+      if (keep(*random) < sparsity) continue;
+      for (int c = 0; c < block_size; ++c) {
+        matrix[r * cols + block * block_size + c] =
+            static_cast<T>(value(*random));
+      }
+    }
+  }
+  return matrix;
+}
+
+template <typename T, typename AccumT>
+std::vector<AccumT> DenseMultiply(const std::vector<T>& matrix, int rows,
+                                  int cols, const std::vector<T>& vectors,
+                                  int32_t input_offset, int n_batch) {
+  std::vector<AccumT> result(n_batch * rows, 0);
+  for (int b = 0; b < n_batch; ++b) {
+    for (int r = 0; r < rows; ++r) {
+      for (int c = 0; c < cols; ++c) {
+        result[b * rows + r] +=
+            static_cast<AccumT>(matrix[r * cols + c]) *
+            (static_cast<AccumT>(vectors[b * cols + c]) + input_offset);
+      }
+    }
+  }
+  return result;
+}
+
+TEST(BlockSparseTest, PackSkipsZeroBlocks) {
+  const std::vector<int8_t> dense = {
+      1, 2, 0, 0, 0, 0, 0, 3,  //
+      0, 0, 0, 0, 0, 0, 0, 0,  //
+      0, 0, 4, 0, 5, 6, 7, 8,  //
+  };
+  BlockSparseMatrix<int8_t> matrix;
+  PackBlockSparseMatrix(dense.data(), /*rows=*/3, /*cols=*/8,
+                        /*block_size=*/4, &matrix);
+  ASSERT_EQ(matrix.num_blocks(), 4);
+  EXPECT_THAT(std::vector<int32_t>(matrix.segments(), matrix.segments() + 4),
+              ElementsAre(0, 2, 2, 4));
+  EXPECT_THAT(std::vector<int32_t>(matrix.indices(), matrix.indices() + 4),
+              ElementsAre(0, 1, 0, 1));
+  EXPECT_THAT(std::vector<int8_t>(matrix.values(), matrix.values() + 16),
+              ElementsAre(1, 2, 0, 0, 0, 0, 0, 3, 0, 0, 4, 0, 5, 6, 7, 8));
+  EXPECT_THAT(std::vector<int32_t>(matrix.row_sums(), matrix.row_sums() + 3),
+              ElementsAre(6, 0, 30));
+  EXPECT_FLOAT_EQ(BlockSparseMatrixDensity(matrix), 16.0f / 24.0f);
+}
+
+TEST(BlockSparseTest, AttachesSerializedMatrix) {
+  std::mt19937 random(2);
+  const int rows = 7;
+  const int cols = 24;
+  const int n_batch = 3;
+  const std::vector<float> dense = RandomBlockSparseMatrix<float>(
+      rows, cols, /*block_size=*/4, /*sparsity=*/0.6f, &random);
+  const std::vector<float> vectors = RandomBlockSparseMatrix<float>(
+      n_batch, cols, /*block_size=*/1, /*sparsity=*/0.0f, &random);
+  BlockSparseMatrix<float> packed;
+  PackBlockSparseMatrix(dense.data(), rows, cols, /*block_size=*/4, &packed);
+  ASSERT_TRUE(packed.is_packed());
+
+  // A copy of the buffer, as stored in a prepacked weights cache.
+  std::vector<int32_t> buffer(packed.buffer_size() / sizeof(int32_t));
+  std::memcpy(buffer.data(), packed.buffer(), packed.buffer_size());
+  BlockSparseMatrix<float> attached;
+  EXPECT_FALSE(attached.is_packed());
+  ASSERT_TRUE(attached.Attach(buffer.data(), packed.buffer_size(), rows, cols,
+                              /*block_size=*/4));
+  EXPECT_EQ(attached.buffer(), buffer.data());
+  EXPECT_EQ(attached.rows(), rows);
+  EXPECT_EQ(attached.cols(), cols);
+  EXPECT_EQ(attached.num_blocks(), packed.num_blocks());
+
+  std::vector<float> result(n_batch * rows, 0.0f);
+  BlockSparseMatrixBatchVectorMultiplyAccumulate(attached, vectors.data(),
+                                                 n_batch, result.data());
+  EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(
+                          DenseMultiply<float, float>(dense, rows, cols,
+                                                      vectors, 0, n_batch))));
+
+  // Buffers of the wrong size are rejected.
+  BlockSparseMatrix<float> malformed;
+  EXPECT_FALSE(malformed.Attach(buffer.data(), packed.buffer_size() - 4, rows,
+                                cols, /*block_size=*/4));
+  EXPECT_FALSE(malformed.Attach(buffer.data(), 8, rows, cols,
+                                /*block_size=*/4));
+  // So are matrices of other dimensions than expected.
+  EXPECT_FALSE(malformed.Attach(buffer.data(), packed.buffer_size(), rows,
+                                cols + 4, /*block_size=*/4));
+  EXPECT_FALSE(malformed.Attach(buffer.data(), packed.buffer_size(), rows - 1,
+                                cols, /*block_size=*/4));
+  EXPECT_FALSE(malformed.Attach(buffer.data(), packed.buffer_size(), rows,
+                                cols, /*block_size=*/8));
+  EXPECT_FALSE(malformed.is_packed());
+
+  // And buffers with segments or block indices out of range.
+  const int kHeaderSize = 4;
+  const int num_blocks = packed.num_blocks();
+  ASSERT_GT(num_blocks, 0);
+  std::vector<int32_t> corrupted = buffer;
+  corrupted[kHeaderSize + 1] = num_blocks + 1;
+  EXPECT_FALSE(malformed.Attach(corrupted.data(), packed.buffer_size(), rows,
+                                cols, /*block_size=*/4));
+  corrupted = buffer;
+  corrupted[kHeaderSize + rows + 1] = cols / 4;
+  EXPECT_FALSE(malformed.Attach(corrupted.data(), packed.buffer_size(), rows,
+                                cols, /*block_size=*/4));
+  corrupted = buffer;
+  corrupted[kHeaderSize + rows + 1] = -1;
+  EXPECT_FALSE(malformed.Attach(corrupted.data(), packed.buffer_size(), rows,
+                                cols, /*block_size=*/4));
+  EXPECT_FALSE(malformed.is_packed());
+}
+
+TEST(BlockSparseTest, FloatMatchesDense) {
+  std::mt19937 random(0);
+  const int rows = 13;
+  const int cols = 48;
+  for (int block_size : {1, 3, 4, 8, 16}) {
+    for (int n_batch : {1, 4, 7}) {
+      const std::vector<float> dense = RandomBlockSparseMatrix<float>(
+          rows, cols, block_size, /*sparsity=*/0.7f, &random);
+      const std::vector<float> vectors = RandomBlockSparseMatrix<float>(
+          n_batch, cols, /*block_size=*/1, /*sparsity=*/0.0f, &random);
+      BlockSparseMatrix<float> matrix;
+      PackBlockSparseMatrix(dense.data(), rows, cols, block_size, &matrix);
+
+      std::vector<float> result(n_batch * rows, 1.0f);
+      BlockSparseMatrixBatchVectorMultiplyAccumulate(matrix, vectors.data(),
+                                                     n_batch, result.data());
+      std::vector<float> expected = DenseMultiply<float, float>(
+          dense, rows, cols, vectors, /*input_offset=*/0, n_batch);
+      for (float& value : expected) value += 1.0f;
+      EXPECT_THAT(result, ElementsAreArray(ArrayFloatNear(expected)))
+          << "block_size " << block_size << ", n_batch " << n_batch;
+    }
+  }
+}
+
+TEST(BlockSparseTest, Int8WithInputOffsetMatchesDense) {
+  std::mt19937 random(1);
+  const int rows = 9;
+  const int cols = 32;
+  const int n_batch = 5;
+  const int32_t input_offset = 17;
+  for (int block_size : {1, 4, 16}) {
+    const std::vector<int8_t> dense = RandomBlockSparseMatrix<int8_t>(
+        rows, cols, block_size, /*sparsity=*/0.5f, &random);
+    const std::vector<int8_t> vectors = RandomBlockSparseMatrix<int8_t>(
+        n_batch, cols, /*block_size=*/1, /*sparsity=*/0.0f, &random);
+    BlockSparseMatrix<int8_t> matrix;
+    PackBlockSparseMatrix(dense.data(), rows, cols, block_size, &matrix);
+
+    std::vector<int32_t> result(n_batch * rows, 0);
+    BlockSparseMatrixBatchVectorMultiplyAccumulate(
+        matrix, vectors.data(), input_offset, n_batch, result.data());
+    EXPECT_THAT(result, ElementsAreArray(DenseMultiply<int8_t, int32_t>(
+                            dense, rows, cols, vectors, input_offset, n_batch)))
+        << "block_size " << block_size;
+  }
+}
+
+}  // namespace
+}  // namespace optimized_ops
+}  // namespace tflite
+
+#ifdef BLOCK_SPARSE_BENCHMARKS
+
+// Compile with --copt="-DGOOGLE_COMMANDLINEFLAGS_FULL_API=1" and
+// --copt="-DBLOCK_SPARSE_BENCHMARKS"
+// Run with --benchmarks=all
+//
+// Compares the block-sparse kernel against the dense kernel on the same
+// matrix, for a range of block sparsities (in percent), to find the sparsity
+// above which the sparse kernels pay off.
+void BM_DenseMultiply(benchmark::State& state) {
+  const int rows = state.range(0);
+  const int cols = state.range(1);
+  const int batch = state.range(2);
+  const float sparsity = state.range(3) / 100.0f;
+  std::mt19937 random(0);
+  const std::vector<float> matrix =
+      tflite::optimized_ops::RandomBlockSparseMatrix<float>(
+          rows, cols, /*block_size=*/4, sparsity, &random);
+  const std::vector<float> vectors(batch * cols, 1.0f);
+  std::vector<float> result(batch * rows);
+  for (auto _ : state) {
+    tflite::tensor_utils::MatrixBatchVectorMultiplyAccumulate(
+        matrix.data(), rows, cols, vectors.data(), batch, result.data());
+    testing::DoNotOptimize(result[0]);
+  }
+}
+BENCHMARK(BM_DenseMultiply)
+    ->Args({256, 256, 1, 0})
+    ->Args({1024, 1024, 1, 0})
+    ->Args({1024, 1024, 8, 0});
+
+void BM_BlockSparseMultiply(benchmark::State& state) {
+  const int rows = state.range(0);
+  const int cols = state.range(1);
+  const int batch = state.range(2);
+  const float sparsity = state.range(3) / 100.0f;
+  const int block_size = state.range(4);
+  std::mt19937 random(0);
+  const std::vector<float> dense =
+      tflite::optimized_ops::RandomBlockSparseMatrix<float>(
+          rows, cols, block_size, sparsity, &random);
+  tflite::optimized_ops::BlockSparseMatrix<float> matrix;
+  tflite::optimized_ops::PackBlockSparseMatrix(dense.data(), rows, cols,
+                                               block_size, &matrix);
+  const std::vector<float> vectors(batch * cols, 1.0f);
+  std::vector<float> result(batch * rows);
+  for (auto _ : state) {
+    tflite::optimized_ops::BlockSparseMatrixBatchVectorMultiplyAccumulate(
+        matrix, vectors.data(), batch, result.data());
+    testing::DoNotOptimize(result[0]);
+  }
+}
+BENCHMARK(BM_BlockSparseMultiply)
+    ->Args({256, 256, 1, 50, 4})
+    ->Args({256, 256, 1, 70, 4})
+    ->Args({256, 256, 1, 90, 4})
+    ->Args({1024, 1024, 1, 50, 1})
+    ->Args({1024, 1024, 1, 50, 4})
+    ->Args({1024, 1024, 1, 70, 4})
+    ->Args({1024, 1024, 1, 80, 8})
+    ->Args({1024, 1024, 1, 90, 4})
+    ->Args({1024, 1024, 1, 90, 16})
+    ->Args({1024, 1024, 8, 70, 4})
+    ->Args({1024, 1024, 8, 90, 4});
+
+#endif  // BLOCK_SPARSE_BENCHMARKS
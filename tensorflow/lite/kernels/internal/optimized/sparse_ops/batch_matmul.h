@@ -0,0 +1,134 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_BATCH_MATMUL_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_BATCH_MATMUL_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "ruy/profiler/instrumentation.h"  // from @ruy
+#include "tensorflow/lite/kernels/cpu_backend_context.h"
+#include "tensorflow/lite/kernels/cpu_backend_threadpool.h"
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/block_sparse.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+
+namespace tflite {
+namespace optimized_ops {
+
+// Computes output rows [row_start, row_end) of a float batch matmul.
+inline void BatchMatMulSparseWeightImpl(const FullyConnectedParams& params,
+                                        const BlockSparseMatrix<float>& rhs,
+                                        const float* lhs_data,
+                                        float* output_data, int row_start,
+                                        int row_end) {
+  float* output = output_data + row_start * rhs.rows();
+  std::fill_n(output, (row_end - row_start) * rhs.rows(), 0.0f);
+  BlockSparseMatrixBatchVectorMultiplyAccumulate(
+      rhs, lhs_data + row_start * rhs.cols(), row_end - row_start, output);
+}
+
+// Computes output rows [row_start, row_end) of an int8 batch matmul.
+inline void BatchMatMulSparseWeightImpl(const FullyConnectedParams& params,
+                                        const BlockSparseMatrix<int8_t>& rhs,
+                                        const int8_t* lhs_data,
+                                        int8_t* output_data, int row_start,
+                                        int row_end) {
+  const int num_rows = row_end - row_start;
+  std::vector<int32_t> accum(num_rows * rhs.rows(), 0);
+  BlockSparseMatrixBatchVectorMultiplyAccumulate(
+      rhs, lhs_data + row_start * rhs.cols(), params.input_offset, num_rows,
+      accum.data());
+  int8_t* output = output_data + row_start * rhs.rows();
+  for (int i = 0; i < num_rows * rhs.rows(); ++i) {
+    int32_t acc = MultiplyByQuantizedMultiplier(
+        accum[i], params.output_multiplier, params.output_shift);
+    acc += params.output_offset;
+    acc = std::max(acc, params.quantized_activation_min);
+    acc = std::min(acc, params.quantized_activation_max);
+    output[i] = static_cast<int8_t>(acc);
+  }
+}
+
+template <typename T>
+struct BatchMatMulSparseWeightTask : cpu_backend_threadpool::Task {
+  BatchMatMulSparseWeightTask(const FullyConnectedParams& params,
+                              const BlockSparseMatrix<T>& rhs,
+                              const T* lhs_data, T* output_data, int row_start,
+                              int row_end)
+      : params(params),
+        rhs(rhs),
+        lhs_data(lhs_data),
+        output_data(output_data),
+        row_start(row_start),
+        row_end(row_end) {}
+
+  void Run() override {
+    BatchMatMulSparseWeightImpl(params, rhs, lhs_data, output_data, row_start,
+                                row_end);
+  }
+
+ private:
+  const FullyConnectedParams& params;
+  const BlockSparseMatrix<T>& rhs;
+  const T* lhs_data;
+  T* output_data;
+  int row_start;
+  int row_end;
+};
+
+// Multiplies each row of the LHS <..., A, B> by a constant RHS <B, C>, which
+// is packed transposed, as a block-sparse C x B matrix. The output <..., A, C>
+// is sliced by rows across threads. The float version ignores the
+// quantization fields of `params`.
+template <typename T>
+inline void BatchMatMulSparseWeight(const FullyConnectedParams& params,
+                                    const BlockSparseMatrix<T>& rhs,
+                                    const RuntimeShape& lhs_shape,
+                                    const T* lhs_data,
+                                    const RuntimeShape& output_shape,
+                                    T* output_data,
+                                    CpuBackendContext* cpu_backend_context) {
+  ruy::profiler::ScopeLabel label("BatchMatMul");
+  ruy::profiler::ScopeLabel inner_label("Block Sparse");
+  const int lhs_dims_count = lhs_shape.DimensionsCount();
+  const int output_dims_count = output_shape.DimensionsCount();
+  TFLITE_DCHECK_EQ(lhs_shape.Dims(lhs_dims_count - 1), rhs.cols());
+  TFLITE_DCHECK_EQ(output_shape.Dims(output_dims_count - 1), rhs.rows());
+  const int rows = FlatSizeSkipDim(lhs_shape, lhs_dims_count - 1);
+  const int max_threads = cpu_backend_context->max_num_threads();
+  const int thread_count = std::max(1, std::min(rows, max_threads));
+  if (thread_count == 1) {
+    BatchMatMulSparseWeightImpl(params, rhs, lhs_data, output_data, 0, rows);
+    return;
+  }
+  std::vector<BatchMatMulSparseWeightTask<T>> tasks;
+  tasks.reserve(thread_count);
+  int row_start = 0;
+  for (int i = 0; i < thread_count; ++i) {
+    int row_end = row_start + rows / thread_count;
+    if (i < rows % thread_count) row_end++;
+    tasks.emplace_back(params, rhs, lhs_data, output_data, row_start, row_end);
+    row_start = row_end;
+  }
+  cpu_backend_threadpool::Execute(tasks.size(), tasks.data(),
+                                  cpu_backend_context);
+}
+
+}  // namespace optimized_ops
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_BATCH_MATMUL_H_
@@ -0,0 +1,351 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_BLOCK_SPARSE_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_BLOCK_SPARSE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/kernels/internal/compatibility.h"
+#include "tensorflow/lite/kernels/internal/tensor_utils.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/tools/optimize/sparsity/format_converter.h"
+
+namespace tflite {
+namespace optimized_ops {
+
+// A rows x cols weight matrix stored in block compressed sparse row format,
+// with 1 x block_size blocks along the accumulation (column) dimension. Only
+// blocks holding at least one nonzero value are stored.
+//
+// The matrix is serialized in a single buffer, so that it can be stored in a
+// prepacked weights cache and used in place from there:
+//   int32 rows, cols, block_size, num_blocks
+//   int32 segments[rows + 1]: the blocks of row r are segments[r] to
+//       segments[r + 1] - 1.
+//   int32 indices[num_blocks]: the first column of each block / block_size.
+//   int32 row_sums[rows]: the sum of each row, for integer types only, where
+//       it is used to apply the input offset.
+//   T values[num_blocks * block_size]
+template <typename T>
+class BlockSparseMatrix {
+ public:
+  BlockSparseMatrix() {}
+
+  bool is_packed() const { return buffer_ != nullptr; }
+  int rows() const { return header()[0]; }
+  int cols() const { return header()[1]; }
+  int block_size() const { return header()[2]; }
+  int num_blocks() const { return header()[3]; }
+  const int32_t* segments() const { return header() + kHeaderSize; }
+  const int32_t* indices() const { return segments() + rows() + 1; }
+  const int32_t* row_sums() const { return indices() + num_blocks(); }
+  const T* values() const {
+    return reinterpret_cast<const T*>(row_sums() + RowSumsSize(rows()));
+  }
+
+  const void* buffer() const { return buffer_; }
+  size_t buffer_size() const { return buffer_size_; }
+
+  // Uses the serialized matrix in `buffer`, which must outlive this matrix
+  // and be aligned to 4 bytes. Returns false, leaving the matrix unchanged, if
+  // the buffer is malformed or doesn't hold a rows x cols matrix with blocks
+  // of block_size values. As the buffer may come from a file, every segment
+  // and block index is checked, so that a matrix attached successfully is
+  // never accessed out of bounds.
+  bool Attach(const void* buffer, size_t buffer_size, int rows, int cols,
+              int block_size) {
+    const int32_t* header = static_cast<const int32_t*>(buffer);
+    if (buffer_size < kHeaderSize * sizeof(int32_t) ||
+        reinterpret_cast<uintptr_t>(buffer) % sizeof(int32_t) != 0 ||
+        header[0] != rows || header[1] != cols || header[2] != block_size ||
+        rows < 0 || cols < 0 || block_size <= 0 || cols % block_size != 0) {
+      return false;
+    }
+    const int num_blocks = header[3];
+    const int blocks_per_row = cols / block_size;
+    if (num_blocks < 0 ||
+        num_blocks > static_cast<int64_t>(rows) * blocks_per_row ||
+        BufferSize(rows, num_blocks, block_size) != buffer_size) {
+      return false;
+    }
+    const int32_t* segments = header + kHeaderSize;
+    const int32_t* indices = segments + rows + 1;
+    if (segments[0] != 0 || segments[rows] != num_blocks) return false;
+    for (int r = 0; r < rows; ++r) {
+      if (segments[r + 1] < segments[r]) return false;
+    }
+    for (int i = 0; i < num_blocks; ++i) {
+      if (indices[i] < 0 || indices[i] >= blocks_per_row) return false;
+    }
+    buffer_ = header;
+    buffer_size_ = buffer_size;
+    storage_.clear();
+    storage_.shrink_to_fit();
+    return true;
+  }
+
+  // Returns the size of the serialized matrix.
+  static size_t BufferSize(int rows, int num_blocks, int block_size) {
+    const size_t words = kHeaderSize + static_cast<size_t>(rows) + 1 +
+                         num_blocks + RowSumsSize(rows);
+    return words * sizeof(int32_t) +
+           static_cast<size_t>(num_blocks) * block_size * sizeof(T);
+  }
+
+ private:
+  template <typename U>
+  friend void PackBlockSparseMatrix(const U* dense, int rows, int cols,
+                                    int block_size,
+                                    BlockSparseMatrix<U>* matrix);
+
+  static constexpr int kHeaderSize = 4;
+
+  static int RowSumsSize(int rows) {
+    return std::is_integral<T>::value ? rows : 0;
+  }
+
+  const int32_t* header() const { return buffer_; }
+
+  // Takes ownership of a serialized matrix.
+  void Own(std::vector<int32_t> storage, size_t buffer_size) {
+    storage_ = std::move(storage);
+    buffer_ = storage_.data();
+    buffer_size_ = buffer_size;
+  }
+
+  const int32_t* buffer_ = nullptr;
+  size_t buffer_size_ = 0;
+  // The buffer, unless it is external.
+  std::vector<int32_t> storage_;
+
+  BlockSparseMatrix(const BlockSparseMatrix&) = delete;
+  BlockSparseMatrix& operator=(const BlockSparseMatrix&) = delete;
+};
+
+// Returns the size of the blocks along the innermost dimension described by
+// `sparsity`, or 1 if the innermost dimension is not blocked or if the block
+// size does not divide `inner_dim`.
+inline int BlockSizeFromSparsity(const TfLiteSparsity& sparsity,
+                                 int inner_dim) {
+  const TfLiteIntArray* block_map = sparsity.block_map;
+  const TfLiteIntArray* traversal_order = sparsity.traversal_order;
+  if (block_map == nullptr || traversal_order == nullptr) return 1;
+  const int rank = sparsity.dim_metadata_size - block_map->size;
+  int block_size = 1;
+  for (int i = 0; i < block_map->size; ++i) {
+    if (block_map->data[i] != rank - 1) continue;
+    // Block dimensions follow the original dimensions, in block map order.
+    for (int j = 0; j < traversal_order->size; ++j) {
+      if (traversal_order->data[j] == rank + i) {
+        block_size = sparsity.dim_metadata[j].dense_size;
+      }
+    }
+  }
+  if (block_size <= 0 || inner_dim % block_size != 0) return 1;
+  return block_size;
+}
+
+// Returns the dense values of a tensor with the given sparsity parameters.
+template <typename T>
+inline std::vector<T> DensifySparseWeights(const TfLiteSparsity& sparsity,
+                                           const RuntimeShape& shape,
+                                           const T* data) {
+  std::vector<int> dense_shape(shape.DimensionsCount());
+  for (int i = 0; i < shape.DimensionsCount(); ++i) {
+    dense_shape[i] = shape.Dims(i);
+  }
+  tflite::optimize::sparsity::FormatConverter<T> converter(dense_shape,
+                                                           sparsity);
+  converter.SparseToDense(data);
+  return converter.GetData();
+}
+
+// Packs a dense row-major rows x cols matrix. `block_size` must divide cols.
+template <typename T>
+void PackBlockSparseMatrix(const T* dense, int rows, int cols, int block_size,
+                           BlockSparseMatrix<T>* matrix) {
+  TFLITE_DCHECK_EQ(cols % block_size, 0);
+  std::vector<int32_t> segments(1, 0);
+  std::vector<int32_t> indices;
+  std::vector<int32_t> row_sums;
+  std::vector<T> values;
+  for (int r = 0; r < rows; ++r) {
+    const T* row = dense + r * cols;
+    int32_t row_sum = 0;
+    for (int block = 0; block < cols / block_size; ++block) {
+      const T* block_values = row + block * block_size;
+      bool is_zero = true;
+      for (int c = 0; c < block_size; ++c) {
+        is_zero &= (block_values[c] == 0);
+        row_sum += static_cast<int32_t>(block_values[c]);
+      }
+      if (is_zero) continue;
+      indices.push_back(block);
+      values.insert(values.end(), block_values, block_values + block_size);
+    }
+    segments.push_back(indices.size());
+    if (std::is_integral<T>::value) {
+      row_sums.push_back(row_sum);
+    }
+  }
+
+  const int num_blocks = indices.size();
+  const size_t buffer_size =
+      BlockSparseMatrix<T>::BufferSize(rows, num_blocks, block_size);
+  std::vector<int32_t> storage(
+      (buffer_size + sizeof(int32_t) - 1) / sizeof(int32_t), 0);
+  int32_t* words = storage.data();
+  *words++ = rows;
+  *words++ = cols;
+  *words++ = block_size;
+  *words++ = num_blocks;
+  words = std::copy(segments.begin(), segments.end(), words);
+  words = std::copy(indices.begin(), indices.end(), words);
+  words = std::copy(row_sums.begin(), row_sums.end(), words);
+  std::copy(values.begin(), values.end(), reinterpret_cast<T*>(words));
+  matrix->Own(std::move(storage), buffer_size);
+}
+
+// Returns the fraction of the values of `matrix` which are stored.
+template <typename T>
+inline float BlockSparseMatrixDensity(const BlockSparseMatrix<T>& matrix) {
+  const int64_t size = static_cast<int64_t>(matrix.rows()) * matrix.cols();
+  return size == 0 ? 0.0f
+                   : static_cast<float>(matrix.num_blocks()) *
+                         matrix.block_size() / size;
+}
+
+// Computes result[b * rows + r] += matrix(r, :) . vectors[b * cols, :] for
+// n_batch vectors. Four vectors are processed at a time, so that each block of
+// weights is loaded once for all of them. kBlockSize is the block size of the
+// matrix, or 0 if it is only known at runtime.
+template <int kBlockSize, typename T, typename AccumT>
+inline void BlockSparseMultiplyAccumulateImpl(
+    const BlockSparseMatrix<T>& matrix, const T* __restrict__ vectors,
+    int n_batch, AccumT* __restrict__ result) {
+  const int block_size = kBlockSize > 0 ? kBlockSize : matrix.block_size();
+  const int rows = matrix.rows();
+  const int cols = matrix.cols();
+  const int32_t* segments = matrix.segments();
+  const int32_t* indices = matrix.indices();
+  const T* values = matrix.values();
+
+  int b = 0;
+  for (; b + 4 <= n_batch; b += 4) {
+    const T* vector0 = vectors + b * cols;
+    const T* vector1 = vector0 + cols;
+    const T* vector2 = vector1 + cols;
+    const T* vector3 = vector2 + cols;
+    for (int r = 0; r < rows; ++r) {
+      AccumT acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+      const T* value = values + segments[r] * block_size;
+      for (int i = segments[r]; i < segments[r + 1]; ++i) {
+        const int col = indices[i] * block_size;
+        for (int c = 0; c < block_size; ++c) {
+          const AccumT weight = value[c];
+          acc0 += weight * vector0[col + c];
+          acc1 += weight * vector1[col + c];
+          acc2 += weight * vector2[col + c];
+          acc3 += weight * vector3[col + c];
+        }
+        value += block_size;
+      }
+      result[b * rows + r] += acc0;
+      result[(b + 1) * rows + r] += acc1;
+      result[(b + 2) * rows + r] += acc2;
+      result[(b + 3) * rows + r] += acc3;
+    }
+  }
+  for (; b < n_batch; ++b) {
+    const T* vector = vectors + b * cols;
+    for (int r = 0; r < rows; ++r) {
+      AccumT acc = 0;
+      const T* value = values + segments[r] * block_size;
+      for (int i = segments[r]; i < segments[r + 1]; ++i) {
+        const int col = indices[i] * block_size;
+        for (int c = 0; c < block_size; ++c) {
+          acc += static_cast<AccumT>(value[c]) * vector[col + c];
+        }
+        value += block_size;
+      }
+      result[b * rows + r] += acc;
+    }
+  }
+}
+
+template <typename T, typename AccumT>
+inline void BlockSparseMultiplyAccumulate(const BlockSparseMatrix<T>& matrix,
+                                          const T* vectors, int n_batch,
+                                          AccumT* result) {
+  switch (matrix.block_size()) {
+    case 1:
+      return BlockSparseMultiplyAccumulateImpl<1>(matrix, vectors, n_batch,
+                                                  result);
+    case 4:
+      return BlockSparseMultiplyAccumulateImpl<4>(matrix, vectors, n_batch,
+                                                  result);
+    case 8:
+      return BlockSparseMultiplyAccumulateImpl<8>(matrix, vectors, n_batch,
+                                                  result);
+    case 16:
+      return BlockSparseMultiplyAccumulateImpl<16>(matrix, vectors, n_batch,
+                                                   result);
+    default:
+      return BlockSparseMultiplyAccumulateImpl<0>(matrix, vectors, n_batch,
+                                                  result);
+  }
+}
+
+// Computes result[b * rows + r] += matrix(r, :) . vectors[b * cols, :] for
+// n_batch float vectors.
+inline void BlockSparseMatrixBatchVectorMultiplyAccumulate(
+    const BlockSparseMatrix<float>& matrix, const float* vectors, int n_batch,
+    float* result) {
+  if (matrix.block_size() == 4) {
+    // Use the NEON kernel of the sparse FullyConnected op where available.
+    tensor_utils::SparseMatrixBatchVectorMultiplyAccumulate1x4(
+        matrix.values(), matrix.segments(), matrix.indices(), matrix.rows(),
+        matrix.cols(), vectors, n_batch, result);
+    return;
+  }
+  BlockSparseMultiplyAccumulate(matrix, vectors, n_batch, result);
+}
+
+// Computes result[b * rows + r] += matrix(r, :) . (vectors[b * cols, :] +
+// input_offset) for n_batch int8 vectors.
+inline void BlockSparseMatrixBatchVectorMultiplyAccumulate(
+    const BlockSparseMatrix<int8_t>& matrix, const int8_t* vectors,
+    int32_t input_offset, int n_batch, int32_t* result) {
+  BlockSparseMultiplyAccumulate(matrix, vectors, n_batch, result);
+  if (input_offset == 0) return;
+  const int rows = matrix.rows();
+  const int32_t* row_sums = matrix.row_sums();
+  for (int b = 0; b < n_batch; ++b) {
+    for (int r = 0; r < rows; ++r) {
+      result[b * rows + r] += input_offset * row_sums[r];
+    }
+  }
+}
+
+}  // namespace optimized_ops
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_BLOCK_SPARSE_H_
@@ -0,0 +1,317 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_CONV_H_
+#define TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_CONV_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "ruy/profiler/instrumentation.h"  // from @ruy
+#include "tensorflow/lite/kernels/cpu_backend_context.h"
+#include "tensorflow/lite/kernels/cpu_backend_threadpool.h"
+#include "tensorflow/lite/kernels/internal/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/block_sparse.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+
+namespace tflite {
+namespace optimized_ops {
+
+// Sparse convolutions treat the filter as an [output_depth, filter_height *
+// filter_width * input_depth] matrix and gather the input values under the
+// filter for this many output positions at a time.
+constexpr int kSparseConvTilePixels = 8;
+// Each thread computes at least this many output positions.
+constexpr int kSparseConvMinPixelsPerThread = 64;
+
+// Returns true if the input of the convolution can be read directly as the
+// matrix of gathered input values.
+inline bool IsPointwiseSparseConv(const ConvParams& params, int filter_height,
+                                  int filter_width) {
+  return filter_height == 1 && filter_width == 1 && params.stride_height == 1 &&
+         params.stride_width == 1 && params.padding_values.height == 0 &&
+         params.padding_values.width == 0;
+}
+
+// Copies the input values under the filter at `num_pixels` consecutive output
+// positions, starting at `first_pixel`, to `patches`, in filter [height, width,
+// depth] order. Values in the padding are set to `pad_value`.
+template <typename T>
+inline void GatherConvPatches(const ConvParams& params,
+                              const RuntimeShape& input_shape,
+                              const T* input_data, int filter_height,
+                              int filter_width,
+                              const RuntimeShape& output_shape,
+                              int first_pixel, int num_pixels, T pad_value,
+                              T* patches) {
+  const int input_height = input_shape.Dims(1);
+  const int input_width = input_shape.Dims(2);
+  const int input_depth = input_shape.Dims(3);
+  const int output_height = output_shape.Dims(1);
+  const int output_width = output_shape.Dims(2);
+  const int patch_size = filter_height * filter_width * input_depth;
+  for (int p = 0; p < num_pixels; ++p) {
+    const int pixel = first_pixel + p;
+    const int out_x = pixel % output_width;
+    const int out_y = (pixel / output_width) % output_height;
+    const int batch = pixel / (output_width * output_height);
+    const int in_y_origin =
+        out_y * params.stride_height - params.padding_values.height;
+    const int in_x_origin =
+        out_x * params.stride_width - params.padding_values.width;
+    T* patch = patches + p * patch_size;
+    for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+      const int in_y = in_y_origin + filter_y * params.dilation_height_factor;
+      for (int filter_x = 0; filter_x < filter_width; ++filter_x) {
+        const int in_x = in_x_origin + filter_x * params.dilation_width_factor;
+        T* dst = patch + (filter_y * filter_width + filter_x) * input_depth;
+        if (in_y >= 0 && in_y < input_height && in_x >= 0 &&
+            in_x < input_width) {
+          std::memcpy(dst,
+                      input_data + Offset(input_shape, batch, in_y, in_x, 0),
+                      input_depth * sizeof(T));
+        } else {
+          std::fill_n(dst, input_depth, pad_value);
+        }
+      }
+    }
+  }
+}
+
+// Computes output positions [pixel_start, pixel_end) of a float convolution.
+inline void ConvSparseWeightImpl(
+    const ConvParams& params, const int32_t* output_multiplier,
+    const int32_t* output_shift, const BlockSparseMatrix<float>& filter,
+    int filter_height, int filter_width, const RuntimeShape& input_shape,
+    const float* input_data, const float* bias_data,
+    const RuntimeShape& output_shape, float* output_data, int pixel_start,
+    int pixel_end) {
+  const int output_depth = filter.rows();
+  float* output = output_data + pixel_start * output_depth;
+  const int num_pixels = pixel_end - pixel_start;
+  for (int p = 0; p < num_pixels; ++p) {
+    if (bias_data) {
+      std::copy_n(bias_data, output_depth, output + p * output_depth);
+    } else {
+      std::fill_n(output + p * output_depth, output_depth, 0.0f);
+    }
+  }
+
+  if (IsPointwiseSparseConv(params, filter_height, filter_width)) {
+    BlockSparseMatrixBatchVectorMultiplyAccumulate(
+        filter, input_data + pixel_start * filter.cols(), num_pixels, output);
+  } else {
+    std::vector<float> patches(kSparseConvTilePixels * filter.cols());
+    for (int pixel = pixel_start; pixel < pixel_end;
+         pixel += kSparseConvTilePixels) {
+      const int tile_pixels =
+          std::min(kSparseConvTilePixels, pixel_end - pixel);
+      GatherConvPatches(params, input_shape, input_data, filter_height,
+                        filter_width, output_shape, pixel, tile_pixels, 0.0f,
+                        patches.data());
+      BlockSparseMatrixBatchVectorMultiplyAccumulate(
+          filter, patches.data(), tile_pixels,
+          output_data + pixel * output_depth);
+    }
+  }
+
+  for (int i = 0; i < num_pixels * output_depth; ++i) {
+    output[i] = ActivationFunctionWithMinMax(
+        output[i], params.float_activation_min, params.float_activation_max);
+  }
+}
+
+// Computes output positions [pixel_start, pixel_end) of an int8 convolution
+// with per-channel quantized filter.
+inline void ConvSparseWeightImpl(
+    const ConvParams& params, const int32_t* output_multiplier,
+    const int32_t* output_shift, const BlockSparseMatrix<int8_t>& filter,
+    int filter_height, int filter_width, const RuntimeShape& input_shape,
+    const int8_t* input_data, const int32_t* bias_data,
+    const RuntimeShape& output_shape, int8_t* output_data, int pixel_start,
+    int pixel_end) {
+  const int output_depth = filter.rows();
+  const bool is_pointwise =
+      IsPointwiseSparseConv(params, filter_height, filter_width);
+  std::vector<int32_t> accum(kSparseConvTilePixels * output_depth);
+  std::vector<int8_t> patches;
+  if (!is_pointwise) {
+    patches.resize(kSparseConvTilePixels * filter.cols());
+  }
+  // Padding holds the input zero point, which contributes nothing once the
+  // input offset is added.
+  const int8_t pad_value = static_cast<int8_t>(-params.input_offset);
+
+  for (int pixel = pixel_start; pixel < pixel_end;
+       pixel += kSparseConvTilePixels) {
+    const int tile_pixels = std::min(kSparseConvTilePixels, pixel_end - pixel);
+    const int8_t* vectors = input_data + pixel * filter.cols();
+    if (!is_pointwise) {
+      GatherConvPatches(params, input_shape, input_data, filter_height,
+                        filter_width, output_shape, pixel, tile_pixels,
+                        pad_value, patches.data());
+      vectors = patches.data();
+    }
+    std::fill_n(accum.data(), tile_pixels * output_depth, 0);
+    BlockSparseMatrixBatchVectorMultiplyAccumulate(
+        filter, vectors, params.input_offset, tile_pixels, accum.data());
+
+    int8_t* output = output_data + pixel * output_depth;
+    for (int p = 0; p < tile_pixels; ++p) {
+      for (int c = 0; c < output_depth; ++c) {
+        int32_t acc = accum[p * output_depth + c];
+        if (bias_data) {
+          acc += bias_data[c];
+        }
+        acc = MultiplyByQuantizedMultiplier(acc, output_multiplier[c],
+                                            output_shift[c]);
+        acc += params.output_offset;
+        acc = std::max(acc, params.quantized_activation_min);
+        acc = std::min(acc, params.quantized_activation_max);
+        output[p * output_depth + c] = static_cast<int8_t>(acc);
+      }
+    }
+  }
+}
+
+template <typename T, typename BiasT>
+struct ConvSparseWeightTask : cpu_backend_threadpool::Task {
+  ConvSparseWeightTask(const ConvParams& params,
+                       const int32_t* output_multiplier,
+                       const int32_t* output_shift,
+                       const BlockSparseMatrix<T>& filter, int filter_height,
+                       int filter_width, const RuntimeShape& input_shape,
+                       const T* input_data, const BiasT* bias_data,
+                       const RuntimeShape& output_shape, T* output_data,
+                       int pixel_start, int pixel_end)
+      : params(params),
+        output_multiplier(output_multiplier),
+        output_shift(output_shift),
+        filter(filter),
+        filter_height(filter_height),
+        filter_width(filter_width),
+        input_shape(input_shape),
+        input_data(input_data),
+        bias_data(bias_data),
+        output_shape(output_shape),
+        output_data(output_data),
+        pixel_start(pixel_start),
+        pixel_end(pixel_end) {}
+
+  void Run() override {
+    ConvSparseWeightImpl(params, output_multiplier, output_shift, filter,
+                         filter_height, filter_width, input_shape, input_data,
+                         bias_data, output_shape, output_data, pixel_start,
+                         pixel_end);
+  }
+
+ private:
+  const ConvParams& params;
+  const int32_t* output_multiplier;
+  const int32_t* output_shift;
+  const BlockSparseMatrix<T>& filter;
+  int filter_height;
+  int filter_width;
+  const RuntimeShape& input_shape;
+  const T* input_data;
+  const BiasT* bias_data;
+  const RuntimeShape& output_shape;
+  T* output_data;
+  int pixel_start;
+  int pixel_end;
+};
+
+// The multi-threaded kernel slices the output positions of all batches.
+template <typename T, typename BiasT>
+inline void ConvSparseWeightMultiThreaded(
+    const ConvParams& params, const int32_t* output_multiplier,
+    const int32_t* output_shift, const BlockSparseMatrix<T>& filter,
+    int filter_height, int filter_width, const RuntimeShape& input_shape,
+    const T* input_data, const BiasT* bias_data,
+    const RuntimeShape& output_shape, T* output_data,
+    CpuBackendContext* cpu_backend_context) {
+  TFLITE_DCHECK_EQ(input_shape.DimensionsCount(), 4);
+  TFLITE_DCHECK_EQ(output_shape.DimensionsCount(), 4);
+  TFLITE_DCHECK_EQ(output_shape.Dims(3), filter.rows());
+  TFLITE_DCHECK_EQ(filter_height * filter_width * input_shape.Dims(3),
+                   filter.cols());
+  const int pixels = FlatSizeSkipDim(output_shape, 3);
+  const int max_threads = cpu_backend_context->max_num_threads();
+  const int thread_count = std::max(
+      1, std::min(max_threads, pixels / kSparseConvMinPixelsPerThread));
+  if (thread_count == 1) {
+    ConvSparseWeightImpl(params, output_multiplier, output_shift, filter,
+                         filter_height, filter_width, input_shape, input_data,
+                         bias_data, output_shape, output_data, 0, pixels);
+    return;
+  }
+  std::vector<ConvSparseWeightTask<T, BiasT>> tasks;
+  tasks.reserve(thread_count);
+  int pixel_start = 0;
+  for (int i = 0; i < thread_count; ++i) {
+    int pixel_end = pixel_start + pixels / thread_count;
+    if (i < pixels % thread_count) pixel_end++;
+    tasks.emplace_back(params, output_multiplier, output_shift, filter,
+                       filter_height, filter_width, input_shape, input_data,
+                       bias_data, output_shape, output_data, pixel_start,
+                       pixel_end);
+    pixel_start = pixel_end;
+  }
+  cpu_backend_threadpool::Execute(tasks.size(), tasks.data(),
+                                  cpu_backend_context);
+}
+
+// Float convolution with a filter packed as a block-sparse [output_depth,
+// filter_height * filter_width * input_depth] matrix. 1x1 convolutions with
+// unit strides multiply the input directly; other convolutions gather the
+// input under the filter for a few output positions at a time.
+inline void ConvSparseWeight(const ConvParams& params,
+                             const BlockSparseMatrix<float>& filter,
+                             int filter_height, int filter_width,
+                             const RuntimeShape& input_shape,
+                             const float* input_data, const float* bias_data,
+                             const RuntimeShape& output_shape,
+                             float* output_data,
+                             CpuBackendContext* cpu_backend_context) {
+  ruy::profiler::ScopeLabel label("Conv");
+  ruy::profiler::ScopeLabel inner_label("Block Sparse");
+  ConvSparseWeightMultiThreaded<float, float>(
+      params, /*output_multiplier=*/nullptr, /*output_shift=*/nullptr, filter,
+      filter_height, filter_width, input_shape, input_data, bias_data,
+      output_shape, output_data, cpu_backend_context);
+}
+
+// Same as above, for int8 inputs and per-channel quantized filters.
+inline void ConvPerChannelSparseWeight(
+    const ConvParams& params, const int32_t* output_multiplier,
+    const int32_t* output_shift, const BlockSparseMatrix<int8_t>& filter,
+    int filter_height, int filter_width, const RuntimeShape& input_shape,
+    const int8_t* input_data, const int32_t* bias_data,
+    const RuntimeShape& output_shape, int8_t* output_data,
+    CpuBackendContext* cpu_backend_context) {
+  ruy::profiler::ScopeLabel label("ConvPerChannel");
+  ruy::profiler::ScopeLabel inner_label("Block Sparse");
+  ConvSparseWeightMultiThreaded<int8_t, int32_t>(
+      params, output_multiplier, output_shift, filter, filter_height,
+      filter_width, input_shape, input_data, bias_data, output_shape,
+      output_data, cpu_backend_context);
+}
+
+}  // namespace optimized_ops
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_KERNELS_INTERNAL_OPTIMIZED_SPARSE_OPS_CONV_H_
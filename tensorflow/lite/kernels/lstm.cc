@@ -55,6 +55,8 @@ struct OpData {
   int scratch_tensor_index;
   lstm_eval::IntegerLstmParameter integer_lstm_param;
   bool compute_row_sums;
+  // Float weights with sparsity parameters, packed for the gate computations.
+  lstm_eval::SparseLstmWeights sparse_weights;
 };
 
 namespace full {
@@ -1239,6 +1241,20 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   // The weights are of consistent type, so it suffices to check one.
   const bool is_hybrid_op = IsHybridOp(input, input_to_output_weights);
 
+  TF_LITE_ENSURE_OK(
+      context,
+      lstm_eval::PrepareSparseLstmWeights(
+          context,
+          GetOptionalInputTensor(context, node, kInputToInputWeightsTensor),
+          GetInput(context, node, kInputToForgetWeightsTensor),
+          GetInput(context, node, kInputToCellWeightsTensor),
+          input_to_output_weights,
+          GetOptionalInputTensor(context, node,
+                                 kRecurrentToInputWeightsTensor),
+          GetInput(context, node, kRecurrentToForgetWeightsTensor),
+          GetInput(context, node, kRecurrentToCellWeightsTensor),
+          recurrent_to_output_weights, &op_data->sparse_weights));
+
   // The type of Integer LSTM.
   const int num_intermediate_tensors = node->intermediates->size;
   if (is_integer) {
@@ -1601,6 +1617,12 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
     case kTfLiteFloat32: {
       // Index the scratch buffers pointers to the global scratch buffer.
       TfLiteTensor* scratch_buffer = GetTemporary(context, node, 0);
+      lstm_eval::PackSparseLstmWeights(
+          context, input_to_input_weights, input_to_forget_weights,
+          input_to_cell_weights, input_to_output_weights,
+          recurrent_to_input_weights, recurrent_to_forget_weights,
+          recurrent_to_cell_weights, recurrent_to_output_weights,
+          &op_data->sparse_weights);
       return lstm_eval::EvalFloat(
           input, input_to_input_weights, input_to_forget_weights,
           input_to_cell_weights, input_to_output_weights,
@@ -1619,7 +1641,7 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
           /*forward_sequence=*/true,
           /*time_major=*/true,
           /*output_offset=*/0, scratch_buffer, output_state, cell_state,
-          output);
+          output, &op_data->sparse_weights);
     }
     case kTfLiteUInt8:
     case kTfLiteInt8: {
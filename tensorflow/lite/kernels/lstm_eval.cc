@@ -28,9 +28,11 @@ limitations under the License.
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
 #include "tensorflow/lite/kernels/internal/kernel_utils.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/block_sparse.h"
 #include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
 #include "tensorflow/lite/kernels/internal/tensor_utils.h"
 #include "tensorflow/lite/kernels/op_macros.h"
+#include "tensorflow/lite/kernels/prepacked_weights.h"
 
 namespace tflite {
 namespace ops {
@@ -160,6 +162,9 @@ inline float GetTensorScale(const TfLiteTensor* tensor) {
 //   activation                                 - activation to use.
 //   is_input_all_zeros, is_aux_input_all_zeros - if input vectors are all zero.
 //   use_layer_norm                             - if doing layer norm LSTM.
+// Optional block-sparse copies of the input and recurrent weights, used
+// instead of the dense weights when not null:
+//   sparse_input_to_gate_weights, sparse_recurrent_to_gate_weights
 inline void CalculateLstmGateFloat(
     const float* input, const float* input_to_gate_weights,
     const float* aux_input, const float* aux_input_to_gate_weights,
@@ -169,7 +174,9 @@ inline void CalculateLstmGateFloat(
     const int n_batch, const int n_input, const int n_aux_input,
     const int n_output, const int n_cell,
     const TfLiteFusedActivation activation, float* gate,
-    const bool is_input_all_zeros, const bool is_aux_input_all_zeros) {
+    const bool is_input_all_zeros, const bool is_aux_input_all_zeros,
+    const SparseLstmWeights::Matrix* sparse_input_to_gate_weights,
+    const SparseLstmWeights::Matrix* sparse_recurrent_to_gate_weights) {
   const bool use_peephole = (cell_to_gate_weights != nullptr);
   const bool use_layer_norm = (layer_norm_coefficients != nullptr);
 
@@ -183,8 +190,13 @@ inline void CalculateLstmGateFloat(
   // For each batch and cell: compute input_weight * input.
   // Skip if input is all zeros.
   if (!is_input_all_zeros) {
-    tensor_utils::MatrixBatchVectorMultiplyAccumulate(
-        input_to_gate_weights, n_cell, n_input, input, n_batch, gate);
+    if (sparse_input_to_gate_weights) {
+      optimized_ops::BlockSparseMatrixBatchVectorMultiplyAccumulate(
+          *sparse_input_to_gate_weights, input, n_batch, gate);
+    } else {
+      tensor_utils::MatrixBatchVectorMultiplyAccumulate(
+          input_to_gate_weights, n_cell, n_input, input, n_batch, gate);
+    }
   }
   // For each batch and cell: compute aux_input_weight * aux_input.
   // Skip if auxiliary input is not available or all zeros.
@@ -194,8 +206,14 @@ inline void CalculateLstmGateFloat(
                                                       aux_input, n_batch, gate);
   }
   // For each batch and cell: compute recurrent_weight * output_state.
-  tensor_utils::MatrixBatchVectorMultiplyAccumulate(
-      recurrent_to_gate_weights, n_cell, n_output, output_state, n_batch, gate);
+  if (sparse_recurrent_to_gate_weights) {
+    optimized_ops::BlockSparseMatrixBatchVectorMultiplyAccumulate(
+        *sparse_recurrent_to_gate_weights, output_state, n_batch, gate);
+  } else {
+    tensor_utils::MatrixBatchVectorMultiplyAccumulate(
+        recurrent_to_gate_weights, n_cell, n_output, output_state, n_batch,
+        gate);
+  }
   // For each batch and cell: compute cell_weight .* cell_state (peephole LSTM)
   if (use_peephole) {
     tensor_utils::VectorBatchVectorCwiseProductAccumulate(
@@ -777,6 +795,9 @@ void CalculateLstmOutputInteger8x8_8(
 // in batch_major order, and each step processes batch_size many inputs from
 // input_ptr, and updates batch_size many cell and output states.
 //
+// The input and recurrent weights which are set in sparse_weights are used
+// instead of the corresponding dense weight pointers.
+//
 // The output_batch_dim is output.shape[-1], i.e. the outermost dimension of the
 // output tensor, and in most cases will be equal to n_output. It is usually not
 // when we want to store the LSTM output into a slice of the output tensor, e.g.
@@ -810,7 +831,8 @@ inline void LstmStepFloat(
     const TfLiteLSTMParams* params, int n_batch, int n_cell, int n_input,
     int n_aux_input, int n_output, int output_batch_leading_dim,
     float* output_state_ptr, float* cell_state_ptr, float* scratch0,
-    float* scratch1, float* scratch2, float* scratch3, float* output_ptr) {
+    float* scratch1, float* scratch2, float* scratch3, float* output_ptr,
+    const SparseLstmWeights& sparse_weights) {
   ruy::profiler::ScopeLabel label("LstmStepFloat");
   // Since we have already checked that weights are all there or none, we can
   // check the existence of only one to the get the condition.
@@ -837,7 +859,9 @@ inline void LstmStepFloat(
         cell_to_input_weights_ptr, input_layer_norm_coefficients_ptr,
         input_gate_bias_ptr, n_batch, n_input, n_aux_input, n_output, n_cell,
         /*activation=*/kTfLiteActSigmoid, input_gate_scratch,
-        is_input_all_zeros, is_aux_input_all_zeros);
+        is_input_all_zeros, is_aux_input_all_zeros,
+        sparse_weights.input_to_input_weights.get(),
+        sparse_weights.recurrent_to_input_weights.get());
   }
   // Calculate the forget gate.
   CalculateLstmGateFloat(
@@ -847,7 +871,9 @@ inline void LstmStepFloat(
       cell_to_forget_weights_ptr, forget_layer_norm_coefficients_ptr,
       forget_gate_bias_ptr, n_batch, n_input, n_aux_input, n_output, n_cell,
       /*activation=*/kTfLiteActSigmoid, forget_gate_scratch, is_input_all_zeros,
-      is_aux_input_all_zeros);
+      is_aux_input_all_zeros,
+      sparse_weights.input_to_forget_weights.get(),
+      sparse_weights.recurrent_to_forget_weights.get());
   // Calculate the cell update gate.
   CalculateLstmGateFloat(input_ptr, input_to_cell_weights_ptr, aux_input_ptr,
                          aux_input_to_cell_weights_ptr, output_state_ptr,
@@ -856,7 +882,9 @@ inline void LstmStepFloat(
                          cell_layer_norm_coefficients_ptr, cell_gate_bias_ptr,
                          n_batch, n_input, n_aux_input, n_output, n_cell,
                          params->activation, cell_gate_scratch,
-                         is_input_all_zeros, is_aux_input_all_zeros);
+                         is_input_all_zeros, is_aux_input_all_zeros,
+                         sparse_weights.input_to_cell_weights.get(),
+                         sparse_weights.recurrent_to_cell_weights.get());
   // Update the cell state.
   UpdateLstmCellFloat(n_batch, n_cell, cell_state_ptr, input_gate_scratch,
                       forget_gate_scratch, cell_gate_scratch, use_cifg,
@@ -869,7 +897,9 @@ inline void LstmStepFloat(
       cell_to_output_weights_ptr, output_layer_norm_coefficients_ptr,
       output_gate_bias_ptr, n_batch, n_input, n_aux_input, n_output, n_cell,
       /*activation=*/kTfLiteActSigmoid, output_gate_scratch, is_input_all_zeros,
-      is_aux_input_all_zeros);
+      is_aux_input_all_zeros,
+      sparse_weights.input_to_output_weights.get(),
+      sparse_weights.recurrent_to_output_weights.get());
   // Update the output state.
   CalculateLstmOutputFloat(n_batch, n_cell, n_output, cell_state_ptr,
                            output_gate_scratch, params->activation,
@@ -1643,8 +1673,111 @@ inline void LstmStepInteger8x8_8(
   std::copy_n(output_state_ptr, n_batch * n_output, output_ptr);
 }
 
+// Checks `weights` and allocates `matrix` if it has sparsity parameters.
+TfLiteStatus PrepareSparseWeights(
+    TfLiteContext* context, const TfLiteTensor* weights,
+    std::unique_ptr<SparseLstmWeights::Matrix>* matrix) {
+  if (weights == nullptr || weights->sparsity == nullptr || *matrix) {
+    return kTfLiteOk;
+  }
+  TF_LITE_ENSURE_MSG(context, weights->type == kTfLiteFloat32,
+                     "Sparse LSTM weights are only supported for float32.");
+  TF_LITE_ENSURE_EQ(context, weights->dims->size, 2);
+  matrix->reset(new SparseLstmWeights::Matrix);
+  return kTfLiteOk;
+}
+
+// Packs `weights` into `matrix`, if allocated by PrepareSparseWeights().
+void PackSparseWeights(TfLiteContext* context, const TfLiteTensor* weights,
+                       SparseLstmWeights::Matrix* matrix) {
+  if (matrix == nullptr) return;
+  const RuntimeShape shape = GetTensorShape(weights);
+  const int rows = shape.Dims(0);
+  const int cols = shape.Dims(1);
+  const int block_size =
+      optimized_ops::BlockSizeFromSparsity(*weights->sparsity, cols);
+  GetOrPackBlockSparseMatrix(
+      context, weights, "lstm/block_sparse/float32", rows, cols, block_size,
+      [&](SparseLstmWeights::Matrix* matrix) {
+        const std::vector<float> dense = optimized_ops::DensifySparseWeights(
+            *weights->sparsity, shape, GetTensorData<float>(weights));
+        optimized_ops::PackBlockSparseMatrix(dense.data(), rows, cols,
+                                             block_size, matrix);
+      },
+      matrix);
+}
+
 }  // namespace
 
+TfLiteStatus PrepareSparseLstmWeights(
+    TfLiteContext* context, const TfLiteTensor* input_to_input_weights,
+    const TfLiteTensor* input_to_forget_weights,
+    const TfLiteTensor* input_to_cell_weights,
+    const TfLiteTensor* input_to_output_weights,
+    const TfLiteTensor* recurrent_to_input_weights,
+    const TfLiteTensor* recurrent_to_forget_weights,
+    const TfLiteTensor* recurrent_to_cell_weights,
+    const TfLiteTensor* recurrent_to_output_weights,
+    SparseLstmWeights* sparse_weights) {
+  TF_LITE_ENSURE_OK(
+      context, PrepareSparseWeights(context, input_to_input_weights,
+                                    &sparse_weights->input_to_input_weights));
+  TF_LITE_ENSURE_OK(
+      context, PrepareSparseWeights(context, input_to_forget_weights,
+                                    &sparse_weights->input_to_forget_weights));
+  TF_LITE_ENSURE_OK(
+      context, PrepareSparseWeights(context, input_to_cell_weights,
+                                    &sparse_weights->input_to_cell_weights));
+  TF_LITE_ENSURE_OK(
+      context, PrepareSparseWeights(context, input_to_output_weights,
+                                    &sparse_weights->input_to_output_weights));
+  TF_LITE_ENSURE_OK(
+      context,
+      PrepareSparseWeights(context, recurrent_to_input_weights,
+                           &sparse_weights->recurrent_to_input_weights));
+  TF_LITE_ENSURE_OK(
+      context,
+      PrepareSparseWeights(context, recurrent_to_forget_weights,
+                           &sparse_weights->recurrent_to_forget_weights));
+  TF_LITE_ENSURE_OK(
+      context,
+      PrepareSparseWeights(context, recurrent_to_cell_weights,
+                           &sparse_weights->recurrent_to_cell_weights));
+  TF_LITE_ENSURE_OK(
+      context,
+      PrepareSparseWeights(context, recurrent_to_output_weights,
+                           &sparse_weights->recurrent_to_output_weights));
+  return kTfLiteOk;
+}
+
+void PackSparseLstmWeights(TfLiteContext* context,
+                           const TfLiteTensor* input_to_input_weights,
+                           const TfLiteTensor* input_to_forget_weights,
+                           const TfLiteTensor* input_to_cell_weights,
+                           const TfLiteTensor* input_to_output_weights,
+                           const TfLiteTensor* recurrent_to_input_weights,
+                           const TfLiteTensor* recurrent_to_forget_weights,
+                           const TfLiteTensor* recurrent_to_cell_weights,
+                           const TfLiteTensor* recurrent_to_output_weights,
+                           SparseLstmWeights* sparse_weights) {
+  PackSparseWeights(context, input_to_input_weights,
+                    sparse_weights->input_to_input_weights.get());
+  PackSparseWeights(context, input_to_forget_weights,
+                    sparse_weights->input_to_forget_weights.get());
+  PackSparseWeights(context, input_to_cell_weights,
+                    sparse_weights->input_to_cell_weights.get());
+  PackSparseWeights(context, input_to_output_weights,
+                    sparse_weights->input_to_output_weights.get());
+  PackSparseWeights(context, recurrent_to_input_weights,
+                    sparse_weights->recurrent_to_input_weights.get());
+  PackSparseWeights(context, recurrent_to_forget_weights,
+                    sparse_weights->recurrent_to_forget_weights.get());
+  PackSparseWeights(context, recurrent_to_cell_weights,
+                    sparse_weights->recurrent_to_cell_weights.get());
+  PackSparseWeights(context, recurrent_to_output_weights,
+                    sparse_weights->recurrent_to_output_weights.get());
+}
+
 // LINT.IfChange
 TfLiteStatus EvalFloat(
     const TfLiteTensor* input, const TfLiteTensor* input_to_input_weights,
@@ -1672,7 +1805,8 @@ TfLiteStatus EvalFloat(
     const TfLiteTensor* projection_weights, const TfLiteTensor* projection_bias,
     const TfLiteLSTMParams* params, bool forward_sequence, bool time_major,
     int output_offset, TfLiteTensor* scratch_buffer, TfLiteTensor* output_state,
-    TfLiteTensor* cell_state, TfLiteTensor* output) {
+    TfLiteTensor* cell_state, TfLiteTensor* output,
+    const SparseLstmWeights* sparse_weights) {
   TF_LITE_ASSERT(input->dims->size >= 2 && input->dims->size <= 3);
   int max_time, n_batch;
   if (input->dims->size == 3) {
@@ -1711,6 +1845,12 @@ TfLiteStatus EvalFloat(
     output_gate_scratch = scratch_buffer_ptr + 3 * n_cell * n_batch;
   }
 
+  // Without sparse weights, all gates read the dense weight tensors.
+  const SparseLstmWeights dense_weights;
+  if (sparse_weights == nullptr) {
+    sparse_weights = &dense_weights;
+  }
+
   const int output_batch_leading_dim =
       output->dims->data[output->dims->size - 1];
   if (time_major) {
@@ -1758,7 +1898,7 @@ TfLiteStatus EvalFloat(
           n_input, aux_input_size, n_output, output_batch_leading_dim,
           GetTensorData<float>(output_state), GetTensorData<float>(cell_state),
           input_gate_scratch, forget_gate_scratch, cell_gate_scratch,
-          output_gate_scratch, output_ptr);
+          output_gate_scratch, output_ptr, *sparse_weights);
     }
   } else {
     for (int b = 0; b < n_batch; b++) {
@@ -1819,7 +1959,7 @@ TfLiteStatus EvalFloat(
             n_cell, n_input, aux_input_size, n_output, output_batch_leading_dim,
             output_state_ptr, cell_state_ptr, input_gate_scratch_ptr,
             forget_gate_scratch_ptr, cell_gate_scratch_ptr,
-            output_gate_scratch_ptr, output_ptr);
+            output_gate_scratch_ptr, output_ptr, *sparse_weights);
       }
     }
   }
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/block_sparse.h"
 
 namespace tflite {
 namespace ops {
@@ -95,6 +96,49 @@ struct IntegerLstmParameter {
   int32_t intermediate_zp[12];
 };
 
+// Block-sparse copies of the float input and recurrent weights which have
+// sparsity parameters. The gate computations read the dense weight tensors
+// for the matrices which are null.
+struct SparseLstmWeights {
+  using Matrix = optimized_ops::BlockSparseMatrix<float>;
+  std::unique_ptr<Matrix> input_to_input_weights;
+  std::unique_ptr<Matrix> input_to_forget_weights;
+  std::unique_ptr<Matrix> input_to_cell_weights;
+  std::unique_ptr<Matrix> input_to_output_weights;
+  std::unique_ptr<Matrix> recurrent_to_input_weights;
+  std::unique_ptr<Matrix> recurrent_to_forget_weights;
+  std::unique_ptr<Matrix> recurrent_to_cell_weights;
+  std::unique_ptr<Matrix> recurrent_to_output_weights;
+};
+
+// Allocates the block-sparse matrices of those of the given (optional) float
+// weights which have sparsity parameters. Returns an error for sparse weights
+// of other types. Called from Prepare().
+TfLiteStatus PrepareSparseLstmWeights(
+    TfLiteContext* context, const TfLiteTensor* input_to_input_weights,
+    const TfLiteTensor* input_to_forget_weights,
+    const TfLiteTensor* input_to_cell_weights,
+    const TfLiteTensor* input_to_output_weights,
+    const TfLiteTensor* recurrent_to_input_weights,
+    const TfLiteTensor* recurrent_to_forget_weights,
+    const TfLiteTensor* recurrent_to_cell_weights,
+    const TfLiteTensor* recurrent_to_output_weights,
+    SparseLstmWeights* sparse_weights);
+
+// Packs the weights allocated by PrepareSparseLstmWeights(), unless already
+// packed. Called before the first EvalFloat(), so that weights are only
+// packed when run, or taken from the prepacked weights cache.
+void PackSparseLstmWeights(TfLiteContext* context,
+                           const TfLiteTensor* input_to_input_weights,
+                           const TfLiteTensor* input_to_forget_weights,
+                           const TfLiteTensor* input_to_cell_weights,
+                           const TfLiteTensor* input_to_output_weights,
+                           const TfLiteTensor* recurrent_to_input_weights,
+                           const TfLiteTensor* recurrent_to_forget_weights,
+                           const TfLiteTensor* recurrent_to_cell_weights,
+                           const TfLiteTensor* recurrent_to_output_weights,
+                           SparseLstmWeights* sparse_weights);
+
 TfLiteStatus EvalFloat(
     const TfLiteTensor* input, const TfLiteTensor* input_to_input_weights,
     const TfLiteTensor* input_to_forget_weights,
@@ -121,7 +165,8 @@ TfLiteStatus EvalFloat(
     const TfLiteTensor* projection_weights, const TfLiteTensor* projection_bias,
     const TfLiteLSTMParams* params, bool forward_sequence, bool time_major,
     int output_offset, TfLiteTensor* scratch_buffer, TfLiteTensor* output_state,
-    TfLiteTensor* cell_state, TfLiteTensor* output);
+    TfLiteTensor* cell_state, TfLiteTensor* output,
+    const SparseLstmWeights* sparse_weights = nullptr);
 
 TfLiteStatus EvalHybrid(
     const TfLiteTensor* input, const TfLiteTensor* input_to_input_weights,
@@ -0,0 +1,79 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_PREPACKED_WEIGHTS_H_
+#define TENSORFLOW_LITE_KERNELS_PREPACKED_WEIGHTS_H_
+
+#include <cstddef>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
+#include "tensorflow/lite/kernels/internal/optimized/sparse_ops/block_sparse.h"
+#include "tensorflow/lite/prepacked_weights_cache.h"
+
+namespace tflite {
+
+// Returns the prepacked weights cache set on the interpreter, or null.
+inline PrepackedWeightsCache* GetPrepackedWeightsCache(
+    TfLiteContext* context) {
+  auto* external_context = static_cast<ExternalCpuBackendContext*>(
+      context->GetExternalContext(context, kTfLiteCpuBackendContext));
+  return external_context != nullptr
+             ? external_context->prepacked_weights_cache()
+             : nullptr;
+}
+
+// Sets `matrix` to the packed form of the constant `weights`, computed by
+// `pack(matrix)`, unless `matrix` is already packed. Kernels call this on
+// first use rather than in Prepare(), so that models load without touching
+// the pages of weights they don't run.
+//
+// With a prepacked weights cache, `matrix` uses the packed form stored in the
+// cache when there is one, and stores its packed form there otherwise.
+// `format` identifies the packing done by `pack`, and must change whenever the
+// packing does. `rows`, `cols` and `block_size` are the dimensions `pack`
+// produces; cached matrices with other dimensions, or which are malformed,
+// are ignored and the weights are packed again.
+template <typename T, typename PackFn>
+void GetOrPackBlockSparseMatrix(TfLiteContext* context,
+                                const TfLiteTensor* weights,
+                                const char* format, int rows, int cols,
+                                int block_size, PackFn pack,
+                                optimized_ops::BlockSparseMatrix<T>* matrix) {
+  if (matrix->is_packed()) return;
+  PrepackedWeightsCache* cache = GetPrepackedWeightsCache(context);
+  const uint64_t tag = PrepackedWeightsCache::Tag(format);
+  if (cache != nullptr) {
+    size_t size = 0;
+    const void* data =
+        cache->Find(weights->data.raw_const, weights->bytes, tag, &size);
+    if (data != nullptr && matrix->Attach(data, size, rows, cols, block_size)) {
+      return;
+    }
+  }
+  pack(matrix);
+  if (cache != nullptr) {
+    const void* data =
+        cache->Insert(weights->data.raw_const, weights->bytes, tag,
+                      matrix->buffer(), matrix->buffer_size());
+    // Share the cached copy, which may be in use by other interpreters.
+    if (data != nullptr) {
+      matrix->Attach(data, matrix->buffer_size(), rows, cols, block_size);
+    }
+  }
+}
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_KERNELS_PREPACKED_WEIGHTS_H_
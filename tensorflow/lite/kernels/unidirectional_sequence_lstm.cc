@@ -37,6 +37,8 @@ struct OpData {
   // The scratch tensor index.
   int scratch_tensor_index;
   bool compute_row_sums = false;
+  // Float weights with sparsity parameters, packed for the gate computations.
+  lstm_eval::SparseLstmWeights sparse_weights;
 };
 
 // Temporary tensors
@@ -341,6 +343,21 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_OK(context,
                     context->ResizeTensor(context, output, output_size));
 
+  TF_LITE_ENSURE_OK(
+      context,
+      lstm_eval::PrepareSparseLstmWeights(
+          context,
+          GetOptionalInputTensor(context, node,
+                                 lstm::full::kInputToInputWeightsTensor),
+          GetInput(context, node, lstm::full::kInputToForgetWeightsTensor),
+          GetInput(context, node, lstm::full::kInputToCellWeightsTensor),
+          input_to_output_weights,
+          GetOptionalInputTensor(context, node,
+                                 lstm::full::kRecurrentToInputWeightsTensor),
+          GetInput(context, node, lstm::full::kRecurrentToForgetWeightsTensor),
+          GetInput(context, node, lstm::full::kRecurrentToCellWeightsTensor),
+          recurrent_to_output_weights, &op_data->sparse_weights));
+
   TfLiteIntArrayFree(node->temporaries);
   if (IsHybridOp(input, input_to_output_weights)) {
     node->temporaries = TfLiteIntArrayCreate(kNumTemporaryTensors);
@@ -625,6 +642,13 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
 
   switch (input_to_output_weights->type) {
     case kTfLiteFloat32: {
+      OpData* op_data = reinterpret_cast<OpData*>(node->user_data);
+      lstm_eval::PackSparseLstmWeights(
+          context, input_to_input_weights, input_to_forget_weights,
+          input_to_cell_weights, input_to_output_weights,
+          recurrent_to_input_weights, recurrent_to_forget_weights,
+          recurrent_to_cell_weights, recurrent_to_output_weights,
+          &op_data->sparse_weights);
       return lstm_eval::EvalFloat(
           input, input_to_input_weights, input_to_forget_weights,
           input_to_cell_weights, input_to_output_weights,
@@ -642,7 +666,7 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
           projection_weights, projection_bias, &lstm_params,
           /*forward_sequence=*/true, time_major,
           /*output_offset=*/0, scratch_buffer, output_state, cell_state,
-          output);
+          output, &op_data->sparse_weights);
     }
     case kTfLiteUInt8:
     case kTfLiteInt8: {
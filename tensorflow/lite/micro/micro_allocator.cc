@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/core/api/error_reporter.h"
 #include "tensorflow/lite/core/api/flatbuffer_conversions.h"
+#include "tensorflow/lite/core/api/offline_memory_allocation.h"
 #include "tensorflow/lite/core/api/op_resolver.h"
 #include "tensorflow/lite/core/api/tensor_utils.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
@@ -50,8 +51,6 @@ struct AllocationInfo {
 // requirement for SIMD extensions.
 constexpr int kBufferAlignment = 16;
 
-constexpr char kOfflineMemAllocMetadata[] = "OfflineMemoryAllocation";
-
 // Instance of a zero-length int to pass as tensor dims for a flatbuffer
 // Tensor with no shape. Note that the second member of a TfLiteArray is a
 // flexible array member, which is not strictly valid C++. However it is
@@ -91,8 +90,8 @@ TfLiteStatus CheckOfflinePlannedOffsets(const Model* model,
   if (model->metadata()) {
     for (size_t i = 0; i < model->metadata()->size(); ++i) {
       auto metadata = model->metadata()->Get(i);
-      if (strncmp(metadata->name()->c_str(), kOfflineMemAllocMetadata,
-                  strlen(kOfflineMemAllocMetadata)) == 0) {
+      if (strncmp(metadata->name()->c_str(), kOfflineMemoryAllocationMetadata,
+                  strlen(kOfflineMemoryAllocationMetadata)) == 0) {
         auto* subgraphs = model->subgraphs();
         const SubGraph* subgraph = (*subgraphs)[0];
         const flatbuffers::Vector<flatbuffers::Offset<Tensor>>* tensors =
@@ -304,8 +303,8 @@ TfLiteStatus AllocationInfoBuilder::GetOfflinePlannedOffsets(
   if (model->metadata()) {
     for (size_t i = 0; i < model->metadata()->size(); ++i) {
       auto metadata = model->metadata()->Get(i);
-      if (strncmp(metadata->name()->c_str(), kOfflineMemAllocMetadata,
-                  strlen(kOfflineMemAllocMetadata)) == 0) {
+      if (strncmp(metadata->name()->c_str(), kOfflineMemoryAllocationMetadata,
+                  strlen(kOfflineMemoryAllocationMetadata)) == 0) {
         const flatbuffers::Vector<flatbuffers::Offset<Buffer>>* buffers =
             model->buffers();
         auto* buffer = (*buffers)[metadata->buffer()];
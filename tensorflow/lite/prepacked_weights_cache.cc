@@ -0,0 +1,279 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/prepacked_weights_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+namespace tflite {
+namespace {
+
+// Cache file layout: a FileHeader, num_entries FileEntry records, then the
+// packed data of each entry, at offsets aligned to kAlignment.
+constexpr char kFileMagic[8] = {'T', 'F', 'L', 'P', 'W', 'C', '0', '2'};
+
+struct FileHeader {
+  char magic[8];
+  uint64_t model_size;
+  uint64_t num_entries;
+};
+
+struct FileEntry {
+  uint64_t weights_offset;
+  uint64_t weights_size;
+  uint64_t tag;
+  uint64_t weights_hash;
+  uint64_t data_offset;
+  uint64_t data_size;
+};
+
+constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ull;
+
+uint64_t Fnv1a(const void* data, size_t size, uint64_t hash) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+size_t AlignTo(size_t alignment, size_t offset) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+std::unique_ptr<PrepackedWeightsCache> PrepackedWeightsCache::Create(
+    const Allocation* model, const char* path, ErrorReporter* error_reporter) {
+  if (model == nullptr || !model->valid()) {
+    error_reporter->Report("Prepacked weights cache requires a valid model.");
+    return nullptr;
+  }
+  std::unique_ptr<PrepackedWeightsCache> cache(
+      new PrepackedWeightsCache(model, path, error_reporter));
+  cache->Load();
+  return cache;
+}
+
+PrepackedWeightsCache::PrepackedWeightsCache(const Allocation* model,
+                                             const char* path,
+                                             ErrorReporter* error_reporter)
+    : model_(model),
+      path_(path != nullptr ? path : ""),
+      error_reporter_(error_reporter) {}
+
+PrepackedWeightsCache::~PrepackedWeightsCache() {}
+
+uint64_t PrepackedWeightsCache::WeightsHash(const void* weights,
+                                            size_t weights_size) {
+  return Fnv1a(weights, weights_size, kFnvOffsetBasis);
+}
+
+uint64_t PrepackedWeightsCache::Tag(const char* format) {
+  return Fnv1a(format, std::strlen(format), kFnvOffsetBasis);
+}
+
+void PrepackedWeightsCache::Load() {
+  if (path_.empty()) return;
+  // A missing file is the normal state of a first run, and not an error.
+  std::FILE* file = std::fopen(path_.c_str(), "rb");
+  if (file == nullptr) return;
+  std::fclose(file);
+
+  std::unique_ptr<Allocation> allocation;
+  if (MMAPAllocation::IsSupported()) {
+    allocation.reset(new MMAPAllocation(path_.c_str(), error_reporter_));
+  } else {
+    allocation.reset(new FileCopyAllocation(path_.c_str(), error_reporter_));
+  }
+  if (!allocation->valid()) return;
+
+  const char* base = static_cast<const char*>(allocation->base());
+  const size_t size = allocation->bytes();
+  FileHeader header;
+  if (size < sizeof(header)) {
+    error_reporter_->Report("Prepacked weights cache '%s' is truncated.",
+                            path_.c_str());
+    return;
+  }
+  std::memcpy(&header, base, sizeof(header));
+  if (std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 ||
+      header.model_size != model_->bytes()) {
+    error_reporter_->Report(
+        "Ignoring prepacked weights cache '%s', which was written for another "
+        "model or version.",
+        path_.c_str());
+    return;
+  }
+  if (header.num_entries > (size - sizeof(header)) / sizeof(FileEntry)) {
+    error_reporter_->Report("Prepacked weights cache '%s' is truncated.",
+                            path_.c_str());
+    return;
+  }
+
+  std::map<Key, Entry> entries;
+  for (uint64_t i = 0; i < header.num_entries; ++i) {
+    FileEntry entry;
+    std::memcpy(&entry, base + sizeof(header) + i * sizeof(entry),
+                sizeof(entry));
+    if (entry.data_offset > size ||
+        entry.data_size > size - entry.data_offset ||
+        entry.data_offset % kAlignment != 0) {
+      error_reporter_->Report("Prepacked weights cache '%s' is corrupted.",
+                              path_.c_str());
+      return;
+    }
+    entries[Key(entry.weights_offset, entry.weights_size, entry.tag)] = {
+        base + entry.data_offset, static_cast<size_t>(entry.data_size),
+        entry.weights_hash, /*verified=*/false};
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_ = std::move(entries);
+  num_loaded_entries_ = entries_.size();
+  file_ = std::move(allocation);
+}
+
+bool PrepackedWeightsCache::GetKey(const void* weights, size_t weights_size,
+                                   uint64_t tag, Key* key) const {
+  const char* base = static_cast<const char*>(model_->base());
+  const char* data = static_cast<const char*>(weights);
+  if (data < base || data + weights_size > base + model_->bytes()) {
+    return false;
+  }
+  *key = Key(data - base, weights_size, tag);
+  return true;
+}
+
+const void* PrepackedWeightsCache::Find(const void* weights,
+                                        size_t weights_size, uint64_t tag,
+                                        size_t* packed_size) const {
+  Key key;
+  if (!GetKey(weights, weights_size, tag, &key)) return nullptr;
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) return nullptr;
+  if (!it->second.verified) {
+    // Entries loaded from the file were packed from the weights of the model
+    // which wrote it. Weights are hashed on first use, without holding the
+    // lock, so that entries for weights which changed since are never used.
+    const uint64_t expected_hash = it->second.weights_hash;
+    lock.unlock();
+    const bool matches = WeightsHash(weights, weights_size) == expected_hash;
+    lock.lock();
+    it = entries_.find(key);
+    if (it == entries_.end() || !matches ||
+        it->second.weights_hash != expected_hash) {
+      return nullptr;
+    }
+    it->second.verified = true;
+  }
+  *packed_size = it->second.size;
+  return it->second.data;
+}
+
+const void* PrepackedWeightsCache::Insert(const void* weights,
+                                          size_t weights_size, uint64_t tag,
+                                          const void* packed_data,
+                                          size_t packed_size) {
+  Key key;
+  if (!GetKey(weights, weights_size, tag, &key)) return nullptr;
+  const uint64_t weights_hash = WeightsHash(weights, weights_size);
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Another interpreter sharing the cache may have packed the same weights.
+  // A stale entry loaded from the file, for other weights, is replaced.
+  const auto it = entries_.find(key);
+  if (it != entries_.end() && it->second.weights_hash == weights_hash) {
+    it->second.verified = true;
+    return it->second.data;
+  }
+
+  std::unique_ptr<char[]> storage(new char[packed_size + kAlignment]);
+  char* data = reinterpret_cast<char*>(
+      AlignTo(kAlignment, reinterpret_cast<uintptr_t>(storage.get())));
+  std::memcpy(data, packed_data, packed_size);
+  inserted_data_.push_back(std::move(storage));
+  entries_[key] = {data, packed_size, weights_hash, /*verified=*/true};
+  modified_ = true;
+  return data;
+}
+
+size_t PrepackedWeightsCache::num_entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+TfLiteStatus PrepackedWeightsCache::Save() {
+  if (path_.empty()) return kTfLiteOk;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!modified_) return kTfLiteOk;
+
+  FileHeader header;
+  std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+  header.model_size = model_->bytes();
+  header.num_entries = entries_.size();
+
+  std::vector<FileEntry> file_entries;
+  file_entries.reserve(entries_.size());
+  size_t offset = AlignTo(
+      kAlignment, sizeof(header) + entries_.size() * sizeof(FileEntry));
+  for (const auto& entry : entries_) {
+    file_entries.push_back({std::get<0>(entry.first), std::get<1>(entry.first),
+                            std::get<2>(entry.first), entry.second.weights_hash,
+                            offset, entry.second.size});
+    offset = AlignTo(kAlignment, offset + entry.second.size);
+  }
+
+  // Write to a temporary file and rename it, so that a concurrent or crashed
+  // run never leaves a partial file, and the file currently mapped stays
+  // valid.
+  const string temp_path = path_ + ".tmp";
+  std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+  if (file == nullptr) {
+    error_reporter_->Report("Could not open '%s' for writing.",
+                            temp_path.c_str());
+    return kTfLiteError;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(file_entries.data(), sizeof(FileEntry),
+                        file_entries.size(), file) == file_entries.size();
+  size_t written = sizeof(header) + file_entries.size() * sizeof(FileEntry);
+  const char padding[kAlignment] = {};
+  auto entry = entries_.begin();
+  for (const FileEntry& file_entry : file_entries) {
+    if (!ok) break;
+    ok = std::fwrite(padding, 1, file_entry.data_offset - written, file) ==
+             file_entry.data_offset - written &&
+         std::fwrite(entry->second.data, 1, entry->second.size, file) ==
+             entry->second.size;
+    written = file_entry.data_offset + entry->second.size;
+    ++entry;
+  }
+  ok = (std::fclose(file) == 0) && ok;
+  if (!ok || std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+    error_reporter_->Report("Failed to write prepacked weights cache '%s'.",
+                            path_.c_str());
+    std::remove(temp_path.c_str());
+    return kTfLiteError;
+  }
+  // The entries now all are in the file.
+  num_loaded_entries_ = entries_.size();
+  modified_ = false;
+  return kTfLiteOk;
+}
+
+}  // namespace tflite
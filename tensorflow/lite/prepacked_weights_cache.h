@@ -0,0 +1,142 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_PREPACKED_WEIGHTS_CACHE_H_
+#define TENSORFLOW_LITE_PREPACKED_WEIGHTS_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <tuple>
+#include <vector>
+
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/string_type.h"
+
+namespace tflite {
+
+// Stores the prepacked forms of constant weights, for kernels which repack
+// their weights before use, and optionally persists them to a file.
+//
+// Weights are identified by their offset and size in the model buffer, and a
+// kernel-defined tag describing the packed format. When the cache file of a
+// previous run is loaded, it is memory-mapped: kernels use the packed weights
+// in place, so neither the packing work nor the packed copy in private memory
+// is paid for again.
+//
+// Typical usage:
+//
+//   auto model = FlatBufferModel::BuildFromFile("model.tflite");
+//   auto cache = PrepackedWeightsCache::Create(
+//       model->allocation(), "model.tflite.packed", model->error_reporter());
+//   InterpreterBuilder(*model, resolver)(&interpreter);
+//   interpreter->SetPrepackedWeightsCache(cache.get());
+//   interpreter->AllocateTensors();
+//   interpreter->Invoke();
+//   cache->Save();  // Writes the file if new weights were packed.
+//
+// The cache must outlive the interpreters using it, and the model must
+// outlive the cache. Each entry of the cache file records a hash of the
+// weights it was packed from, which is checked the first time the entry is
+// found, so that entries of another version of the model are never used: they
+// are packed again and replaced. Files for a model of another size are
+// ignored.
+//
+// Find() and Insert() are thread-safe.
+class PrepackedWeightsCache {
+ public:
+  // Creates a cache for the weights in `model`. Entries are loaded from the
+  // file at `path` if it exists, and Save() writes them there. `path` may be
+  // null, for a cache which is only shared between interpreters.
+  static std::unique_ptr<PrepackedWeightsCache> Create(
+      const Allocation* model, const char* path,
+      ErrorReporter* error_reporter);
+
+  ~PrepackedWeightsCache();
+
+  // Returns the packed data stored for `weights` in the format `tag`, and
+  // sets `packed_size` to its size, or returns null if there is none or if it
+  // was packed from other weights.
+  const void* Find(const void* weights, size_t weights_size, uint64_t tag,
+                   size_t* packed_size) const;
+
+  // Stores a copy of `packed_data` for `weights` in the format `tag`, and
+  // returns the stored copy, which lives as long as the cache. If packed data
+  // for the same weights is already stored, returns it instead. Returns null,
+  // and stores nothing, if `weights` aren't part of the model.
+  const void* Insert(const void* weights, size_t weights_size, uint64_t tag,
+                     const void* packed_data, size_t packed_size);
+
+  // Writes all the entries to the cache file, if entries were inserted or
+  // replaced since it was loaded. The file is replaced atomically.
+  TfLiteStatus Save();
+
+  // Returns the tag of the packed format named `format`.
+  static uint64_t Tag(const char* format);
+
+  // Returns the number of entries, and the number of them in the cache file.
+  size_t num_entries() const;
+  size_t num_loaded_entries() const { return num_loaded_entries_; }
+
+  // The alignment of packed data, in the file and in memory.
+  static constexpr size_t kAlignment = 64;
+
+ private:
+  // Weights offset in the model, weights size, tag.
+  using Key = std::tuple<uint64_t, uint64_t, uint64_t>;
+  struct Entry {
+    const void* data;
+    size_t size;
+    // Hash of the weights the data was packed from.
+    uint64_t weights_hash;
+    // Whether the weights in the model were checked against weights_hash.
+    bool verified;
+  };
+
+  PrepackedWeightsCache(const Allocation* model, const char* path,
+                        ErrorReporter* error_reporter);
+
+  // Loads the entries of the cache file, if it exists and matches the model.
+  void Load();
+  bool GetKey(const void* weights, size_t weights_size, uint64_t tag,
+              Key* key) const;
+  static uint64_t WeightsHash(const void* weights, size_t weights_size);
+
+  const Allocation* const model_;
+  const string path_;
+  ErrorReporter* const error_reporter_;
+
+  mutable std::mutex mutex_;
+  // Mutable, as Find() records which loaded entries were verified.
+  mutable std::map<Key, Entry> entries_;
+  // The memory-mapped cache file, which loaded entries point into.
+  std::unique_ptr<Allocation> file_;
+  // Storage of the entries inserted since the file was loaded, over-allocated
+  // for alignment.
+  std::vector<std::unique_ptr<char[]>> inserted_data_;
+  size_t num_loaded_entries_ = 0;
+  // Whether entries were inserted or replaced since the file was loaded.
+  bool modified_ = false;
+
+  PrepackedWeightsCache(const PrepackedWeightsCache&) = delete;
+  PrepackedWeightsCache& operator=(const PrepackedWeightsCache&) = delete;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_PREPACKED_WEIGHTS_CACHE_H_
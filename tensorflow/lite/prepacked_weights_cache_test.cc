@@ -0,0 +1,196 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/prepacked_weights_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/lite/testing/util.h"
+
+namespace tflite {
+namespace {
+
+class PrepackedWeightsCacheTest : public ::testing::Test {
+ protected:
+  PrepackedWeightsCacheTest()
+      : model_data_(16384),
+        model_(model_data_.data(), model_data_.size(), &error_reporter_),
+        path_(::testing::TempDir() + "/prepacked_weights_cache_test.bin") {
+    for (size_t i = 0; i < model_data_.size(); ++i) {
+      model_data_[i] = static_cast<char>(i * 7);
+    }
+    std::remove(path_.c_str());
+  }
+
+  ~PrepackedWeightsCacheTest() override { std::remove(path_.c_str()); }
+
+  const char* weights(int offset) const { return model_data_.data() + offset; }
+
+  TestErrorReporter error_reporter_;
+  std::vector<char> model_data_;
+  MemoryAllocation model_;
+  std::string path_;
+};
+
+TEST_F(PrepackedWeightsCacheTest, FindsInsertedEntries) {
+  auto cache =
+      PrepackedWeightsCache::Create(&model_, nullptr, &error_reporter_);
+  const std::vector<int32_t> packed = {1, 2, 3};
+  size_t size = 0;
+  EXPECT_EQ(cache->Find(weights(100), 64, /*tag=*/1, &size), nullptr);
+
+  const void* stored = cache->Insert(weights(100), 64, /*tag=*/1,
+                                     packed.data(), sizeof(int32_t) * 3);
+  ASSERT_NE(stored, nullptr);
+  EXPECT_NE(stored, packed.data());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(stored) %
+                PrepackedWeightsCache::kAlignment,
+            0);
+  EXPECT_EQ(cache->Find(weights(100), 64, /*tag=*/1, &size), stored);
+  EXPECT_EQ(size, sizeof(int32_t) * 3);
+  EXPECT_EQ(std::memcmp(stored, packed.data(), size), 0);
+
+  // Other tags, offsets and sizes are other entries.
+  EXPECT_EQ(cache->Find(weights(100), 64, /*tag=*/2, &size), nullptr);
+  EXPECT_EQ(cache->Find(weights(101), 64, /*tag=*/1, &size), nullptr);
+  EXPECT_EQ(cache->Find(weights(100), 32, /*tag=*/1, &size), nullptr);
+  // Inserting the same weights again returns the first copy.
+  EXPECT_EQ(cache->Insert(weights(100), 64, /*tag=*/1, packed.data(), 4),
+            stored);
+  EXPECT_EQ(cache->num_entries(), 1);
+}
+
+TEST_F(PrepackedWeightsCacheTest, IgnoresWeightsOutsideTheModel) {
+  auto cache =
+      PrepackedWeightsCache::Create(&model_, nullptr, &error_reporter_);
+  const std::vector<char> other(64);
+  const char packed[4] = {};
+  size_t size = 0;
+  EXPECT_EQ(cache->Insert(other.data(), 64, /*tag=*/1, packed, 4), nullptr);
+  EXPECT_EQ(cache->Find(other.data(), 64, /*tag=*/1, &size), nullptr);
+  // Weights which run past the end of the model.
+  EXPECT_EQ(cache->Insert(weights(16384 - 32), 64, /*tag=*/1, packed, 4),
+            nullptr);
+  EXPECT_EQ(cache->num_entries(), 0);
+}
+
+TEST_F(PrepackedWeightsCacheTest, SavesAndLoadsEntries) {
+  const std::vector<float> packed1 = {1.0f, 2.0f, 3.0f};
+  const std::vector<int8_t> packed2 = {4, 5, 6, 7, 8};
+  {
+    auto cache =
+        PrepackedWeightsCache::Create(&model_, path_.c_str(), &error_reporter_);
+    EXPECT_EQ(cache->num_loaded_entries(), 0);
+    cache->Insert(weights(0), 1024, /*tag=*/7, packed1.data(),
+                  sizeof(float) * packed1.size());
+    cache->Insert(weights(4096), 512, /*tag=*/7, packed2.data(),
+                  packed2.size());
+    EXPECT_EQ(cache->Save(), kTfLiteOk);
+    EXPECT_EQ(cache->num_loaded_entries(), 2);
+  }
+
+  auto cache =
+      PrepackedWeightsCache::Create(&model_, path_.c_str(), &error_reporter_);
+  EXPECT_EQ(cache->num_loaded_entries(), 2);
+  size_t size = 0;
+  const void* data = cache->Find(weights(0), 1024, /*tag=*/7, &size);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data) %
+                PrepackedWeightsCache::kAlignment,
+            0);
+  ASSERT_EQ(size, sizeof(float) * packed1.size());
+  EXPECT_EQ(std::memcmp(data, packed1.data(), size), 0);
+  data = cache->Find(weights(4096), 512, /*tag=*/7, &size);
+  ASSERT_NE(data, nullptr);
+  ASSERT_EQ(size, packed2.size());
+  EXPECT_EQ(std::memcmp(data, packed2.data(), size), 0);
+
+  // Nothing new to write.
+  EXPECT_EQ(cache->Save(), kTfLiteOk);
+  EXPECT_EQ(error_reporter_.num_calls(), 0);
+}
+
+TEST_F(PrepackedWeightsCacheTest, IgnoresEntriesOfChangedWeights) {
+  const char packed1[4] = {1, 2, 3, 4};
+  const char packed2[4] = {5, 6, 7, 8};
+  {
+    auto cache =
+        PrepackedWeightsCache::Create(&model_, path_.c_str(), &error_reporter_);
+    cache->Insert(weights(0), 1024, /*tag=*/7, packed1, 4);
+    cache->Insert(weights(8192), 1024, /*tag=*/7, packed2, 4);
+    EXPECT_EQ(cache->Save(), kTfLiteOk);
+  }
+
+  // Change weights in the middle of the model, keeping its size and layout,
+  // as retraining does.
+  model_data_[8200] ^= 1;
+  auto cache =
+      PrepackedWeightsCache::Create(&model_, path_.c_str(), &error_reporter_);
+  EXPECT_EQ(cache->num_loaded_entries(), 2);
+  size_t size = 0;
+  const void* data = cache->Find(weights(0), 1024, /*tag=*/7, &size);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(std::memcmp(data, packed1, 4), 0);
+  EXPECT_EQ(cache->Find(weights(8192), 1024, /*tag=*/7, &size), nullptr);
+
+  // Packing the changed weights again replaces the stale entry.
+  const char repacked[4] = {9, 10, 11, 12};
+  data = cache->Insert(weights(8192), 1024, /*tag=*/7, repacked, 4);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(std::memcmp(data, repacked, 4), 0);
+  EXPECT_EQ(cache->Find(weights(8192), 1024, /*tag=*/7, &size), data);
+  EXPECT_EQ(cache->num_entries(), 2);
+  EXPECT_EQ(cache->Save(), kTfLiteOk);
+
+  cache.reset();
+  cache =
+      PrepackedWeightsCache::Create(&model_, path_.c_str(), &error_reporter_);
+  data = cache->Find(weights(8192), 1024, /*tag=*/7, &size);
+  ASSERT_NE(data, nullptr);
+  EXPECT_EQ(std::memcmp(data, repacked, 4), 0);
+  EXPECT_EQ(error_reporter_.num_calls(), 0);
+}
+
+TEST_F(PrepackedWeightsCacheTest, IgnoresFileOfAnotherModel) {
+  {
+    auto cache =
+        PrepackedWeightsCache::Create(&model_, path_.c_str(), &error_reporter_);
+    const char packed[4] = {1, 2, 3, 4};
+    cache->Insert(weights(0), 1024, /*tag=*/7, packed, 4);
+    EXPECT_EQ(cache->Save(), kTfLiteOk);
+  }
+
+  MemoryAllocation other_model(model_data_.data(), model_data_.size() - 64,
+                               &error_reporter_);
+  auto cache = PrepackedWeightsCache::Create(&other_model, path_.c_str(),
+                                             &error_reporter_);
+  EXPECT_EQ(cache->num_loaded_entries(), 0);
+  size_t size = 0;
+  EXPECT_EQ(cache->Find(weights(0), 1024, /*tag=*/7, &size), nullptr);
+  EXPECT_EQ(error_reporter_.num_calls(), 1);
+}
+
+}  // namespace
+}  // namespace tflite
+
+int main(int argc, char** argv) {
+  ::tflite::LogToStderr();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,348 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/perf_event_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#include "tensorflow/lite/profiling/time.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tflite {
+namespace profiling {
+namespace {
+
+constexpr uint32_t kInvalidHandle = ~static_cast<uint32_t>(0);
+
+const char* EventTypeName(Profiler::EventType event_type) {
+  switch (event_type) {
+    case Profiler::EventType::OPERATOR_INVOKE_EVENT:
+      return "operator";
+    case Profiler::EventType::DELEGATE_OPERATOR_INVOKE_EVENT:
+      return "delegate_operator";
+    default:
+      return "other";
+  }
+}
+
+bool Available(uint64_t value) { return value != kPerfCounterUnavailable; }
+
+// Returns numerator / denominator, or a negative value if unavailable.
+double Ratio(uint64_t numerator, uint64_t denominator, double scale) {
+  if (!Available(numerator) || !Available(denominator) || denominator == 0) {
+    return -1.0;
+  }
+  return scale * static_cast<double>(numerator) / denominator;
+}
+
+void WriteCounter(uint64_t value, int64_t count, std::ostream* stream) {
+  if (Available(value)) {
+    (*stream) << value / std::max<int64_t>(count, 1);
+  } else {
+    (*stream) << "n/a";
+  }
+}
+
+void WriteRatio(double value, std::ostream* stream) {
+  if (value >= 0.0) {
+    (*stream) << value;
+  } else {
+    (*stream) << "n/a";
+  }
+}
+
+// Writes `text` as a JSON string.
+void WriteJsonString(const std::string& text, std::ostream* stream) {
+  (*stream) << '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      (*stream) << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      (*stream) << ' ';
+    } else {
+      (*stream) << c;
+    }
+  }
+  (*stream) << '"';
+}
+
+#if defined(__linux__)
+int OpenCounter(uint64_t config, int group_fd) {
+  perf_event_attr attr = {};
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = group_fd == -1 ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, /*pid=*/0,
+                                  /*cpu=*/-1, group_fd, /*flags=*/0));
+}
+#endif
+
+}  // namespace
+
+void PerfEventStats::Add(const PerfEventRecord& record) {
+  ++count;
+  total_us += record.end_us - record.begin_us;
+  for (int i = 0; i < kNumPerfCounters; ++i) {
+    if (Available(counters[i]) && Available(record.counters[i])) {
+      counters[i] += record.counters[i];
+    } else {
+      counters[i] = kPerfCounterUnavailable;
+    }
+  }
+}
+
+std::unique_ptr<PerfEventProfiler> PerfEventProfiler::Create(
+    uint32_t max_num_records) {
+#if defined(__linux__)
+  std::unique_ptr<PerfEventProfiler> profiler(
+      new PerfEventProfiler(max_num_records));
+  const uint64_t configs[kNumPerfCounters] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  for (int i = 0; i < kNumPerfCounters; ++i) {
+    const int group_fd = profiler->fds_.empty() ? -1 : profiler->fds_[0];
+    const int fd = OpenCounter(configs[i], group_fd);
+    if (fd < 0) {
+      // Without cycles there is no point in profiling; other counters are
+      // optional, as not all CPUs (or virtual machines) provide them.
+      if (i == kPerfCycles) return nullptr;
+      continue;
+    }
+    profiler->counter_index_[i] = profiler->fds_.size();
+    profiler->fds_.push_back(fd);
+  }
+  ioctl(profiler->fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return profiler;
+#else
+  return nullptr;
+#endif
+}
+
+PerfEventProfiler::PerfEventProfiler(uint32_t max_num_records)
+    : max_num_records_(max_num_records) {
+  std::fill(counter_index_, counter_index_ + kNumPerfCounters, -1);
+}
+
+PerfEventProfiler::~PerfEventProfiler() {
+#if defined(__linux__)
+  for (int fd : fds_) close(fd);
+#endif
+}
+
+void PerfEventProfiler::ReadCounters(uint64_t* values) const {
+  std::fill(values, values + kNumPerfCounters, kPerfCounterUnavailable);
+#if defined(__linux__)
+  // nr, time_enabled, time_running, then a value per counter.
+  uint64_t buffer[3 + kNumPerfCounters];
+  const ssize_t size = read(fds_[0], buffer, sizeof(buffer));
+  if (size < static_cast<ssize_t>(3 * sizeof(uint64_t)) || buffer[2] == 0) {
+    return;
+  }
+  // Scale the counts if the group was multiplexed with other counters.
+  const double scale = static_cast<double>(buffer[1]) / buffer[2];
+  for (int i = 0; i < kNumPerfCounters; ++i) {
+    const int index = counter_index_[i];
+    if (index >= 0 && index < static_cast<int>(buffer[0])) {
+      values[i] = static_cast<uint64_t>(buffer[3 + index] * scale);
+    }
+  }
+#endif
+}
+
+uint32_t PerfEventProfiler::BeginEvent(const char* tag, EventType event_type,
+                                       int64_t event_metadata1,
+                                       int64_t event_metadata2) {
+  if (!enabled_ ||
+      event_type == EventType::GENERAL_RUNTIME_INSTRUMENTATION_EVENT) {
+    return kInvalidHandle;
+  }
+  open_events_.emplace_back();
+  OpenEvent& event = open_events_.back();
+  event.active = true;
+  event.record.tag = tag;
+  event.record.event_type = event_type;
+  event.record.node_index = event_metadata1;
+  event.record.subgraph_index = event_metadata2;
+  event.record.begin_us = time::NowMicros();
+  // Read the counters last, to leave the bookkeeping out of the event.
+  ReadCounters(event.record.counters);
+  return open_events_.size() - 1;
+}
+
+void PerfEventProfiler::EndEvent(uint32_t event_handle) {
+  if (event_handle >= open_events_.size()) return;
+  uint64_t counters[kNumPerfCounters];
+  ReadCounters(counters);
+  const uint64_t end_us = time::NowMicros();
+
+  OpenEvent& event = open_events_[event_handle];
+  event.active = false;
+  PerfEventRecord& record = event.record;
+  record.end_us = end_us;
+  for (int i = 0; i < kNumPerfCounters; ++i) {
+    record.counters[i] =
+        Available(counters[i]) && Available(record.counters[i])
+            ? counters[i] - record.counters[i]
+            : kPerfCounterUnavailable;
+  }
+  const auto key = std::make_tuple(record.subgraph_index,
+                                   static_cast<int>(record.event_type),
+                                   record.node_index);
+  auto it = stats_.find(key);
+  if (it == stats_.end()) {
+    PerfEventStats stats;
+    stats.tag = record.tag;
+    stats.event_type = record.event_type;
+    stats.node_index = record.node_index;
+    stats.subgraph_index = record.subgraph_index;
+    it = stats_.emplace(key, std::move(stats)).first;
+  }
+  it->second.Add(record);
+  if (records_.size() < max_num_records_) {
+    records_.push_back(record);
+  }
+  // Events end in the reverse order of their beginning.
+  while (!open_events_.empty() && !open_events_.back().active) {
+    open_events_.pop_back();
+  }
+}
+
+void PerfEventProfiler::Reset() {
+  open_events_.clear();
+  records_.clear();
+  stats_.clear();
+}
+
+std::vector<PerfEventStats> PerfEventProfiler::GetStats() const {
+  std::vector<PerfEventStats> stats;
+  stats.reserve(stats_.size());
+  for (const auto& entry : stats_) stats.push_back(entry.second);
+  return stats;
+}
+
+void WritePerfEventSummary(const std::vector<PerfEventStats>& stats,
+                           std::ostream* stream) {
+  (*stream) << std::left << std::setw(12) << "[subgraph]" << std::setw(8)
+            << "[node]" << std::setw(32) << "[name]" << std::right
+            << std::setw(8) << "[count]" << std::setw(12) << "[avg us]"
+            << std::setw(14) << "[avg cycles]" << std::setw(14)
+            << "[avg instrs]" << std::setw(8) << "[IPC]" << std::setw(12)
+            << "[LLC MPKI]" << std::setw(14) << "[br misses]" << std::setw(14)
+            << "[est. MB/s]" << std::endl;
+  (*stream) << std::fixed << std::setprecision(2);
+  for (const PerfEventStats& entry : stats) {
+    const int64_t count = std::max<int64_t>(entry.count, 1);
+    (*stream) << std::left << std::setw(12) << entry.subgraph_index
+              << std::setw(8) << entry.node_index << std::setw(32)
+              << entry.tag.substr(0, 31) << std::right << std::setw(8)
+              << entry.count << std::setw(12)
+              << static_cast<double>(entry.total_us) / count << std::setw(14);
+    WriteCounter(entry.counters[kPerfCycles], count, stream);
+    (*stream) << std::setw(14);
+    WriteCounter(entry.counters[kPerfInstructions], count, stream);
+    (*stream) << std::setw(8);
+    WriteRatio(Ratio(entry.counters[kPerfInstructions],
+                     entry.counters[kPerfCycles], 1.0),
+               stream);
+    (*stream) << std::setw(12);
+    WriteRatio(Ratio(entry.counters[kPerfCacheMisses],
+                     entry.counters[kPerfInstructions], 1000.0),
+               stream);
+    (*stream) << std::setw(14);
+    WriteCounter(entry.counters[kPerfBranchMisses], count, stream);
+    (*stream) << std::setw(14);
+    WriteRatio(Ratio(entry.counters[kPerfCacheMisses], entry.total_us,
+                     kPerfCacheLineBytes),
+               stream);
+    (*stream) << std::endl;
+  }
+  (*stream) << std::defaultfloat;
+}
+
+void WritePerfEventCsv(const std::vector<PerfEventStats>& stats,
+                       std::ostream* stream) {
+  (*stream) << "subgraph,node,type,name,count,total_us,cycles,instructions,"
+               "cache_misses,branch_misses,ipc,cache_mpki,est_mb_per_s"
+            << std::endl;
+  for (const PerfEventStats& entry : stats) {
+    (*stream) << entry.subgraph_index << ',' << entry.node_index << ','
+              << EventTypeName(entry.event_type) << ',' << entry.tag << ','
+              << entry.count << ',' << entry.total_us;
+    for (int i = 0; i < kNumPerfCounters; ++i) {
+      (*stream) << ',';
+      if (Available(entry.counters[i])) (*stream) << entry.counters[i];
+    }
+    const double ratios[] = {
+        Ratio(entry.counters[kPerfInstructions], entry.counters[kPerfCycles],
+              1.0),
+        Ratio(entry.counters[kPerfCacheMisses],
+              entry.counters[kPerfInstructions], 1000.0),
+        Ratio(entry.counters[kPerfCacheMisses], entry.total_us,
+              kPerfCacheLineBytes)};
+    for (double ratio : ratios) {
+      (*stream) << ',';
+      if (ratio >= 0.0) (*stream) << ratio;
+    }
+    (*stream) << std::endl;
+  }
+}
+
+void WritePerfEventChromeTrace(const std::vector<PerfEventRecord>& records,
+                               std::ostream* stream) {
+  const char* const counter_names[kNumPerfCounters] = {
+      "cycles", "instructions", "cache_misses", "branch_misses"};
+  uint64_t start_us = 0;
+  if (!records.empty()) {
+    start_us = std::min_element(records.begin(), records.end(),
+                                [](const PerfEventRecord& a,
+                                   const PerfEventRecord& b) {
+                                  return a.begin_us < b.begin_us;
+                                })
+                   ->begin_us;
+  }
+  (*stream) << "{\"traceEvents\":[";
+  for (size_t i = 0; i < records.size(); ++i) {
+    const PerfEventRecord& record = records[i];
+    if (i > 0) (*stream) << ',';
+    (*stream) << "\n{\"name\":";
+    WriteJsonString(record.tag, stream);
+    (*stream) << ",\"cat\":\"" << EventTypeName(record.event_type)
+              << "\",\"ph\":\"X\",\"ts\":" << record.begin_us - start_us
+              << ",\"dur\":" << record.end_us - record.begin_us
+              << ",\"pid\":0,\"tid\":" << record.subgraph_index
+              << ",\"args\":{\"node\":" << record.node_index;
+    for (int c = 0; c < kNumPerfCounters; ++c) {
+      if (Available(record.counters[c])) {
+        (*stream) << ",\"" << counter_names[c] << "\":" << record.counters[c];
+      }
+    }
+    (*stream) << "}}";
+  }
+  (*stream) << "\n]}" << std::endl;
+}
+
+}  // namespace profiling
+}  // namespace tflite
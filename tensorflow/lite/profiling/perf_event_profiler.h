@@ -0,0 +1,148 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_PROFILING_PERF_EVENT_PROFILER_H_
+#define TENSORFLOW_LITE_PROFILING_PERF_EVENT_PROFILER_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "tensorflow/lite/core/api/profiler.h"
+
+namespace tflite {
+namespace profiling {
+
+// The hardware counters read by PerfEventProfiler. A counter which the CPU or
+// kernel doesn't provide reads as kPerfCounterUnavailable.
+enum PerfCounter {
+  kPerfCycles = 0,
+  kPerfInstructions,
+  // Last level cache misses, which approximate the traffic to memory.
+  kPerfCacheMisses,
+  kPerfBranchMisses,
+  kNumPerfCounters,
+};
+
+constexpr uint64_t kPerfCounterUnavailable = ~static_cast<uint64_t>(0);
+
+// The size of the cache line transfers behind each cache miss, used to
+// estimate memory bandwidth.
+constexpr int kPerfCacheLineBytes = 64;
+
+// One profiled event, i.e. one invocation of an operator or of an operator
+// internal to a delegate.
+struct PerfEventRecord {
+  std::string tag;
+  Profiler::EventType event_type;
+  int64_t node_index;
+  int64_t subgraph_index;
+  uint64_t begin_us;
+  uint64_t end_us;
+  uint64_t counters[kNumPerfCounters];
+};
+
+// The counters of all the invocations of one node.
+struct PerfEventStats {
+  std::string tag;
+  Profiler::EventType event_type;
+  int64_t node_index;
+  int64_t subgraph_index;
+  int64_t count = 0;
+  uint64_t total_us = 0;
+  uint64_t counters[kNumPerfCounters] = {};
+
+  void Add(const PerfEventRecord& record);
+};
+
+// A Profiler which reads the CPU hardware counters of the calling thread with
+// Linux perf_event around each operator, and of each delegate partition and,
+// where the delegate reports them, of the operators run by the delegate.
+//
+// Counters are per thread: work that kernels hand off to thread pools isn't
+// counted, so multi-threaded kernels are best profiled with a single thread.
+// Like BufferedProfiler, it must be used on a single thread.
+class PerfEventProfiler : public tflite::Profiler {
+ public:
+  // Returns null if perf_event isn't available, e.g. on other platforms, or
+  // when disallowed by /proc/sys/kernel/perf_event_paranoid. At most
+  // `max_num_records` events are kept for the trace; statistics cover all of
+  // them.
+  static std::unique_ptr<PerfEventProfiler> Create(uint32_t max_num_records);
+
+  ~PerfEventProfiler() override;
+
+  uint32_t BeginEvent(const char* tag, EventType event_type,
+                      int64_t event_metadata1,
+                      int64_t event_metadata2) override;
+  void EndEvent(uint32_t event_handle) override;
+
+  void StartProfiling() { enabled_ = true; }
+  void StopProfiling() { enabled_ = false; }
+  void Reset();
+
+  // Returns whether `counter` is provided by this CPU.
+  bool HasCounter(PerfCounter counter) const {
+    return counter_index_[counter] >= 0;
+  }
+
+  // The events recorded since the last Reset(), in order of completion.
+  const std::vector<PerfEventRecord>& records() const { return records_; }
+  // The statistics per node, ordered by subgraph, event type and node.
+  std::vector<PerfEventStats> GetStats() const;
+
+ private:
+  explicit PerfEventProfiler(uint32_t max_num_records);
+
+  // Reads the counters into `values`.
+  void ReadCounters(uint64_t* values) const;
+
+  struct OpenEvent {
+    PerfEventRecord record;
+    bool active;
+  };
+
+  const uint32_t max_num_records_;
+  bool enabled_ = false;
+  // The file descriptors of the counter group, the leader first.
+  std::vector<int> fds_;
+  // The position of each counter in a group read, or -1.
+  int counter_index_[kNumPerfCounters];
+  std::vector<OpenEvent> open_events_;
+  std::vector<PerfEventRecord> records_;
+  std::map<std::tuple<int64_t, int, int64_t>, PerfEventStats> stats_;
+};
+
+// Writes a table of the per-node statistics, with derived metrics (IPC, cache
+// misses per thousand instructions and estimated memory bandwidth).
+void WritePerfEventSummary(const std::vector<PerfEventStats>& stats,
+                           std::ostream* stream);
+
+// Writes the per-node statistics as CSV.
+void WritePerfEventCsv(const std::vector<PerfEventStats>& stats,
+                       std::ostream* stream);
+
+// Writes the records in the Chrome trace event format, viewable in
+// chrome://tracing or Perfetto, with the counters as event arguments.
+void WritePerfEventChromeTrace(const std::vector<PerfEventRecord>& records,
+                               std::ostream* stream);
+
+}  // namespace profiling
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_PROFILING_PERF_EVENT_PROFILER_H_
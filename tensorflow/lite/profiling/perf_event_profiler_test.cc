@@ -0,0 +1,157 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/perf_event_profiler.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/lite/testing/util.h"
+
+namespace tflite {
+namespace profiling {
+namespace {
+
+using ::testing::HasSubstr;
+
+PerfEventRecord MakeRecord(const char* tag, Profiler::EventType event_type,
+                           int node_index, uint64_t begin_us, uint64_t end_us,
+                           uint64_t cycles, uint64_t instructions,
+                           uint64_t cache_misses) {
+  PerfEventRecord record;
+  record.tag = tag;
+  record.event_type = event_type;
+  record.node_index = node_index;
+  record.subgraph_index = 0;
+  record.begin_us = begin_us;
+  record.end_us = end_us;
+  record.counters[kPerfCycles] = cycles;
+  record.counters[kPerfInstructions] = instructions;
+  record.counters[kPerfCacheMisses] = cache_misses;
+  record.counters[kPerfBranchMisses] = kPerfCounterUnavailable;
+  return record;
+}
+
+TEST(PerfEventProfilerTest, StatsAccumulateCounters) {
+  PerfEventStats stats;
+  stats.Add(MakeRecord("CONV_2D", Profiler::EventType::OPERATOR_INVOKE_EVENT,
+                       3, 100, 110, 1000, 2000, 10));
+  stats.Add(MakeRecord("CONV_2D", Profiler::EventType::OPERATOR_INVOKE_EVENT,
+                       3, 200, 230, 3000, 4000, 30));
+  EXPECT_EQ(stats.count, 2);
+  EXPECT_EQ(stats.total_us, 40);
+  EXPECT_EQ(stats.counters[kPerfCycles], 4000);
+  EXPECT_EQ(stats.counters[kPerfInstructions], 6000);
+  EXPECT_EQ(stats.counters[kPerfCacheMisses], 40);
+  EXPECT_EQ(stats.counters[kPerfBranchMisses], kPerfCounterUnavailable);
+}
+
+TEST(PerfEventProfilerTest, WritesCsv) {
+  PerfEventStats stats;
+  stats.tag = "ADD";
+  stats.event_type = Profiler::EventType::OPERATOR_INVOKE_EVENT;
+  stats.node_index = 1;
+  stats.subgraph_index = 0;
+  stats.Add(MakeRecord("ADD", Profiler::EventType::OPERATOR_INVOKE_EVENT, 1, 0,
+                       64, 1000, 2000, 100));
+  std::ostringstream stream;
+  WritePerfEventCsv({stats}, &stream);
+  // IPC 2, 50 misses per thousand instructions, 100 * 64 bytes in 64 us.
+  EXPECT_EQ(stream.str(),
+            "subgraph,node,type,name,count,total_us,cycles,instructions,"
+            "cache_misses,branch_misses,ipc,cache_mpki,est_mb_per_s\n"
+            "0,1,operator,ADD,1,64,1000,2000,100,,2,50,100\n");
+
+  std::ostringstream summary;
+  WritePerfEventSummary({stats}, &summary);
+  EXPECT_THAT(summary.str(), HasSubstr("ADD"));
+  EXPECT_THAT(summary.str(), HasSubstr("n/a"));
+}
+
+TEST(PerfEventProfilerTest, WritesChromeTrace) {
+  const std::vector<PerfEventRecord> records = {
+      MakeRecord("TfLiteXNNPackDelegate",
+                 Profiler::EventType::OPERATOR_INVOKE_EVENT, 0, 1000, 1050, 10,
+                 20, 1),
+      MakeRecord("Convolution \"3x3\"",
+                 Profiler::EventType::DELEGATE_OPERATOR_INVOKE_EVENT, 2, 1010,
+                 1020, 5, 6, 0)};
+  std::ostringstream stream;
+  WritePerfEventChromeTrace(records, &stream);
+  const std::string trace = stream.str();
+  EXPECT_THAT(trace, HasSubstr("{\"traceEvents\":["));
+  EXPECT_THAT(trace,
+              HasSubstr("{\"name\":\"TfLiteXNNPackDelegate\",\"cat\":"
+                        "\"operator\",\"ph\":\"X\",\"ts\":0,\"dur\":50,"
+                        "\"pid\":0,\"tid\":0,\"args\":{\"node\":0,"
+                        "\"cycles\":10,\"instructions\":20,"
+                        "\"cache_misses\":1}}"));
+  EXPECT_THAT(trace, HasSubstr("\"name\":\"Convolution \\\"3x3\\\"\","
+                               "\"cat\":\"delegate_operator\",\"ph\":\"X\","
+                               "\"ts\":10,\"dur\":10"));
+}
+
+TEST(PerfEventProfilerTest, ProfilesEvents) {
+  auto profiler = PerfEventProfiler::Create(/*max_num_records=*/2);
+  if (profiler == nullptr) {
+    // perf_event is unavailable on this platform or machine.
+    return;
+  }
+  // Events are only recorded while profiling.
+  profiler->EndEvent(profiler->BeginEvent(
+      "Ignored", Profiler::EventType::OPERATOR_INVOKE_EVENT, 0, 0));
+  EXPECT_TRUE(profiler->records().empty());
+
+  profiler->StartProfiling();
+  volatile float sum = 0.0f;
+  for (int run = 0; run < 3; ++run) {
+    const uint32_t outer = profiler->BeginEvent(
+        "Delegate", Profiler::EventType::OPERATOR_INVOKE_EVENT, 0, 0);
+    const uint32_t inner = profiler->BeginEvent(
+        "Op", Profiler::EventType::DELEGATE_OPERATOR_INVOKE_EVENT, 5, 0);
+    for (int i = 0; i < 100000; ++i) sum = sum + i;
+    profiler->EndEvent(inner);
+    profiler->EndEvent(outer);
+  }
+  profiler->StopProfiling();
+
+  // The trace is bounded, the statistics aren't.
+  EXPECT_EQ(profiler->records().size(), 2);
+  const std::vector<PerfEventStats> stats = profiler->GetStats();
+  ASSERT_EQ(stats.size(), 2);
+  EXPECT_EQ(stats[0].tag, "Delegate");
+  EXPECT_EQ(stats[0].count, 3);
+  EXPECT_EQ(stats[1].tag, "Op");
+  EXPECT_EQ(stats[1].node_index, 5);
+  EXPECT_EQ(stats[1].count, 3);
+  EXPECT_GT(stats[1].counters[kPerfCycles], 0);
+  EXPECT_GE(stats[0].counters[kPerfCycles], stats[1].counters[kPerfCycles]);
+
+  profiler->Reset();
+  EXPECT_TRUE(profiler->records().empty());
+  EXPECT_TRUE(profiler->GetStats().empty());
+}
+
+}  // namespace
+}  // namespace profiling
+}  // namespace tflite
+
+int main(int argc, char** argv) {
+  ::tflite::LogToStderr();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -36,13 +36,9 @@ TfLiteStatus SimpleMemoryArena::Allocate(
     int32_t first_node, int32_t last_node,
     ArenaAllocWithUsageInterval* new_alloc) {
   TF_LITE_ENSURE(context, alignment <= arena_alignment_);
-  new_alloc->tensor = tensor;
-  new_alloc->first_node = first_node;
-  new_alloc->last_node = last_node;
-  new_alloc->size = size;
   if (size == 0) {
-    new_alloc->offset = 0;
-    return kTfLiteOk;
+    return AllocateAt(context, /*offset=*/0, size, tensor, first_node,
+                      last_node, new_alloc);
   }
 
   // If we don't find a better gap just allocate at the end of the buffer.
@@ -72,9 +68,26 @@ TfLiteStatus SimpleMemoryArena::Allocate(
     best_offset = AlignTo(alignment, current_offset);
   }
 
+  return AllocateAt(context, best_offset, size, tensor, first_node, last_node,
+                    new_alloc);
+}
+
+TfLiteStatus SimpleMemoryArena::AllocateAt(
+    TfLiteContext* context, size_t offset, size_t size, int32_t tensor,
+    int32_t first_node, int32_t last_node,
+    ArenaAllocWithUsageInterval* new_alloc) {
+  new_alloc->tensor = tensor;
+  new_alloc->first_node = first_node;
+  new_alloc->last_node = last_node;
+  new_alloc->size = size;
+  if (size == 0) {
+    new_alloc->offset = 0;
+    return kTfLiteOk;
+  }
+
   // Update the required buffer size.
-  high_water_mark_ = std::max(high_water_mark_, best_offset + size);
-  new_alloc->offset = best_offset;
+  high_water_mark_ = std::max(high_water_mark_, offset + size);
+  new_alloc->offset = offset;
 
   auto insertion_it = ordered_allocs_.begin();
   while (insertion_it != ordered_allocs_.end() && *insertion_it < *new_alloc) {
@@ -153,6 +166,17 @@ TfLiteStatus SimpleMemoryArena::ClearPlan() {
   return kTfLiteOk;
 }
 
+TfLiteStatus SimpleMemoryArena::RestorePlan(
+    const std::vector<ArenaAllocWithUsageInterval>& ordered_allocs) {
+  committed_ = false;
+  high_water_mark_ = 0;
+  for (const auto& alloc : ordered_allocs) {
+    high_water_mark_ = std::max(high_water_mark_, alloc.offset + alloc.size);
+  }
+  ordered_allocs_ = ordered_allocs;
+  return kTfLiteOk;
+}
+
 TfLiteStatus SimpleMemoryArena::ReleaseBuffer() {
   committed_ = false;
   underlying_buffer_size_ = 0;
@@ -73,6 +73,13 @@ class SimpleMemoryArena {
                         int32_t tensor, int32_t first_node, int32_t last_node,
                         ArenaAllocWithUsageInterval* new_alloc);
 
+  // Schedule memory allocation for a tensor at a fixed offset, e.g. one planned
+  // offline. The caller is responsible for the allocation not overlapping with
+  // other allocations used at the same time.
+  TfLiteStatus AllocateAt(TfLiteContext* context, size_t offset, size_t size,
+                          int32_t tensor, int32_t first_node, int32_t last_node,
+                          ArenaAllocWithUsageInterval* new_alloc);
+
   TfLiteStatus Deallocate(TfLiteContext* context,
                           const ArenaAllocWithUsageInterval& alloc);
 
@@ -101,6 +108,18 @@ class SimpleMemoryArena {
 
   size_t GetBufferSize() { return underlying_buffer_size_; }
 
+  // Returns the planned non-empty allocations, ordered by offset.
+  const std::vector<ArenaAllocWithUsageInterval>& ordered_allocs() const {
+    return ordered_allocs_;
+  }
+
+  // Replaces the allocation plan with `ordered_allocs`, which must be ordered
+  // by offset, e.g. a plan previously returned by ordered_allocs(). As with
+  // ClearPlan(), the arena must be committed and allocations resolved before
+  // using it again.
+  TfLiteStatus RestorePlan(
+      const std::vector<ArenaAllocWithUsageInterval>& ordered_allocs);
+
   std::intptr_t BasePointer() const {
     return reinterpret_cast<std::intptr_t>(underlying_buffer_aligned_ptr_);
   }
@@ -23,6 +23,7 @@ limitations under the License.
 #include <memory>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <unordered_set>
 #include <vector>
 
@@ -94,6 +95,30 @@ void RuyProfileListener::OnBenchmarkEnd(const BenchmarkResults& results) {
   ruy_profile_ = nullptr;
 }
 
+// Logs how effectively the batching layer merged concurrent requests.
+class BatchingStatsListener : public BenchmarkListener {
+ public:
+  explicit BatchingStatsListener(
+      const batching::BatchingInterpreter* batching_interpreter)
+      : batching_interpreter_(batching_interpreter) {}
+
+  void OnBenchmarkEnd(const BenchmarkResults& results) override {
+    const batching::BatchingInterpreter::Stats stats =
+        batching_interpreter_->stats();
+    if (stats.num_batches == 0) return;
+    TFLITE_LOG(INFO) << "Batching (incl. warmup): " << stats.num_requests
+                     << " requests in " << stats.num_batches
+                     << " batches, avg batch size "
+                     << static_cast<double>(stats.num_batch_elements) /
+                            stats.num_batches
+                     << ", padding elements " << stats.num_padding_elements
+                     << ", resizes " << stats.num_resizes;
+  }
+
+ private:
+  const batching::BatchingInterpreter* batching_interpreter_;
+};
+
 std::vector<std::string> Split(const std::string& str, const char delim) {
   std::vector<std::string> results;
   if (!util::SplitAndParse(str, delim, &results)) {
@@ -273,6 +298,20 @@ BenchmarkParams BenchmarkTfLiteModel::DefaultParams() {
                           BenchmarkParam::Create<std::string>(""));
   default_params.AddParam("enable_platform_tracing",
                           BenchmarkParam::Create<bool>(false));
+  default_params.AddParam("enable_perf_event_profiling",
+                          BenchmarkParam::Create<bool>(false));
+  default_params.AddParam("perf_event_output_file",
+                          BenchmarkParam::Create<std::string>(""));
+  default_params.AddParam("batching_max_batch_size",
+                          BenchmarkParam::Create<int32_t>(0));
+  default_params.AddParam("batching_timeout_us",
+                          BenchmarkParam::Create<int32_t>(1000));
+  default_params.AddParam("batching_allowed_batch_sizes",
+                          BenchmarkParam::Create<std::string>(""));
+  default_params.AddParam("num_concurrent_requests",
+                          BenchmarkParam::Create<int32_t>(1));
+  default_params.AddParam("prepacked_weights_cache",
+                          BenchmarkParam::Create<std::string>(""));
 
   for (const auto& delegate_provider :
        tools::GetRegisteredDelegateProviders()) {
@@ -296,8 +335,14 @@ void BenchmarkTfLiteModel::CleanUp() {
 BenchmarkTfLiteModel::~BenchmarkTfLiteModel() {
   CleanUp();
 
-  // Destory the owned interpreter earlier than other objects (specially
+  if (prepacked_weights_cache_ &&
+      prepacked_weights_cache_->Save() != kTfLiteOk) {
+    TFLITE_LOG(WARN) << "Failed to save the prepacked weights cache.";
+  }
+
+  // Destory the owned interpreters earlier than other objects (specially
   // 'owned_delegates_').
+  batching_interpreter_.reset();
   interpreter_.reset();
 }
 
@@ -337,7 +382,34 @@ std::vector<Flag> BenchmarkTfLiteModel::GetFlags() {
           "prints to stdout."),
       CreateFlag<bool>("enable_platform_tracing", &params_,
                        "enable platform-wide tracing, only meaningful when "
-                       "--enable_op_profiling is set to true.")};
+                       "--enable_op_profiling is set to true."),
+      CreateFlag<bool>("enable_perf_event_profiling", &params_,
+                       "report the CPU hardware counters (cycles, "
+                       "instructions, cache and branch misses) of each "
+                       "operator, using Linux perf_event."),
+      CreateFlag<std::string>(
+          "perf_event_output_file", &params_,
+          "file to export the hardware counters to, as a Chrome trace if "
+          "it ends with .json, as CSV otherwise."),
+      CreateFlag<int32_t>(
+          "batching_max_batch_size", &params_,
+          "if positive, each run sends --num_concurrent_requests "
+          "single-element requests concurrently through a dynamic batching "
+          "layer which merges them into batches of up to this size."),
+      CreateFlag<int32_t>("batching_timeout_us", &params_,
+                          "max time a request waits for others to be batched "
+                          "with, in microseconds."),
+      CreateFlag<std::string>(
+          "batching_allowed_batch_sizes", &params_,
+          "comma-separated, increasing list of batch sizes to pad batches "
+          "to, ending with --batching_max_batch_size."),
+      CreateFlag<int32_t>("num_concurrent_requests", &params_,
+                          "number of concurrent requests per run when "
+                          "batching is enabled."),
+      CreateFlag<std::string>(
+          "prepacked_weights_cache", &params_,
+          "file from which to load the prepacked weights of the model, and "
+          "to which to save the weights packed during the benchmark.")};
 
   flags.insert(flags.end(), specific_flags.begin(), specific_flags.end());
 
@@ -377,6 +449,20 @@ void BenchmarkTfLiteModel::LogParams() {
                       "CSV File to export profiling data to", verbose);
   LOG_BENCHMARK_PARAM(bool, "enable_platform_tracing",
                       "Enable platform-wide tracing", verbose);
+  LOG_BENCHMARK_PARAM(bool, "enable_perf_event_profiling",
+                      "Enable perf_event profiling", verbose);
+  LOG_BENCHMARK_PARAM(std::string, "perf_event_output_file",
+                      "perf_event output file", verbose);
+  LOG_BENCHMARK_PARAM(int32_t, "batching_max_batch_size",
+                      "Batching max batch size", verbose);
+  LOG_BENCHMARK_PARAM(int32_t, "batching_timeout_us",
+                      "Batching timeout (us)", verbose);
+  LOG_BENCHMARK_PARAM(std::string, "batching_allowed_batch_sizes",
+                      "Batching allowed batch sizes", verbose);
+  LOG_BENCHMARK_PARAM(int32_t, "num_concurrent_requests",
+                      "Num concurrent requests", verbose);
+  LOG_BENCHMARK_PARAM(std::string, "prepacked_weights_cache",
+                      "Prepacked weights cache", verbose);
 
   for (const auto& delegate_provider :
        tools::GetRegisteredDelegateProviders()) {
@@ -622,6 +708,22 @@ TfLiteStatus BenchmarkTfLiteModel::InitInterpreter() {
                                      external_context_.get());
   }
 
+  const std::string cache_path =
+      params_.Get<std::string>("prepacked_weights_cache");
+  if (!cache_path.empty()) {
+    prepacked_weights_cache_ = tflite::PrepackedWeightsCache::Create(
+        model_->allocation(), cache_path.c_str(), model_->error_reporter());
+    if (!prepacked_weights_cache_ ||
+        interpreter_->SetPrepackedWeightsCache(
+            prepacked_weights_cache_.get()) != kTfLiteOk) {
+      TFLITE_LOG(ERROR) << "Failed to set up the prepacked weights cache";
+      return kTfLiteError;
+    }
+    TFLITE_LOG(INFO) << "Loaded "
+                     << prepacked_weights_cache_->num_loaded_entries()
+                     << " prepacked weights from " << cache_path;
+  }
+
   return kTfLiteOk;
 }
 
@@ -713,6 +815,113 @@ TfLiteStatus BenchmarkTfLiteModel::Init() {
   ruy_profiling_listener_.reset(new RuyProfileListener());
   AddListener(ruy_profiling_listener_.get());
 
+  if (params_.Get<int32_t>("batching_max_batch_size") > 0) {
+    TF_LITE_ENSURE_STATUS(InitBatchingInterpreter());
+  }
+
+  return kTfLiteOk;
+}
+
+TfLiteStatus BenchmarkTfLiteModel::InitBatchingInterpreter() {
+  batching::BatchingInterpreter::Options options;
+  options.max_batch_size = params_.Get<int32_t>("batching_max_batch_size");
+  options.batch_timeout_micros = params_.Get<int32_t>("batching_timeout_us");
+  const std::string allowed_batch_sizes =
+      params_.Get<std::string>("batching_allowed_batch_sizes");
+  if (!allowed_batch_sizes.empty() &&
+      !util::SplitAndParse(allowed_batch_sizes, ',',
+                           &options.allowed_batch_sizes)) {
+    TFLITE_LOG(ERROR) << "Invalid batching_allowed_batch_sizes: "
+                      << allowed_batch_sizes;
+    return kTfLiteError;
+  }
+  const int num_requests = params_.Get<int32_t>("num_concurrent_requests");
+  if (num_requests < 1) {
+    TFLITE_LOG(ERROR) << "num_concurrent_requests must be positive.";
+    return kTfLiteError;
+  }
+
+  // The batched interpreter is built like 'interpreter_', and shares the model
+  // and delegates with it.
+  batching_resolver_ = GetOpResolver();
+  std::unique_ptr<Interpreter> interpreter;
+  tflite::InterpreterBuilder(*model_, *batching_resolver_)(
+      &interpreter, params_.Get<int32_t>("num_threads"));
+  if (!interpreter) {
+    TFLITE_LOG(ERROR) << "Failed to construct the batched interpreter.";
+    return kTfLiteError;
+  }
+  interpreter->SetAllowFp16PrecisionForFp32(params_.Get<bool>("allow_fp16"));
+  for (const auto& delegate : owned_delegates_) {
+    if (interpreter->ModifyGraphWithDelegate(delegate.get()) != kTfLiteOk) {
+      TFLITE_LOG(ERROR) << "Failed to apply delegates to the batched "
+                        << "interpreter.";
+      return kTfLiteError;
+    }
+  }
+  for (int j = 0; j < inputs_.size(); ++j) {
+    const int i = interpreter->inputs()[j];
+    if (interpreter->tensor(i)->type != kTfLiteString) {
+      interpreter->ResizeInputTensor(i, inputs_[j].shape);
+    }
+  }
+  batching_interpreter_ = batching::BatchingInterpreter::Create(
+      std::move(interpreter), options, interpreter_->error_reporter());
+  if (!batching_interpreter_) {
+    TFLITE_LOG(ERROR) << "Failed to create the batching interpreter.";
+    return kTfLiteError;
+  }
+
+  // Requests reuse the first batch element of the inputs of 'interpreter_'.
+  for (int j = 0; j < batching_interpreter_->inputs_size(); ++j) {
+    const TfLiteTensor* t = interpreter_->tensor(interpreter_->inputs()[j]);
+    if (t->bytes < batching_interpreter_->input_element_bytes(j)) {
+      TFLITE_LOG(ERROR) << "Input " << t->name << " is smaller than a batch "
+                        << "element.";
+      return kTfLiteError;
+    }
+  }
+  batching_outputs_.resize(num_requests);
+  for (auto& request_outputs : batching_outputs_) {
+    for (int j = 0; j < batching_interpreter_->outputs_size(); ++j) {
+      request_outputs.emplace_back(
+          batching_interpreter_->output_element_bytes(j));
+    }
+  }
+
+  batching_listener_.reset(
+      new BatchingStatsListener(batching_interpreter_.get()));
+  AddListener(batching_listener_.get());
+  return kTfLiteOk;
+}
+
+TfLiteStatus BenchmarkTfLiteModel::RunBatchedRequests() {
+  std::vector<const void*> inputs;
+  for (int i : interpreter_->inputs()) {
+    inputs.push_back(interpreter_->tensor(i)->data.raw_const);
+  }
+
+  const int num_requests = batching_outputs_.size();
+  std::vector<TfLiteStatus> statuses(num_requests, kTfLiteError);
+  auto run_request = [&](int r) {
+    std::vector<void*> outputs;
+    for (auto& output : batching_outputs_[r]) {
+      outputs.push_back(output.data());
+    }
+    statuses[r] = batching_interpreter_->Invoke(inputs, outputs);
+  };
+  std::vector<std::thread> threads;
+  for (int r = 1; r < num_requests; ++r) {
+    threads.emplace_back(run_request, r);
+  }
+  run_request(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (TfLiteStatus status : statuses) {
+    TF_LITE_ENSURE_STATUS(status);
+  }
   return kTfLiteOk;
 }
 
@@ -736,6 +945,15 @@ std::unique_ptr<tflite::OpResolver> BenchmarkTfLiteModel::GetOpResolver()
 
 std::unique_ptr<BenchmarkListener>
 BenchmarkTfLiteModel::MayCreateProfilingListener() const {
+  // The interpreter takes a single profiler, so hardware counter profiling
+  // replaces the regular op profiling.
+  if (params_.Get<bool>("enable_perf_event_profiling")) {
+    return std::unique_ptr<BenchmarkListener>(new PerfEventProfilingListener(
+        interpreter_.get(),
+        params_.Get<int32_t>("max_profiling_buffer_entries"),
+        params_.Get<std::string>("perf_event_output_file")));
+  }
+
   if (!params_.Get<bool>("enable_op_profiling")) return nullptr;
 
   if (params_.Get<bool>("enable_platform_tracing")) {
@@ -750,7 +968,10 @@ BenchmarkTfLiteModel::MayCreateProfilingListener() const {
           !params_.Get<std::string>("profiling_output_csv_file").empty())));
 }
 
-TfLiteStatus BenchmarkTfLiteModel::RunImpl() { return interpreter_->Invoke(); }
+TfLiteStatus BenchmarkTfLiteModel::RunImpl() {
+  if (batching_interpreter_) return RunBatchedRequests();
+  return interpreter_->Invoke();
+}
 
 }  // namespace benchmark
 }  // namespace tflite
@@ -23,7 +23,9 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "tensorflow/lite/experimental/batching/batching_interpreter.h"
 #include "tensorflow/lite/model.h"
+#include "tensorflow/lite/prepacked_weights_cache.h"
 #include "tensorflow/lite/profiling/profiler.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_model.h"
 
@@ -84,6 +86,8 @@ class BenchmarkTfLiteModel : public BenchmarkModel {
   void CleanUp();
 
   std::unique_ptr<tflite::FlatBufferModel> model_;
+  // Declared before the interpreter, which must not outlive it.
+  std::unique_ptr<tflite::PrepackedWeightsCache> prepacked_weights_cache_;
   std::unique_ptr<tflite::Interpreter> interpreter_;
   std::unique_ptr<tflite::ExternalCpuBackendContext> external_context_;
 
@@ -118,12 +122,24 @@ class BenchmarkTfLiteModel : public BenchmarkModel {
   InputTensorData LoadInputTensorData(const TfLiteTensor& t,
                                       const std::string& input_file_path);
 
+  // Creates the batching layer used when --batching_max_batch_size is set.
+  TfLiteStatus InitBatchingInterpreter();
+
+  // Runs --num_concurrent_requests single-element requests concurrently
+  // through the batching layer.
+  TfLiteStatus RunBatchedRequests();
+
   std::vector<InputLayerInfo> inputs_;
   std::vector<InputTensorData> inputs_data_;
   std::unique_ptr<BenchmarkListener> profiling_listener_ = nullptr;
   std::unique_ptr<BenchmarkListener> ruy_profiling_listener_ = nullptr;
   std::mt19937 random_engine_;
   std::vector<Interpreter::TfLiteDelegatePtr> owned_delegates_;
+  std::unique_ptr<tflite::OpResolver> batching_resolver_;
+  std::unique_ptr<batching::BatchingInterpreter> batching_interpreter_;
+  // Output buffers of each concurrent request, indexed by request and output.
+  std::vector<std::vector<std::vector<char>>> batching_outputs_;
+  std::unique_ptr<BenchmarkListener> batching_listener_;
   // Always TFLITE_LOG the benchmark result.
   BenchmarkLoggingListener log_output_;
 };
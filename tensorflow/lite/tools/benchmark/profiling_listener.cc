@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/lite/tools/benchmark/profiling_listener.h"
 
 #include <fstream>
+#include <sstream>
 
 #include "tensorflow/lite/tools/logging.h"
 
@@ -88,5 +89,53 @@ void ProfilingListener::WriteOutput(const std::string& header,
   (*stream) << data << std::endl;
 }
 
+PerfEventProfilingListener::PerfEventProfilingListener(
+    Interpreter* interpreter, uint32_t max_num_entries,
+    const std::string& output_file_path)
+    : output_file_path_(output_file_path),
+      profiler_(profiling::PerfEventProfiler::Create(max_num_entries)) {
+  TFLITE_TOOLS_CHECK(interpreter);
+  if (!profiler_) {
+    TFLITE_LOG(WARN) << "CPU hardware counters are unavailable; check "
+                        "/proc/sys/kernel/perf_event_paranoid.";
+    return;
+  }
+  interpreter->SetProfiler(profiler_.get());
+}
+
+void PerfEventProfilingListener::OnSingleRunStart(RunType run_type) {
+  if (profiler_ && run_type == REGULAR) profiler_->StartProfiling();
+}
+
+void PerfEventProfilingListener::OnSingleRunEnd() {
+  if (profiler_) profiler_->StopProfiling();
+}
+
+void PerfEventProfilingListener::OnBenchmarkEnd(
+    const BenchmarkResults& results) {
+  if (!profiler_) return;
+  const std::vector<profiling::PerfEventStats> stats = profiler_->GetStats();
+  std::stringstream summary;
+  profiling::WritePerfEventSummary(stats, &summary);
+  TFLITE_LOG(INFO) << "Operator-wise CPU hardware counters for Regular "
+                      "Benchmark Runs:\n"
+                   << summary.str();
+  if (output_file_path_.empty()) return;
+
+  std::ofstream output_file(output_file_path_);
+  if (!output_file.good()) {
+    TFLITE_LOG(ERROR) << "Failed to open " << output_file_path_;
+    return;
+  }
+  const std::string kJsonSuffix = ".json";
+  if (output_file_path_.size() >= kJsonSuffix.size() &&
+      output_file_path_.compare(output_file_path_.size() - kJsonSuffix.size(),
+                                kJsonSuffix.size(), kJsonSuffix) == 0) {
+    profiling::WritePerfEventChromeTrace(profiler_->records(), &output_file);
+  } else {
+    profiling::WritePerfEventCsv(stats, &output_file);
+  }
+}
+
 }  // namespace benchmark
 }  // namespace tflite
@@ -19,6 +19,7 @@ limitations under the License.
 #include <memory>
 
 #include "tensorflow/lite/profiling/buffered_profiler.h"
+#include "tensorflow/lite/profiling/perf_event_profiler.h"
 #include "tensorflow/lite/profiling/profile_summarizer.h"
 #include "tensorflow/lite/profiling/profile_summary_formatter.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_model.h"
@@ -55,6 +56,26 @@ class ProfilingListener : public BenchmarkListener {
   profiling::BufferedProfiler profiler_;
 };
 
+// Reports the CPU hardware counters of each operator over the regular runs,
+// using Linux perf_event, and optionally exports them to `output_file_path`:
+// as a Chrome trace if the path ends with ".json", as CSV otherwise.
+class PerfEventProfilingListener : public BenchmarkListener {
+ public:
+  PerfEventProfilingListener(Interpreter* interpreter,
+                             uint32_t max_num_entries,
+                             const std::string& output_file_path);
+
+  void OnSingleRunStart(RunType run_type) override;
+
+  void OnSingleRunEnd() override;
+
+  void OnBenchmarkEnd(const BenchmarkResults& results) override;
+
+ private:
+  std::string output_file_path_;
+  std::unique_ptr<profiling::PerfEventProfiler> profiler_;
+};
+
 }  // namespace benchmark
 }  // namespace tflite
 
@@ -0,0 +1,63 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <string>
+
+#include "tensorflow/lite/delegates/fusion/elementwise_fusion_delegate.h"
+#include "tensorflow/lite/tools/delegates/delegate_provider.h"
+
+namespace tflite {
+namespace tools {
+
+class ElementwiseFusionDelegateProvider : public DelegateProvider {
+ public:
+  ElementwiseFusionDelegateProvider() {
+    default_params_.AddParam("use_elementwise_fusion",
+                             ToolParam::Create<bool>(false));
+  }
+
+  std::vector<Flag> CreateFlags(ToolParams* params) const final;
+
+  void LogParams(const ToolParams& params, bool verbose) const final;
+
+  TfLiteDelegatePtr CreateTfLiteDelegate(const ToolParams& params) const final;
+
+  std::string GetName() const final { return "ElementwiseFusion"; }
+};
+REGISTER_DELEGATE_PROVIDER(ElementwiseFusionDelegateProvider);
+
+std::vector<Flag> ElementwiseFusionDelegateProvider::CreateFlags(
+    ToolParams* params) const {
+  std::vector<Flag> flags = {
+      CreateFlag<bool>("use_elementwise_fusion", params,
+                       "fuse chains of elementwise operators")};
+  return flags;
+}
+
+void ElementwiseFusionDelegateProvider::LogParams(const ToolParams& params,
+                                                  bool verbose) const {
+  LOG_TOOL_PARAM(params, bool, "use_elementwise_fusion",
+                 "Use elementwise fusion", verbose);
+}
+
+TfLiteDelegatePtr ElementwiseFusionDelegateProvider::CreateTfLiteDelegate(
+    const ToolParams& params) const {
+  if (params.Get<bool>("use_elementwise_fusion")) {
+    return fusion::CreateElementwiseFusionDelegate();
+  }
+  return TfLiteDelegatePtr(nullptr, [](TfLiteDelegate*) {});
+}
+
+}  // namespace tools
+}  // namespace tflite
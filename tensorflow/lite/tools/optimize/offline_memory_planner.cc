@@ -0,0 +1,381 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/tools/optimize/offline_memory_planner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "flatbuffers/flatbuffers.h"  // from @flatbuffers
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/context_util.h"
+#include "tensorflow/lite/core/subgraph.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/util.h"
+
+namespace tflite {
+namespace optimize {
+
+namespace {
+
+constexpr int kOfflineMemoryAllocationVersion = 0;
+constexpr int kOfflineMemoryAllocationHeaderSize = 3;
+
+size_t AlignTo(size_t alignment, size_t offset) {
+  return offset % alignment == 0 ? offset
+                                 : offset + (alignment - offset % alignment);
+}
+
+bool LifetimesOverlap(const ArenaBuffer& buffer1, const ArenaBuffer& buffer2) {
+  return buffer1.first_node <= buffer2.last_node &&
+         buffer2.first_node <= buffer1.last_node;
+}
+
+// Returns the indices of buffers in the order the strategy places them.
+std::vector<int> CreatePlacementOrder(const std::vector<ArenaBuffer>& buffers,
+                                      ArenaPlanStrategy strategy) {
+  std::vector<int> order(buffers.size());
+  std::iota(order.begin(), order.end(), 0);
+  int last_node = 0;
+  for (const ArenaBuffer& buffer : buffers) {
+    last_node = std::max(last_node, buffer.last_node);
+  }
+  auto lifetime = [&buffers](int i) {
+    return static_cast<size_t>(buffers[i].last_node - buffers[i].first_node) +
+           1;
+  };
+  auto by_size = [&buffers](int i, int j) {
+    return buffers[i].size > buffers[j].size;
+  };
+
+  switch (strategy) {
+    case ArenaPlanStrategy::kGreedyBySize:
+      // Same order as the interpreter: buffers used during the whole
+      // inference first, then by size and by first use.
+      std::stable_sort(order.begin(), order.end(), [&](int i, int j) {
+        const bool whole_i =
+            buffers[i].first_node == 0 && buffers[i].last_node == last_node;
+        const bool whole_j =
+            buffers[j].first_node == 0 && buffers[j].last_node == last_node;
+        if (whole_i || whole_j) {
+          return whole_i && !whole_j;
+        }
+        if (buffers[i].size != buffers[j].size) {
+          return by_size(i, j);
+        }
+        return buffers[i].first_node < buffers[j].first_node;
+      });
+      break;
+    case ArenaPlanStrategy::kGreedyByBreadth: {
+      std::vector<size_t> breadth(last_node + 1, 0);
+      for (const ArenaBuffer& buffer : buffers) {
+        for (int node = buffer.first_node; node <= buffer.last_node; ++node) {
+          breadth[node] += buffer.size;
+        }
+      }
+      std::vector<int> nodes(breadth.size());
+      std::iota(nodes.begin(), nodes.end(), 0);
+      std::stable_sort(nodes.begin(), nodes.end(), [&breadth](int i, int j) {
+        return breadth[i] > breadth[j];
+      });
+      std::stable_sort(order.begin(), order.end(), by_size);
+      std::vector<bool> is_ordered(buffers.size(), false);
+      std::vector<int> breadth_order;
+      for (int node : nodes) {
+        for (int i : order) {
+          if (!is_ordered[i] && buffers[i].first_node <= node &&
+              node <= buffers[i].last_node) {
+            is_ordered[i] = true;
+            breadth_order.push_back(i);
+          }
+        }
+      }
+      order = std::move(breadth_order);
+      break;
+    }
+    case ArenaPlanStrategy::kGreedyBySizeTimesLifetime:
+      std::stable_sort(order.begin(), order.end(), [&](int i, int j) {
+        return buffers[i].size * lifetime(i) > buffers[j].size * lifetime(j);
+      });
+      break;
+    case ArenaPlanStrategy::kGreedyByLifetime:
+      std::stable_sort(order.begin(), order.end(), [&](int i, int j) {
+        if (lifetime(i) != lifetime(j)) {
+          return lifetime(i) > lifetime(j);
+        }
+        return by_size(i, j);
+      });
+      break;
+  }
+  return order;
+}
+
+// Computes the arena buffers of a prepared subgraph, with the same lifetimes
+// as the interpreter's ArenaPlanner, and returns the tensor of each buffer in
+// `tensors`.
+std::vector<ArenaBuffer> CreateArenaBuffers(Subgraph* subgraph,
+                                            std::vector<int>* tensors) {
+  const int kNotAssigned = -1;
+  const std::vector<int>& execution_plan = subgraph->execution_plan();
+  const int num_nodes = execution_plan.size();
+  std::vector<int> first_node(subgraph->tensors_size(), kNotAssigned);
+  std::vector<int> last_node(subgraph->tensors_size(), kNotAssigned);
+  std::vector<int> refcounts(subgraph->tensors_size(), 0);
+
+  // Graph inputs, outputs and variables are never overwritten.
+  for (int tensor_index : subgraph->outputs()) {
+    refcounts[tensor_index]++;
+  }
+  for (int tensor_index : subgraph->inputs()) {
+    if (tensor_index != kTfLiteOptionalTensor) {
+      refcounts[tensor_index]++;
+      first_node[tensor_index] = 0;
+    }
+  }
+  for (int tensor_index : subgraph->variables()) {
+    refcounts[tensor_index]++;
+    first_node[tensor_index] = 0;
+  }
+  for (int node_index : execution_plan) {
+    const TfLiteNode& node = subgraph->node_and_registration(node_index)->first;
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index != kTfLiteOptionalTensor) {
+        refcounts[tensor_index]++;
+      }
+    }
+  }
+  for (int i = 0; i < num_nodes; ++i) {
+    const TfLiteNode& node =
+        subgraph->node_and_registration(execution_plan[i])->first;
+    for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+      if (first_node[tensor_index] == kNotAssigned) {
+        first_node[tensor_index] = i;
+      }
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.temporaries)) {
+      first_node[tensor_index] = i;
+      last_node[tensor_index] = i;
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index != kTfLiteOptionalTensor &&
+          --refcounts[tensor_index] == 0 &&
+          first_node[tensor_index] != kNotAssigned) {
+        last_node[tensor_index] = i;
+      }
+    }
+  }
+
+  std::vector<ArenaBuffer> buffers;
+  tensors->clear();
+  for (int i = 0; i < static_cast<int>(subgraph->tensors_size()); ++i) {
+    const TfLiteTensor* tensor = subgraph->tensor(i);
+    if (tensor->allocation_type != kTfLiteArenaRw ||
+        first_node[i] == kNotAssigned || tensor->bytes == 0) {
+      continue;
+    }
+    const int last = last_node[i] == kNotAssigned
+                         ? std::max(num_nodes - 1, first_node[i])
+                         : last_node[i];
+    buffers.push_back({tensor->bytes, first_node[i], last});
+    tensors->push_back(i);
+  }
+  return buffers;
+}
+
+}  // namespace
+
+ArenaPlan PlanArena(const std::vector<ArenaBuffer>& buffers, size_t alignment,
+                    ArenaPlanStrategy strategy) {
+  ArenaPlan plan;
+  plan.strategy = strategy;
+  plan.offsets.assign(buffers.size(), 0);
+
+  // Placed buffers, ordered by offset.
+  std::vector<int> placed;
+  for (int i : CreatePlacementOrder(buffers, strategy)) {
+    const ArenaBuffer& buffer = buffers[i];
+    // Find the smallest gap between buffers in use at the same time that fits
+    // the buffer, or place it after all of them.
+    size_t current_offset = 0;
+    size_t best_offset = std::numeric_limits<size_t>::max();
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    for (int j : placed) {
+      if (!LifetimesOverlap(buffer, buffers[j])) {
+        continue;
+      }
+      const size_t aligned_offset = AlignTo(alignment, current_offset);
+      if (aligned_offset + buffer.size <= plan.offsets[j] &&
+          plan.offsets[j] - aligned_offset < best_gap) {
+        best_offset = aligned_offset;
+        best_gap = plan.offsets[j] - aligned_offset;
+      }
+      current_offset =
+          std::max(current_offset, plan.offsets[j] + buffers[j].size);
+    }
+    if (best_offset == std::numeric_limits<size_t>::max()) {
+      best_offset = AlignTo(alignment, current_offset);
+    }
+
+    plan.offsets[i] = best_offset;
+    plan.arena_size = std::max(plan.arena_size, best_offset + buffer.size);
+    placed.insert(std::upper_bound(placed.begin(), placed.end(), best_offset,
+                                   [&plan](size_t offset, int j) {
+                                     return offset < plan.offsets[j];
+                                   }),
+                  i);
+  }
+  return plan;
+}
+
+ArenaPlan PlanArena(const std::vector<ArenaBuffer>& buffers, size_t alignment) {
+  ArenaPlan best_plan;
+  best_plan.arena_size = std::numeric_limits<size_t>::max();
+  for (ArenaPlanStrategy strategy :
+       {ArenaPlanStrategy::kGreedyBySize, ArenaPlanStrategy::kGreedyByBreadth,
+        ArenaPlanStrategy::kGreedyBySizeTimesLifetime,
+        ArenaPlanStrategy::kGreedyByLifetime}) {
+    ArenaPlan plan = PlanArena(buffers, alignment, strategy);
+    if (plan.arena_size < best_plan.arena_size) {
+      best_plan = std::move(plan);
+    }
+  }
+  return best_plan;
+}
+
+TfLiteStatus PlanModelMemory(const FlatBufferModel& model,
+                             std::vector<SubgraphMemoryPlan>* plans,
+                             ErrorReporter* error_reporter) {
+  ops::builtin::BuiltinOpResolver resolver;
+  std::unique_ptr<Interpreter> interpreter;
+  if (InterpreterBuilder(model, resolver, error_reporter)(&interpreter) !=
+      kTfLiteOk) {
+    TF_LITE_REPORT_ERROR(error_reporter, "Failed to build the interpreter.");
+    return kTfLiteError;
+  }
+
+  plans->clear();
+  for (int i = 0; i < static_cast<int>(interpreter->subgraphs_size()); ++i) {
+    // Allocating each subgraph directly, rather than through the interpreter,
+    // leaves the graph undelegated.
+    Subgraph* subgraph = interpreter->subgraph(i);
+    if (subgraph->AllocateTensors() != kTfLiteOk) {
+      TF_LITE_REPORT_ERROR(error_reporter,
+                           "Failed to allocate tensors of subgraph %d.", i);
+      return kTfLiteError;
+    }
+
+    std::vector<int> tensors;
+    const std::vector<ArenaBuffer> buffers =
+        CreateArenaBuffers(subgraph, &tensors);
+    const ArenaPlan plan = PlanArena(buffers, kDefaultTensorAlignment);
+
+    SubgraphMemoryPlan subgraph_plan;
+    subgraph_plan.runtime_arena_size =
+        PlanArena(buffers, kDefaultTensorAlignment,
+                  ArenaPlanStrategy::kGreedyBySize)
+            .arena_size;
+    subgraph_plan.offline_arena_size = plan.arena_size;
+    // Tensors added by kernels, e.g. temporaries, are planned at runtime in
+    // the gaps left for them.
+    subgraph_plan.offsets.assign(
+        model.GetModel()->subgraphs()->Get(i)->tensors()->size(), -1);
+    for (size_t j = 0; j < tensors.size(); ++j) {
+      if (tensors[j] < static_cast<int>(subgraph_plan.offsets.size())) {
+        subgraph_plan.offsets[tensors[j]] = plan.offsets[j];
+      }
+    }
+    plans->push_back(std::move(subgraph_plan));
+  }
+  return kTfLiteOk;
+}
+
+void SetOfflineMemoryAllocation(int subgraph_index,
+                                const std::vector<int32_t>& offsets,
+                                ModelT* model) {
+  std::vector<int32_t> values = {kOfflineMemoryAllocationVersion,
+                                 subgraph_index,
+                                 static_cast<int32_t>(offsets.size())};
+  values.insert(values.end(), offsets.begin(), offsets.end());
+  std::vector<uint8_t> data(values.size() * sizeof(int32_t));
+  std::memcpy(data.data(), values.data(), data.size());
+
+  for (const auto& metadata : model->metadata) {
+    if (metadata->name != kOfflineMemoryAllocationMetadata ||
+        metadata->buffer >= model->buffers.size()) {
+      continue;
+    }
+    std::vector<uint8_t>& previous_data =
+        model->buffers[metadata->buffer]->data;
+    int32_t previous_subgraph_index;
+    if (previous_data.size() >=
+        kOfflineMemoryAllocationHeaderSize * sizeof(int32_t)) {
+      std::memcpy(&previous_subgraph_index,
+                  previous_data.data() + sizeof(int32_t), sizeof(int32_t));
+      if (previous_subgraph_index == subgraph_index) {
+        previous_data = std::move(data);
+        return;
+      }
+    }
+  }
+
+  auto buffer = absl::make_unique<BufferT>();
+  buffer->data = std::move(data);
+  model->buffers.push_back(std::move(buffer));
+  auto metadata = absl::make_unique<MetadataT>();
+  metadata->name = kOfflineMemoryAllocationMetadata;
+  metadata->buffer = model->buffers.size() - 1;
+  model->metadata.push_back(std::move(metadata));
+}
+
+TfLiteStatus AddOfflineMemoryAllocation(const string& input_file,
+                                        const string& output_file,
+                                        ErrorReporter* error_reporter) {
+  std::unique_ptr<FlatBufferModel> model =
+      FlatBufferModel::BuildFromFile(input_file.c_str(), error_reporter);
+  if (!model) {
+    TF_LITE_REPORT_ERROR(error_reporter, "Failed to load model %s.",
+                         input_file.c_str());
+    return kTfLiteError;
+  }
+  std::vector<SubgraphMemoryPlan> plans;
+  TF_LITE_ENSURE_STATUS(PlanModelMemory(*model, &plans, error_reporter));
+
+  ModelT mutable_model;
+  model->GetModel()->UnPackTo(&mutable_model, nullptr);
+  for (size_t i = 0; i < plans.size(); ++i) {
+    SetOfflineMemoryAllocation(i, plans[i].offsets, &mutable_model);
+  }
+  flatbuffers::FlatBufferBuilder builder;
+  FinishModelBuffer(builder, Model::Pack(builder, &mutable_model));
+
+  std::ofstream stream(output_file, std::ios::binary | std::ios::out);
+  stream.write(reinterpret_cast<const char*>(builder.GetBufferPointer()),
+               builder.GetSize());
+  if (!stream) {
+    TF_LITE_REPORT_ERROR(error_reporter, "Failed to write model %s.",
+                         output_file.c_str());
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+}  // namespace optimize
+}  // namespace tflite
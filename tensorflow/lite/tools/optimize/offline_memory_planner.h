@@ -0,0 +1,106 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_TOOLS_OPTIMIZE_OFFLINE_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_TOOLS_OPTIMIZE_OFFLINE_MEMORY_PLANNER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/core/api/offline_memory_allocation.h"
+#include "tensorflow/lite/model.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+namespace optimize {
+
+// A buffer to place in the arena, used from the execution of node `first_node`
+// to the execution of node `last_node`, both inclusive.
+struct ArenaBuffer {
+  size_t size;
+  int first_node;
+  int last_node;
+};
+
+// Order in which buffers are placed in the arena. Each buffer is placed in the
+// smallest gap between the buffers placed before it, and used at the same
+// time, that fits it.
+enum class ArenaPlanStrategy {
+  // Largest buffers first, which is what the interpreter does at runtime.
+  kGreedyBySize,
+  // Buffers used by the nodes with the most memory in use first, largest
+  // buffers first within each node.
+  kGreedyByBreadth,
+  // Buffers with the largest product of size and lifetime first.
+  kGreedyBySizeTimesLifetime,
+  // Longest-lived buffers first.
+  kGreedyByLifetime,
+};
+
+struct ArenaPlan {
+  ArenaPlanStrategy strategy = ArenaPlanStrategy::kGreedyBySize;
+  // Offset of each buffer in the arena.
+  std::vector<size_t> offsets;
+  // Size of the arena required by the plan.
+  size_t arena_size = 0;
+};
+
+// Places buffers with offsets aligned to `alignment` using the given strategy.
+ArenaPlan PlanArena(const std::vector<ArenaBuffer>& buffers, size_t alignment,
+                    ArenaPlanStrategy strategy);
+
+// Returns the plan requiring the smallest arena of all strategies.
+ArenaPlan PlanArena(const std::vector<ArenaBuffer>& buffers, size_t alignment);
+
+struct SubgraphMemoryPlan {
+  // Offline planned arena offset of each tensor of the subgraph, or -1 for
+  // tensors outside of the non-persistent arena.
+  std::vector<int32_t> offsets;
+  // Arena size required when planning at runtime, and with the offline plan.
+  size_t runtime_arena_size = 0;
+  size_t offline_arena_size = 0;
+};
+
+// Plans the non-persistent arena of each subgraph of the model offline, using
+// the tensor sizes of the model with builtin ops and without delegates.
+// Tensors of dynamic size, and tensors added by kernels, are left to the
+// runtime.
+//
+// Note: This is a private API, subject to change.
+TfLiteStatus PlanModelMemory(const FlatBufferModel& model,
+                             std::vector<SubgraphMemoryPlan>* plans,
+                             ErrorReporter* error_reporter);
+
+// Stores the arena offsets of the given subgraph in the model metadata,
+// replacing the previous offsets of that subgraph, if any.
+//
+// Note: This is a private API, subject to change.
+void SetOfflineMemoryAllocation(int subgraph_index,
+                                const std::vector<int32_t>& offsets,
+                                ModelT* model);
+
+// Same as above but plans and stores the offsets of all subgraphs of the model
+// at `input_file`, and writes the result to `output_file`.
+//
+// Note: This is a private API, subject to change.
+TfLiteStatus AddOfflineMemoryAllocation(const string& input_file,
+                                        const string& output_file,
+                                        ErrorReporter* error_reporter);
+
+}  // namespace optimize
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_TOOLS_OPTIMIZE_OFFLINE_MEMORY_PLANNER_H_
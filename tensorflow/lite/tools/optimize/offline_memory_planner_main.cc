@@ -0,0 +1,83 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/lite/model.h"
+#include "tensorflow/lite/stderr_reporter.h"
+#include "tensorflow/lite/tools/optimize/offline_memory_planner.h"
+
+namespace {
+
+// Prints the arena sizes required with runtime and offline planning for each
+// subgraph of each model.
+int Report(int num_models, char** model_files) {
+  tflite::StderrReporter error_reporter;
+  printf("%-40s %8s %14s %14s %8s\n", "model", "subgraph", "runtime bytes",
+         "offline bytes", "saving");
+  for (int i = 0; i < num_models; ++i) {
+    std::unique_ptr<tflite::FlatBufferModel> model =
+        tflite::FlatBufferModel::BuildFromFile(model_files[i],
+                                               &error_reporter);
+    std::vector<tflite::optimize::SubgraphMemoryPlan> plans;
+    if (!model || tflite::optimize::PlanModelMemory(*model, &plans,
+                                                    &error_reporter) !=
+                      kTfLiteOk) {
+      printf("%-40s failed to plan\n", model_files[i]);
+      continue;
+    }
+    for (size_t j = 0; j < plans.size(); ++j) {
+      const double saving =
+          plans[j].runtime_arena_size == 0
+              ? 0.0
+              : 100.0 * (plans[j].runtime_arena_size -
+                         plans[j].offline_arena_size) /
+                    plans[j].runtime_arena_size;
+      printf("%-40s %8zu %14zu %14zu %7.1f%%\n", model_files[i], j,
+             plans[j].runtime_arena_size, plans[j].offline_arena_size, saving);
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+// Plans the non-persistent arena of a model offline, and stores the offsets in
+// the model metadata, from which the interpreter reads them.
+//
+// Note: This is a private API, subject to change.
+int main(int argc, char** argv) {
+  if (argc >= 3 && !strcmp(argv[1], "--report")) {
+    return Report(argc - 2, argv + 2);
+  }
+  if (argc != 3) {
+    printf(
+        "Wrong number of arguments. Example: offline_memory_planner_main "
+        "${input} ${output}\n"
+        "or, to compare arena sizes without writing models: "
+        "offline_memory_planner_main --report ${model} [${model}...]\n");
+    return 1;
+  }
+
+  tflite::StderrReporter error_reporter;
+  if (tflite::optimize::AddOfflineMemoryAllocation(argv[1], argv[2],
+                                                   &error_reporter) !=
+      kTfLiteOk) {
+    return 1;
+  }
+  return 0;
+}
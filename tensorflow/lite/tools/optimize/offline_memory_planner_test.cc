@@ -0,0 +1,194 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/tools/optimize/offline_memory_planner.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "flatbuffers/flatbuffers.h"  // from @flatbuffers
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/util/command_line_flags.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "tensorflow/lite/stderr_reporter.h"
+#include "tensorflow/lite/tools/optimize/test_util.h"
+
+namespace {
+tensorflow::string* g_test_model_dir = nullptr;
+}  // namespace
+
+namespace tflite {
+namespace optimize {
+namespace {
+
+std::unique_ptr<FlatBufferModel> ReadModel(const string& model_name) {
+  auto model_path = tensorflow::io::JoinPath(*g_test_model_dir, model_name);
+  return FlatBufferModel::BuildFromFile(model_path.c_str());
+}
+
+// Returns true if no two buffers used at the same time overlap in the arena.
+bool IsValidPlan(const std::vector<ArenaBuffer>& buffers,
+                 const ArenaPlan& plan) {
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    for (size_t j = i + 1; j < buffers.size(); ++j) {
+      if (buffers[i].first_node <= buffers[j].last_node &&
+          buffers[j].first_node <= buffers[i].last_node &&
+          plan.offsets[i] < plan.offsets[j] + buffers[j].size &&
+          plan.offsets[j] < plan.offsets[i] + buffers[i].size) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+TEST(OfflineMemoryPlannerTest, PlanArena) {
+  const std::vector<ArenaBuffer> buffers = {
+      {16, 2, 4}, {16, 3, 4}, {12, 3, 3}, {24, 2, 2}};
+  for (ArenaPlanStrategy strategy :
+       {ArenaPlanStrategy::kGreedyBySize, ArenaPlanStrategy::kGreedyByBreadth,
+        ArenaPlanStrategy::kGreedyBySizeTimesLifetime,
+        ArenaPlanStrategy::kGreedyByLifetime}) {
+    const ArenaPlan plan = PlanArena(buffers, /*alignment=*/4, strategy);
+    EXPECT_TRUE(IsValidPlan(buffers, plan));
+    for (size_t offset : plan.offsets) {
+      EXPECT_EQ(offset % 4, 0);
+    }
+  }
+
+  // Placing the largest buffer first leaves a gap too small for the 12 byte
+  // buffer, which placing the buffers used by node 3 first avoids.
+  EXPECT_EQ(
+      PlanArena(buffers, /*alignment=*/4, ArenaPlanStrategy::kGreedyBySize)
+          .arena_size,
+      52);
+  const ArenaPlan best_plan = PlanArena(buffers, /*alignment=*/4);
+  EXPECT_EQ(best_plan.arena_size, 44);
+  EXPECT_EQ(best_plan.strategy, ArenaPlanStrategy::kGreedyByBreadth);
+}
+
+TEST(OfflineMemoryPlannerTest, SetOfflineMemoryAllocation) {
+  ModelT model;
+  SetOfflineMemoryAllocation(0, {0, -1, 64}, &model);
+  SetOfflineMemoryAllocation(1, {-1}, &model);
+  SetOfflineMemoryAllocation(0, {128, 0, -1}, &model);
+
+  ASSERT_EQ(model.metadata.size(), 2);
+  ASSERT_EQ(model.buffers.size(), 2);
+  EXPECT_EQ(model.metadata[0]->name, kOfflineMemoryAllocationMetadata);
+  const std::vector<uint8_t>& data =
+      model.buffers[model.metadata[0]->buffer]->data;
+  std::vector<int32_t> values(data.size() / sizeof(int32_t));
+  std::memcpy(values.data(), data.data(), data.size());
+  EXPECT_THAT(values, testing::ElementsAre(0, 0, 3, 128, 0, -1));
+}
+
+TEST(OfflineMemoryPlannerTest, PlanModelMemory) {
+  std::unique_ptr<FlatBufferModel> model =
+      ReadModel(internal::kMultiInputAddWithReshape);
+  ASSERT_TRUE(model);
+  StderrReporter error_reporter;
+  std::vector<SubgraphMemoryPlan> plans;
+  ASSERT_EQ(PlanModelMemory(*model, &plans, &error_reporter), kTfLiteOk);
+  ASSERT_EQ(plans.size(), model->GetModel()->subgraphs()->size());
+  EXPECT_EQ(plans[0].offsets.size(),
+            model->GetModel()->subgraphs()->Get(0)->tensors()->size());
+  EXPECT_LE(plans[0].offline_arena_size, plans[0].runtime_arena_size);
+
+  // The interpreter places tensors at the offsets stored in the model.
+  ModelT mutable_model;
+  model->GetModel()->UnPackTo(&mutable_model, nullptr);
+  SetOfflineMemoryAllocation(0, plans[0].offsets, &mutable_model);
+  flatbuffers::FlatBufferBuilder builder;
+  FinishModelBuffer(builder, Model::Pack(builder, &mutable_model));
+  std::unique_ptr<FlatBufferModel> planned_model =
+      FlatBufferModel::BuildFromBuffer(
+          reinterpret_cast<const char*>(builder.GetBufferPointer()),
+          builder.GetSize());
+  ASSERT_TRUE(planned_model);
+
+  ops::builtin::BuiltinOpResolver resolver;
+  std::unique_ptr<Interpreter> interpreter;
+  ASSERT_EQ(InterpreterBuilder(*planned_model, resolver)(&interpreter),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter->subgraph(0)->AllocateTensors(), kTfLiteOk);
+  const char* base = nullptr;
+  for (size_t i = 0; i < plans[0].offsets.size(); ++i) {
+    if (plans[0].offsets[i] == 0) {
+      base = interpreter->tensor(i)->data.raw;
+    }
+  }
+  ASSERT_NE(base, nullptr);
+  for (size_t i = 0; i < plans[0].offsets.size(); ++i) {
+    if (plans[0].offsets[i] >= 0) {
+      EXPECT_EQ(interpreter->tensor(i)->data.raw - base, plans[0].offsets[i])
+          << "tensor " << i;
+    }
+  }
+}
+
+TEST(OfflineMemoryPlannerTest, MismatchedPlanIsIgnored) {
+  std::unique_ptr<FlatBufferModel> model =
+      ReadModel(internal::kMultiInputAddWithReshape);
+  ASSERT_TRUE(model);
+
+  // A plan with fewer offsets than the subgraph has tensors, e.g. one written
+  // for a different version of the model, is ignored when loading the model.
+  ModelT mutable_model;
+  model->GetModel()->UnPackTo(&mutable_model, nullptr);
+  SetOfflineMemoryAllocation(0, {0}, &mutable_model);
+  flatbuffers::FlatBufferBuilder builder;
+  FinishModelBuffer(builder, Model::Pack(builder, &mutable_model));
+  std::unique_ptr<FlatBufferModel> planned_model =
+      FlatBufferModel::BuildFromBuffer(
+          reinterpret_cast<const char*>(builder.GetBufferPointer()),
+          builder.GetSize());
+  ASSERT_TRUE(planned_model);
+
+  ops::builtin::BuiltinOpResolver resolver;
+  std::unique_ptr<Interpreter> interpreter;
+  ASSERT_EQ(InterpreterBuilder(*planned_model, resolver)(&interpreter),
+            kTfLiteOk);
+  EXPECT_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+}
+
+}  // namespace
+}  // namespace optimize
+}  // namespace tflite
+
+int main(int argc, char** argv) {
+  tensorflow::string model_file;
+  const std::vector<tensorflow::Flag> flag_list = {
+      tensorflow::Flag("test_model_file", &model_file,
+                       "Path to test tflite model file."),
+  };
+
+  const bool parse_result = tensorflow::Flags::Parse(&argc, argv, flag_list);
+  if (!parse_result) {
+    std::cerr << "Required test_model_file\n";
+    std::abort();
+  }
+  g_test_model_dir =
+      new tensorflow::string(tensorflow::io::Dirname(model_file));
+  ::tensorflow::port::InitMain(argv[0], &argc, &argv);
+  return RUN_ALL_TESTS();
+}
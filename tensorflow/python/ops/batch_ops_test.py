@@ -324,6 +324,108 @@ class BatchOpsTest(test.TestCase):
       self.assertEqual(thread_results[0], [2])
       self.assertEqual(main_results[0], [3])
 
+  def testBatchFunctionOpWithPaddingAndWideOutputs(self):
+    """Tests batch_function outputs that are slices of the batched output."""
+    if context.executing_eagerly():
+      return
+    with self.cached_session() as sess:
+      # Rows of 16 floats keep each request's slice of the batched output
+      # aligned, so that it is handed out without a copy.
+      inp = array_ops.placeholder(dtype=dtypes.float32, shape=[1, 16])
+
+      @function.Defun(dtypes.float32)
+      def computation(in_t):
+        return in_t * 2
+
+      result = gen_batch_ops.batch_function(
+          [inp],
+          num_batch_threads=1,
+          max_batch_size=10,
+          batch_timeout_micros=100000,  # 100ms
+          allowed_batch_sizes=[3, 10],
+          Tout=[dtypes.float32],
+          f=computation,
+          captured_tensors=computation.captured_inputs)
+      thread_results = []
+
+      def worker():
+        thread_results.extend(
+            sess.run([result], feed_dict={inp: [[1.0] * 16]}))
+
+      worker_thread = threading.Thread(target=worker)
+      worker_thread.start()
+      main_results = sess.run([result], feed_dict={inp: [[2.0] * 16]})
+      worker_thread.join()
+      self.assertAllEqual(thread_results[0], [[2.0] * 16])
+      self.assertAllEqual(main_results[0], [[4.0] * 16])
+
+  def testBatchFunctionOpReusesLargeBatchInputs(self):
+    """Tests that pooled batch input buffers don't corrupt earlier results."""
+    if context.executing_eagerly():
+      return
+    with self.cached_session() as sess:
+      # Batches of two rows of 64Ki floats take 512KiB, which is large enough
+      # for the batch input buffer to be pooled and reused across batches.
+      row_size = 64 << 10
+      inp = array_ops.placeholder(dtype=dtypes.float32, shape=[1, row_size])
+
+      @function.Defun(dtypes.float32)
+      def computation(in_t):
+        # The output may alias the batch input buffer, so reusing that buffer
+        # while an earlier output is alive would overwrite it.
+        return array_ops.identity(in_t)
+
+      result, = gen_batch_ops.batch_function(
+          [inp],
+          num_batch_threads=1,
+          max_batch_size=2,
+          batch_timeout_micros=100000,  # 100ms
+          allowed_batch_sizes=[2],
+          Tout=[dtypes.float32],
+          f=computation,
+          captured_tensors=computation.captured_inputs)
+      num_rounds = 5
+      thread_results = []
+      main_results = []
+
+      def worker(value):
+        thread_results.append(
+            sess.run(result, feed_dict={inp: np.full([1, row_size], value)}))
+
+      for i in range(num_rounds):
+        worker_thread = threading.Thread(target=worker, args=(2 * i,))
+        worker_thread.start()
+        main_input = np.full([1, row_size], 2 * i + 1)
+        main_results.append(sess.run(result, feed_dict={inp: main_input}))
+        worker_thread.join()
+      for i in range(num_rounds):
+        self.assertAllEqual(thread_results[i], np.full([1, row_size], 2 * i))
+        self.assertAllEqual(main_results[i], np.full([1, row_size], 2 * i + 1))
+
+  def testBatchFunctionOpWithSingleTaskAndNoPadding(self):
+    """Tests a batch made of a single task, whose input is passed through."""
+    if context.executing_eagerly():
+      return
+    with self.cached_session() as sess:
+      inp = array_ops.placeholder(dtype=dtypes.float32, shape=[None, 16])
+
+      @function.Defun(dtypes.float32)
+      def computation(in_t):
+        return in_t * 2
+
+      result, = gen_batch_ops.batch_function(
+          [inp],
+          num_batch_threads=1,
+          max_batch_size=10,
+          batch_timeout_micros=0,
+          Tout=[dtypes.float32],
+          f=computation,
+          captured_tensors=computation.captured_inputs)
+      first = np.arange(2 * 16, dtype=np.float32).reshape([2, 16])
+      second = np.arange(3 * 16, dtype=np.float32).reshape([3, 16]) + 100
+      self.assertAllEqual(sess.run(result, feed_dict={inp: first}), first * 2)
+      self.assertAllEqual(sess.run(result, feed_dict={inp: second}), second * 2)
+
   def testBatchFunctionOpWithInputError(self):
     """Tests that batch_function op works with error in the inputs."""
     if context.executing_eagerly():